@@ -5,7 +5,7 @@
  *
  * Generator: C/C++
  * Specification: gl
- * Extensions: 0
+ * Extensions: 2
  *
  * APIs:
  *  - gl:core=4.6
@@ -19,10 +19,10 @@
  *  - ON_DEMAND = False
  *
  * Commandline:
- *    --api='gl:core=4.6' --extensions='' c
+ *    --api='gl:core=4.6' --extensions='GL_ARB_get_program_binary,GL_ARB_separate_shader_objects' c
  *
  * Online:
- *    http://glad.sh/#api=gl%3Acore%3D4.6&extensions=&generator=c&options=
+ *    http://glad.sh/#api=gl%3Acore%3D4.6&extensions=GL_ARB_get_program_binary%2CGL_ARB_separate_shader_objects&generator=c&options=
  *
  */
 
@@ -1647,6 +1647,10 @@ GLAD_API_CALL int GLAD_GL_VERSION_4_4;
 GLAD_API_CALL int GLAD_GL_VERSION_4_5;
 #define GL_VERSION_4_6 1
 GLAD_API_CALL int GLAD_GL_VERSION_4_6;
+#define GL_ARB_get_program_binary 1
+GLAD_API_CALL int GLAD_GL_ARB_get_program_binary;
+#define GL_ARB_separate_shader_objects 1
+GLAD_API_CALL int GLAD_GL_ARB_separate_shader_objects;
 
 
 typedef void (GLAD_API_PTR *PFNGLACTIVESHADERPROGRAMPROC)(GLuint pipeline, GLuint program);
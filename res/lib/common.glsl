@@ -0,0 +1,222 @@
+#version 330 core
+
+// Engine provided function library. This is compiled once and linked into every wallpaper program, so
+// wallpapers only need to declare the prototypes of the functions they use. Everything is prefixed with
+// "lib" so it can't clash with functions a wallpaper defines itself.
+
+// ---------------------------------------------------------------------------------------------------
+// Hashing
+// ---------------------------------------------------------------------------------------------------
+
+float libMod289(float x) { return x - floor(x * (1.0 / 289.0)) * 289.0; }
+vec4 libMod289(vec4 x) { return x - floor(x * (1.0 / 289.0)) * 289.0; }
+vec4 libPerm(vec4 x) { return libMod289(((x * 34.0) + 1.0) * x); }
+
+// Hashes returning values in [0, 1), named hash<outputs><inputs>
+float libHash11(float p) {
+    p = fract(p * 0.1031);
+    p *= p + 33.33;
+    p *= p + p;
+    return fract(p);
+}
+
+float libHash12(vec2 p) {
+    vec3 p3 = fract(vec3(p.xyx) * 0.1031);
+    p3 += dot(p3, p3.yzx + 33.33);
+    return fract((p3.x + p3.y) * p3.z);
+}
+
+vec2 libHash22(vec2 p) {
+    vec3 p3 = fract(vec3(p.xyx) * vec3(0.1031, 0.1030, 0.0973));
+    p3 += dot(p3, p3.yzx + 33.33);
+    return fract((p3.xx + p3.yz) * p3.zy);
+}
+
+vec3 libHash33(vec3 p) {
+    p = fract(p * vec3(0.1031, 0.1030, 0.0973));
+    p += dot(p, p.yxz + 33.33);
+    return fract((p.xxy + p.yxx) * p.zyx);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Noise
+// ---------------------------------------------------------------------------------------------------
+
+// 3D value noise built on the mod289 permutation polynomial, in [0, 1]
+float libNoise(vec3 p) {
+    vec3 a = floor(p);
+    vec3 d = p - a;
+    d = d * d * (3.0 - 2.0 * d);
+
+    vec4 b = a.xxyy + vec4(0.0, 1.0, 0.0, 1.0);
+    vec4 k1 = libPerm(b.xyxy);
+    vec4 k2 = libPerm(k1.xyxy + b.zzww);
+
+    vec4 c = k2 + a.zzzz;
+    vec4 k3 = libPerm(c);
+    vec4 k4 = libPerm(c + 1.0);
+
+    vec4 o1 = fract(k3 * (1.0 / 41.0));
+    vec4 o2 = fract(k4 * (1.0 / 41.0));
+
+    vec4 o3 = o2 * d.z + o1 * (1.0 - d.z);
+    vec2 o4 = o3.yw * d.x + o3.xz * (1.0 - d.x);
+
+    return o4.y * d.y + o4.x * (1.0 - d.y);
+}
+
+// 2D value noise in [0, 1]
+float libNoise(vec2 p) {
+    vec2 i = floor(p);
+    vec2 f = fract(p);
+    vec2 u = f * f * (3.0 - 2.0 * f);
+    return mix(mix(libHash12(i), libHash12(i + vec2(1.0, 0.0)), u.x),
+               mix(libHash12(i + vec2(0.0, 1.0)), libHash12(i + vec2(1.0, 1.0)), u.x), u.y);
+}
+
+// Fractal brownian motion over 2D value noise, octaves is clamped to 8
+float libFbm(vec2 p, int octaves) {
+    float value = 0.0;
+    float amplitude = 0.5;
+    for (int i = 0; i < 8; i++) {
+        if (i >= octaves) {
+            break;
+        }
+        value += amplitude * libNoise(p);
+        p *= 2.0;
+        amplitude *= 0.5;
+    }
+    return value;
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Signed distance field primitives
+// ---------------------------------------------------------------------------------------------------
+
+float libSdSphere(vec3 p, float radius) {
+    return length(p) - radius;
+}
+
+float libSdBox(vec3 p, vec3 halfExtents) {
+    vec3 q = abs(p) - halfExtents;
+    return length(max(q, 0.0)) + min(max(q.x, max(q.y, q.z)), 0.0);
+}
+
+float libSdTorus(vec3 p, vec2 radii) {
+    vec2 q = vec2(length(p.xz) - radii.x, p.y);
+    return length(q) - radii.y;
+}
+
+float libSdCapsule(vec3 p, vec3 a, vec3 b, float radius) {
+    vec3 pa = p - a;
+    vec3 ba = b - a;
+    float h = clamp(dot(pa, ba) / dot(ba, ba), 0.0, 1.0);
+    return length(pa - ba * h) - radius;
+}
+
+float libSdCircle(vec2 p, float radius) {
+    return length(p) - radius;
+}
+
+float libSdBox2(vec2 p, vec2 halfExtents) {
+    vec2 d = abs(p) - halfExtents;
+    return length(max(d, 0.0)) + min(max(d.x, d.y), 0.0);
+}
+
+// Polynomial smooth minimum, k is the blend radius
+float libSmoothMin(float a, float b, float k) {
+    float h = clamp(0.5 + 0.5 * (b - a) / k, 0.0, 1.0);
+    return mix(b, a, h) - k * h * (1.0 - h);
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Colour
+// ---------------------------------------------------------------------------------------------------
+
+vec3 libHsvToRgb(vec3 c) {
+    vec3 rgb = clamp(abs(mod(c.x * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
+    return c.z * mix(vec3(1.0), rgb, c.y);
+}
+
+vec3 libRgbToHsv(vec3 c) {
+    vec4 k = vec4(0.0, -1.0 / 3.0, 2.0 / 3.0, -1.0);
+    vec4 p = mix(vec4(c.bg, k.wz), vec4(c.gb, k.xy), step(c.b, c.g));
+    vec4 q = mix(vec4(p.xyw, c.r), vec4(c.r, p.yzx), step(p.x, c.r));
+    float d = q.x - min(q.w, q.y);
+    float e = 1.0e-10;
+    return vec3(abs(q.z + (q.w - q.y) / (6.0 * d + e)), d / (q.x + e), q.x);
+}
+
+// Cosine gradient palette, a + b * cos(2pi * (c * t + d))
+vec3 libPalette(float t, vec3 a, vec3 b, vec3 c, vec3 d) {
+    return a + b * cos(6.28318530718 * (c * t + d));
+}
+
+vec3 libSrgbToLinear(vec3 c) {
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+}
+
+vec3 libLinearToSrgb(vec3 c) {
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, c));
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Virtual textures
+// ---------------------------------------------------------------------------------------------------
+
+// Must match VIRTUAL_TILE_SIZE and VIRTUAL_TILE_BORDER in the engine
+const float LIB_VIRTUAL_TILE_SIZE = 128.0;
+const float LIB_VIRTUAL_TILE_BORDER = 1.0;
+
+// Set by the engine, negative during the low resolution feedback pass so tiles are requested for the level
+// the full resolution frame needs
+uniform float iVirtualLodBias;
+
+// The tile the pixel last sampled, read back by the engine to decide what to stream in. Nothing is drawn to
+// this output outside the feedback pass.
+layout(location = 1) out vec4 libVirtualFeedback;
+
+// Sample a virtual texture declared in the metadata as libVirtualTexture(name, nameTable, nameInfo, uv). Uses
+// screen space derivatives to pick a level, so call it outside non uniform control flow. UVs are clamped.
+vec4 libVirtualTexture(sampler2D pages, sampler2D table, vec4 info, vec2 uv) {
+    vec2 size = info.xy;
+    uv = clamp(uv, 0.0, 1.0);
+
+    vec2 texel = uv * size;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + iVirtualLodBias;
+    int level = clamp(int(floor(lod)), 0, int(info.z));
+
+    vec2 levelSize = max(floor(size / exp2(float(level))), vec2(1.0));
+    vec2 levelTiles = ceil(levelSize / LIB_VIRTUAL_TILE_SIZE);
+    ivec2 tile = ivec2(min(floor(uv * levelSize / LIB_VIRTUAL_TILE_SIZE), levelTiles - 1.0));
+    libVirtualFeedback = vec4(float(tile.x & 255), float(tile.y & 255), float((tile.x >> 8) | ((tile.y >> 8) << 4)),
+        float(int(info.w) * 16 + level + 1)) / 255.0;
+
+    // The table points at the tile itself or its closest resident ancestor, whose level is in b
+    ivec4 entry = ivec4(texelFetch(table, tile, level) * 255.0 + 0.5);
+    vec2 residentSize = max(floor(size / exp2(float(entry.b))), vec2(1.0));
+    vec2 residentTiles = ceil(residentSize / LIB_VIRTUAL_TILE_SIZE);
+    vec2 pixel = uv * residentSize;
+    vec2 inTile = pixel - min(floor(pixel / LIB_VIRTUAL_TILE_SIZE), residentTiles - 1.0) * LIB_VIRTUAL_TILE_SIZE;
+
+    float pageSize = LIB_VIRTUAL_TILE_SIZE + 2.0 * LIB_VIRTUAL_TILE_BORDER;
+    vec2 pageUv = (vec2(entry.rg) * pageSize + LIB_VIRTUAL_TILE_BORDER + inTile) / vec2(textureSize(pages, 0));
+    return textureLod(pages, pageUv, 0.0);
+}
+
+// Distance read from a volume baked from the wallpaper's own distance function, called as
+// libSdfVolume(iSdf, iSdfMin, iSdfMax, p). Outside the bounds the distance to them is added, which keeps marching
+// towards the volume without overstepping it.
+float libSdfVolume(sampler3D volume, vec3 boundsMin, vec3 boundsMax, vec3 p) {
+    vec3 q = clamp(p, boundsMin, boundsMax);
+    return texture(volume, (q - boundsMin) / (boundsMax - boundsMin)).r + length(p - q);
+}
+
+// Sample a sprite declared in the metadata as libAtlasTexture(name, nameRect, uv), repeating across the sprite
+// as uv goes past 0 to 1. The level is picked from the derivatives before wrapping so seams stay sharp.
+vec4 libAtlasTexture(sampler2D atlas, vec4 rect, vec2 uv) {
+    vec2 size = rect.zw - rect.xy;
+    return textureGrad(atlas, rect.xy + fract(uv) * size, dFdx(uv) * size, dFdy(uv) * size);
+}
@@ -1,5 +1,14 @@
 #version 330 core
 
+// Redeclared so the shader can also be linked as a separable program. Only where the extension is there, as the same
+// file is linked into every wallpaper program without it and strict compilers reject the block on their own.
+#ifdef GL_ARB_separate_shader_objects
+#extension GL_ARB_separate_shader_objects : enable
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+#endif
+
 vec2 vertices[6] = vec2[6](
 	vec2(-1.0, -1.0),
 	vec2(1.0, 1.0),
@@ -12,6 +12,9 @@
 #include <util/OS.hpp>
 #include <opengl/Uniform.hpp>
 
+// Watchdog stage for thumbnails of library wallpapers, which aren't on the desktop so stalling in one needs no fallback
+static const char* THUMBNAIL_STAGE = "thumbnail render";
+
 Application::Application() : mOriginalWallpaperPath(GetWallpaper())
 {
 
@@ -48,8 +51,29 @@ void Application::Run()
     }
 
     // Create our shader manager and set it to use the default shader
-    pWallpaperManager = std::make_unique<WallpaperManager>();
+    pWallpaperManager = std::make_unique<WallpaperManager>(*pWallpaperWindow);
+    pWallpaperTimer = std::make_unique<GpuTimer>();
     pWallpaperManager->TrySetWallpaper("default.wallpaper", pWallpaperWindow->GetDimensions());
+    pHotReloader = std::make_unique<HotReloader>(*pWallpaperManager);
+
+    /*
+    A draw or swap that hangs in the driver stops this whole loop, so a watchdog thread notices instead. It can't
+    use the stuck context, so all it does straight away is put the original wallpaper back and ask for the wallpaper
+    window to be hidden, which happens as soon as the loop handles window messages again. Once the loop is back the
+    wallpaper is unloaded if it was the one that stalled.
+    */
+    pFrameWatchdog = std::make_unique<FrameWatchdog>([this, wallpaperWindowHwnd](const StallIncident& incident) {
+        if (incident.stage == THUMBNAIL_STAGE) {
+            return;
+        }
+        ShowWindowAsync(wallpaperWindowHwnd, SW_HIDE);
+        SetWallpaper(mOriginalWallpaperPath);
+    });
+
+    // Index the wallpaper library in the background, only wallpapers changed since the last run are read
+    pCatalogPool = std::make_unique<ThreadPool>();
+    pCatalog = std::make_unique<WallpaperCatalog>(DEFAULT_LIBRARY_DIRECTORY, *pCatalogPool);
+    pCatalog->Refresh();
     ImGui::CreateContext();
 
     /*
@@ -63,6 +87,14 @@ void Application::Run()
     ImGui_ImplGlfw_InitForOpenGL(pImGUIWindow->GetWindow(), true);
     ImGui_ImplOpenGL3_Init("#version 330");
 
+    // Thumbnails are drawn in the control menu, so they are rendered with its context rather than the wallpaper's
+    pImGUIWindow->Bind();
+    pThumbnailWorker = std::make_unique<GLWorker>(*pImGUIWindow);
+    pThumbnailRenderer = std::make_unique<ThumbnailRenderer>(*pCatalogPool, DEFAULT_VERTEX_SHADER_PATH, DEFAULT_LIBRARY_SHADER_PATH,
+        DEFAULT_THUMBNAIL_CACHE_DIRECTORY, DEFAULT_PROGRAM_CACHE_DIRECTORY, pWallpaperManager->GetShaderSandbox(), pThumbnailWorker.get());
+    pLibraryBrowser = std::make_unique<LibraryBrowser>(*pCatalog, *pCatalogPool, pThumbnailRenderer.get());
+    pWallpaperWindow->Bind();
+
     /*
     We are rendering a fullscreen quad to our wallpaper window by hardcoding the vertices for it in the
     vertex shader. This means that no VBO or any buffer objects are required however OpenGL requires there
@@ -78,17 +110,35 @@ void Application::Run()
     */
     while (!pImGUIWindow->ShouldClose()) {
         pWallpaperWindow->Bind();
+        pHotReloader->Update(pWallpaperWindow->GetDimensions());
+        pWallpaperManager->Update(pWallpaperTimer->HasResult(), pWallpaperTimer->GetAverageMilliseconds());
+        pLibraryBrowser->Update(pCatalog->Update());
         UpdateUniforms();
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        pWallpaperWindow->SwapBuffers();
+        // A capped wallpaper skips frames, the window keeps showing the last one it presented
+        if (IsWallpaperFrameDue()) {
+            pFrameWatchdog->Begin("wallpaper draw", pWallpaperManager->GetWallpaperPath());
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            DrawWallpaper();
+            pFrameWatchdog->Begin("wallpaper swap", pWallpaperManager->GetWallpaperPath());
+            pWallpaperWindow->SwapBuffers();
+            pFrameWatchdog->End();
+            pHotReloader->OnFramePresented();
+        }
 
         ProcessImGUI();
 
         // render ImGUI window
         // -----------------------
         pImGUIWindow->Bind();
+        pThumbnailRenderer->Process();
+        // Finished here under a stage of its own, otherwise a thumbnail that hangs the GPU would hold up the control
+        // menu's swap and be blamed on the wallpaper on the desktop
+        if (!pThumbnailRenderer->GetRenderingPath().empty()) {
+            pFrameWatchdog->Begin(THUMBNAIL_STAGE, pThumbnailRenderer->GetRenderingPath());
+            pThumbnailRenderer->FinishRenders();
+            pFrameWatchdog->End();
+        }
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
@@ -100,17 +150,97 @@ void Application::Run()
 
         ImGui::End();
         ImGui::Render();
+        // A wallpaper that overloads the GPU can just as well hold up the control menu's frame
+        pFrameWatchdog->Begin("control menu swap", pWallpaperManager->GetWallpaperPath());
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         pImGUIWindow->SwapBuffers();
+        pFrameWatchdog->End();
         glfwPollEvents();
 
+        StallIncident incident{};
+        if (pFrameWatchdog->TakeStall(&incident) && pWallpaperManager->hasWallpaper &&
+            incident.wallpaperPath == pWallpaperManager->GetWallpaperPath()) {
+            pWallpaperWindow->Bind();
+            UnloadWallpaper();
+        }
+
     }
     Cleanup();
 }
 
-void Application::Cleanup() const
+bool Application::IsWallpaperFrameDue()
+{
+    int frameCap = pWallpaperManager->GetFrameCap();
+    double now = glfwGetTime();
+    if (frameCap > 0 && now - mLastWallpaperFrame < 1.0 / frameCap) {
+        return false;
+    }
+    mLastWallpaperFrame = now;
+    return true;
+}
+
+void Application::DrawWallpaper()
 {
+    /*
+    Wallpapers predicted to be too expensive are rendered into a smaller offscreen framebuffer which
+    is then stretched over the window, otherwise we draw straight to the window.
+    */
+    WindowDimensions windowDimensions = pWallpaperWindow->GetDimensions();
+    WindowDimensions renderDimensions = pWallpaperManager->GetRenderDimensions();
+    bool scaled = pWallpaperManager->GetRenderScale() < 1.0f;
+
+    pWallpaperManager->BindTextures();
+    // Virtual textures pick which tiles to stream from a small pass that records what the shader sampled
+    if (pWallpaperManager->BeginVirtualFeedback()) {
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        pWallpaperManager->EndVirtualFeedback();
+        glViewport(0, 0, windowDimensions.width, windowDimensions.height);
+    }
+
+    if (scaled) {
+        if (pWallpaperFramebuffer == nullptr) {
+            pWallpaperFramebuffer = std::make_unique<Framebuffer>(renderDimensions.width, renderDimensions.height);
+        }
+        pWallpaperFramebuffer->Resize(renderDimensions.width, renderDimensions.height);
+        pWallpaperFramebuffer->Bind();
+        glViewport(0, 0, renderDimensions.width, renderDimensions.height);
+    }
+
+    // The quality tiers would otherwise go on averaging the previous program's frame times
+    if (pWallpaperManager->TakeProgramSwitch()) {
+        pWallpaperTimer->Reset();
+    }
+    pWallpaperTimer->Begin();
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    pWallpaperTimer->End();
+
+    if (scaled) {
+        pWallpaperFramebuffer->BlitToDefault(windowDimensions.width, windowDimensions.height);
+        glViewport(0, 0, windowDimensions.width, windowDimensions.height);
+    }
+}
+
+void Application::Cleanup()
+{
+    // Thumbnail programs still compiling use the wallpaper manager's sandbox, so they are finished first
+    pLibraryBrowser.reset();
+    if (pImGUIWindow != nullptr) {
+        pImGUIWindow->Bind();
+    }
+    pThumbnailRenderer.reset();
+    pThumbnailWorker.reset();
+    if (pWallpaperWindow != nullptr) {
+        pWallpaperWindow->Bind();
+    }
+    // The wallpaper manager owns a GL worker thread which has to be stopped before GLFW is terminated
+    pFrameWatchdog.reset();
+    pHotReloader.reset();
+    pWallpaperManager.reset();
+    pWallpaperTimer.reset();
+    pWallpaperFramebuffer.reset();
     glDeleteVertexArrays(1, &mVAO);
+    pCatalog.reset();
+    pCatalogPool.reset();
     glfwTerminate();
     SetWallpaper(mOriginalWallpaperPath);
 }
@@ -122,27 +252,45 @@ void Application::ProcessImGUI() const
         bool success = openFileDialog(&newPath);
 
         if (success) {
-            bool hasWallpaperBefore = pWallpaperManager->hasWallpaper;
-            bool setWallpaper = pWallpaperManager->TrySetWallpaper(newPath, pWallpaperWindow->GetDimensions());
-            if (setWallpaper && !hasWallpaperBefore) {
-                pWallpaperWindow->SetVisible();
-            }
+            LoadWallpaper(newPath);
         }
         else {
             LOG_ERROR("Failed to load wallpaper");
         }
     }
 
+    if (!mSelectedLibraryPath.empty()) {
+        LoadWallpaper(mSelectedLibraryPath);
+    }
+
     if (mIsUnloadWallpaperButtonPressed) {
         if (pWallpaperManager->hasWallpaper) {
-            pWallpaperManager->UnloadCurrentWallpaper();
-            pWallpaperManager->hasWallpaper = false;
-            pWallpaperWindow->SetHidden();
-            SetWallpaper(mOriginalWallpaperPath);
+            UnloadWallpaper();
         };
     }
 }
 
+void Application::LoadWallpaper(const std::string& path) const
+{
+    if (pFrameWatchdog->IsUnhealthy(path)) {
+        LOG_ERROR("Not loading {}, it stalled the GPU earlier", path);
+        return;
+    }
+    bool hasWallpaperBefore = pWallpaperManager->hasWallpaper;
+    bool setWallpaper = pWallpaperManager->TrySetWallpaper(path, pWallpaperWindow->GetDimensions());
+    if (setWallpaper && !hasWallpaperBefore) {
+        pWallpaperWindow->SetVisible();
+    }
+}
+
+void Application::UnloadWallpaper() const
+{
+    pWallpaperManager->UnloadCurrentWallpaper();
+    pWallpaperManager->hasWallpaper = false;
+    pWallpaperWindow->SetHidden();
+    SetWallpaper(mOriginalWallpaperPath);
+}
+
 void Application::DrawImGUIControlMenu()
 {
     ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
@@ -158,6 +306,131 @@ void Application::DrawImGUIControlMenu()
     mIsLoadWallpaperButtonPressed = ImGui::Button("Load");
     ImGui::SameLine();
     mIsUnloadWallpaperButtonPressed = ImGui::Button("Unload");
+    ImGui::SameLine();
+    ImGui::Checkbox("Specialize", &pWallpaperManager->specializeUniforms);
+    if (pWallpaperManager->IsSpecialized()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("(constants baked)");
+    }
+    ImGui::Checkbox("Hot Reload", &pHotReloader->enabled);
+    const HotReloadStats& reloadStats = pHotReloader->GetStats();
+    if (pHotReloader->enabled && reloadStats.reloads > 0) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("(last %.0f ms from save to screen)", reloadStats.latencyMilliseconds);
+    }
+
+    std::vector<StallIncident> incidents = pFrameWatchdog->GetIncidents();
+    if (!incidents.empty()) {
+        const StallIncident& incident = incidents.back();
+        ImGui::Text("Stalls: %zu, last in the %s for %.0f ms", incidents.size(), incident.stage.c_str(),
+            incident.stalledMilliseconds > 0.0 ? incident.stalledMilliseconds : incident.detectedMilliseconds);
+        ImGui::SameLine();
+        if (ImGui::Button("Allow Again")) {
+            pFrameWatchdog->ForgetUnhealthy();
+        }
+    }
+
+    if (pCatalog->IsRefreshing()) {
+        ImGui::Text("Library: %zu wallpapers, indexing %zu...", pCatalog->GetEntries().size(), pCatalog->GetPendingCount());
+    }
+    else {
+        ImGui::Text("Library: %zu wallpapers", pCatalog->GetEntries().size());
+    }
+    mSelectedLibraryPath.clear();
+    pLibraryBrowser->Draw(&mSelectedLibraryPath);
+
+    // Quality tier selection, only shown for wallpapers that declare tiers
+    const QualityMetadata& quality = pWallpaperManager->mMetadata.quality;
+    if (!quality.tiers.empty()) {
+        int qualityOverride = pWallpaperManager->qualityOverride;
+        const char* preview = qualityOverride >= 0 && static_cast<size_t>(qualityOverride) < quality.tiers.size() ?
+            quality.tiers[static_cast<size_t>(qualityOverride)].c_str() : "Auto";
+        if (ImGui::BeginCombo("Quality", preview)) {
+            if (ImGui::Selectable("Auto", pWallpaperManager->qualityOverride < 0)) {
+                pWallpaperManager->qualityOverride = -1;
+            }
+            for (size_t i = 0; i < quality.tiers.size(); i++) {
+                std::string label = quality.tiers.at(i);
+                if (!pWallpaperManager->IsQualityTierReady(i)) {
+                    label += " (compiling)";
+                }
+                if (ImGui::Selectable(label.c_str(), pWallpaperManager->qualityOverride == static_cast<int>(i))) {
+                    pWallpaperManager->qualityOverride = static_cast<int>(i);
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::Text("Active: %s (%s)", quality.tiers.at(pWallpaperManager->GetQualityTier()).c_str(), pWallpaperManager->GetQualityReason().c_str());
+        ImGui::Text("GPU frame time: %.2f ms / %.2f ms budget", pWallpaperTimer->GetAverageMilliseconds(), quality.budgetMilliseconds);
+    }
+
+    // Static cost estimate and the resolution the wallpaper is rendered at
+    if (pWallpaperManager->hasWallpaper) {
+        const ShaderCost& cost = pWallpaperManager->GetEstimatedCost();
+        ImGui::Text("Estimated cost: %.0f ops/pixel, %.1f ms/frame", cost.TotalOps(), pWallpaperManager->GetPredictedMilliseconds());
+        const CostProbeResult& measuredCost = pWallpaperManager->GetMeasuredCost();
+        if (measuredCost.measured) {
+            ImGui::Text("Measured cost: %.1f ms/frame at full resolution, probed in %.0f ms", measuredCost.fullMilliseconds,
+                measuredCost.probeMilliseconds);
+        }
+        size_t pendingTextures = pWallpaperManager->GetPendingTextureCount();
+        if (pendingTextures > 0) {
+            ImGui::Text("Loading %zu texture(s)...", pendingTextures);
+        }
+        TextureCacheStats cacheStats = pWallpaperManager->GetTextureCacheStats();
+        if (cacheStats.entries > 0) {
+            size_t lookups = cacheStats.hits + cacheStats.misses;
+            ImGui::Text("Texture cache: %.0f%% hits, %.1f MB resident, %.1f MB warm", 100.0 * static_cast<double>(cacheStats.hits) / static_cast<double>(lookups),
+                static_cast<double>(cacheStats.residentBytes) / (1024.0 * 1024.0), static_cast<double>(cacheStats.unreferencedBytes) / (1024.0 * 1024.0));
+            ImGui::Text("Disk cache: %zu loaded, %zu decoded", cacheStats.diskHits, cacheStats.diskMisses);
+        }
+        ProgramCacheStats programStats = pWallpaperManager->GetProgramCacheStats();
+        if (programStats.hits + programStats.misses > 0) {
+            ImGui::Text("Program cache: %zu loaded, %zu compiled", programStats.hits, programStats.misses);
+        }
+        ShaderSandboxStats sandboxStats = pWallpaperManager->GetShaderSandboxStats();
+        if (sandboxStats.compiled + sandboxStats.failed + sandboxStats.timedOut + sandboxStats.crashed > 0) {
+            ImGui::Text("Shader sandbox: %zu built, %zu timed out, %zu crashed, slowest %.0f ms", sandboxStats.compiled, sandboxStats.timedOut,
+                sandboxStats.crashed, sandboxStats.slowestMilliseconds);
+        }
+        VirtualTextureStats virtualStats = pWallpaperManager->GetVirtualTextureStats();
+        if (virtualStats.totalPages > 0) {
+            ImGui::Text("Virtual pages: %zu / %zu resident, %zu streaming", virtualStats.residentPages, virtualStats.totalPages, virtualStats.pendingTiles);
+        }
+        if (pWallpaperManager->GetVideoCount() > 0) {
+            VideoTextureStats videoStats = pWallpaperManager->GetVideoStats();
+            ImGui::Text("Video: %zu shown, %zu dropped, %zu late", videoStats.shownFrames, videoStats.droppedFrames, videoStats.lateFrames);
+        }
+        if (pWallpaperManager->HasAudio()) {
+            AudioStats audioStats = pWallpaperManager->GetAudioStats();
+            ImGui::Text("Audio latency: %.1f ms (%.1f ms now)", audioStats.averageLatencyMilliseconds, audioStats.latencyMilliseconds);
+        }
+        AtlasStats atlasStats = pWallpaperManager->GetAtlasStats();
+        if (atlasStats.sprites > 0) {
+            ImGui::Text("Atlas: %zu sprites in %zu pages, %.0f%% packed, %zu binds saved", atlasStats.sprites, atlasStats.pages,
+                atlasStats.efficiency * 100.0, atlasStats.bindsSaved);
+        }
+        if (pWallpaperManager->HasSdfVolume()) {
+            SdfStats sdfStats = pWallpaperManager->GetSdfStats();
+            ImGui::Checkbox("Baked SDF", &pWallpaperManager->useBakedSdf);
+            ImGui::SameLine();
+            ImGui::Text("%d^3, %.1f MB, baked in %.2f ms", sdfStats.resolution, static_cast<double>(sdfStats.bytes) / (1024.0 * 1024.0), sdfStats.bakeMilliseconds);
+            if (sdfStats.bakedFrameMilliseconds > 0.0 && sdfStats.analyticFrameMilliseconds > 0.0) {
+                ImGui::Text("SDF frame time: %.2f ms baked, %.2f ms analytic (%.1fx)", sdfStats.bakedFrameMilliseconds,
+                    sdfStats.analyticFrameMilliseconds, sdfStats.analyticFrameMilliseconds / sdfStats.bakedFrameMilliseconds);
+            }
+        }
+        float renderScale = pWallpaperManager->GetRenderScale();
+        if (ImGui::SliderFloat("Render Scale", &renderScale, MIN_RENDER_SCALE, 1.0f)) {
+            pWallpaperManager->SetRenderScale(renderScale);
+        }
+        int frameCap = pWallpaperManager->GetFrameCap();
+        if (ImGui::SliderInt("Frame Cap", &frameCap, 0, static_cast<int>(COST_PROBE_REFERENCE_FPS), frameCap == 0 ? "Off" : "%d fps")) {
+            pWallpaperManager->SetFrameCap(frameCap);
+        }
+    }
+
+    bool uniformsEdited = false;
 
     // Controls for integer uniforms
     for (auto it = pWallpaperManager->mIntUniforms.begin(); it != pWallpaperManager->mIntUniforms.end(); ++it) {
@@ -165,16 +438,16 @@ void Application::DrawImGUIControlMenu()
         const char* name = uniform->metadata.name.c_str();
         switch (uniform->elements.size()) {
         case 1:
-            ImGui::SliderInt(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderInt(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         case 2:
-            ImGui::SliderInt2(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderInt2(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         case 3:
-            ImGui::SliderInt3(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderInt3(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         case 4:
-            ImGui::SliderInt4(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderInt4(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         }
     }
@@ -185,16 +458,16 @@ void Application::DrawImGUIControlMenu()
         const char* name = uniform->metadata.name.c_str();
         switch (uniform->elements.size()) {
         case 1:
-            ImGui::SliderFloat(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderFloat(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         case 2:
-            ImGui::SliderFloat2(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderFloat2(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         case 3:
-            ImGui::SliderFloat3(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderFloat3(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         case 4:
-            ImGui::SliderFloat4(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
+            uniformsEdited |= ImGui::SliderFloat4(name, uniform->elements.data(), uniform->metadata.min, uniform->metadata.max);
             break;
         }
     }
@@ -203,7 +476,11 @@ void Application::DrawImGUIControlMenu()
     for (auto it = pWallpaperManager->mBoolUniforms.begin(); it != pWallpaperManager->mBoolUniforms.end(); ++it) {
         Uniform<GLboolean>* uniform = &it->second;
         const char* name = uniform->metadata.name.c_str();
-        ImGui::Checkbox(name, reinterpret_cast<bool*>(uniform->elements.data())); // TODO: Check this is okay?
+        uniformsEdited |= ImGui::Checkbox(name, reinterpret_cast<bool*>(uniform->elements.data())); // TODO: Check this is okay?
+    }
+
+    if (uniformsEdited) {
+        pWallpaperManager->NotifyUniformsEdited();
     }
 }
 
@@ -5,6 +5,12 @@
 #include <GLFW/glfw3.h>
 #include <memory>
 #include <string>
+#include <core/FrameWatchdog.hpp>
+#include <core/HotReloader.hpp>
+#include <core/LibraryBrowser.hpp>
+#include <core/WallpaperCatalog.hpp>
+#include <opengl/Framebuffer.hpp>
+#include <opengl/GpuTimer.hpp>
 #include <opengl/WallpaperManager.hpp>
 #include <opengl/Window.hpp>
 
@@ -12,19 +18,35 @@ class Application
 {
 private:
     std::unique_ptr<WallpaperManager> pWallpaperManager = nullptr;
+    std::unique_ptr<HotReloader> pHotReloader = nullptr;
+    std::unique_ptr<FrameWatchdog> pFrameWatchdog = nullptr;
     std::unique_ptr<Window> pWallpaperWindow = nullptr;
     std::unique_ptr<Window> pImGUIWindow = nullptr;
+    std::unique_ptr<GpuTimer> pWallpaperTimer = nullptr;
+    std::unique_ptr<Framebuffer> pWallpaperFramebuffer = nullptr;
+    std::unique_ptr<ThreadPool> pCatalogPool = nullptr;
+    std::unique_ptr<WallpaperCatalog> pCatalog = nullptr;
+    std::unique_ptr<GLWorker> pThumbnailWorker = nullptr;
+    std::unique_ptr<ThumbnailRenderer> pThumbnailRenderer = nullptr;
+    std::unique_ptr<LibraryBrowser> pLibraryBrowser = nullptr;
     std::wstring mOriginalWallpaperPath;
     void ProcessImGUI() const;
+    void LoadWallpaper(const std::string& path) const;
+    void UnloadWallpaper() const;
     void DrawImGUIControlMenu();
     void UpdateUniforms() const;
+    bool IsWallpaperFrameDue();
+    void DrawWallpaper();
     bool mIsLoadWallpaperButtonPressed = false;
     bool mIsUnloadWallpaperButtonPressed = false;
+    // Wallpaper picked from the library browser, loaded on the next frame like the buttons
+    std::string mSelectedLibraryPath;
     GLuint mVAO{};
+    double mLastWallpaperFrame = 0.0;
 public:
     Application();
     void Run();
-    void Cleanup() const;
+    void Cleanup();
 };
 
 #endif // !APPLICATION_H
@@ -0,0 +1,143 @@
+#include <core/FrameWatchdog.hpp>
+#include <fstream>
+#include <spdlog/fmt/chrono.h>
+#include <util/Log.hpp>
+#include <util/Timing.hpp>
+
+FrameWatchdog::FrameWatchdog(std::function<void(const StallIncident&)> onStall, double thresholdSeconds, const std::string& logPath)
+    : mOnStall(std::move(onStall)), mThresholdSeconds(thresholdSeconds), mLogPath(logPath)
+{
+    mThread = std::thread(&FrameWatchdog::WatchLoop, this);
+}
+
+FrameWatchdog::~FrameWatchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+void FrameWatchdog::WatchLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStopping) {
+        mCondition.wait_for(lock, WATCHDOG_POLL_INTERVAL);
+        if (mStopping || mStage == nullptr || mStalled) {
+            continue;
+        }
+        double milliseconds = MillisecondsBetween(mStageStart, std::chrono::steady_clock::now());
+        if (milliseconds < mThresholdSeconds * 1000.0) {
+            continue;
+        }
+        mStalled = true;
+        StallIncident incident{ mWallpaperPath, mStage, std::time(nullptr), milliseconds, 0.0, mLastFrameMilliseconds };
+        mIncidents.push_back(incident);
+        mUnhealthy.insert(mWallpaperPath);
+
+        // The loop may return while the handler runs, it only needs the lock to do so
+        lock.unlock();
+        LOG_ERROR("{} has been stuck in the {} for {:.0f} ms", incident.wallpaperPath,
+            incident.stage, milliseconds);
+        Record(incident, false);
+        if (mOnStall) {
+            mOnStall(incident);
+        }
+        lock.lock();
+    }
+}
+
+void FrameWatchdog::Record(const StallIncident& incident, bool returned) const
+{
+    std::ofstream file(mLogPath, std::ios::app);
+    if (!file.is_open()) {
+        return;
+    }
+    file << fmt::format("{:%Y-%m-%d %H:%M:%S}", fmt::localtime(incident.time)) << " " << incident.wallpaperPath << ": ";
+    if (returned) {
+        file << incident.stage << " stalled for " << static_cast<long long>(incident.stalledMilliseconds) << " ms";
+    }
+    else {
+        file << incident.stage << " not returned after " << static_cast<long long>(incident.detectedMilliseconds) << " ms";
+    }
+    file << fmt::format(" (previous frame {:.1f} ms)", incident.previousFrameMilliseconds) << std::endl;
+}
+
+void FrameWatchdog::FinishStage(std::chrono::steady_clock::time_point now)
+{
+    if (!mStalled) {
+        return;
+    }
+    StallIncident& incident = mIncidents.back();
+    incident.stalledMilliseconds = MillisecondsBetween(mStageStart, now);
+    mStalled = false;
+    mFrameStalled = true;
+    mStallReturned = true;
+    LOG_WARNING("{} came back from the {} after {:.0f} ms", incident.wallpaperPath, incident.stage, incident.stalledMilliseconds);
+    Record(incident, true);
+}
+
+void FrameWatchdog::Begin(const char* stage, const std::string& wallpaperPath)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStage == nullptr) {
+        if (wallpaperPath.empty()) {
+            return;
+        }
+        mFrameStart = now;
+        mFrameStalled = false;
+        mWallpaperPath = wallpaperPath;
+    }
+    else {
+        FinishStage(now);
+    }
+    mStage = stage;
+    mStageStart = now;
+}
+
+void FrameWatchdog::End()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStage == nullptr) {
+        return;
+    }
+    FinishStage(now);
+    // Only frames that went through are kept for comparing the next stall against
+    if (!mFrameStalled) {
+        mLastFrameMilliseconds = MillisecondsBetween(mFrameStart, now);
+    }
+    mStage = nullptr;
+}
+
+bool FrameWatchdog::TakeStall(StallIncident* incident)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mStallReturned) {
+        return false;
+    }
+    mStallReturned = false;
+    *incident = mIncidents.back();
+    return true;
+}
+
+bool FrameWatchdog::IsUnhealthy(const std::string& wallpaperPath) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUnhealthy.count(wallpaperPath) > 0;
+}
+
+void FrameWatchdog::ForgetUnhealthy()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mUnhealthy.clear();
+}
+
+std::vector<StallIncident> FrameWatchdog::GetIncidents() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mIncidents;
+}
@@ -0,0 +1,88 @@
+#ifndef FRAME_WATCHDOG_H
+#define FRAME_WATCHDOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Incidents are appended to this file as well as logged, so a stall that never returned is still on record
+#define DEFAULT_STALL_LOG_PATH "stalls.log"
+
+// How long a stage may go without returning before it counts as stalled, the same as the default Windows GPU
+// timeout so a hung draw is usually noticed around when the driver resets
+constexpr double WATCHDOG_STALL_SECONDS = 2.0;
+constexpr auto WATCHDOG_POLL_INTERVAL = std::chrono::milliseconds(100);
+
+struct StallIncident {
+    std::string wallpaperPath;
+    std::string stage;
+    std::time_t time{};
+    // How long the stage had been running when the watchdog noticed, and in all once it returned. Zero until then.
+    double detectedMilliseconds = 0.0;
+    double stalledMilliseconds = 0.0;
+    // The last frame that finished before the stall, from its first stage to its end
+    double previousFrameMilliseconds = 0.0;
+};
+
+/*
+Watches the render loop from a thread of its own. The loop marks the stages of a frame that can block on the GPU,
+and if one of them goes without returning for longer than the threshold the wallpaper the stage was drawing is marked
+unhealthy and the stall handler is called with the incident straight away on the watchdog thread. The loop is stuck at that point, so the
+handler may only do what doesn't need it or its context. Once the stage returns the loop sees the stall and falls
+back, and a wallpaper marked unhealthy isn't loaded again until the marks are forgotten.
+*/
+class FrameWatchdog {
+private:
+    std::function<void(const StallIncident&)> mOnStall;
+    double mThresholdSeconds = WATCHDOG_STALL_SECONDS;
+    std::string mLogPath;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStopping = false;
+    // Stage being run, nullptr between frames
+    const char* mStage = nullptr;
+    std::string mWallpaperPath;
+    std::chrono::steady_clock::time_point mFrameStart{};
+    std::chrono::steady_clock::time_point mStageStart{};
+    double mLastFrameMilliseconds = 0.0;
+    // Set when the running stage was reported, until it returns
+    bool mStalled = false;
+    // Set when a stage of the running frame stalled
+    bool mFrameStalled = false;
+    // Set when a stalled stage returned, until the loop takes it
+    bool mStallReturned = false;
+    std::vector<StallIncident> mIncidents;
+    std::unordered_set<std::string> mUnhealthy;
+    std::thread mThread;
+
+    void WatchLoop();
+    // Called with the lock held when the running stage returns
+    void FinishStage(std::chrono::steady_clock::time_point now);
+    void Record(const StallIncident& incident, bool returned) const;
+public:
+    FrameWatchdog(std::function<void(const StallIncident&)> onStall, double thresholdSeconds = WATCHDOG_STALL_SECONDS, const std::string& logPath = DEFAULT_STALL_LOG_PATH);
+    ~FrameWatchdog();
+    // Start a stage of a frame drawing the wallpaper at the path, ending the previous stage if one is running. Frames
+    // without a wallpaper, an empty path, aren't watched.
+    void Begin(const char* stage, const std::string& wallpaperPath);
+    // End the frame's last stage
+    void End();
+    // True once for every stall, after the stage that stalled has returned, with the incident copied to incident
+    bool TakeStall(StallIncident* incident);
+    bool IsUnhealthy(const std::string& wallpaperPath) const;
+    void ForgetUnhealthy();
+    std::vector<StallIncident> GetIncidents() const;
+
+    FrameWatchdog(const FrameWatchdog& arg) = delete;
+    FrameWatchdog(const FrameWatchdog&& arg) = delete;
+    FrameWatchdog& operator=(const FrameWatchdog& arg) = delete;
+    FrameWatchdog& operator=(const FrameWatchdog&& arg) = delete;
+};
+
+#endif // !FRAME_WATCHDOG_H
@@ -0,0 +1,152 @@
+#include <core/HotReloader.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+#include <util/MappedFile.hpp>
+#include <util/Timing.hpp>
+
+static uint64_t HashStamp(uintmax_t size, std::filesystem::file_time_type modifiedTime, uint64_t seed)
+{
+    int64_t ticks = modifiedTime.time_since_epoch().count();
+    uint64_t hash = HashBytes(&size, sizeof(size), seed);
+    return HashBytes(&ticks, sizeof(ticks), hash);
+}
+
+// Changes whenever the contents do. Directories are image sequences, so their listing stands in for their frames.
+static uint64_t FingerprintPath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::file_status status = std::filesystem::status(path, error);
+    if (error || !std::filesystem::exists(status)) {
+        return 0;
+    }
+    if (std::filesystem::is_directory(status)) {
+        std::vector<std::filesystem::directory_entry> entries;
+        for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+            entries.push_back(entry);
+        }
+        std::sort(entries.begin(), entries.end());
+        uint64_t hash = HashString(path);
+        for (const std::filesystem::directory_entry& entry : entries) {
+            hash = HashString(entry.path().filename().string(), hash);
+            hash = HashStamp(entry.file_size(error), entry.last_write_time(error), hash);
+        }
+        return hash;
+    }
+    uintmax_t size = std::filesystem::file_size(path, error);
+    MappedFile file;
+    if (size > HOT_RELOAD_HASH_LIMIT || !file.Open(path)) {
+        return HashStamp(size, std::filesystem::last_write_time(path, error), HashString(path));
+    }
+    return HashBytes(file.GetData(), file.GetSize());
+}
+
+HotReloader::HotReloader(WallpaperManager& manager) : mManager(manager)
+{
+
+}
+
+void HotReloader::Watch()
+{
+    std::vector<std::string> paths = mManager.GetDependencyPaths();
+    paths.insert(paths.begin(), mManager.GetWallpaperPath());
+    if (paths == mWatchedPaths) {
+        return;
+    }
+    mWatcher.Watch(paths);
+    // Fingerprints are kept for paths the same wallpaper was already watching, anything else is read now so the
+    // next save has something to compare against
+    bool sameWallpaper = !mWatchedPaths.empty() && mWatchedPaths.front() == paths.front();
+    std::unordered_map<std::string, uint64_t> fingerprints;
+    for (const std::string& path : paths) {
+        auto find = mFingerprints.find(path);
+        fingerprints[path] = sameWallpaper && find != mFingerprints.end() ? find->second : FingerprintPath(path);
+    }
+    mFingerprints = std::move(fingerprints);
+    if (!sameWallpaper) {
+        mChanged.clear();
+        mPending = false;
+    }
+    mWatchedPaths = std::move(paths);
+    LOG_TRACE("Watching {} file(s) of {} for changes", mWatchedPaths.size(), mWatchedPaths.front());
+}
+
+void HotReloader::Stop()
+{
+    mWatcher.Clear();
+    mWatchedPaths.clear();
+    mFingerprints.clear();
+    mChanged.clear();
+    mPending = false;
+}
+
+void HotReloader::Update(WindowDimensions windowDimensions)
+{
+    if (!enabled || !mManager.hasWallpaper) {
+        if (!mWatchedPaths.empty()) {
+            Stop();
+        }
+        return;
+    }
+    Watch();
+
+    size_t changedBefore = mChanged.size();
+    mWatcher.Poll(&mChanged);
+    auto now = std::chrono::steady_clock::now();
+    if (mChanged.size() > changedBefore) {
+        if (!mPending) {
+            mFirstChange = now;
+        }
+        mPending = true;
+        mLastChange = now;
+    }
+    if (!mPending || MillisecondsBetween(mLastChange, now) < HOT_RELOAD_DEBOUNCE_SECONDS * 1000.0) {
+        return;
+    }
+    mPending = false;
+
+    // Saving without editing, or touching a file, changes nothing worth recompiling for
+    bool contentChanged = false;
+    for (const std::string& path : mChanged) {
+        uint64_t fingerprint = FingerprintPath(path);
+        uint64_t& previous = mFingerprints[path];
+        contentChanged |= fingerprint != previous;
+        previous = fingerprint;
+    }
+    mChanged.clear();
+    if (!contentChanged) {
+        mStats.skipped++;
+        LOG_TRACE("Files of {} were saved unchanged, not reloading", mManager.GetWallpaperPath());
+        return;
+    }
+
+    mReloadStart = std::chrono::steady_clock::now();
+    bool reloaded = mManager.ReloadWallpaper(windowDimensions);
+    mReloadEnd = std::chrono::steady_clock::now();
+    if (!reloaded) {
+        mStats.failed++;
+        return;
+    }
+    mStats.reloads++;
+    mAwaitingPresent = true;
+}
+
+void HotReloader::OnFramePresented()
+{
+    if (!mAwaitingPresent) {
+        return;
+    }
+    mAwaitingPresent = false;
+    auto now = std::chrono::steady_clock::now();
+    mStats.debounceMilliseconds = MillisecondsBetween(mFirstChange, mReloadStart);
+    mStats.reloadMilliseconds = MillisecondsBetween(mReloadStart, mReloadEnd);
+    mStats.latencyMilliseconds = MillisecondsBetween(mFirstChange, now);
+    LOG_INFO("Reloaded {}, {:.1f} ms from save to screen ({:.1f} ms waiting for writes to settle, {:.1f} ms loading)",
+        mManager.GetWallpaperPath(), mStats.latencyMilliseconds, mStats.debounceMilliseconds, mStats.reloadMilliseconds);
+}
+
+const HotReloadStats& HotReloader::GetStats() const
+{
+    return mStats;
+}
@@ -0,0 +1,64 @@
+#ifndef HOT_RELOADER_H
+#define HOT_RELOADER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opengl/WallpaperManager.hpp>
+#include <opengl/Window.hpp>
+#include <util/FileWatcher.hpp>
+
+// How long the files must stay quiet after a change before reloading, editors often write a file several times per save
+constexpr double HOT_RELOAD_DEBOUNCE_SECONDS = 0.15;
+// Files larger than this are compared by size and write time instead of being hashed
+constexpr uintmax_t HOT_RELOAD_HASH_LIMIT = 64ull * 1024 * 1024;
+
+struct HotReloadStats {
+    size_t reloads = 0;
+    // Saves that left every file's contents the same
+    size_t skipped = 0;
+    size_t failed = 0;
+    // Timings of the last reload, from the first change being seen to the reloaded wallpaper being presented
+    double debounceMilliseconds = 0.0;
+    double reloadMilliseconds = 0.0;
+    double latencyMilliseconds = 0.0;
+};
+
+/*
+Reloads the current wallpaper when its file or anything it reads from disk changes. Changes are gathered until
+the files go quiet, then only reloaded if some file's contents actually differ from what was last loaded, and the
+values of the wallpaper's uniforms are kept across the reload.
+*/
+class HotReloader {
+private:
+    WallpaperManager& mManager;
+    FileWatcher mWatcher;
+    std::vector<std::string> mWatchedPaths;
+    std::unordered_map<std::string, uint64_t> mFingerprints;
+    std::vector<std::string> mChanged;
+    bool mPending = false;
+    bool mAwaitingPresent = false;
+    std::chrono::steady_clock::time_point mFirstChange{};
+    std::chrono::steady_clock::time_point mLastChange{};
+    std::chrono::steady_clock::time_point mReloadStart{};
+    std::chrono::steady_clock::time_point mReloadEnd{};
+    HotReloadStats mStats{};
+    void Watch();
+    void Stop();
+public:
+    HotReloader(WallpaperManager& manager);
+    // Called once a frame with the wallpaper context bound, reloads the wallpaper if a change is due
+    void Update(WindowDimensions windowDimensions);
+    // Called after the wallpaper window's buffers are swapped, to time how long a save takes to reach the screen
+    void OnFramePresented();
+    const HotReloadStats& GetStats() const;
+    bool enabled = true;
+    HotReloader(const HotReloader& arg) = delete;
+    HotReloader(const HotReloader&& arg) = delete;
+    HotReloader& operator=(const HotReloader& arg) = delete;
+    HotReloader& operator=(const HotReloader&& arg) = delete;
+};
+
+#endif // !HOT_RELOADER_H
@@ -0,0 +1,124 @@
+#include <core/LibraryBrowser.hpp>
+#include <filesystem>
+#include <imgui.h>
+#include <util/Log.hpp>
+
+LibraryBrowser::LibraryBrowser(const WallpaperCatalog& catalog, ThreadPool& pool, ThumbnailRenderer* thumbnails)
+    : mCatalog(catalog), mPool(pool), pThumbnails(thumbnails)
+{
+
+}
+
+void LibraryBrowser::Update(bool catalogChanged)
+{
+    mStale |= catalogChanged;
+    if (IsReady(mPendingSnapshot)) {
+        pSnapshot = mPendingSnapshot.get();
+        const TrigramIndexStats& stats = pSnapshot->index.GetStats();
+        LOG_TRACE("Library index of {} wallpapers built in {:.1f} ms, {:.1f} MB", stats.documents, stats.buildMilliseconds,
+            static_cast<double>(stats.bytes) / (1024.0 * 1024.0));
+        Search();
+    }
+
+    // While the catalog is still indexing it changes every frame, so the index only catches up now and then
+    bool rebuildDue = !mCatalog.IsRefreshing() ||
+        std::chrono::steady_clock::now() - mLastBuild > std::chrono::duration<double>(LIBRARY_REBUILD_INTERVAL_SECONDS);
+    if (mStale && !mPendingSnapshot.valid() && rebuildDue) {
+        BuildSnapshot();
+    }
+}
+
+void LibraryBrowser::BuildSnapshot()
+{
+    mStale = false;
+    mLastBuild = std::chrono::steady_clock::now();
+
+    // Copied here so the catalog can keep changing while the index is built
+    auto snapshot = std::make_unique<LibrarySnapshot>();
+    std::vector<std::string> documents;
+    snapshot->items.reserve(mCatalog.GetEntries().size());
+    documents.reserve(mCatalog.GetEntries().size());
+    std::filesystem::path root(mCatalog.GetRoot());
+    for (const CatalogEntry& entry : mCatalog.GetEntries()) {
+        LibraryItem item{};
+        item.path = (root / entry.path).string();
+        item.name = entry.name;
+        item.contentHash = entry.contentHash;
+        item.uniformCount = entry.uniforms.size();
+        item.valid = entry.valid;
+        snapshot->items.push_back(std::move(item));
+
+        // Newlines keep a query from matching across the end of one name and the start of the next
+        std::string document = entry.name;
+        for (const CatalogUniform& uniform : entry.uniforms) {
+            document += '\n';
+            document += uniform.name;
+        }
+        documents.push_back(std::move(document));
+    }
+    mPendingSnapshot = mPool.Submit([snapshot = std::move(snapshot), documents = std::move(documents)]() mutable {
+        snapshot->index.Build(std::move(documents));
+        return std::move(snapshot);
+    });
+}
+
+void LibraryBrowser::Search()
+{
+    if (pSnapshot == nullptr) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    pSnapshot->index.Search(mQuery, &mResults);
+    mSearchMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool LibraryBrowser::Draw(std::string* selectedPath)
+{
+    if (!ImGui::CollapsingHeader("Library")) {
+        return false;
+    }
+    if (ImGui::InputTextWithHint("##LibrarySearch", "Search names and uniforms", mQuery, sizeof(mQuery))) {
+        Search();
+    }
+    if (pSnapshot == nullptr) {
+        ImGui::TextDisabled("Indexing %zu wallpapers...", mCatalog.GetEntries().size());
+        return false;
+    }
+    const TrigramIndexStats& stats = pSnapshot->index.GetStats();
+    ImGui::Text("%zu / %zu wallpapers in %.0f us", mResults.size(), pSnapshot->items.size(), mSearchMicroseconds);
+    ImGui::SameLine();
+    ImGui::TextDisabled("(index %.1f MB, built in %.1f ms)", static_cast<double>(stats.bytes) / (1024.0 * 1024.0), stats.buildMilliseconds);
+
+    bool selected = false;
+    ImGui::BeginChild("LibraryList", ImVec2(0.0f, LIBRARY_LIST_HEIGHT), ImGuiChildFlags_Border);
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(mResults.size()));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            const LibraryItem& item = pSnapshot->items.at(mResults.at(row));
+            ImGui::PushID(row);
+            ImGui::BeginDisabled(!item.valid);
+            if (ImGui::Selectable(item.name.c_str())) {
+                *selectedPath = item.path;
+                selected = true;
+            }
+            ImGui::EndDisabled();
+            if (ImGui::BeginItemTooltip()) {
+                GLuint thumbnail = pThumbnails != nullptr && item.valid ? pThumbnails->GetDisplayTexture(item.path, item.contentHash) : 0;
+                if (thumbnail != 0) {
+                    // Thumbnails are stored bottom row first, as they were read back
+                    ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(thumbnail)),
+                        ImVec2(static_cast<float>(THUMBNAIL_WIDTH), static_cast<float>(THUMBNAIL_HEIGHT)), ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+                }
+                else if (pThumbnails != nullptr && item.valid) {
+                    ImGui::TextDisabled("Rendering thumbnail...");
+                }
+                ImGui::Text("%s\n%zu uniform(s)", item.path.c_str(), item.uniformCount);
+                ImGui::EndTooltip();
+            }
+            ImGui::PopID();
+        }
+    }
+    ImGui::EndChild();
+    return selected;
+}
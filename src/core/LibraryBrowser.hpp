@@ -0,0 +1,67 @@
+#ifndef LIBRARY_BROWSER_H
+#define LIBRARY_BROWSER_H
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <core/WallpaperCatalog.hpp>
+#include <opengl/ThumbnailRenderer.hpp>
+#include <util/ThreadPool.hpp>
+#include <util/TrigramIndex.hpp>
+
+// Height of the scrolling list of wallpapers in the control menu
+constexpr float LIBRARY_LIST_HEIGHT = 200.0f;
+// How often the search index is rebuilt while the catalog is still indexing
+constexpr double LIBRARY_REBUILD_INTERVAL_SECONDS = 1.0;
+
+struct LibraryItem {
+    std::string path;
+    std::string name;
+    uint64_t contentHash = 0;
+    size_t uniformCount = 0;
+    bool valid = false;
+};
+
+/*
+Catalog entries as they were when the search index was built, the index's document ids are positions in items
+*/
+struct LibrarySnapshot {
+    std::vector<LibraryItem> items;
+    TrigramIndex index;
+};
+
+/*
+Control menu panel listing the wallpapers in the catalog. Only the rows in view are drawn, and typing filters the
+list by wallpaper and uniform names through a trigram index, which is rebuilt on the thread pool whenever the
+catalog changes so the menu never waits on it. Hovering a row shows its thumbnail, rendering it first if needed.
+*/
+class LibraryBrowser {
+private:
+    const WallpaperCatalog& mCatalog;
+    ThreadPool& mPool;
+    // Optional, without it rows have no preview
+    ThumbnailRenderer* pThumbnails = nullptr;
+    std::unique_ptr<LibrarySnapshot> pSnapshot = nullptr;
+    std::future<std::unique_ptr<LibrarySnapshot>> mPendingSnapshot;
+    std::chrono::steady_clock::time_point mLastBuild{};
+    bool mStale = true;
+    char mQuery[128]{};
+    std::vector<uint32_t> mResults;
+    double mSearchMicroseconds = 0.0;
+    void BuildSnapshot();
+    void Search();
+public:
+    LibraryBrowser(const WallpaperCatalog& catalog, ThreadPool& pool, ThumbnailRenderer* thumbnails = nullptr);
+    // Called once a frame with whether the catalog's entries changed since the last call
+    void Update(bool catalogChanged);
+    // Draw the panel, returns true with the wallpaper's path if one was picked
+    bool Draw(std::string* selectedPath);
+    LibraryBrowser(const LibraryBrowser& arg) = delete;
+    LibraryBrowser(const LibraryBrowser&& arg) = delete;
+    LibraryBrowser& operator=(const LibraryBrowser& arg) = delete;
+    LibraryBrowser& operator=(const LibraryBrowser&& arg) = delete;
+};
+
+#endif // !LIBRARY_BROWSER_H
@@ -0,0 +1,248 @@
+#include <core/WallpaperCatalog.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unordered_map>
+#include <opengl/WallpaperMetadata.hpp>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+#include <util/Timing.hpp>
+#include <util/WallpaperFile.hpp>
+
+template<typename T>
+static void AddUniforms(const std::unordered_map<std::string, Uniform<T>>& uniforms, CatalogUniformType type, std::vector<CatalogUniform>* out)
+{
+    for (auto it = uniforms.begin(); it != uniforms.end(); ++it) {
+        CatalogUniform uniform{};
+        uniform.uniform = it->first;
+        uniform.name = it->second.metadata.name;
+        uniform.type = type;
+        if constexpr (!std::is_same_v<T, GLboolean>) {
+            uniform.min = static_cast<float>(it->second.metadata.min);
+            uniform.max = static_cast<float>(it->second.metadata.max);
+        }
+        out->push_back(std::move(uniform));
+    }
+}
+
+// Runs on the thread pool. Files that were touched without their contents changing keep the previous entry.
+static CatalogEntry IndexWallpaper(const std::filesystem::path& path, CatalogEntry entry, const CatalogEntry& previous)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (stream.fail()) {
+        LOG_WARNING("Could not read {} for the catalog", path.string());
+        return entry;
+    }
+    std::string source{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+    entry.contentHash = HashBytes(source.data(), source.size());
+    if (!previous.path.empty() && previous.contentHash == entry.contentHash) {
+        entry.name = previous.name;
+        entry.valid = previous.valid;
+        entry.uniforms = previous.uniforms;
+        return entry;
+    }
+
+    entry.name = path.stem().string();
+    WallpaperSources sources{};
+    if (!SplitWallpaperSource(source, &sources)) {
+        LOG_WARNING("Catalog skipped {}, it has no shader section", entry.path);
+        return entry;
+    }
+
+    WallpaperMetadata metadata{};
+    std::unordered_map<std::string, Uniform<GLint>> intUniforms;
+    std::unordered_map<std::string, Uniform<GLfloat>> floatUniforms;
+    std::unordered_map<std::string, Uniform<GLboolean>> boolUniforms;
+    try {
+        entry.valid = ParseWallpaperMetadata(sources.metadataYamlSource, metadata, intUniforms, floatUniforms, boolUniforms);
+    }
+    catch (const YAML::Exception& e) {
+        LOG_WARNING("Catalog could not parse the metadata of {}: {}", entry.path, e.what());
+        entry.valid = false;
+    }
+    if (!entry.valid) {
+        return entry;
+    }
+    if (!metadata.name.empty()) {
+        entry.name = metadata.name;
+    }
+    AddUniforms(intUniforms, CatalogUniformType::Int, &entry.uniforms);
+    AddUniforms(floatUniforms, CatalogUniformType::Float, &entry.uniforms);
+    AddUniforms(boolUniforms, CatalogUniformType::Bool, &entry.uniforms);
+    std::sort(entry.uniforms.begin(), entry.uniforms.end(), [](const CatalogUniform& a, const CatalogUniform& b) {
+        return a.uniform < b.uniform;
+    });
+    return entry;
+}
+
+WallpaperCatalog::WallpaperCatalog(const std::string& root, ThreadPool& pool, const std::string& catalogDirectory) : mPool(pool)
+{
+    std::error_code error;
+    std::filesystem::path rootPath = std::filesystem::weakly_canonical(root, error);
+    mRoot = error ? std::filesystem::path(root).generic_string() : rootPath.generic_string();
+    std::filesystem::create_directories(catalogDirectory, error);
+    mCatalogPath = (std::filesystem::path(catalogDirectory) / (HashToHex(HashString(mRoot)) + ".catalog")).string();
+}
+
+void WallpaperCatalog::Refresh()
+{
+    if (IsRefreshing()) {
+        return;
+    }
+    mRefreshStart = std::chrono::steady_clock::now();
+    mStats = {};
+    mDirty = false;
+    if (!mLoaded) {
+        mLoaded = true;
+        if (!ReadCatalogFile(mCatalogPath, mRoot, &mEntries)) {
+            mEntries.clear();
+            mDirty = true;
+        }
+        mStats.loadMilliseconds = MillisecondsSince(mRefreshStart);
+    }
+
+    std::unordered_map<std::string, CatalogEntry*> known;
+    known.reserve(mEntries.size());
+    for (CatalogEntry& entry : mEntries) {
+        known[entry.path] = &entry;
+    }
+
+    // Directory entries carry the modified time and size from the directory listing itself on Windows, so
+    // unchanged files cost no more than the walk
+    auto walkStart = std::chrono::steady_clock::now();
+    std::vector<CatalogEntry> current;
+    current.reserve(mEntries.size());
+    std::error_code error;
+    std::filesystem::path rootPath(mRoot);
+    std::filesystem::recursive_directory_iterator it(rootPath, std::filesystem::directory_options::skip_permission_denied, error);
+    if (error == std::errc::no_such_file_or_directory) {
+        LOG_INFO("No wallpaper library at {}", mRoot);
+    }
+    else if (error) {
+        LOG_WARNING("Could not open wallpaper library {}: {}", mRoot, error.message());
+    }
+    bool opened = !error;
+    for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        const std::filesystem::directory_entry& file = *it;
+        std::error_code fileError;
+        if (file.path().extension() != ".wallpaper" || !file.is_regular_file(fileError)) {
+            continue;
+        }
+        CatalogEntry entry{};
+        entry.path = file.path().lexically_relative(rootPath).generic_string();
+        entry.modifiedTime = static_cast<int64_t>(file.last_write_time(fileError).time_since_epoch().count());
+        entry.size = static_cast<uint64_t>(file.file_size(fileError));
+        if (fileError) {
+            continue;
+        }
+
+        CatalogEntry previous{};
+        auto knownEntry = known.find(entry.path);
+        if (knownEntry != known.end()) {
+            CatalogEntry* old = knownEntry->second;
+            known.erase(knownEntry);
+            if (old->modifiedTime == entry.modifiedTime && old->size == entry.size) {
+                current.push_back(std::move(*old));
+                mStats.unchanged++;
+                continue;
+            }
+            previous = std::move(*old);
+        }
+        mPendingEntries.push_back(mPool.Submit([path = file.path(), entry = std::move(entry), previous = std::move(previous)]() {
+            return IndexWallpaper(path, entry, previous);
+        }));
+    }
+    mStats.walkMilliseconds = MillisecondsSince(walkStart);
+    if (opened && error) {
+        LOG_WARNING("Walk of wallpaper library {} stopped early: {}", mRoot, error.message());
+    }
+    // A walk that didn't get through says nothing about the wallpapers it never reached, so they are kept as they
+    // were until one does. Only a library that isn't there at all empties the catalog.
+    if (error && (opened || error != std::errc::no_such_file_or_directory)) {
+        for (auto& [path, entry] : known) {
+            current.push_back(std::move(*entry));
+        }
+        known.clear();
+    }
+    mStats.removed = known.size();
+    mDirty |= mStats.removed > 0;
+
+    std::sort(current.begin(), current.end(), [](const CatalogEntry& a, const CatalogEntry& b) {
+        return a.path < b.path;
+    });
+    mEntries = std::move(current);
+    mStats.wallpapers = mEntries.size();
+    LOG_INFO("Catalog of {} opened in {:.2f} ms, {} wallpapers unchanged, {} to index, {} removed", mRoot,
+        mStats.loadMilliseconds + mStats.walkMilliseconds, mStats.unchanged, mPendingEntries.size(), mStats.removed);
+    if (mPendingEntries.empty()) {
+        FinishRefresh();
+    }
+}
+
+bool WallpaperCatalog::Update()
+{
+    bool changed = false;
+    for (size_t i = 0; i < mPendingEntries.size();) {
+        if (!IsReady(mPendingEntries[i])) {
+            i++;
+            continue;
+        }
+        InsertEntry(mPendingEntries[i].get());
+        mPendingEntries[i] = std::move(mPendingEntries.back());
+        mPendingEntries.pop_back();
+        changed = true;
+    }
+    if (changed && mPendingEntries.empty()) {
+        FinishRefresh();
+    }
+    return changed;
+}
+
+void WallpaperCatalog::InsertEntry(CatalogEntry entry)
+{
+    auto position = std::lower_bound(mEntries.begin(), mEntries.end(), entry.path, [](const CatalogEntry& a, const std::string& path) {
+        return a.path < path;
+    });
+    mEntries.insert(position, std::move(entry));
+    mStats.wallpapers = mEntries.size();
+    mStats.indexed++;
+    mDirty = true;
+}
+
+void WallpaperCatalog::FinishRefresh()
+{
+    mStats.totalMilliseconds = MillisecondsSince(mRefreshStart);
+    if (mStats.indexed > 0) {
+        LOG_INFO("Catalog indexed {} wallpapers in {:.1f} ms", mStats.indexed, mStats.totalMilliseconds);
+    }
+    if (mDirty && WriteCatalogFile(mCatalogPath, mRoot, mEntries)) {
+        mDirty = false;
+    }
+}
+
+bool WallpaperCatalog::IsRefreshing() const
+{
+    return !mPendingEntries.empty();
+}
+
+size_t WallpaperCatalog::GetPendingCount() const
+{
+    return mPendingEntries.size();
+}
+
+const std::string& WallpaperCatalog::GetRoot() const
+{
+    return mRoot;
+}
+
+const std::vector<CatalogEntry>& WallpaperCatalog::GetEntries() const
+{
+    return mEntries;
+}
+
+const CatalogScanStats& WallpaperCatalog::GetStats() const
+{
+    return mStats;
+}
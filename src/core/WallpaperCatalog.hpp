@@ -0,0 +1,65 @@
+#ifndef WALLPAPER_CATALOG_H
+#define WALLPAPER_CATALOG_H
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include <util/CatalogFile.hpp>
+#include <util/ThreadPool.hpp>
+
+// Directory of .wallpaper files indexed at startup, relative to the working directory
+#define DEFAULT_LIBRARY_DIRECTORY "wallpapers"
+// Directory catalog files are kept in, one per library root
+#define DEFAULT_CATALOG_DIRECTORY "cache/catalog"
+
+struct CatalogScanStats {
+    size_t wallpapers = 0;
+    // Entries kept from the catalog file because the file's modified time and size hadn't changed
+    size_t unchanged = 0;
+    // Entries read and parsed again, including files that were touched but hashed the same
+    size_t indexed = 0;
+    size_t removed = 0;
+    double loadMilliseconds = 0.0;
+    double walkMilliseconds = 0.0;
+    // From the start of the refresh until the last entry was indexed
+    double totalMilliseconds = 0.0;
+};
+
+/*
+Index of every .wallpaper file under a library directory, so the library can be listed and searched without
+opening each file. The index is kept in a catalog file between runs, and refreshing it only stats the files;
+those whose modified time or size changed are read and parsed again on the thread pool.
+*/
+class WallpaperCatalog {
+private:
+    std::string mRoot;
+    std::string mCatalogPath;
+    ThreadPool& mPool;
+    // Sorted by path
+    std::vector<CatalogEntry> mEntries;
+    std::vector<std::future<CatalogEntry>> mPendingEntries;
+    CatalogScanStats mStats{};
+    std::chrono::steady_clock::time_point mRefreshStart{};
+    bool mLoaded = false;
+    bool mDirty = false;
+    void InsertEntry(CatalogEntry entry);
+    void FinishRefresh();
+public:
+    WallpaperCatalog(const std::string& root, ThreadPool& pool, const std::string& catalogDirectory = DEFAULT_CATALOG_DIRECTORY);
+    // Load the catalog file the first time, then walk the library and queue every new or changed wallpaper
+    void Refresh();
+    // Collect indexed wallpapers, saving the catalog file once the last one is in. True if any entries changed.
+    bool Update();
+    bool IsRefreshing() const;
+    size_t GetPendingCount() const;
+    const std::string& GetRoot() const;
+    const std::vector<CatalogEntry>& GetEntries() const;
+    const CatalogScanStats& GetStats() const;
+    WallpaperCatalog(const WallpaperCatalog& arg) = delete;
+    WallpaperCatalog(const WallpaperCatalog&& arg) = delete;
+    WallpaperCatalog& operator=(const WallpaperCatalog& arg) = delete;
+    WallpaperCatalog& operator=(const WallpaperCatalog&& arg) = delete;
+};
+
+#endif // !WALLPAPER_CATALOG_H
@@ -2,10 +2,16 @@
 #include <stb_image.h>
 
 #include <core/Application.hpp>
+#include <opengl/ShaderSandbox.hpp>
+#include <string>
 #include <system_error>
 #include <util/Log.hpp>
 
-int main() {
+int main(int argc, char** argv) {
+    // The engine starts copies of itself to compile shaders in
+    if (argc > 1 && std::string(argv[1]) == SHADER_WORKER_ARGUMENT) {
+        return RunShaderWorker(argc, argv);
+    }
     Log::Init();
     Application app;
     try {
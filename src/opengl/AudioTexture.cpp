@@ -0,0 +1,62 @@
+#include <opengl/AudioTexture.hpp>
+#include <algorithm>
+
+// Weight of each new latency sample in the smoothed average
+constexpr double AUDIO_LATENCY_SMOOTHING = 0.05;
+
+AudioTexture::AudioTexture(std::unique_ptr<AudioSource> source) : pAnalyzer(std::make_unique<AudioAnalyzer>(std::move(source)))
+{
+    glGenTextures(1, &uTexture);
+    glBindTexture(GL_TEXTURE_2D, uTexture);
+    std::array<float, AUDIO_SPECTRUM_SIZE * 2> silence{};
+    std::fill(silence.begin() + AUDIO_SPECTRUM_SIZE, silence.end(), 0.5f);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, static_cast<GLsizei>(AUDIO_SPECTRUM_SIZE), 2, 0, GL_RED, GL_FLOAT, silence.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+AudioTexture::~AudioTexture()
+{
+    glDeleteTextures(1, &uTexture);
+}
+
+bool AudioTexture::Update()
+{
+    const AudioFrame* frame = pAnalyzer->Acquire();
+    if (frame == nullptr) {
+        return false;
+    }
+    // Two rows of a few kilobytes, small enough that a plain upload doesn't need a pixel buffer
+    static_assert(AUDIO_WAVEFORM_SIZE == AUDIO_SPECTRUM_SIZE, "Spectrum and waveform share the texture's width");
+    glBindTexture(GL_TEXTURE_2D, uTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(AUDIO_SPECTRUM_SIZE), 1, GL_RED, GL_FLOAT, frame->spectrum.data());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 1, static_cast<GLsizei>(AUDIO_WAVEFORM_SIZE), 1, GL_RED, GL_FLOAT, frame->waveform.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mBands = frame->bands;
+
+    mStats.latencyMilliseconds = (GetAudioClock() - frame->captureTime) * 1000.0;
+    mStats.averageLatencyMilliseconds = mStats.frames == 0 ? mStats.latencyMilliseconds
+        : mStats.averageLatencyMilliseconds + (mStats.latencyMilliseconds - mStats.averageLatencyMilliseconds) * AUDIO_LATENCY_SMOOTHING;
+    mStats.frames++;
+    return true;
+}
+
+void AudioTexture::Bind(GLint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    glBindTexture(GL_TEXTURE_2D, uTexture);
+}
+
+const std::array<float, 4>& AudioTexture::GetBands() const
+{
+    return mBands;
+}
+
+AudioStats AudioTexture::GetStats() const
+{
+    return mStats;
+}
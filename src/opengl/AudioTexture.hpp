@@ -0,0 +1,43 @@
+#ifndef AUDIO_TEXTURE_H
+#define AUDIO_TEXTURE_H
+
+#include <gl.h>
+#include <array>
+#include <memory>
+#include <util/AudioAnalyzer.hpp>
+
+struct AudioStats {
+    size_t frames = 0;
+    // Time from the newest sample being captured to its analysis reaching the shader, smoothed and latest
+    double averageLatencyMilliseconds = 0.0;
+    double latencyMilliseconds = 0.0;
+};
+
+/*
+The newest audio analysis as a texture laid out like Shadertoy's sound input: AUDIO_SPECTRUM_SIZE x 2 single
+channel floats, the spectrum in the bottom row and the waveform in the top.
+*/
+class AudioTexture {
+private:
+    std::unique_ptr<AudioAnalyzer> pAnalyzer = nullptr;
+    GLuint uTexture = 0;
+    std::array<float, 4> mBands{};
+    AudioStats mStats{};
+public:
+    AudioTexture(std::unique_ptr<AudioSource> source);
+    ~AudioTexture();
+    // Upload the latest analysis if there is a new one, returns whether the bands changed. The caller is expected to
+    // set the uniforms straight after, which is the point latency is measured to.
+    bool Update();
+    void Bind(GLint unit) const;
+    // Bass, mid, treble and volume
+    const std::array<float, 4>& GetBands() const;
+    AudioStats GetStats() const;
+
+    AudioTexture(const AudioTexture& arg) = delete;
+    AudioTexture(const AudioTexture&& arg) = delete;
+    AudioTexture& operator=(const AudioTexture& arg) = delete;
+    AudioTexture& operator=(const AudioTexture&& arg) = delete;
+};
+
+#endif // !AUDIO_TEXTURE_H
@@ -0,0 +1,146 @@
+#include <opengl/CostProbe.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <opengl/ProgramBuilder.hpp>
+
+double CostProbeResult::PredictMilliseconds(int width, int height) const
+{
+    return fixedMilliseconds + nanosecondsPerPixel * static_cast<double>(width) * static_cast<double>(height) / 1.0e6;
+}
+
+CostProbe::CostProbe()
+{
+    glGenQueries(1, &uQuery);
+    // The probe draws before the application has bound its own vertex array
+    glGenVertexArrays(1, &uVAO);
+}
+
+CostProbe::~CostProbe()
+{
+    glDeleteQueries(1, &uQuery);
+    glDeleteVertexArrays(1, &uVAO);
+}
+
+double CostProbe::TimeFrame()
+{
+    glBeginQuery(GL_TIME_ELAPSED, uQuery);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glEndQuery(GL_TIME_ELAPSED);
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(uQuery, GL_QUERY_RESULT, &nanoseconds);
+    return static_cast<double>(nanoseconds) / 1.0e6;
+}
+
+CostProbeResult CostProbe::Measure(WindowDimensions windowDimensions, const std::function<void(WindowDimensions, float)>& prepare)
+{
+    auto start = std::chrono::steady_clock::now();
+    CostProbeResult result{};
+
+    // Put back whatever the caller had bound, the probe can run in the middle of its frame
+    GLint previousFramebuffer = 0;
+    GLint previousVertexArray = 0;
+    GLint previousViewport[4]{};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    while (glGetError() != GL_NO_ERROR) {
+    }
+
+    std::vector<double> pixels;
+    std::vector<double> milliseconds;
+    for (float scale : COST_PROBE_SCALES) {
+        WindowDimensions probeDimensions{
+            std::max(static_cast<int>(static_cast<float>(windowDimensions.width) * scale), 1),
+            std::max(static_cast<int>(static_cast<float>(windowDimensions.height) * scale), 1)
+        };
+        if (pFramebuffer == nullptr) {
+            pFramebuffer = std::make_unique<Framebuffer>(probeDimensions.width, probeDimensions.height);
+        }
+        pFramebuffer->Resize(probeDimensions.width, probeDimensions.height);
+        pFramebuffer->Bind();
+        glViewport(0, 0, probeDimensions.width, probeDimensions.height);
+        glBindVertexArray(uVAO);
+
+        prepare(probeDimensions, 0.0f);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glFinish();
+        std::array<double, COST_PROBE_FRAMES> frames{};
+        for (int frame = 0; frame < COST_PROBE_FRAMES; frame++) {
+            prepare(probeDimensions, static_cast<float>(frame + 1) * COST_PROBE_TIME_STEP);
+            frames[static_cast<size_t>(frame)] = TimeFrame();
+        }
+        // The median is less thrown by a frame the GPU was busy with something else for
+        std::sort(frames.begin(), frames.end());
+        pixels.push_back(static_cast<double>(probeDimensions.width) * static_cast<double>(probeDimensions.height));
+        milliseconds.push_back(frames[frames.size() / 2]);
+        if (milliseconds.back() > COST_PROBE_STOP_MS) {
+            break;
+        }
+    }
+
+    // A draw that raised an error did no work, so its times say nothing about the wallpaper
+    result.error = glGetError();
+    result.measured = result.error == GL_NO_ERROR;
+    if (pixels.size() > 1 && pixels.back() > pixels.front() && milliseconds.back() > milliseconds.front()) {
+        result.nanosecondsPerPixel = (milliseconds.back() - milliseconds.front()) * 1.0e6 / (pixels.back() - pixels.front());
+        result.fixedMilliseconds = std::max(milliseconds.front() - result.nanosecondsPerPixel * pixels.front() / 1.0e6, 0.0);
+    }
+    else {
+        // With a single size, or times too noisy to fit, everything is put down to the pixels, which overestimates
+        result.nanosecondsPerPixel = milliseconds.back() * 1.0e6 / pixels.back();
+    }
+    result.fullMilliseconds = result.PredictMilliseconds(windowDimensions.width, windowDimensions.height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    glBindVertexArray(static_cast<GLuint>(previousVertexArray));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    result.probeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+CostProbeResult CostProbe::MeasureProgram(GLuint program, WindowDimensions windowDimensions, const std::function<void(GLuint)>& bind,
+    const std::unordered_map<std::string, Uniform<GLint>>& intUniforms, const std::unordered_map<std::string, Uniform<GLfloat>>& floatUniforms,
+    const std::unordered_map<std::string, Uniform<GLboolean>>& boolUniforms)
+{
+    bind(program);
+    SpreadSamplerUnits(program);
+    SetUniformValues(program, intUniforms, floatUniforms, boolUniforms);
+    GLint resolution = glGetUniformLocation(program, "iResolution");
+    GLint time = glGetUniformLocation(program, "iTime");
+    return Measure(windowDimensions, [&bind, program, resolution, time](WindowDimensions probeDimensions, float seconds) {
+        bind(program);
+        glUniform2f(resolution, static_cast<float>(probeDimensions.width), static_cast<float>(probeDimensions.height));
+        glUniform1f(time, seconds);
+    });
+}
+
+bool PickRenderSettings(const CostProbeResult& measuredCost, WindowDimensions windowDimensions, double budgetMilliseconds,
+    float* renderScale, int* frameCap, double* scaledMilliseconds)
+{
+    *renderScale = 1.0f;
+    *frameCap = 0;
+    *scaledMilliseconds = measuredCost.fullMilliseconds;
+    if (measuredCost.fullMilliseconds <= budgetMilliseconds) {
+        return true;
+    }
+
+    // Only the per pixel part of the cost comes down with the resolution
+    double pixelMilliseconds = measuredCost.fullMilliseconds - measuredCost.fixedMilliseconds;
+    double scale = MIN_RENDER_SCALE;
+    if (pixelMilliseconds > 0.0 && budgetMilliseconds > measuredCost.fixedMilliseconds) {
+        scale = std::sqrt((budgetMilliseconds - measuredCost.fixedMilliseconds) / pixelMilliseconds);
+    }
+    *renderScale = std::clamp(static_cast<float>(scale), MIN_RENDER_SCALE, 1.0f);
+    *scaledMilliseconds = measuredCost.PredictMilliseconds(static_cast<int>(static_cast<float>(windowDimensions.width) * *renderScale),
+        static_cast<int>(static_cast<float>(windowDimensions.height) * *renderScale));
+    if (*scaledMilliseconds > COST_PROBE_REJECT_MS) {
+        return false;
+    }
+    // Still over budget at the lowest scale, so draw it less often to take the same share of the GPU
+    if (*scaledMilliseconds > budgetMilliseconds) {
+        *frameCap = std::max(static_cast<int>(COST_PROBE_REFERENCE_FPS * budgetMilliseconds / *scaledMilliseconds), 1);
+    }
+    return true;
+}
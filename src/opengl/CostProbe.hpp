@@ -0,0 +1,82 @@
+#ifndef COST_PROBE_H
+#define COST_PROBE_H
+
+#include <gl.h>
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <opengl/Framebuffer.hpp>
+#include <opengl/Uniform.hpp>
+#include <opengl/Window.hpp>
+
+// Fractions of the window's width and height the probe renders at, smallest first
+constexpr std::array<float, 2> COST_PROBE_SCALES = { 0.125f, 0.25f };
+// Frames timed at each scale, after one untimed frame for drivers that finish compiling on the first draw
+constexpr int COST_PROBE_FRAMES = 3;
+// iTime step between probe frames, so an animated wallpaper isn't only measured on its first frame
+constexpr float COST_PROBE_TIME_STEP = 1.7f;
+// A probe frame taking longer than this is enough to decide on, larger scales are skipped
+constexpr double COST_PROBE_STOP_MS = 10.0;
+// Wallpapers predicted to take longer than this per frame even at the lowest render scale are rejected, the
+// desktop would stall on every frame however rarely they were drawn
+constexpr double COST_PROBE_REJECT_MS = 50.0;
+// Frame rate the cost budget is meant for, a frame cap keeps the same share of the GPU at a lower rate
+constexpr double COST_PROBE_REFERENCE_FPS = 60.0;
+// Lowest render scale picked automatically for wallpapers predicted to go over the cost budget
+constexpr float MIN_RENDER_SCALE = 0.25f;
+
+/*
+GPU time of a frame modelled as a fixed cost plus a cost per pixel, fitted to the probe frames
+*/
+struct CostProbeResult {
+    bool measured = false;
+    // The first GL error the probe draws raised, measured is false if there was one
+    GLenum error = GL_NO_ERROR;
+    double fixedMilliseconds = 0.0;
+    double nanosecondsPerPixel = 0.0;
+    // Predicted for the full window resolution
+    double fullMilliseconds = 0.0;
+    // Wall time the probe held up loading the wallpaper
+    double probeMilliseconds = 0.0;
+
+    double PredictMilliseconds(int width, int height) const;
+};
+
+/*
+Measures what a program costs before it goes on the desktop. The program is drawn into an offscreen framebuffer at a
+few reduced resolutions with every frame timed by a GL_TIME_ELAPSED query, and the times are extrapolated to the full
+window resolution. Results are read back straight away, so measuring stalls the caller for as long as the frames take.
+*/
+class CostProbe {
+private:
+    std::unique_ptr<Framebuffer> pFramebuffer = nullptr;
+    GLuint uQuery = 0;
+    GLuint uVAO = 0;
+
+    double TimeFrame();
+public:
+    CostProbe();
+    ~CostProbe();
+    // Prepare binds the program and sets its iResolution and iTime for each probe frame, called with the frame's size and time
+    CostProbeResult Measure(WindowDimensions windowDimensions, const std::function<void(WindowDimensions, float)>& prepare);
+    // Measures a wallpaper program before its textures are loaded, with its samplers on units of their own and its
+    // uniforms at the values the metadata declares. Bind makes the program the one drawn and set, and is left to the
+    // caller to undo.
+    CostProbeResult MeasureProgram(GLuint program, WindowDimensions windowDimensions, const std::function<void(GLuint)>& bind,
+        const std::unordered_map<std::string, Uniform<GLint>>& intUniforms, const std::unordered_map<std::string, Uniform<GLfloat>>& floatUniforms,
+        const std::unordered_map<std::string, Uniform<GLboolean>>& boolUniforms);
+
+    CostProbe(const CostProbe& arg) = delete;
+    CostProbe(const CostProbe&& arg) = delete;
+    CostProbe& operator=(const CostProbe& arg) = delete;
+    CostProbe& operator=(const CostProbe&& arg) = delete;
+};
+
+// Render scale and frame cap keeping a measured wallpaper within budget, with the milliseconds a frame is predicted to
+// take at them. False if it is too expensive to show at all.
+bool PickRenderSettings(const CostProbeResult& measuredCost, WindowDimensions windowDimensions, double budgetMilliseconds,
+    float* renderScale, int* frameCap, double* scaledMilliseconds);
+
+#endif // !COST_PROBE_H
@@ -0,0 +1,98 @@
+#include <opengl/Framebuffer.hpp>
+#include <stdexcept>
+
+Framebuffer::Framebuffer(Framebuffer&& other) noexcept : uID(other.uID), uColorTexture(other.uColorTexture), mWidth(other.mWidth), mHeight(other.mHeight)
+{
+    other.uID = 0;
+    other.uColorTexture = 0;
+}
+
+Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        glDeleteFramebuffers(1, &uID);
+        glDeleteTextures(1, &uColorTexture);
+        uID = other.uID;
+        uColorTexture = other.uColorTexture;
+        mWidth = other.mWidth;
+        mHeight = other.mHeight;
+        other.uID = 0;
+        other.uColorTexture = 0;
+    }
+    return *this;
+}
+
+Framebuffer::Framebuffer(int width, int height)
+{
+    glGenFramebuffers(1, &uID);
+    glGenTextures(1, &uColorTexture);
+    Resize(width, height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, uID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, uColorTexture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, &uID);
+        glDeleteTextures(1, &uColorTexture);
+        throw std::runtime_error("Failed to create framebuffer");
+    }
+}
+
+Framebuffer::~Framebuffer()
+{
+    glDeleteFramebuffers(1, &uID);
+    glDeleteTextures(1, &uColorTexture);
+}
+
+void Framebuffer::Resize(int width, int height)
+{
+    if (width == mWidth && height == mHeight) {
+        return;
+    }
+    mWidth = width;
+    mHeight = height;
+
+    glBindTexture(GL_TEXTURE_2D, uColorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Framebuffer::Bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, uID);
+}
+
+void Framebuffer::Unbind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::BlitToDefault(int width, int height) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, uID);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, mWidth, mHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint Framebuffer::GetColorTexture() const
+{
+    return uColorTexture;
+}
+
+int Framebuffer::GetWidth() const
+{
+    return mWidth;
+}
+
+int Framebuffer::GetHeight() const
+{
+    return mHeight;
+}
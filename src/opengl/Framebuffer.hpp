@@ -0,0 +1,32 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <gl.h>
+
+/*
+Wrapper class for an OpenGL framebuffer object with a single RGBA8 colour texture attached
+*/
+class Framebuffer {
+private:
+    GLuint uID{};
+    GLuint uColorTexture{};
+    int mWidth = 0;
+    int mHeight = 0;
+public:
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+    Framebuffer(Framebuffer&& other) noexcept;
+    Framebuffer& operator=(Framebuffer&& other) noexcept;
+    Framebuffer(int width, int height);
+    ~Framebuffer();
+    void Resize(int width, int height);
+    void Bind() const;
+    void Unbind() const;
+    // Stretch the colour attachment over the whole of the default framebuffer
+    void BlitToDefault(int width, int height) const;
+    GLuint GetColorTexture() const;
+    int GetWidth() const;
+    int GetHeight() const;
+};
+
+#endif // !FRAMEBUFFER_H
@@ -0,0 +1,42 @@
+#include <opengl/GLWorker.hpp>
+
+GLWorker::GLWorker(const Window& sharedWith)
+{
+    // GLFW windows must be created on the main thread, only the context is handed to the worker
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    pContextWindow = std::make_unique<Window>(1, 1, "", &sharedWith);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    mThread = std::thread(&GLWorker::WorkerLoop, this);
+}
+
+GLWorker::~GLWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void GLWorker::WorkerLoop()
+{
+    pContextWindow->Bind();
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            if (mStopping && mTasks.empty()) {
+                break;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop();
+        }
+        task();
+    }
+
+    pContextWindow->Unbind();
+}
@@ -0,0 +1,67 @@
+#ifndef GL_WORKER_H
+#define GL_WORKER_H
+
+#include <gl.h>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <opengl/Window.hpp>
+#include <util/ThreadPool.hpp>
+
+/*
+Runs OpenGL work on a background thread. The worker owns a hidden window whose context shares objects
+with the window passed in, so shaders, programs and textures created by a task can be used by the main
+thread once the task's future is ready. Every task is followed by a glFinish so that nothing it created
+is still pending on the GPU when the result is handed over.
+*/
+class GLWorker {
+private:
+    std::unique_ptr<Window> pContextWindow = nullptr;
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::queue<std::function<void()>> mTasks;
+    bool mStopping = false;
+
+    void WorkerLoop();
+public:
+    GLWorker(const Window& sharedWith);
+    ~GLWorker();
+
+    template<typename F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        auto packaged = std::make_shared<std::packaged_task<R()>>(
+            [task = std::forward<F>(task)]() mutable -> R {
+                if constexpr (std::is_void_v<R>) {
+                    task();
+                    glFinish();
+                }
+                else {
+                    R result = task();
+                    glFinish();
+                    return result;
+                }
+            }
+        );
+        std::future<R> future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.emplace([packaged]() { (*packaged)(); });
+        }
+        mCondition.notify_one();
+        return future;
+    }
+
+    GLWorker(const GLWorker& arg) = delete;
+    GLWorker(const GLWorker&& arg) = delete;
+    GLWorker& operator=(const GLWorker& arg) = delete;
+    GLWorker& operator=(const GLWorker&& arg) = delete;
+};
+
+#endif // !GL_WORKER_H
@@ -0,0 +1,84 @@
+#include <opengl/GpuTimer.hpp>
+
+GpuTimer::GpuTimer()
+{
+    glGenQueries(static_cast<GLsizei>(QUERY_COUNT), mQueries.data());
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(static_cast<GLsizei>(QUERY_COUNT), mQueries.data());
+}
+
+void GpuTimer::CollectResults()
+{
+    // Queries complete in the order they were issued, so stop at the first one that isn't ready
+    // mCurrent is the next slot to be issued, so if it is still in flight it holds the oldest query
+    for (size_t i = 0; i < QUERY_COUNT; i++) {
+        size_t slot = (mCurrent + i) % QUERY_COUNT;
+        if (!mInFlight[slot]) {
+            continue;
+        }
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(mQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            break;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(mQueries[slot], GL_QUERY_RESULT, &nanoseconds);
+        mInFlight[slot] = false;
+
+        mLastMilliseconds = static_cast<double>(nanoseconds) / 1.0e6;
+        mAverageMilliseconds = mHasResult ? mAverageMilliseconds + (mLastMilliseconds - mAverageMilliseconds) * SMOOTHING : mLastMilliseconds;
+        mHasResult = true;
+    }
+}
+
+void GpuTimer::Begin()
+{
+    CollectResults();
+
+    // Every query is still waiting on the GPU, skip timing this frame rather than blocking
+    if (mInFlight[mCurrent]) {
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, mQueries[mCurrent]);
+    mTiming = true;
+}
+
+void GpuTimer::End()
+{
+    if (!mTiming) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    mInFlight[mCurrent] = true;
+    mCurrent = (mCurrent + 1) % QUERY_COUNT;
+    mTiming = false;
+}
+
+void GpuTimer::Reset()
+{
+    // Drop anything still in flight, those queries measured work from before the reset
+    mInFlight.fill(false);
+    mHasResult = false;
+    mLastMilliseconds = 0.0;
+    mAverageMilliseconds = 0.0;
+}
+
+bool GpuTimer::HasResult() const
+{
+    return mHasResult;
+}
+
+double GpuTimer::GetLastMilliseconds() const
+{
+    return mLastMilliseconds;
+}
+
+double GpuTimer::GetAverageMilliseconds() const
+{
+    return mAverageMilliseconds;
+}
@@ -0,0 +1,44 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <gl.h>
+#include <array>
+#include <cstddef>
+
+/*
+Measures GPU time spent between Begin and End using GL_TIME_ELAPSED queries. Several queries are kept
+in flight and only read back once the driver reports them available, so timing a frame never stalls
+the pipeline. Results are smoothed into a moving average.
+*/
+class GpuTimer {
+private:
+    static constexpr size_t QUERY_COUNT = 4;
+    static constexpr double SMOOTHING = 0.1;
+
+    std::array<GLuint, QUERY_COUNT> mQueries{};
+    std::array<bool, QUERY_COUNT> mInFlight{};
+    size_t mCurrent = 0;
+    bool mTiming = false;
+    bool mHasResult = false;
+    double mLastMilliseconds = 0.0;
+    double mAverageMilliseconds = 0.0;
+
+    void CollectResults();
+public:
+    GpuTimer();
+    ~GpuTimer();
+    void Begin();
+    void End();
+    // Forget every result, for when the work being timed changes
+    void Reset();
+    bool HasResult() const;
+    double GetLastMilliseconds() const;
+    double GetAverageMilliseconds() const;
+
+    GpuTimer(const GpuTimer& arg) = delete;
+    GpuTimer(const GpuTimer&& arg) = delete;
+    GpuTimer& operator=(const GpuTimer& arg) = delete;
+    GpuTimer& operator=(const GpuTimer&& arg) = delete;
+};
+
+#endif // !GPU_TIMER_H
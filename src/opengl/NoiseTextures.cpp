@@ -0,0 +1,100 @@
+#include <opengl/NoiseTextures.hpp>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+#include <util/TextureFile.hpp>
+
+// Noise is stored in texture files with volumes laid out as one tall image of stacked slices
+static bool LoadCachedNoise(const std::string& path, uint64_t key, NoiseVolume* volume)
+{
+    TexturePayload payload{};
+    if (!ReadTextureFile(path, key, &payload) || payload.levels.size() != 1 || payload.levels[0].width != volume->width
+        || payload.levels[0].height != volume->height * volume->depth) {
+        return false;
+    }
+    volume->pixels.assign(payload.levels[0].pixels, payload.levels[0].pixels + payload.levels[0].size);
+    return true;
+}
+
+static void SaveCachedNoise(const std::string& cacheDirectory, const std::string& path, uint64_t key, const NoiseVolume& volume)
+{
+    TexturePayload payload{};
+    payload.levels.push_back(TextureLevel{ volume.width, volume.height * volume.depth, volume.pixels.data(), volume.pixels.size() });
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    std::string temporaryPath = path + ".tmp";
+    if (WriteTextureFile(temporaryPath, key, payload)) {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    if (error) {
+        LOG_WARNING("Could not write noise file {}: {}", path, error.message());
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
+
+NoiseTextures::NoiseTextures(ThreadPool& pool, const std::string& cacheDirectory)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::array<NoiseVolume, static_cast<size_t>(NoiseKind::Count)> volumes{};
+    size_t generated = 0;
+    for (size_t i = 0; i < volumes.size(); i++) {
+        NoiseKind kind = static_cast<NoiseKind>(i);
+        std::string name = GetNoiseUniformName(kind);
+        uint64_t key = HashString(name + " " + std::to_string(NOISE_VERSION));
+        std::string path = (std::filesystem::path(cacheDirectory) / (name + ".wptx")).string();
+
+        volumes[i].width = kind == NoiseKind::Blue ? BLUE_NOISE_SIZE : IsNoise3D(kind) ? NOISE_3D_SIZE : NOISE_2D_SIZE;
+        volumes[i].height = volumes[i].width;
+        volumes[i].depth = IsNoise3D(kind) ? volumes[i].width : 1;
+        if (LoadCachedNoise(path, key, &volumes[i])) {
+            continue;
+        }
+        // Kinds are generated one after another since each waits on its own tasks, which could deadlock if the
+        // kinds themselves were pool tasks
+        volumes[i] = GenerateNoise(kind, &pool);
+        SaveCachedNoise(cacheDirectory, path, key, volumes[i]);
+        generated++;
+    }
+
+    for (size_t i = 0; i < volumes.size(); i++) {
+        const NoiseVolume& volume = volumes[i];
+        GLenum target = volume.depth > 1 ? GL_TEXTURE_3D : GL_TEXTURE_2D;
+        glGenTextures(1, &mTextures[i]);
+        glBindTexture(target, mTextures[i]);
+        if (target == GL_TEXTURE_3D) {
+            glTexImage3D(target, 0, GL_RGBA8, volume.width, volume.height, volume.depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, volume.pixels.data());
+            glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_REPEAT);
+        }
+        else {
+            glTexImage2D(target, 0, GL_RGBA8, volume.width, volume.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, volume.pixels.data());
+        }
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        // White and blue noise are read one texel at a time, filtering them would only average the noise away
+        bool perTexel = static_cast<NoiseKind>(i) == NoiseKind::White || static_cast<NoiseKind>(i) == NoiseKind::Blue;
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, perTexel ? GL_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, perTexel ? GL_NEAREST : GL_LINEAR);
+        if (perTexel) {
+            glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+        }
+        else {
+            glGenerateMipmap(target);
+        }
+        glBindTexture(target, 0);
+    }
+    LOG_INFO("Noise textures ready in {:.1f} ms, {} generated and {} from the disk cache",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), generated, volumes.size() - generated);
+}
+
+NoiseTextures::~NoiseTextures()
+{
+    glDeleteTextures(static_cast<GLsizei>(mTextures.size()), mTextures.data());
+}
+
+void NoiseTextures::Bind(NoiseKind kind, GLint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    glBindTexture(IsNoise3D(kind) ? GL_TEXTURE_3D : GL_TEXTURE_2D, mTextures[static_cast<size_t>(kind)]);
+}
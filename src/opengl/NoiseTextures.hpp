@@ -0,0 +1,31 @@
+#ifndef NOISE_TEXTURES_H
+#define NOISE_TEXTURES_H
+
+#include <gl.h>
+#include <array>
+#include <string>
+#include <util/Noise.hpp>
+#include <util/ThreadPool.hpp>
+
+// Where generated noise is kept between runs, relative to the working directory
+#define DEFAULT_NOISE_CACHE_DIRECTORY "cache/noise"
+
+/*
+The engine's builtin noise textures, one per NoiseKind. They are read from the disk cache, or generated on
+the pool and written to it, once at startup.
+*/
+class NoiseTextures {
+private:
+    std::array<GLuint, static_cast<size_t>(NoiseKind::Count)> mTextures{};
+public:
+    NoiseTextures(ThreadPool& pool, const std::string& cacheDirectory = DEFAULT_NOISE_CACHE_DIRECTORY);
+    ~NoiseTextures();
+    void Bind(NoiseKind kind, GLint unit) const;
+
+    NoiseTextures(const NoiseTextures& arg) = delete;
+    NoiseTextures(const NoiseTextures&& arg) = delete;
+    NoiseTextures& operator=(const NoiseTextures& arg) = delete;
+    NoiseTextures& operator=(const NoiseTextures&& arg) = delete;
+};
+
+#endif // !NOISE_TEXTURES_H
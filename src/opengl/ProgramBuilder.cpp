@@ -0,0 +1,427 @@
+#include <opengl/ProgramBuilder.hpp>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <opengl/ShaderSandbox.hpp>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+#include <util/ShaderPreprocessor.hpp>
+
+ProgramBuilder::ProgramBuilder(const std::string& vertexPath, const std::string& libraryPath, const std::string& cacheDirectory,
+    ShaderSandbox* sandbox) :
+    mCacheDirectory(cacheDirectory), pSandbox(sandbox)
+{
+    LoadVertexShader(vertexPath);
+    LoadLibraryShader(libraryPath);
+    CreateVertexProgram();
+    InitBinaryCache();
+}
+
+ProgramBuilder::~ProgramBuilder()
+{
+    glDeleteShader(uVertexShader);
+    glDeleteShader(uLibraryShader);
+    glDeleteProgram(uVertexProgram);
+}
+
+void ProgramBuilder::LoadVertexShader(const std::string& path)
+{
+    std::ifstream stream(path);
+
+    if (stream.fail()) {
+        throw std::runtime_error("Failed to open file stream to " + path + " to load default vertex shader.");
+    }
+
+    std::stringstream ss;
+    ss << stream.rdbuf();
+    mVertexSource = ss.str();
+
+    CompileShader(GL_VERTEX_SHADER, mVertexSource, &uVertexShader);
+}
+
+void ProgramBuilder::LoadLibraryShader(const std::string& path)
+{
+    std::ifstream stream(path);
+
+    if (stream.fail()) {
+        throw std::runtime_error("Failed to open file stream to " + path + " to load shader library.");
+    }
+
+    std::stringstream ss;
+    ss << stream.rdbuf();
+    mLibrarySource = ss.str();
+
+    // Compiled once here and then only attached, so wallpapers using it never pay to compile it again
+    if (!CompileShader(GL_FRAGMENT_SHADER, mLibrarySource, &uLibraryShader)) {
+        throw std::runtime_error("Failed to compile shader library " + path);
+    }
+}
+
+void ProgramBuilder::CreateVertexProgram()
+{
+    // Separate shader objects are core since OpenGL 4.1 and an extension before it, contexts with neither keep linking
+    // the vertex shader into every program
+    mUseSeparablePrograms = GLAD_GL_VERSION_4_1 != 0 || GLAD_GL_ARB_separate_shader_objects != 0;
+    if (!mUseSeparablePrograms) {
+        LOG_INFO("Separate shader objects unavailable, linking the vertex shader into every wallpaper program");
+        return;
+    }
+
+    uVertexProgram = glCreateProgram();
+    glProgramParameteri(uVertexProgram, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glAttachShader(uVertexProgram, uVertexShader);
+    glLinkProgram(uVertexProgram);
+    glDetachShader(uVertexProgram, uVertexShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(uVertexProgram, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        LOG_WARNING("Failed to link separable vertex program, linking the vertex shader into every wallpaper program");
+        glDeleteProgram(uVertexProgram);
+        uVertexProgram = 0;
+        mUseSeparablePrograms = false;
+    }
+}
+
+void ProgramBuilder::InitBinaryCache()
+{
+    // Program binaries are core since OpenGL 4.1 and an extension before it, and a driver may still support no binary
+    // formats at all
+    GLint formats = 0;
+    if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    mSupportsBinaries = formats > 0;
+    if (mCacheDirectory.empty()) {
+        return;
+    }
+    if (!mSupportsBinaries) {
+        LOG_INFO("Program binaries unsupported, wallpaper programs will be compiled every time");
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(mCacheDirectory, error);
+    if (error) {
+        LOG_WARNING("Could not create program cache directory {}", mCacheDirectory);
+        return;
+    }
+
+    // Binaries only load on the driver that saved them, so it is part of every key
+    std::string driver;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION }) {
+        const GLubyte* value = glGetString(name);
+        driver += value != nullptr ? reinterpret_cast<const char*>(value) : "";
+        driver += '\n';
+    }
+    mDriverHash = HashString(driver);
+    mUseBinaryCache = true;
+}
+
+std::string ProgramBuilder::GetCachePath(uint64_t key) const
+{
+    return (std::filesystem::path(mCacheDirectory) / (HashToHex(key) + ".wpprog")).string();
+}
+
+bool ProgramBuilder::CompileShader(GLenum type, const std::string& source, GLuint* shaderIn, const std::vector<std::string>* files,
+    std::string* log) const
+{
+    GLuint id = glCreateShader(type);
+    const char* sourceCStr = source.c_str();
+    glShaderSource(id, 1, &sourceCStr, nullptr);
+    glCompileShader(id);
+
+    GLint result;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+    if (result == GL_FALSE) {
+        GLint length;
+        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+
+        std::vector<GLchar> msg(length);
+        glGetShaderInfoLog(id, length, &length, msg.data());
+        if (type == GL_VERTEX_SHADER) {
+            LOG_ERROR("Failed to compile vertex shader");
+        }
+        else {
+            LOG_ERROR("Failed to compile fragment shader");
+        }
+        std::string message = files != nullptr ? AnnotateShaderLog(msg.data(), *files) : std::string(msg.data());
+        LOG_ERROR(message);
+        if (log != nullptr) {
+            *log = std::move(message);
+        }
+        glDeleteShader(id);
+        return false;
+    }
+
+    *shaderIn = id;
+    return true;
+}
+
+// Name of the vec4 output a wallpaper draws to, empty if it declares none the library's doesn't
+static std::string FindColourOutput(const std::string& fragmentSource)
+{
+    static const std::regex output(R"(\bout\s+(?:(?:highp|mediump|lowp)\s+)?vec4\s+(\w+)\s*;)");
+    std::string stripped = StripShaderComments(fragmentSource);
+    for (auto it = std::sregex_iterator(stripped.begin(), stripped.end(), output); it != std::sregex_iterator(); ++it) {
+        if ((*it)[1] != "libVirtualFeedback") {
+            return (*it)[1].str();
+        }
+    }
+    return std::string();
+}
+
+bool ProgramBuilder::LinkProgram(GLuint fragmentShader, const std::string& colourOutput, GLuint* programIn, std::string* log) const
+{
+    GLuint program = glCreateProgram();
+
+    if (mUseSeparablePrograms) {
+        glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    }
+    else {
+        glAttachShader(program, uVertexShader);
+    }
+    if (mSupportsBinaries) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, uLibraryShader);
+    glAttachShader(program, fragmentShader);
+    // The linker would otherwise be free to give it any location but the library's. An explicit layout in the shader still wins.
+    if (!colourOutput.empty()) {
+        glBindFragDataLocation(program, 0, colourOutput.c_str());
+    }
+    glLinkProgram(program);
+
+    GLint valid = GL_FALSE;
+    if (mUseSeparablePrograms) {
+        // A fragment only program can't be validated on its own, the pipeline supplies the rest of the state
+        glGetProgramiv(program, GL_LINK_STATUS, &valid);
+    }
+    else {
+        glValidateProgram(program);
+        glGetProgramiv(program, GL_VALIDATE_STATUS, &valid);
+    }
+
+    if (valid == GL_FALSE) {
+        if (log != nullptr) {
+            GLint length = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+            std::vector<GLchar> msg(static_cast<size_t>(length) + 1);
+            glGetProgramInfoLog(program, length, &length, msg.data());
+            *log = msg.data();
+        }
+        glDeleteProgram(program);
+        return false;
+    }
+
+    *programIn = program;
+    return true;
+}
+
+GLuint ProgramBuilder::BuildProgram(const std::string& fragmentSource, const std::vector<std::string>* files, std::string* log, bool* cached,
+    double timeoutSeconds) const
+{
+    uint64_t key = 0;
+    if (mUseBinaryCache) {
+        key = GetProgramKey(fragmentSource);
+        ProgramBinary binary{};
+        if (ReadProgramBinaryFile(GetCachePath(key), key, &binary)) {
+            GLuint program = LoadProgramBinary(binary);
+            if (program != 0) {
+                mCacheHits++;
+                if (cached != nullptr) {
+                    *cached = true;
+                }
+                return program;
+            }
+            mCacheRejected++;
+        }
+        mCacheMisses++;
+    }
+    if (cached != nullptr) {
+        *cached = false;
+    }
+
+    GLuint program = CompileProgram(fragmentSource, files, log, timeoutSeconds);
+    if (program == 0) {
+        return 0;
+    }
+
+    ProgramBinary binary{};
+    if (mUseBinaryCache && GetProgramBinary(program, &binary) && WriteProgramBinaryFile(GetCachePath(key), key, binary)) {
+        mCacheStored++;
+    }
+    return program;
+}
+
+GLuint ProgramBuilder::CompileProgram(const std::string& fragmentSource, const std::vector<std::string>* files, std::string* log,
+    double timeoutSeconds) const
+{
+    // Binaries are the only way to bring a program back from a worker
+    if (pSandbox == nullptr || !mSupportsBinaries || !pSandbox->IsAvailable()) {
+        return CompileInProcess(fragmentSource, files, log);
+    }
+
+    SandboxResult result = pSandbox->Compile(fragmentSource, files, timeoutSeconds);
+    switch (result.status) {
+    case SandboxStatus::Compiled:
+        if (!result.binary.data.empty()) {
+            GLuint program = LoadProgramBinary(result.binary);
+            if (program != 0) {
+                return program;
+            }
+        }
+        // Proven safe to build in the worker, only the binary did not carry over
+        LOG_WARNING("Program binary from the shader worker was not accepted, compiling it in process");
+        return CompileInProcess(fragmentSource, files, log);
+    case SandboxStatus::Failed:
+        LOG_ERROR("Failed to build wallpaper program");
+        break;
+    case SandboxStatus::TimedOut:
+    case SandboxStatus::Crashed:
+        LOG_ERROR("Shader rejected by the sandbox");
+        break;
+    case SandboxStatus::Unavailable:
+        return CompileInProcess(fragmentSource, files, log);
+    }
+    LOG_ERROR(result.log);
+    if (log != nullptr) {
+        *log = std::move(result.log);
+    }
+    return 0;
+}
+
+GLuint ProgramBuilder::CompileInProcess(const std::string& fragmentSource, const std::vector<std::string>* files, std::string* log) const
+{
+    GLuint fragmentShader = 0;
+    if (!CompileShader(GL_FRAGMENT_SHADER, fragmentSource, &fragmentShader, files, log)) {
+        return 0;
+    }
+    GLuint program = 0;
+    bool linked = LinkProgram(fragmentShader, FindColourOutput(fragmentSource), &program, log);
+    glDeleteShader(fragmentShader);
+    return linked ? program : 0;
+}
+
+uint64_t ProgramBuilder::GetProgramKey(const std::string& fragmentSource) const
+{
+    // Without separable programs the vertex shader is linked into every program, so it is part of the key too
+    uint64_t hash = HashString(mUseSeparablePrograms ? "separable" : mVertexSource, mDriverHash);
+    hash = HashString(mLibrarySource, hash);
+    return HashString(fragmentSource, hash);
+}
+
+bool ProgramBuilder::GetProgramBinary(GLuint program, ProgramBinary* out) const
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    GLenum format = 0;
+    out->data.resize(static_cast<size_t>(length));
+    glGetProgramBinary(program, length, &length, &format, out->data.data());
+    out->data.resize(static_cast<size_t>(length));
+    out->format = format;
+    return length > 0;
+}
+
+GLuint ProgramBuilder::LoadProgramBinary(const ProgramBinary& binary) const
+{
+    GLuint program = glCreateProgram();
+    if (mUseSeparablePrograms) {
+        glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    }
+    glProgramBinary(program, binary.format, binary.data.data(), static_cast<GLsizei>(binary.data.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool ProgramBuilder::UsesSeparablePrograms() const
+{
+    return mUseSeparablePrograms;
+}
+
+GLuint ProgramBuilder::GetVertexProgram() const
+{
+    return uVertexProgram;
+}
+
+const std::string& ProgramBuilder::GetLibrarySource() const
+{
+    return mLibrarySource;
+}
+
+ProgramCacheStats ProgramBuilder::GetCacheStats() const
+{
+    return ProgramCacheStats{ mCacheHits.load(), mCacheMisses.load(), mCacheRejected.load(), mCacheStored.load() };
+}
+
+void SpreadSamplerUnits(GLuint program)
+{
+    GLint count = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    GLint unit = 0;
+    for (GLint i = 0; i < count; i++) {
+        GLchar name[64];
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+        if (type == GL_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_ARRAY) {
+            glUniform1i(glGetUniformLocation(program, name), unit++);
+        }
+    }
+}
+
+void SetUniformValues(GLuint program, const std::unordered_map<std::string, Uniform<GLint>>& intUniforms,
+    const std::unordered_map<std::string, Uniform<GLfloat>>& floatUniforms, const std::unordered_map<std::string, Uniform<GLboolean>>& boolUniforms)
+{
+    for (auto it = intUniforms.begin(); it != intUniforms.end(); ++it) {
+        GLint location = glGetUniformLocation(program, it->first.c_str());
+        const std::vector<GLint>& elements = it->second.elements;
+        switch (elements.size()) {
+        case 1:
+            glUniform1iv(location, 1, elements.data());
+            break;
+        case 2:
+            glUniform2iv(location, 1, elements.data());
+            break;
+        case 3:
+            glUniform3iv(location, 1, elements.data());
+            break;
+        case 4:
+            glUniform4iv(location, 1, elements.data());
+            break;
+        }
+    }
+    for (auto it = floatUniforms.begin(); it != floatUniforms.end(); ++it) {
+        GLint location = glGetUniformLocation(program, it->first.c_str());
+        const std::vector<GLfloat>& elements = it->second.elements;
+        switch (elements.size()) {
+        case 1:
+            glUniform1fv(location, 1, elements.data());
+            break;
+        case 2:
+            glUniform2fv(location, 1, elements.data());
+            break;
+        case 3:
+            glUniform3fv(location, 1, elements.data());
+            break;
+        case 4:
+            glUniform4fv(location, 1, elements.data());
+            break;
+        }
+    }
+    for (auto it = boolUniforms.begin(); it != boolUniforms.end(); ++it) {
+        GLint location = glGetUniformLocation(program, it->first.c_str());
+        if (!it->second.elements.empty()) {
+            glUniform1i(location, it->second.elements.front());
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef PROGRAM_BUILDER_H
+#define PROGRAM_BUILDER_H
+
+#include <gl.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opengl/Uniform.hpp>
+#include <util/ProgramBinaryFile.hpp>
+
+class ShaderSandbox;
+
+#define DEFAULT_VERTEX_SHADER_PATH "vertex.glsl"
+#define DEFAULT_LIBRARY_SHADER_PATH "lib/common.glsl"
+#define DEFAULT_PROGRAM_CACHE_DIRECTORY "cache/programs"
+
+struct ProgramCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    // Binaries the driver refused, usually because it was updated since they were saved
+    size_t rejected = 0;
+    size_t stored = 0;
+};
+
+/*
+Builds wallpaper programs from a fragment shader, the engine's vertex shader and the shader library. Linked programs
+are saved as driver binaries keyed by their sources and the driver, so a shader built before is loaded instead of
+compiled. Constructed with a context current, after which programs can be built on any thread whose context shares
+objects with it, which is how quality tiers are compiled on the GL worker. Given a sandbox, new programs are built in
+its worker processes and only the binary of one that compiled, linked and drew a frame there is loaded.
+*/
+class ProgramBuilder {
+private:
+    GLuint uVertexShader = 0;
+    GLuint uLibraryShader = 0;
+    // Separable vertex program the wallpaper programs are paired with, unused when mUseSeparablePrograms is false
+    GLuint uVertexProgram = 0;
+    bool mUseSeparablePrograms = false;
+    bool mSupportsBinaries = false;
+    bool mUseBinaryCache = false;
+    std::string mVertexSource;
+    std::string mLibrarySource;
+    std::string mCacheDirectory;
+    uint64_t mDriverHash = 0;
+    ShaderSandbox* pSandbox = nullptr;
+    mutable std::atomic<size_t> mCacheHits = 0;
+    mutable std::atomic<size_t> mCacheMisses = 0;
+    mutable std::atomic<size_t> mCacheRejected = 0;
+    mutable std::atomic<size_t> mCacheStored = 0;
+
+    void LoadVertexShader(const std::string& path);
+    void LoadLibraryShader(const std::string& path);
+    void CreateVertexProgram();
+    void InitBinaryCache();
+    std::string GetCachePath(uint64_t key) const;
+    GLuint CompileInProcess(const std::string& fragmentSource, const std::vector<std::string>* files, std::string* log) const;
+public:
+    // An empty cache directory compiles every program, and without a sandbox they are compiled in this process
+    ProgramBuilder(const std::string& vertexPath = DEFAULT_VERTEX_SHADER_PATH, const std::string& libraryPath = DEFAULT_LIBRARY_SHADER_PATH,
+        const std::string& cacheDirectory = DEFAULT_PROGRAM_CACHE_DIRECTORY, ShaderSandbox* sandbox = nullptr);
+    ~ProgramBuilder();
+    // Files are the names of the source string numbers the shader's #line directives use, for its error messages
+    bool CompileShader(GLenum type, const std::string& source, GLuint* shaderIn, const std::vector<std::string>* files = nullptr,
+        std::string* log = nullptr) const;
+    // The colour output named, if any, is bound to location 0, the shader library declares its own output at location 1
+    bool LinkProgram(GLuint fragmentShader, const std::string& colourOutput, GLuint* programIn, std::string* log = nullptr) const;
+    // Load the program from the cache or compile and link it, 0 if it fails with the reason logged and copied to log.
+    // A timeout other than zero replaces the sandbox's own.
+    GLuint BuildProgram(const std::string& fragmentSource, const std::vector<std::string>* files = nullptr, std::string* log = nullptr,
+        bool* cached = nullptr, double timeoutSeconds = 0.0) const;
+    // Compile and link without going through the cache, for programs unlikely to be built again
+    GLuint CompileProgram(const std::string& fragmentSource, const std::vector<std::string>* files = nullptr, std::string* log = nullptr,
+        double timeoutSeconds = 0.0) const;
+    // Identifies a program built from the fragment source by this driver
+    uint64_t GetProgramKey(const std::string& fragmentSource) const;
+    bool GetProgramBinary(GLuint program, ProgramBinary* out) const;
+    // Create a program from a binary, 0 if the driver does not accept it
+    GLuint LoadProgramBinary(const ProgramBinary& binary) const;
+    bool UsesSeparablePrograms() const;
+    GLuint GetVertexProgram() const;
+    const std::string& GetLibrarySource() const;
+    ProgramCacheStats GetCacheStats() const;
+
+    ProgramBuilder(const ProgramBuilder& arg) = delete;
+    ProgramBuilder(const ProgramBuilder&& arg) = delete;
+    ProgramBuilder& operator=(const ProgramBuilder& arg) = delete;
+    ProgramBuilder& operator=(const ProgramBuilder&& arg) = delete;
+};
+
+// Give every sampler the program declares a unit of its own, counting up from 0, for drawing it without its textures.
+// Nothing has to be bound to them, but two sampler types left sharing unit 0 make the draw fail. The program has to
+// be the one glUniform calls go to.
+void SpreadSamplerUnits(GLuint program);
+// Set the values of a wallpaper's own uniforms on the program, looked up by name. The program has to be the one
+// glUniform calls go to.
+void SetUniformValues(GLuint program, const std::unordered_map<std::string, Uniform<GLint>>& intUniforms,
+    const std::unordered_map<std::string, Uniform<GLfloat>>& floatUniforms, const std::unordered_map<std::string, Uniform<GLboolean>>& boolUniforms);
+
+#endif // !PROGRAM_BUILDER_H
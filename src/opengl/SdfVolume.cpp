@@ -0,0 +1,93 @@
+#include <opengl/SdfVolume.hpp>
+
+SdfVolume::SdfVolume(int resolution) : mResolution(resolution)
+{
+    // Half floats keep plenty of precision for distances at half the memory of full floats, and are renderable
+    glGenTextures(1, &uTexture);
+    glBindTexture(GL_TEXTURE_3D, uTexture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, mResolution, mResolution, mResolution, 0, GL_RED, GL_HALF_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glGenFramebuffers(1, &uFramebuffer);
+    glGenQueries(1, &uQuery);
+}
+
+SdfVolume::~SdfVolume()
+{
+    glDeleteQueries(1, &uQuery);
+    glDeleteFramebuffers(1, &uFramebuffer);
+    glDeleteTextures(1, &uTexture);
+}
+
+void SdfVolume::Bake(GLint sliceLocation)
+{
+    // A bake still being timed is overwritten, only the latest one is reported
+    if (!mTiming) {
+        glBeginQuery(GL_TIME_ELAPSED, uQuery);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, uFramebuffer);
+    const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0 };
+    glDrawBuffers(1, drawBuffers);
+    glViewport(0, 0, mResolution, mResolution);
+    for (int slice = 0; slice < mResolution; slice++) {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, uTexture, 0, slice);
+        glUniform1f(sliceLocation, static_cast<float>(slice));
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!mTiming) {
+        glEndQuery(GL_TIME_ELAPSED);
+        mTiming = true;
+    }
+}
+
+bool SdfVolume::CollectBakeTime()
+{
+    if (!mTiming) {
+        return false;
+    }
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(uQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE) {
+        return false;
+    }
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(uQuery, GL_QUERY_RESULT, &nanoseconds);
+    mBakeMilliseconds = static_cast<double>(nanoseconds) / 1.0e6;
+    mTiming = false;
+    mHasBakeTime = true;
+    return true;
+}
+
+void SdfVolume::Bind(GLint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    glBindTexture(GL_TEXTURE_3D, uTexture);
+}
+
+int SdfVolume::GetResolution() const
+{
+    return mResolution;
+}
+
+size_t SdfVolume::GetBytes() const
+{
+    return static_cast<size_t>(mResolution) * static_cast<size_t>(mResolution) * static_cast<size_t>(mResolution) * 2;
+}
+
+bool SdfVolume::HasBakeTime() const
+{
+    return mHasBakeTime;
+}
+
+double SdfVolume::GetBakeMilliseconds() const
+{
+    return mBakeMilliseconds;
+}
@@ -0,0 +1,44 @@
+#ifndef SDF_VOLUME_H
+#define SDF_VOLUME_H
+
+#include <gl.h>
+#include <cstddef>
+
+// Texels along each side of a baked volume when the metadata doesn't give one, and the most allowed
+constexpr int DEFAULT_SDF_RESOLUTION = 64;
+constexpr int MAX_SDF_RESOLUTION = 256;
+
+/*
+A signed distance function baked into a cube of half float texels by drawing the bake program once per slice.
+Bake times are read back from a timer query once the GPU has finished, so baking never waits on it.
+*/
+class SdfVolume {
+private:
+    GLuint uTexture = 0;
+    GLuint uFramebuffer = 0;
+    GLuint uQuery = 0;
+    int mResolution = 0;
+    bool mTiming = false;
+    bool mHasBakeTime = false;
+    double mBakeMilliseconds = 0.0;
+public:
+    SdfVolume(int resolution);
+    ~SdfVolume();
+    // Draw every slice with the bound program, which reads the slice index from sliceLocation. Leaves the
+    // default framebuffer bound and the viewport covering the volume.
+    void Bake(GLint sliceLocation);
+    // Read back the time the last bake took on the GPU if it has finished, returns true the first time it has
+    bool CollectBakeTime();
+    void Bind(GLint unit) const;
+    int GetResolution() const;
+    size_t GetBytes() const;
+    bool HasBakeTime() const;
+    double GetBakeMilliseconds() const;
+
+    SdfVolume(const SdfVolume& arg) = delete;
+    SdfVolume(const SdfVolume&& arg) = delete;
+    SdfVolume& operator=(const SdfVolume& arg) = delete;
+    SdfVolume& operator=(const SdfVolume&& arg) = delete;
+};
+
+#endif // !SDF_VOLUME_H
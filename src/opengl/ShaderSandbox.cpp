@@ -0,0 +1,407 @@
+#include <opengl/ShaderSandbox.hpp>
+#include <gl.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <opengl/Framebuffer.hpp>
+#include <opengl/ProgramBuilder.hpp>
+#include <util/Log.hpp>
+
+// Sent by a worker once its context and the engine shaders are ready
+constexpr uint32_t SHADER_WORKER_MAGIC = 0x57535357; // 'WSSW'
+// Anything longer than this in a message means the stream is corrupt
+constexpr uint32_t MAX_MESSAGE_BYTES = 256u * 1024u * 1024u;
+
+constexpr uint32_t STATUS_COMPILED = 0;
+constexpr uint32_t STATUS_FAILED = 1;
+
+static void AppendUint32(std::string* message, uint32_t value)
+{
+    message->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void AppendBytes(std::string* message, const void* data, size_t size)
+{
+    AppendUint32(message, static_cast<uint32_t>(size));
+    message->append(static_cast<const char*>(data), size);
+}
+
+static void AppendString(std::string* message, const std::string& value)
+{
+    AppendBytes(message, value.data(), value.size());
+}
+
+static std::chrono::steady_clock::time_point DeadlineAfter(double seconds)
+{
+    return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+static bool ReadUint32(ChildProcess& process, uint32_t* value, std::chrono::steady_clock::time_point deadline)
+{
+    return process.Read(value, sizeof(*value), deadline);
+}
+
+template<typename T>
+static bool ReadBytes(ChildProcess& process, T* out, std::chrono::steady_clock::time_point deadline)
+{
+    uint32_t size = 0;
+    if (!ReadUint32(process, &size, deadline) || size > MAX_MESSAGE_BYTES) {
+        return false;
+    }
+    out->resize(size);
+    return size == 0 || process.Read(out->data(), size, deadline);
+}
+
+ShaderSandbox::ShaderSandbox(const std::string& executable, const std::string& vertexPath, const std::string& libraryPath, size_t maxWorkers,
+    double timeoutSeconds) :
+    mExecutable(executable), mArguments{ SHADER_WORKER_ARGUMENT, vertexPath, libraryPath }, mMaxWorkers(std::max<size_t>(maxWorkers, 1)),
+    mTimeoutSeconds(timeoutSeconds)
+{
+    // The first worker creates its context while the engine starts up, it is only waited for when first used
+    auto worker = std::make_unique<Worker>();
+    if (StartWorker(worker.get())) {
+        mIdleWorkers.push_back(std::move(worker));
+        mWorkerCount++;
+    }
+}
+
+ShaderSandbox::~ShaderSandbox()
+{
+    // Closing their input lets workers exit on their own
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIdleWorkers.clear();
+}
+
+bool ShaderSandbox::StartWorker(Worker* worker)
+{
+    worker->ready = false;
+    if (mExecutable.empty() || !worker->process.Start(mExecutable, mArguments)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.workersStarted++;
+    return true;
+}
+
+bool ShaderSandbox::WaitUntilReady(Worker* worker)
+{
+    if (!worker->ready) {
+        uint32_t magic = 0;
+        worker->ready = ReadUint32(worker->process, &magic, DeadlineAfter(SHADER_WORKER_START_SECONDS)) && magic == SHADER_WORKER_MAGIC;
+    }
+    return worker->ready;
+}
+
+std::unique_ptr<ShaderSandbox::Worker> ShaderSandbox::AcquireWorker(std::chrono::steady_clock::time_point deadline, bool* timedOut)
+{
+    std::unique_ptr<Worker> worker = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto retrying = [this]() { return std::chrono::steady_clock::now() < mRetryTime; };
+        bool acquired = mCondition.wait_until(lock, deadline, [this, &retrying]() {
+            return retrying() || !mIdleWorkers.empty() || mWorkerCount < mMaxWorkers;
+        });
+        if (!acquired) {
+            *timedOut = true;
+            return nullptr;
+        }
+        if (retrying()) {
+            return nullptr;
+        }
+        if (!mIdleWorkers.empty()) {
+            worker = std::move(mIdleWorkers.back());
+            mIdleWorkers.pop_back();
+        }
+        else {
+            mWorkerCount++;
+        }
+    }
+
+    // A worker that died while idle is replaced rather than blamed on the next shader
+    bool started = true;
+    if (worker == nullptr) {
+        worker = std::make_unique<Worker>();
+        started = StartWorker(worker.get());
+    }
+    else if (!worker->process.IsRunning()) {
+        started = StartWorker(worker.get());
+    }
+    if (started && WaitUntilReady(worker.get())) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRetrySeconds = SHADER_WORKER_RETRY_SECONDS;
+        return worker;
+    }
+
+    worker->process.Kill();
+    {
+        // Whatever kept it from starting may pass, a driver update or a busy machine, so it is tried again later
+        std::lock_guard<std::mutex> lock(mMutex);
+        LOG_WARNING("Could not start a shader worker from {}, shaders will be compiled in process for {:.0f} s", mExecutable, mRetrySeconds);
+        mRetryTime = DeadlineAfter(mRetrySeconds);
+        mRetrySeconds = std::min(mRetrySeconds * 2.0, SHADER_WORKER_MAX_RETRY_SECONDS);
+        mWorkerCount--;
+    }
+    mCondition.notify_all();
+    return nullptr;
+}
+
+void ShaderSandbox::ReleaseWorker(std::unique_ptr<Worker> worker)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (worker != nullptr) {
+            mIdleWorkers.push_back(std::move(worker));
+        }
+        else {
+            mWorkerCount--;
+        }
+    }
+    mCondition.notify_one();
+}
+
+void ShaderSandbox::RecordResult(const SandboxResult& result)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    switch (result.status) {
+    case SandboxStatus::Compiled:
+        mStats.compiled++;
+        break;
+    case SandboxStatus::Failed:
+        mStats.failed++;
+        break;
+    case SandboxStatus::TimedOut:
+        mStats.timedOut++;
+        break;
+    case SandboxStatus::Crashed:
+        mStats.crashed++;
+        break;
+    case SandboxStatus::Unavailable:
+        return;
+    }
+    mStats.slowestMilliseconds = std::max(mStats.slowestMilliseconds, result.milliseconds);
+}
+
+SandboxResult ShaderSandbox::Compile(const std::string& fragmentSource, const std::vector<std::string>* files, double timeoutSeconds)
+{
+    if (timeoutSeconds <= 0.0) {
+        timeoutSeconds = mTimeoutSeconds;
+    }
+    // Waiting for a worker counts against the timeout too, other threads' compiles can hold every worker
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = DeadlineAfter(timeoutSeconds);
+    SandboxResult result{};
+    bool waitTimedOut = false;
+    std::unique_ptr<Worker> worker = AcquireWorker(deadline, &waitTimedOut);
+    if (waitTimedOut) {
+        // Compiling in process instead could hang for as long as the sandbox is there to stop, so the shader is refused
+        result.status = SandboxStatus::TimedOut;
+        result.log = fmt::format("No shader worker was free within {:.1f} s", timeoutSeconds);
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+    if (worker == nullptr) {
+        return result;
+    }
+
+    std::string request;
+    AppendString(&request, fragmentSource);
+    AppendUint32(&request, files != nullptr ? static_cast<uint32_t>(files->size()) : 0);
+    if (files != nullptr) {
+        for (const std::string& file : *files) {
+            AppendString(&request, file);
+        }
+    }
+
+    uint32_t status = STATUS_FAILED;
+    uint32_t format = 0;
+    bool answered = worker->process.Write(request.data(), request.size()) && ReadUint32(worker->process, &status, deadline) &&
+        ReadBytes(worker->process, &result.log, deadline) && ReadUint32(worker->process, &format, deadline) &&
+        ReadBytes(worker->process, &result.binary.data, deadline);
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (answered) {
+        result.status = status == STATUS_COMPILED ? SandboxStatus::Compiled : SandboxStatus::Failed;
+        result.binary.format = format;
+        ReleaseWorker(std::move(worker));
+    }
+    else {
+        // Whatever state the worker is in it can't be trusted with another shader
+        bool timedOut = std::chrono::steady_clock::now() >= deadline;
+        worker->process.Kill();
+        ReleaseWorker(nullptr);
+        result.status = timedOut ? SandboxStatus::TimedOut : SandboxStatus::Crashed;
+        result.log = timedOut ? fmt::format("The shader took longer than {:.1f} s to build and was killed", timeoutSeconds) :
+            std::string("The shader worker exited while building the shader");
+        result.binary = ProgramBinary{};
+    }
+    RecordResult(result);
+    return result;
+}
+
+bool ShaderSandbox::IsAvailable() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return std::chrono::steady_clock::now() >= mRetryTime;
+}
+
+ShaderSandboxStats ShaderSandbox::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+static bool ReadParentUint32(uint32_t* value)
+{
+    return ReadFromParent(value, sizeof(*value));
+}
+
+static bool ReadParentString(std::string* out)
+{
+    uint32_t size = 0;
+    if (!ReadParentUint32(&size) || size > MAX_MESSAGE_BYTES) {
+        return false;
+    }
+    out->resize(size);
+    return size == 0 || ReadFromParent(out->data(), size);
+}
+
+// Drivers often finish compiling on the first draw, and waiting for the frame puts a shader that never finishes on
+// the worker's timeout instead of the engine's first frame. Returns the GL error the draw raised, as a draw that
+// raised one did no work and proves nothing about the shader.
+static GLenum DrawTestFrame(GLuint program, GLuint pipeline, GLuint vertexArray, const Framebuffer& framebuffer)
+{
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    if (pipeline != 0) {
+        glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, program);
+        glActiveShaderProgram(pipeline, program);
+    }
+    else {
+        glUseProgram(program);
+    }
+    SpreadSamplerUnits(program);
+    glUniform2f(glGetUniformLocation(program, "iResolution"), static_cast<float>(SHADER_TEST_SIZE), static_cast<float>(SHADER_TEST_SIZE));
+    glUniform2f(glGetUniformLocation(program, "iMouse"), SHADER_TEST_SIZE * 0.5f, SHADER_TEST_SIZE * 0.5f);
+    framebuffer.Bind();
+    glViewport(0, 0, SHADER_TEST_SIZE, SHADER_TEST_SIZE);
+    glBindVertexArray(vertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glFinish();
+    GLenum error = glGetError();
+    if (pipeline != 0) {
+        glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, 0);
+    }
+    else {
+        glUseProgram(0);
+    }
+    return error;
+}
+
+static void ServeShaderRequests(const ProgramBuilder& builder)
+{
+    Framebuffer framebuffer(SHADER_TEST_SIZE, SHADER_TEST_SIZE);
+    GLuint vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+    GLuint pipeline = 0;
+    if (builder.UsesSeparablePrograms()) {
+        glGenProgramPipelines(1, &pipeline);
+        glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, builder.GetVertexProgram());
+        glBindProgramPipeline(pipeline);
+    }
+
+    std::string ready;
+    AppendUint32(&ready, SHADER_WORKER_MAGIC);
+    bool serving = WriteToParent(ready.data(), ready.size());
+    while (serving) {
+        // The parent closing the pipe is the signal to exit
+        std::string source;
+        uint32_t fileCount = 0;
+        if (!ReadParentString(&source) || !ReadParentUint32(&fileCount)) {
+            break;
+        }
+        std::vector<std::string> files(fileCount);
+        for (std::string& file : files) {
+            serving = serving && ReadParentString(&file);
+        }
+        if (!serving) {
+            break;
+        }
+
+        std::string log;
+        ProgramBinary binary{};
+        GLuint program = builder.CompileProgram(source, &files, &log);
+        bool compiled = program != 0;
+        if (compiled) {
+            GLenum error = DrawTestFrame(program, pipeline, vertexArray, framebuffer);
+            if (error == GL_NO_ERROR) {
+                // A program the driver gives no binary for still passed, the parent compiles it again itself
+                builder.GetProgramBinary(program, &binary);
+            }
+            else {
+                log += fmt::format("Drawing a test frame with the shader raised GL error 0x{:04X}\n", error);
+                compiled = false;
+            }
+            glDeleteProgram(program);
+        }
+
+        std::string response;
+        AppendUint32(&response, compiled ? STATUS_COMPILED : STATUS_FAILED);
+        AppendString(&response, log);
+        AppendUint32(&response, binary.format);
+        AppendBytes(&response, binary.data.data(), binary.data.size());
+        serving = WriteToParent(response.data(), response.size());
+    }
+
+    glDeleteProgramPipelines(1, &pipeline);
+    glDeleteVertexArrays(1, &vertexArray);
+}
+
+int RunShaderWorker(int argc, char** argv)
+{
+    if (!OpenParentChannel()) {
+        return EXIT_FAILURE;
+    }
+    Log::Init();
+    // The parent logs the results it is sent, the worker only reports what stops it from working
+    Log::GetLogger()->set_level(spdlog::level::critical);
+    if (argc < 4) {
+        LOG_CRITICAL("Usage: {} <vertex shader> <shader library>", SHADER_WORKER_ARGUMENT);
+        return EXIT_FAILURE;
+    }
+    if (!glfwInit()) {
+        LOG_CRITICAL("Failed to initialise GLFW in shader worker");
+        return EXIT_FAILURE;
+    }
+
+    // Same context version as the wallpaper window so the binaries it sends back load there
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(SHADER_TEST_SIZE, SHADER_TEST_SIZE, "Shader Worker", NULL, NULL);
+    int exitCode = EXIT_FAILURE;
+    if (window == NULL) {
+        LOG_CRITICAL("Failed to create shader worker window");
+    }
+    else {
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGL(static_cast<GLADloadfunc>(glfwGetProcAddress))) {
+            LOG_CRITICAL("Failed to initialise GLAD in shader worker");
+        }
+        else {
+            try {
+                ProgramBuilder builder(argv[2], argv[3], std::string());
+                ServeShaderRequests(builder);
+                exitCode = EXIT_SUCCESS;
+            }
+            catch (const std::runtime_error& e) {
+                LOG_CRITICAL(e.what());
+            }
+        }
+        glfwDestroyWindow(window);
+    }
+    glfwTerminate();
+    return exitCode;
+}
@@ -0,0 +1,114 @@
+#ifndef SHADER_SANDBOX_H
+#define SHADER_SANDBOX_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <util/ChildProcess.hpp>
+#include <util/ProgramBinaryFile.hpp>
+
+// Passed to an executable to run it as a shader worker instead of its usual self
+#define SHADER_WORKER_ARGUMENT "--shader-worker"
+
+// Longest a worker may take to compile, link and draw with one program before it is killed and the shader rejected
+constexpr double DEFAULT_SHADER_TIMEOUT_SECONDS = 10.0;
+// Timeout for compiles the render thread waits on, where the desktop would stay frozen for as long as they take
+constexpr double INTERACTIVE_SHADER_TIMEOUT_SECONDS = 3.0;
+// Longest a new worker may take to create its context and report that it is ready
+constexpr double SHADER_WORKER_START_SECONDS = 10.0;
+// After a worker fails to start shaders are compiled in process for this long before trying again, doubling with every
+// failure in a row up to the maximum
+constexpr double SHADER_WORKER_RETRY_SECONDS = 5.0;
+constexpr double SHADER_WORKER_MAX_RETRY_SECONDS = 300.0;
+constexpr size_t DEFAULT_SHADER_WORKERS = 2;
+// Size of the frame a worker draws with every program, drivers often finish compiling a shader on its first draw
+constexpr int SHADER_TEST_SIZE = 64;
+
+enum class SandboxStatus {
+    Compiled,
+    // The shader did not compile or link, the log says why
+    Failed,
+    TimedOut,
+    Crashed,
+    // No worker could be started lately, the caller has to compile in process
+    Unavailable
+};
+
+struct SandboxResult {
+    SandboxStatus status = SandboxStatus::Unavailable;
+    // Compile or link log of a shader that failed, or what happened to the worker
+    std::string log;
+    ProgramBinary binary{};
+    double milliseconds = 0.0;
+};
+
+struct ShaderSandboxStats {
+    size_t compiled = 0;
+    size_t failed = 0;
+    size_t timedOut = 0;
+    size_t crashed = 0;
+    size_t workersStarted = 0;
+    double slowestMilliseconds = 0.0;
+};
+
+/*
+Compiles shaders in worker processes, each a copy of the running executable with a hidden context of its own, so a
+shader that hangs or crashes the driver takes a worker down instead of the engine. A worker compiles and links the
+program, draws a small frame with it and sends back the log and the program binary, and is killed if that takes
+longer than the timeout. Workers are started when first needed and kept for the next shader, and each call gets a
+worker to itself so several threads can compile at once.
+*/
+class ShaderSandbox {
+private:
+    struct Worker {
+        ChildProcess process;
+        bool ready = false;
+    };
+
+    std::string mExecutable;
+    std::vector<std::string> mArguments;
+    size_t mMaxWorkers = DEFAULT_SHADER_WORKERS;
+    double mTimeoutSeconds = DEFAULT_SHADER_TIMEOUT_SECONDS;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::unique_ptr<Worker>> mIdleWorkers;
+    // Idle workers and the ones lent out to a call
+    size_t mWorkerCount = 0;
+    // Workers are not started again until then after one failed to
+    std::chrono::steady_clock::time_point mRetryTime{};
+    double mRetrySeconds = SHADER_WORKER_RETRY_SECONDS;
+    ShaderSandboxStats mStats{};
+
+    bool StartWorker(Worker* worker);
+    bool WaitUntilReady(Worker* worker);
+    // Null if no worker is free by the deadline, which sets timedOut, or none could be started
+    std::unique_ptr<Worker> AcquireWorker(std::chrono::steady_clock::time_point deadline, bool* timedOut);
+    void ReleaseWorker(std::unique_ptr<Worker> worker);
+    void RecordResult(const SandboxResult& result);
+public:
+    // Workers run the executable with SHADER_WORKER_ARGUMENT, which has to hand over to RunShaderWorker
+    ShaderSandbox(const std::string& executable, const std::string& vertexPath, const std::string& libraryPath,
+        size_t maxWorkers = DEFAULT_SHADER_WORKERS, double timeoutSeconds = DEFAULT_SHADER_TIMEOUT_SECONDS);
+    ~ShaderSandbox();
+    // Build the program in a worker, waiting until it answers or the timeout passes, the sandbox's own if it is zero.
+    // The timeout includes waiting for a free worker. Files name the source string numbers in the log, as for
+    // ProgramBuilder::CompileShader.
+    SandboxResult Compile(const std::string& fragmentSource, const std::vector<std::string>* files = nullptr, double timeoutSeconds = 0.0);
+    // False while workers are not being started after one failed to
+    bool IsAvailable() const;
+    ShaderSandboxStats GetStats() const;
+
+    ShaderSandbox(const ShaderSandbox& arg) = delete;
+    ShaderSandbox(const ShaderSandbox&& arg) = delete;
+    ShaderSandbox& operator=(const ShaderSandbox& arg) = delete;
+    ShaderSandbox& operator=(const ShaderSandbox&& arg) = delete;
+};
+
+// Entry point of a worker, for main to call when the first argument is SHADER_WORKER_ARGUMENT
+int RunShaderWorker(int argc, char** argv);
+
+#endif // !SHADER_SANDBOX_H
@@ -28,7 +28,7 @@ GLenum GetTextureFormat(int numComponents) {
     }
 }
 
-Texture::Texture(Texture&& other) noexcept : uID(other.uID)
+Texture::Texture(Texture&& other) noexcept : uID(other.uID), mWidth(other.mWidth), mHeight(other.mHeight), mLevelCount(other.mLevelCount), mSampling(other.mSampling), mReady(other.mReady)
 {
     other.uID = 0;
 }
@@ -39,6 +39,11 @@ Texture& Texture::operator=(Texture&& other) noexcept
     {
         glDeleteTextures(1, &uID);
         uID = other.uID;
+        mWidth = other.mWidth;
+        mHeight = other.mHeight;
+        mLevelCount = other.mLevelCount;
+        mSampling = other.mSampling;
+        mReady = other.mReady;
         other.uID = 0;
     }
     return *this;
@@ -64,6 +69,9 @@ Texture::Texture(std::string path)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        mWidth = width;
+        mHeight = height;
+        mReady = true;
     }
     else {
         LOG_ERROR("Failed to load texture at path {}", path);
@@ -71,6 +79,34 @@ Texture::Texture(std::string path)
     stbi_image_free(data);
 }
 
+Texture::Texture(int width, int height, const TextureSampling& sampling) : mWidth(width), mHeight(height), mSampling(sampling)
+{
+    glGenTextures(1, &uID);
+    glBindTexture(GL_TEXTURE_2D, uID);
+    if (sampling.mipmaps) {
+        for (int size = std::max(width, height); size > 1; size /= 2) {
+            mLevelCount++;
+        }
+        if (sampling.levelLimit > 0) {
+            mLevelCount = std::min(mLevelCount, sampling.levelLimit);
+        }
+    }
+    for (int level = 0; level < mLevelCount; level++) {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(width >> level, 1), std::max(height >> level, 1), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mLevelCount - 1);
+
+    GLenum minFilter = sampling.filter;
+    if (sampling.mipmaps) {
+        minFilter = sampling.filter == GL_NEAREST ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR_MIPMAP_LINEAR;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLint>(sampling.wrap));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLint>(sampling.wrap));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(minFilter));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(sampling.filter));
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 
 Texture::~Texture()
 {
@@ -87,6 +123,43 @@ void Texture::Unbind() const
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void Texture::UploadRows(int level, int yOffset, int rows, const void* pixels) const
+{
+    glBindTexture(GL_TEXTURE_2D, uID);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, yOffset, std::max(mWidth >> level, 1), rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture::FinishUpload(int uploadedLevels)
+{
+    if (mSampling.mipmaps && uploadedLevels < mLevelCount) {
+        glBindTexture(GL_TEXTURE_2D, uID);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    mReady = true;
+}
+
+bool Texture::IsReady() const
+{
+    return mReady;
+}
+
+int Texture::GetWidth() const
+{
+    return mWidth;
+}
+
+int Texture::GetHeight() const
+{
+    return mHeight;
+}
+
+int Texture::GetLevelCount() const
+{
+    return mLevelCount;
+}
+
 /*
 MIT License
 
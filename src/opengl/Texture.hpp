@@ -9,6 +9,21 @@ License: MIT
 #include <glad/gl.h>
 #include <string>
 #include <array>
+#include <util/Mipmap.hpp>
+
+/*
+How a texture is sampled, declared per texture in wallpaper metadata
+*/
+struct TextureSampling {
+    GLenum filter = GL_LINEAR;
+    GLenum wrap = GL_REPEAT;
+    bool mipmaps = true;
+    // How the mip chain is built on the CPU before it is uploaded
+    MipFilter mipFilter = MipFilter::Box;
+    bool srgb = true;
+    // Most levels allocated including the base, 0 for the whole chain. Atlases stop before sprites bleed together.
+    int levelLimit = 0;
+};
 
 /*
 Wrapper class for an OpenGL texture object
@@ -16,15 +31,31 @@ Wrapper class for an OpenGL texture object
 class Texture {
 private:
     GLuint uID{};
+    int mWidth = 0;
+    int mHeight = 0;
+    int mLevelCount = 1;
+    TextureSampling mSampling{};
+    bool mReady = false;
 public:
     Texture(const Texture&) = delete;
     Texture& operator=(const Texture&) = delete;
     Texture(Texture&& other) noexcept;
     Texture& operator=(Texture&& other) noexcept;
     Texture(std::string path);
+    // Allocate an empty RGBA8 texture, with every mip level if the sampling uses them, whose contents are
+    // streamed in later with UploadRows
+    Texture(int width, int height, const TextureSampling& sampling);
     ~Texture();
     void Bind() const;
     void Unbind() const;
+    // Upload rows of RGBA8 pixels to a mip level, pixels is an offset into the bound pixel unpack buffer if there is one
+    void UploadRows(int level, int yOffset, int rows, const void* pixels) const;
+    // Called once every row is uploaded, generates any mip levels past uploadedLevels if the sampling uses them
+    void FinishUpload(int uploadedLevels);
+    bool IsReady() const;
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetLevelCount() const;
 };
 
 #endif // !TEXTURE_H
@@ -0,0 +1,171 @@
+#include <opengl/TextureCache.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+
+static TextureLoad LoadTexture(const std::string& diskCacheDirectory, uint64_t contentHash, const std::vector<unsigned char>& encoded, const MipOptions& mipOptions)
+{
+    // The same image filtered differently gets its own file
+    uint64_t mipBits[] = { static_cast<uint64_t>(mipOptions.filter), mipOptions.srgb ? 1ull : 0ull };
+    uint64_t fileKey = HashBytes(mipBits, sizeof(mipBits), contentHash);
+
+    TextureLoad load{};
+    std::string path;
+    if (!diskCacheDirectory.empty()) {
+        path = (std::filesystem::path(diskCacheDirectory) / (HashToHex(fileKey) + ".wptx")).string();
+        if (ReadTextureFile(path, fileKey, &load.payload)) {
+            load.fromDiskCache = true;
+            return load;
+        }
+    }
+
+    Image image{};
+    if (!DecodeImage(encoded.data(), encoded.size(), &image)) {
+        return load;
+    }
+    load.payload = BuildTexturePayload(std::move(image), mipOptions);
+
+    if (!path.empty()) {
+        // Write to a file of our own and rename it into place, so a reader never maps a half written file
+        // and two workers building the same texture can't interleave
+        std::error_code error;
+        std::filesystem::create_directories(diskCacheDirectory, error);
+        std::string temporaryPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+        if (WriteTextureFile(temporaryPath, fileKey, load.payload)) {
+            std::filesystem::rename(temporaryPath, path, error);
+        }
+        if (error) {
+            LOG_WARNING("Could not write texture file {}: {}", path, error.message());
+            std::filesystem::remove(temporaryPath, error);
+        }
+    }
+    return load;
+}
+
+TextureCache::TextureCache(ThreadPool& pool, ThreadPool& mipPool, TextureUploader& uploader, size_t budgetBytes, const std::string& diskCacheDirectory) :
+    mPool(pool), mMipPool(mipPool), mUploader(uploader), mBudgetBytes(budgetBytes), mDiskCacheDirectory(diskCacheDirectory)
+{
+
+}
+
+TextureHandle TextureCache::Acquire(uint64_t contentHash, const TextureSampling& sampling, std::shared_ptr<const std::vector<unsigned char>> encoded,
+    const std::string& path)
+{
+    // The same image sampled differently needs its own texture object
+    uint64_t samplingBits[] = { sampling.filter, sampling.wrap, sampling.mipmaps ? 1ull : 0ull,
+        static_cast<uint64_t>(sampling.mipFilter), sampling.srgb ? 1ull : 0ull, static_cast<uint64_t>(sampling.levelLimit) };
+    uint64_t key = HashBytes(samplingBits, sizeof(samplingBits), contentHash);
+
+    auto find = mEntries.find(key);
+    if (find != mEntries.end()) {
+        mHits++;
+        return find->second;
+    }
+
+    mMisses++;
+    TextureHandle entry = std::make_shared<CachedTexture>();
+    entry->key = key;
+    entry->path = path;
+    entry->sampling = sampling;
+    MipOptions mipOptions{ sampling.mipFilter, sampling.srgb, &mMipPool };
+    entry->pendingLoad = mPool.Submit([directory = mDiskCacheDirectory, contentHash, encoded, mipOptions]() {
+        return LoadTexture(directory, contentHash, *encoded, mipOptions);
+    });
+    mEntries.insert(std::make_pair(key, entry));
+    return entry;
+}
+
+void TextureCache::Update(double now)
+{
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        CachedTexture& entry = *it->second;
+        if (it->second.use_count() > 1) {
+            entry.lastUsed = now;
+        }
+        if (!IsReady(entry.pendingLoad)) {
+            ++it;
+            continue;
+        }
+
+        TextureLoad load = entry.pendingLoad.get();
+        if (load.payload.Empty()) {
+            // Trim only evicts loaded textures, so a failed entry would stay and be handed out forever
+            LOG_ERROR("Texture {} could not be decoded and will be left black", entry.path);
+            entry.failed = true;
+            it = mEntries.erase(it);
+            continue;
+        }
+        if (load.fromDiskCache) {
+            mDiskHits++;
+        }
+        else if (!mDiskCacheDirectory.empty()) {
+            mDiskMisses++;
+        }
+        const TextureLevel& base = load.payload.levels.front();
+        entry.texture = std::make_shared<Texture>(base.width, base.height, entry.sampling);
+        mUploader.Enqueue(entry.texture, std::move(load.payload));
+        entry.bytes = 0;
+        for (int level = 0; level < entry.texture->GetLevelCount(); level++) {
+            entry.bytes += static_cast<size_t>(std::max(base.width >> level, 1)) * static_cast<size_t>(std::max(base.height >> level, 1)) * Image::CHANNELS;
+        }
+        ++it;
+    }
+    Trim(now);
+}
+
+void TextureCache::Trim(double now)
+{
+    std::vector<TextureHandle> unreferenced;
+    size_t unreferencedBytes = 0;
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        const TextureHandle& entry = it->second;
+        // Entries still decoding or uploading are never evicted, the uploader may hold a reference to them
+        bool loaded = entry->texture != nullptr && entry->texture->IsReady();
+        if (entry.use_count() == 1 && loaded) {
+            unreferenced.push_back(entry);
+            unreferencedBytes += entry->bytes;
+        }
+    }
+    if (unreferencedBytes <= mBudgetBytes) {
+        return;
+    }
+
+    std::sort(unreferenced.begin(), unreferenced.end(), [](const TextureHandle& a, const TextureHandle& b) {
+        return a->lastUsed < b->lastUsed;
+    });
+    for (const TextureHandle& entry : unreferenced) {
+        if (unreferencedBytes <= mBudgetBytes) {
+            break;
+        }
+        LOG_TRACE("Evicting texture {} ({} bytes, unused for {:.1f}s)", HashToHex(entry->key), entry->bytes, now - entry->lastUsed);
+        unreferencedBytes -= entry->bytes;
+        mEntries.erase(entry->key);
+        mEvictions++;
+    }
+}
+
+void TextureCache::Clear()
+{
+    mEntries.clear();
+}
+
+TextureCacheStats TextureCache::GetStats() const
+{
+    TextureCacheStats stats{};
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    stats.diskHits = mDiskHits;
+    stats.diskMisses = mDiskMisses;
+    stats.entries = mEntries.size();
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        stats.residentBytes += it->second->bytes;
+        if (it->second.use_count() == 1) {
+            stats.unreferencedBytes += it->second->bytes;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,97 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opengl/Texture.hpp>
+#include <opengl/TextureUploader.hpp>
+#include <util/TextureFile.hpp>
+#include <util/ThreadPool.hpp>
+
+// Bytes of textures no wallpaper is using that are kept resident in case they are needed again
+constexpr size_t DEFAULT_TEXTURE_CACHE_BUDGET = 512 * 1024 * 1024;
+// Where decoded, mip chained textures are written so later runs can skip decoding, relative to the working directory
+#define DEFAULT_TEXTURE_DISK_CACHE_DIRECTORY "cache/textures"
+
+// Result of loading a texture on the thread pool
+struct TextureLoad {
+    TexturePayload payload;
+    bool fromDiskCache = false;
+};
+
+/*
+A texture shared between every wallpaper that uses the same image with the same sampling
+*/
+struct CachedTexture {
+    uint64_t key = 0;
+    // The image it was first asked for from, for logging
+    std::string path;
+    TextureSampling sampling{};
+    std::shared_ptr<Texture> texture = nullptr;
+    std::future<TextureLoad> pendingLoad;
+    size_t bytes = 0;
+    double lastUsed = 0.0;
+    // Set if the image could not be decoded, the entry has left the cache and texture stays nullptr
+    bool failed = false;
+};
+
+// Handles are reference counted, the cache holds one reference itself so an entry is unused when that is the only one
+using TextureHandle = std::shared_ptr<CachedTexture>;
+
+struct TextureCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t entries = 0;
+    size_t residentBytes = 0;
+    size_t unreferencedBytes = 0;
+    size_t evictions = 0;
+    size_t diskHits = 0;
+    size_t diskMisses = 0;
+};
+
+/*
+Deduplicates textures by file content hash and sampling parameters. The first time an image is asked for
+its texture file is mapped from the disk cache, or the image is decoded and the file written if there isn't
+one, on the thread pool, then streamed in by the uploader. Textures that are no longer referenced
+stay resident until the unreferenced bytes go over the budget, at which point the least recently used are
+evicted.
+*/
+class TextureCache {
+private:
+    ThreadPool& mPool;
+    ThreadPool& mMipPool;
+    TextureUploader& mUploader;
+    std::unordered_map<uint64_t, TextureHandle> mEntries;
+    size_t mBudgetBytes = DEFAULT_TEXTURE_CACHE_BUDGET;
+    std::string mDiskCacheDirectory;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+    size_t mEvictions = 0;
+    size_t mDiskHits = 0;
+    size_t mDiskMisses = 0;
+
+    void Trim(double now);
+public:
+    // Loads run on pool and split mip generation over mipPool. An empty disk cache directory disables the disk cache.
+    TextureCache(ThreadPool& pool, ThreadPool& mipPool, TextureUploader& uploader, size_t budgetBytes = DEFAULT_TEXTURE_CACHE_BUDGET,
+        const std::string& diskCacheDirectory = DEFAULT_TEXTURE_DISK_CACHE_DIRECTORY);
+    // Get the texture for an encoded image read from path, decoding it in the background if it isn't cached yet
+    TextureHandle Acquire(uint64_t contentHash, const TextureSampling& sampling, std::shared_ptr<const std::vector<unsigned char>> encoded,
+        const std::string& path);
+    // Hand finished decodes to the uploader and evict unused textures over budget, call once per frame. Images that
+    // failed to decode are dropped so the next Acquire tries again.
+    void Update(double now);
+    void Clear();
+    TextureCacheStats GetStats() const;
+
+    TextureCache(const TextureCache& arg) = delete;
+    TextureCache(const TextureCache&& arg) = delete;
+    TextureCache& operator=(const TextureCache& arg) = delete;
+    TextureCache& operator=(const TextureCache&& arg) = delete;
+};
+
+#endif // !TEXTURE_CACHE_H
@@ -0,0 +1,39 @@
+#include <opengl/TextureUnits.hpp>
+#include <regex>
+#include <util/Atlas.hpp>
+#include <util/Noise.hpp>
+
+bool SourceReads(const std::string& source, const std::string& name)
+{
+    return std::regex_search(source, std::regex("\\b" + name + "\\b"));
+}
+
+GLint CountTextureUnits(const WallpaperMetadata& metadata, const std::string& source)
+{
+    GLint units = static_cast<GLint>(metadata.textures.size() + 2 * metadata.virtualTextures.size() + metadata.videos.size()) + 1;
+    for (size_t i = 0; i < static_cast<size_t>(NoiseKind::Count); i++) {
+        if (SourceReads(source, GetNoiseUniformName(static_cast<NoiseKind>(i)))) {
+            units++;
+        }
+    }
+    if (!metadata.sdf.function.empty()) {
+        units += ATLAS_MAX_PAGES + 1;
+    }
+    else if (!metadata.sprites.empty()) {
+        units += ATLAS_MAX_PAGES;
+    }
+    return units;
+}
+
+bool CheckTextureUnits(const WallpaperMetadata& metadata, const std::string& source, std::string* error)
+{
+    GLint maxTextureUnits = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+    GLint textureUnits = CountTextureUnits(metadata, source);
+    if (textureUnits <= maxTextureUnits) {
+        return true;
+    }
+    *error = "needs " + std::to_string(textureUnits) + " texture units but the GPU only has " + std::to_string(maxTextureUnits)
+        + ", declare fewer textures, virtual textures or videos";
+    return false;
+}
@@ -0,0 +1,18 @@
+#ifndef TEXTURE_UNITS_H
+#define TEXTURE_UNITS_H
+
+#include <gl.h>
+#include <string>
+#include <opengl/WallpaperMetadata.hpp>
+
+// Whether any quality tier may read the uniform. Every tier is the same source under a different define and only the
+// initial one is linked at load, so the text is searched instead, a name left behind in a comment costs a spare unit.
+bool SourceReads(const std::string& source, const std::string& name);
+// Texture units the wallpaper takes, laid out as WallpaperManager's Load functions do: textures, two per virtual
+// texture, videos, one kept for audio, the noise kinds read, then the atlas pages and the SDF volume after them
+GLint CountTextureUnits(const WallpaperMetadata& metadata, const std::string& source);
+// Units past the fragment stage's limit would fail every glActiveTexture without a word, so a wallpaper needing more
+// than the current context has is refused, with the reason in error
+bool CheckTextureUnits(const WallpaperMetadata& metadata, const std::string& source, std::string* error);
+
+#endif // !TEXTURE_UNITS_H
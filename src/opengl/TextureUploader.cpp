@@ -0,0 +1,79 @@
+#include <opengl/TextureUploader.hpp>
+#include <algorithm>
+#include <cstring>
+
+TextureUploader::TextureUploader()
+{
+    glGenBuffers(1, &uPixelBuffer);
+}
+
+TextureUploader::~TextureUploader()
+{
+    glDeleteBuffers(1, &uPixelBuffer);
+}
+
+void TextureUploader::Enqueue(std::shared_ptr<Texture> texture, TexturePayload payload)
+{
+    // Levels the texture wasn't allocated with, such as a cached mip chain for a texture sampled without mipmaps, are dropped
+    if (payload.levels.size() > static_cast<size_t>(texture->GetLevelCount())) {
+        payload.levels.resize(static_cast<size_t>(texture->GetLevelCount()));
+    }
+    mUploads.push_back(Upload{ std::move(texture), std::move(payload), 0, 0 });
+}
+
+void TextureUploader::Process(size_t byteBudget)
+{
+    if (mUploads.empty()) {
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uPixelBuffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    while (!mUploads.empty() && byteBudget > 0) {
+        Upload& upload = mUploads.front();
+        const TextureLevel& level = upload.payload.levels[upload.level];
+        size_t rowBytes = level.RowBytes();
+
+        // Always move at least one row so a budget smaller than a row can't stall the queue
+        int rows = static_cast<int>(std::max(byteBudget / rowBytes, static_cast<size_t>(1)));
+        rows = std::min(rows, level.height - upload.nextRow);
+        size_t chunkBytes = rowBytes * static_cast<size_t>(rows);
+
+        // Orphan the previous contents so mapping never waits on the GPU finishing the last chunk
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(chunkBytes), nullptr, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(chunkBytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped == nullptr) {
+            break;
+        }
+
+        // Payload rows are already in OpenGL order, so each chunk is a single straight copy
+        std::memcpy(mapped, level.pixels + rowBytes * static_cast<size_t>(upload.nextRow), chunkBytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        upload.texture->UploadRows(static_cast<int>(upload.level), upload.nextRow, rows, nullptr);
+        upload.nextRow += rows;
+        byteBudget -= std::min(byteBudget, chunkBytes);
+
+        if (upload.nextRow == level.height) {
+            upload.nextRow = 0;
+            upload.level++;
+        }
+        if (upload.level == upload.payload.levels.size()) {
+            upload.texture->FinishUpload(static_cast<int>(upload.payload.levels.size()));
+            mUploads.pop_front();
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureUploader::Clear()
+{
+    mUploads.clear();
+}
+
+bool TextureUploader::Empty() const
+{
+    return mUploads.empty();
+}
@@ -0,0 +1,45 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include <gl.h>
+#include <deque>
+#include <memory>
+#include <opengl/Texture.hpp>
+#include <util/TextureFile.hpp>
+
+// Bytes of pixel data streamed to the GPU per frame, large images are spread over several frames
+constexpr size_t UPLOAD_BYTES_PER_FRAME = 16 * 1024 * 1024;
+
+/*
+Streams texture payloads into textures through a pixel unpack buffer a bounded number of bytes per frame,
+so loading large images never produces one long frame. Must be used on the thread owning the context the
+textures are drawn with.
+*/
+class TextureUploader {
+private:
+    struct Upload {
+        std::shared_ptr<Texture> texture;
+        TexturePayload payload;
+        size_t level = 0;
+        int nextRow = 0;
+    };
+
+    GLuint uPixelBuffer = 0;
+    std::deque<Upload> mUploads;
+public:
+    TextureUploader();
+    ~TextureUploader();
+    // Upload every level of the payload, up to the number of levels the texture has
+    void Enqueue(std::shared_ptr<Texture> texture, TexturePayload payload);
+    // Upload up to byteBudget bytes of queued pixel data
+    void Process(size_t byteBudget = UPLOAD_BYTES_PER_FRAME);
+    void Clear();
+    bool Empty() const;
+
+    TextureUploader(const TextureUploader& arg) = delete;
+    TextureUploader(const TextureUploader&& arg) = delete;
+    TextureUploader& operator=(const TextureUploader& arg) = delete;
+    TextureUploader& operator=(const TextureUploader&& arg) = delete;
+};
+
+#endif // !TEXTURE_UPLOADER_H
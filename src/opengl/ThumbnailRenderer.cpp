@@ -0,0 +1,386 @@
+#include <opengl/ThumbnailRenderer.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <opengl/GLWorker.hpp>
+#include <opengl/WallpaperMetadata.hpp>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+#include <util/Mipmap.hpp>
+#include <util/TextureFile.hpp>
+#include <util/WallpaperFile.hpp>
+
+static constexpr int RENDER_WIDTH = THUMBNAIL_WIDTH * THUMBNAIL_SUPERSAMPLE;
+static constexpr int RENDER_HEIGHT = THUMBNAIL_HEIGHT * THUMBNAIL_SUPERSAMPLE;
+static constexpr size_t RENDER_BYTES = static_cast<size_t>(RENDER_WIDTH) * RENDER_HEIGHT * 4;
+
+double ThumbnailStats::ThumbnailsPerSecond() const
+{
+    return busySeconds > 0.0 ? static_cast<double>(rendered) / busySeconds : 0.0;
+}
+
+// Runs on the thread pool. Rows stay bottom up as they were read back, which is the order texture files use.
+static TexturePayload DownscaleThumbnail(std::vector<unsigned char> pixels)
+{
+    Image image{ RENDER_WIDTH, RENDER_HEIGHT, std::move(pixels) };
+    while (image.width > THUMBNAIL_WIDTH) {
+        image = DownsampleImage(image);
+    }
+    // The desktop ignores alpha, so thumbnails do too
+    for (size_t i = 3; i < image.pixels.size(); i += Image::CHANNELS) {
+        image.pixels[i] = 255;
+    }
+
+    auto thumbnail = std::make_shared<std::vector<unsigned char>>(std::move(image.pixels));
+    TexturePayload payload{};
+    payload.levels.push_back(TextureLevel{ image.width, image.height, thumbnail->data(), thumbnail->size() });
+    payload.storage = std::move(thumbnail);
+    return payload;
+}
+
+ThumbnailRenderer::ThumbnailRenderer(ThreadPool& pool, const std::string& vertexPath, const std::string& libraryPath,
+    const std::string& cacheDirectory, const std::string& programCacheDirectory, ShaderSandbox* sandbox, GLWorker* worker)
+    : mPool(pool), pWorker(worker), mCacheDirectory(cacheDirectory)
+{
+    pProgramBuilder = std::make_unique<ProgramBuilder>(vertexPath, libraryPath, programCacheDirectory, sandbox);
+    if (pProgramBuilder->UsesSeparablePrograms()) {
+        glGenProgramPipelines(1, &uPipeline);
+        glUseProgramStages(uPipeline, GL_VERTEX_SHADER_BIT, pProgramBuilder->GetVertexProgram());
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(mCacheDirectory, error);
+    glGenVertexArrays(1, &uVAO);
+    for (Slot& slot : mSlots) {
+        slot.framebuffer = std::make_unique<Framebuffer>(RENDER_WIDTH, RENDER_HEIGHT);
+        glGenBuffers(1, &slot.uPixelBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.uPixelBuffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(RENDER_BYTES), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+ThumbnailRenderer::~ThumbnailRenderer()
+{
+    for (PendingCompile& compile : mCompiling) {
+        glDeleteProgram(compile.program.get());
+    }
+    for (std::future<uint64_t>& write : mPendingWrites) {
+        write.wait();
+    }
+    for (Slot& slot : mSlots) {
+        if (slot.fence != nullptr) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.uPixelBuffer);
+    }
+    for (auto it = mDisplayTextures.begin(); it != mDisplayTextures.end(); ++it) {
+        glDeleteTextures(1, &it->second);
+    }
+    glDeleteVertexArrays(1, &uVAO);
+    glDeleteProgramPipelines(1, &uPipeline);
+}
+
+GLuint ThumbnailRenderer::CompileWallpaper(const std::string& path) const
+{
+    WallpaperSources sources{};
+    if (!ParseWallpaperSource(path, &sources)) {
+        return 0;
+    }
+
+    // Wallpapers with quality tiers are shown at the tier they start at
+    WallpaperMetadata metadata{};
+    std::unordered_map<std::string, Uniform<GLint>> intUniforms;
+    std::unordered_map<std::string, Uniform<GLfloat>> floatUniforms;
+    std::unordered_map<std::string, Uniform<GLboolean>> boolUniforms;
+    try {
+        ParseWallpaperMetadata(sources.metadataYamlSource, metadata, intUniforms, floatUniforms, boolUniforms);
+    }
+    catch (const YAML::Exception& e) {
+        LOG_WARNING("Thumbnail of {} ignores its metadata: {}", path, e.what());
+    }
+    std::string source = sources.fragmentShaderSource;
+    if (!metadata.quality.define.empty()) {
+        source = InjectDefine(source, metadata.quality.define, std::to_string(metadata.quality.defaultTier));
+    }
+    return pProgramBuilder->BuildProgram(source, &sources.shaderFiles);
+}
+
+std::string ThumbnailRenderer::GetThumbnailPath(uint64_t contentHash) const
+{
+    return (std::filesystem::path(mCacheDirectory) / (HashToHex(contentHash) + ".wptx")).string();
+}
+
+void ThumbnailRenderer::Enqueue(const std::string& wallpaperPath, uint64_t contentHash)
+{
+    if (mInFlight.contains(contentHash) || mFailed.contains(contentHash)) {
+        return;
+    }
+    std::error_code error;
+    if (std::filesystem::exists(GetThumbnailPath(contentHash), error)) {
+        return;
+    }
+    if (IsIdle()) {
+        mBusyStart = std::chrono::steady_clock::now();
+    }
+    mQueue.push_back(Request{ wallpaperPath, contentHash });
+    mInFlight.insert(contentHash);
+    mStats.queued = mQueue.size() + mCompiling.size();
+}
+
+void ThumbnailRenderer::Process(size_t renderBudget)
+{
+    bool wasBusy = !IsIdle();
+    for (Slot& slot : mSlots) {
+        if (slot.fence != nullptr) {
+            Collect(slot);
+        }
+    }
+
+    for (size_t i = 0; i < mPendingWrites.size();) {
+        if (!IsReady(mPendingWrites[i])) {
+            i++;
+            continue;
+        }
+        mInFlight.erase(mPendingWrites[i].get());
+        mStats.rendered++;
+        mPendingWrites[i] = std::move(mPendingWrites.back());
+        mPendingWrites.pop_back();
+    }
+
+    // Compiling can take the sandbox's whole timeout, so with a worker it never holds up the caller's frame
+    while (pWorker != nullptr && mCompiling.size() < THUMBNAIL_SLOTS && !mQueue.empty()) {
+        PendingCompile compile{ std::move(mQueue.front()), {} };
+        mQueue.pop_front();
+        compile.program = pWorker->Submit([this, path = compile.request.path]() -> GLuint {
+            return CompileWallpaper(path);
+        });
+        mCompiling.push_back(std::move(compile));
+    }
+
+    for (Slot& slot : mSlots) {
+        if (renderBudget == 0) {
+            break;
+        }
+        if (slot.fence != nullptr) {
+            continue;
+        }
+        Request request{};
+        GLuint program = 0;
+        if (!TakeCompiled(&request, &program)) {
+            break;
+        }
+        if (program == 0 || !Render(slot, request, program)) {
+            LOG_WARNING("Could not render a thumbnail of {}", request.path);
+            mInFlight.erase(request.contentHash);
+            mFailed.insert(request.contentHash);
+            mStats.failed++;
+        }
+        renderBudget--;
+    }
+    mStats.queued = mQueue.size() + mCompiling.size();
+
+    if (wasBusy && IsIdle()) {
+        mStats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - mBusyStart).count();
+    }
+}
+
+bool ThumbnailRenderer::TakeCompiled(Request* request, GLuint* program)
+{
+    if (pWorker == nullptr) {
+        if (mQueue.empty()) {
+            return false;
+        }
+        *request = std::move(mQueue.front());
+        mQueue.pop_front();
+        *program = CompileWallpaper(request->path);
+        return true;
+    }
+    for (size_t i = 0; i < mCompiling.size(); i++) {
+        if (IsReady(mCompiling[i].program)) {
+            *request = std::move(mCompiling[i].request);
+            *program = mCompiling[i].program.get();
+            mCompiling.erase(mCompiling.begin() + static_cast<std::ptrdiff_t>(i));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThumbnailRenderer::Render(Slot& slot, const Request& request, GLuint program)
+{
+    // The caller's bindings are put back afterwards, thumbnails may be rendered in the middle of its frame
+    GLint previousFramebuffer = 0;
+    GLint previousProgram = 0;
+    GLint previousVertexArray = 0;
+    GLint previousViewport[4]{};
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    GLint previousPipeline = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    if (uPipeline != 0) {
+        glGetIntegerv(GL_PROGRAM_PIPELINE_BINDING, &previousPipeline);
+    }
+
+    slot.framebuffer->Bind();
+    glViewport(0, 0, RENDER_WIDTH, RENDER_HEIGHT);
+    if (uPipeline != 0) {
+        // A program in use takes precedence over the bound pipeline
+        glUseProgram(0);
+        glUseProgramStages(uPipeline, GL_FRAGMENT_SHADER_BIT, program);
+        glActiveShaderProgram(uPipeline, program);
+        glBindProgramPipeline(uPipeline);
+    }
+    else {
+        glUseProgram(program);
+    }
+    SpreadSamplerUnits(program);
+    glUniform2f(glGetUniformLocation(program, "iResolution"), static_cast<float>(RENDER_WIDTH), static_cast<float>(RENDER_HEIGHT));
+    glUniform2f(glGetUniformLocation(program, "iMouse"), RENDER_WIDTH * 0.5f, RENDER_HEIGHT * 0.5f);
+    glUniform1f(glGetUniformLocation(program, "iTime"), THUMBNAIL_TIME);
+    glBindVertexArray(uVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.uPixelBuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, RENDER_WIDTH, RENDER_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.contentHash = request.contentHash;
+    mRenderingPath = request.path;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    if (uPipeline != 0) {
+        glUseProgramStages(uPipeline, GL_FRAGMENT_SHADER_BIT, 0);
+        glBindProgramPipeline(static_cast<GLuint>(previousPipeline));
+    }
+    glUseProgram(static_cast<GLuint>(previousProgram));
+    glBindVertexArray(static_cast<GLuint>(previousVertexArray));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    // Deleting only flags the program, it stays alive until the draw using it has finished
+    glDeleteProgram(program);
+    return true;
+}
+
+void ThumbnailRenderer::Collect(Slot& slot)
+{
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    std::vector<unsigned char> pixels(RENDER_BYTES);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.uPixelBuffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(RENDER_BYTES), GL_MAP_READ_BIT);
+    bool copied = mapped != nullptr;
+    if (copied) {
+        std::memcpy(pixels.data(), mapped, RENDER_BYTES);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!copied) {
+        LOG_WARNING("Could not map a thumbnail readback");
+        mInFlight.erase(slot.contentHash);
+        mFailed.insert(slot.contentHash);
+        mStats.failed++;
+        return;
+    }
+
+    mPendingWrites.push_back(mPool.Submit([path = GetThumbnailPath(slot.contentHash), contentHash = slot.contentHash, pixels = std::move(pixels)]() {
+        if (!WriteTextureFile(path, contentHash, DownscaleThumbnail(pixels))) {
+            LOG_WARNING("Could not write thumbnail {}", path);
+        }
+        return contentHash;
+    }));
+}
+
+bool ThumbnailRenderer::IsIdle() const
+{
+    if (!mQueue.empty() || !mCompiling.empty() || !mPendingWrites.empty()) {
+        return false;
+    }
+    for (const Slot& slot : mSlots) {
+        if (slot.fence != nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::string& ThumbnailRenderer::GetRenderingPath() const
+{
+    return mRenderingPath;
+}
+
+void ThumbnailRenderer::FinishRenders()
+{
+    for (Slot& slot : mSlots) {
+        if (slot.fence == nullptr) {
+            continue;
+        }
+        // Waited on in steps, a client wait can't be told to wait forever
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+        }
+    }
+    mRenderingPath.clear();
+}
+
+GLuint ThumbnailRenderer::GetDisplayTexture(const std::string& wallpaperPath, uint64_t contentHash)
+{
+    auto found = mDisplayTextures.find(contentHash);
+    if (found != mDisplayTextures.end()) {
+        mDisplayOrder.remove(contentHash);
+        mDisplayOrder.push_front(contentHash);
+        return found->second;
+    }
+    // Neither has a file to read yet, and a failed one won't have one this session
+    if (mInFlight.contains(contentHash) || mFailed.contains(contentHash)) {
+        return 0;
+    }
+    GLuint texture = LoadDisplayTexture(contentHash);
+    if (texture == 0) {
+        Enqueue(wallpaperPath, contentHash);
+    }
+    return texture;
+}
+
+GLuint ThumbnailRenderer::LoadDisplayTexture(uint64_t contentHash)
+{
+    TexturePayload payload{};
+    std::string path = GetThumbnailPath(contentHash);
+    if (!ReadTextureFile(path, contentHash, &payload)) {
+        // A file that is there but can't be read is rendered again rather than read again every frame
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return 0;
+    }
+    const TextureLevel& level = payload.levels.front();
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    mDisplayTextures[contentHash] = texture;
+    mDisplayOrder.push_front(contentHash);
+    if (mDisplayOrder.size() > THUMBNAIL_DISPLAY_TEXTURES) {
+        glDeleteTextures(1, &mDisplayTextures.at(mDisplayOrder.back()));
+        mDisplayTextures.erase(mDisplayOrder.back());
+        mDisplayOrder.pop_back();
+    }
+    return texture;
+}
+
+const ThumbnailStats& ThumbnailRenderer::GetStats() const
+{
+    return mStats;
+}
@@ -0,0 +1,127 @@
+#ifndef THUMBNAIL_RENDERER_H
+#define THUMBNAIL_RENDERER_H
+
+#include <gl.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <opengl/Framebuffer.hpp>
+#include <opengl/ProgramBuilder.hpp>
+#include <util/ThreadPool.hpp>
+
+class GLWorker;
+
+#define DEFAULT_THUMBNAIL_CACHE_DIRECTORY "cache/thumbnails"
+
+constexpr int THUMBNAIL_WIDTH = 320;
+constexpr int THUMBNAIL_HEIGHT = 180;
+// Thumbnails are rendered at this multiple of their size and filtered down on the thread pool, a power of two
+constexpr int THUMBNAIL_SUPERSAMPLE = 2;
+// iTime thumbnails are rendered at, a few seconds in so that intros and fades have played out
+constexpr float THUMBNAIL_TIME = 5.0f;
+// Renders in flight at once, each with its own framebuffer and pixel pack buffer, and programs built ahead of them
+constexpr size_t THUMBNAIL_SLOTS = 4;
+// Thumbnail textures kept for display, least recently shown first out
+constexpr size_t THUMBNAIL_DISPLAY_TEXTURES = 32;
+
+struct ThumbnailStats {
+    size_t rendered = 0;
+    size_t failed = 0;
+    size_t queued = 0;
+    // Wall time from a render starting on an idle renderer to the last write finishing
+    double busySeconds = 0.0;
+
+    double ThumbnailsPerSecond() const;
+};
+
+/*
+Renders wallpapers offscreen into thumbnails kept on disk as texture files, keyed by the hash of the wallpaper
+file. Framebuffers and pixel pack buffers are reused from a fixed set of slots; each render's pixels are read
+back into its slot's buffer and only mapped once a fence says the GPU has finished, so the caller never waits on
+a readback. Downscaling and writing happen on the thread pool. Programs are built the same way as the engine's, with
+its vertex shader and program cache, so a wallpaper shown in the library loads its program from the cache when it is
+picked. Given a GL worker they are built on it ahead of the renders, otherwise when a slot is free. Given a sandbox,
+new programs are built in its workers first, so a library wallpaper that hangs or crashes the driver fails its
+thumbnail instead of taking the caller down. Uses whichever context is current, and textures the wallpaper declares
+are not loaded, so they read as black.
+*/
+class ThumbnailRenderer {
+private:
+    struct Request {
+        std::string path;
+        uint64_t contentHash = 0;
+    };
+
+    struct PendingCompile {
+        Request request;
+        std::future<GLuint> program;
+    };
+
+    struct Slot {
+        std::unique_ptr<Framebuffer> framebuffer = nullptr;
+        GLuint uPixelBuffer = 0;
+        GLsync fence = nullptr;
+        uint64_t contentHash = 0;
+    };
+
+    ThreadPool& mPool;
+    GLWorker* pWorker = nullptr;
+    std::string mCacheDirectory;
+    std::unique_ptr<ProgramBuilder> pProgramBuilder = nullptr;
+    // Holds the vertex stage when programs are separable, wallpaper programs only go in its fragment stage
+    GLuint uPipeline = 0;
+    GLuint uVAO = 0;
+    std::array<Slot, THUMBNAIL_SLOTS> mSlots{};
+    std::deque<Request> mQueue;
+    std::vector<PendingCompile> mCompiling;
+    std::vector<std::future<uint64_t>> mPendingWrites;
+    // Hashes queued, rendering or being written, and hashes whose wallpaper failed to render this session
+    std::unordered_set<uint64_t> mInFlight;
+    std::unordered_set<uint64_t> mFailed;
+    std::unordered_map<uint64_t, GLuint> mDisplayTextures;
+    std::list<uint64_t> mDisplayOrder;
+    ThumbnailStats mStats{};
+    std::chrono::steady_clock::time_point mBusyStart{};
+    std::string mRenderingPath;
+    GLuint CompileWallpaper(const std::string& path) const;
+    bool Render(Slot& slot, const Request& request, GLuint program);
+    bool TakeCompiled(Request* request, GLuint* program);
+    void Collect(Slot& slot);
+    GLuint LoadDisplayTexture(uint64_t contentHash);
+public:
+    // An empty program cache directory compiles every wallpaper's program. The sandbox has to use the same vertex
+    // shader and library, and the worker's context has to share objects with the current one.
+    ThumbnailRenderer(ThreadPool& pool, const std::string& vertexPath, const std::string& libraryPath,
+        const std::string& cacheDirectory = DEFAULT_THUMBNAIL_CACHE_DIRECTORY, const std::string& programCacheDirectory = DEFAULT_PROGRAM_CACHE_DIRECTORY,
+        ShaderSandbox* sandbox = nullptr, GLWorker* worker = nullptr);
+    ~ThumbnailRenderer();
+    std::string GetThumbnailPath(uint64_t contentHash) const;
+    // Queue a wallpaper unless it already has a thumbnail, is queued or failed before
+    void Enqueue(const std::string& wallpaperPath, uint64_t contentHash);
+    // Start up to renderBudget queued renders in free slots and hand finished readbacks to the thread pool
+    void Process(size_t renderBudget = 1);
+    bool IsIdle() const;
+    // Wallpaper of the last render started, empty once FinishRenders has returned
+    const std::string& GetRenderingPath() const;
+    // Wait for every render in flight to finish on the GPU, so one that hangs it is caught here rather than at the
+    // caller's next swap
+    void FinishRenders();
+    // Texture holding the thumbnail for display, 0 while it doesn't exist yet, in which case it is queued, or if it
+    // failed to render
+    GLuint GetDisplayTexture(const std::string& wallpaperPath, uint64_t contentHash);
+    const ThumbnailStats& GetStats() const;
+    ThumbnailRenderer(const ThumbnailRenderer& arg) = delete;
+    ThumbnailRenderer(const ThumbnailRenderer&& arg) = delete;
+    ThumbnailRenderer& operator=(const ThumbnailRenderer& arg) = delete;
+    ThumbnailRenderer& operator=(const ThumbnailRenderer&& arg) = delete;
+};
+
+#endif // !THUMBNAIL_RENDERER_H
@@ -0,0 +1,229 @@
+#include <opengl/VideoTexture.hpp>
+#include <algorithm>
+#include <cmath>
+#include <util/Log.hpp>
+
+VideoTexture::VideoTexture(const std::string& path, double frameRate, bool loop) : mLoop(loop)
+{
+    pSource = OpenVideoSource(path);
+    if (pSource == nullptr) {
+        return;
+    }
+    if (frameRate > 0.0) {
+        mFrameRate = frameRate;
+    }
+    else if (pSource->GetFrameRate() > 0.0) {
+        mFrameRate = pSource->GetFrameRate();
+    }
+
+    GLsizeiptr frameBytes = static_cast<GLsizeiptr>(pSource->GetWidth()) * pSource->GetHeight() * 4;
+    for (Slot& slot : mSlots) {
+        glGenBuffers(1, &slot.uBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.uBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, frameBytes, nullptr, GL_STREAM_DRAW);
+
+        glGenTextures(1, &slot.uTexture);
+        glBindTexture(GL_TEXTURE_2D, slot.uTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pSource->GetWidth(), pSource->GetHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    mThread = std::thread(&VideoTexture::DecodeLoop, this);
+    mValid = true;
+    LOG_INFO("Opened {}x{} video {} with {} frames at {} fps", pSource->GetWidth(), pSource->GetHeight(), path, pSource->GetFrameCount(), mFrameRate);
+}
+
+VideoTexture::~VideoTexture()
+{
+    if (mThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mCondition.notify_one();
+        mThread.join();
+    }
+    for (Slot& slot : mSlots) {
+        if (slot.state == SlotState::Decoding) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.uBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        glDeleteBuffers(1, &slot.uBuffer);
+        glDeleteTextures(1, &slot.uTexture);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool VideoTexture::IsValid() const
+{
+    return mValid;
+}
+
+void VideoTexture::DecodeLoop()
+{
+    while (true) {
+        DecodeJob job{};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+            if (mStopping) {
+                break;
+            }
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+        bool success = pSource->ReadFrame(job.frame, job.destination);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mResults.push_back(DecodeResult{ job.slot, success });
+    }
+}
+
+int VideoTexture::GetSourceFrame(int64_t sequence) const
+{
+    int64_t frameCount = pSource->GetFrameCount();
+    return static_cast<int>(mLoop ? sequence % frameCount : std::min(sequence, frameCount - 1));
+}
+
+void VideoTexture::FreeSlot(Slot& slot)
+{
+    slot.state = SlotState::Free;
+    slot.sequence = 0;
+}
+
+void VideoTexture::Seek(int64_t sequence)
+{
+    // The frame on screen stays bound until a frame from after the seek replaces it
+    mGeneration++;
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        if (mSlots[i].state == SlotState::Ready && i != mShownSlot) {
+            FreeSlot(mSlots[i]);
+        }
+    }
+    mShownSequence = -1;
+    mLateSequence = -1;
+    mNextSequence = sequence;
+}
+
+void VideoTexture::Update(double time)
+{
+    if (!mValid) {
+        return;
+    }
+    int64_t lastSequence = mLoop ? INT64_MAX : static_cast<int64_t>(pSource->GetFrameCount()) - 1;
+    int64_t wanted = std::clamp(static_cast<int64_t>(std::floor(std::max(time, 0.0) * mFrameRate)), int64_t{ 0 }, lastSequence);
+
+    // Decoded frames are copied from their pixel buffer into the slot's texture, which the GPU does asynchronously
+    std::deque<DecodeResult> results;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        results.swap(mResults);
+    }
+    for (const DecodeResult& result : results) {
+        Slot& slot = mSlots[result.slot];
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.uBuffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        if (!result.success || slot.generation != mGeneration) {
+            FreeSlot(slot);
+            continue;
+        }
+        glBindTexture(GL_TEXTURE_2D, slot.uTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pSource->GetWidth(), pSource->GetHeight(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        slot.state = SlotState::Ready;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (wanted < mShownSequence) {
+        Seek(wanted);
+    }
+    else if (mNextSequence < wanted) {
+        // Fallen behind, there's no point decoding frames that are already due
+        mNextSequence = wanted;
+    }
+
+    // Show the latest frame that is due, anything older than it will never be shown
+    size_t best = mSlots.size();
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        const Slot& slot = mSlots[i];
+        if (slot.state == SlotState::Ready && i != mShownSlot && slot.sequence <= wanted && slot.sequence > mShownSequence &&
+            (best == mSlots.size() || slot.sequence > mSlots[best].sequence)) {
+            best = i;
+        }
+    }
+    if (best != mSlots.size()) {
+        if (mShownSequence >= 0) {
+            mStats.droppedFrames += static_cast<size_t>(mSlots[best].sequence - mShownSequence - 1);
+        }
+        if (mShownSlot != mSlots.size()) {
+            FreeSlot(mSlots[mShownSlot]);
+        }
+        mShownSlot = best;
+        mShownSequence = mSlots[best].sequence;
+        mStats.shownFrames++;
+        for (size_t i = 0; i < mSlots.size(); i++) {
+            if (mSlots[i].state == SlotState::Ready && mSlots[i].sequence < mShownSequence) {
+                FreeSlot(mSlots[i]);
+            }
+        }
+    }
+    if (mStats.shownFrames > 0 && mShownSequence != wanted && mLateSequence != wanted) {
+        mStats.lateFrames++;
+        mLateSequence = wanted;
+    }
+
+    // Hand every free slot's buffer to the decode thread. Invalidating the buffer on map lets the driver give back
+    // fresh memory rather than wait for the last copy out of it to finish.
+    GLsizeiptr frameBytes = static_cast<GLsizeiptr>(pSource->GetWidth()) * pSource->GetHeight() * 4;
+    bool queued = false;
+    for (size_t i = 0; i < mSlots.size() && mNextSequence <= lastSequence; i++) {
+        Slot& slot = mSlots[i];
+        if (slot.state != SlotState::Free || i == mShownSlot) {
+            continue;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.uBuffer);
+        void* destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frameBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (destination == nullptr) {
+            LOG_ERROR("Failed to map video frame buffer");
+            break;
+        }
+        slot.state = SlotState::Decoding;
+        slot.sequence = mNextSequence;
+        slot.generation = mGeneration;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJobs.push_back(DecodeJob{ i, GetSourceFrame(mNextSequence), static_cast<unsigned char*>(destination) });
+        }
+        mNextSequence++;
+        queued = true;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (queued) {
+        mCondition.notify_one();
+    }
+}
+
+void VideoTexture::Bind(GLint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    glBindTexture(GL_TEXTURE_2D, mShownSlot != mSlots.size() ? mSlots[mShownSlot].uTexture : 0);
+}
+
+int VideoTexture::GetWidth() const
+{
+    return pSource == nullptr ? 0 : pSource->GetWidth();
+}
+
+int VideoTexture::GetHeight() const
+{
+    return pSource == nullptr ? 0 : pSource->GetHeight();
+}
+
+VideoTextureStats VideoTexture::GetStats() const
+{
+    return mStats;
+}
@@ -0,0 +1,103 @@
+#ifndef VIDEO_TEXTURE_H
+#define VIDEO_TEXTURE_H
+
+#include <gl.h>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <util/VideoSource.hpp>
+
+// Frames decoded ahead or on screen at once, this bounds memory to this many frames of texture and pixel buffer
+constexpr size_t VIDEO_RING_SIZE = 4;
+// Frame rate for sources that don't store one, such as image sequences
+constexpr double DEFAULT_VIDEO_FRAME_RATE = 30.0;
+
+struct VideoTextureStats {
+    size_t shownFrames = 0;
+    // Frames never shown because playback had moved past them
+    size_t droppedFrames = 0;
+    // Frames that weren't ready when they were due, so the previous one stayed on screen
+    size_t lateFrames = 0;
+};
+
+/*
+Plays a video source in step with the shader's time. Each slot of a small ring owns a pixel unpack buffer and a
+texture. The main thread maps a free slot's buffer and hands it to a decode thread, which writes the frame straight
+into it. Once decoded the buffer is unmapped and copied into the slot's texture without waiting on the GPU, so the
+render loop never blocks on decoding or uploading. Until the first frame arrives the texture reads as black.
+*/
+class VideoTexture {
+private:
+    enum class SlotState {
+        Free,
+        Decoding,
+        Ready,
+    };
+
+    struct Slot {
+        GLuint uBuffer = 0;
+        GLuint uTexture = 0;
+        SlotState state = SlotState::Free;
+        int64_t sequence = 0;
+        uint64_t generation = 0;
+    };
+
+    struct DecodeJob {
+        size_t slot = 0;
+        int frame = 0;
+        unsigned char* destination = nullptr;
+    };
+
+    struct DecodeResult {
+        size_t slot = 0;
+        bool success = false;
+    };
+
+    std::unique_ptr<VideoSource> pSource = nullptr;
+    double mFrameRate = DEFAULT_VIDEO_FRAME_RATE;
+    bool mLoop = true;
+    std::array<Slot, VIDEO_RING_SIZE> mSlots{};
+    // Sequence numbers count frames since time zero, they only wrap onto the source's frames when decoding
+    int64_t mNextSequence = 0;
+    int64_t mShownSequence = -1;
+    int64_t mLateSequence = -1;
+    size_t mShownSlot = VIDEO_RING_SIZE;
+    // Bumped on a seek so decodes started before it are thrown away
+    uint64_t mGeneration = 0;
+    VideoTextureStats mStats{};
+    bool mValid = false;
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<DecodeJob> mJobs;
+    std::deque<DecodeResult> mResults;
+    bool mStopping = false;
+
+    void DecodeLoop();
+    int GetSourceFrame(int64_t sequence) const;
+    void FreeSlot(Slot& slot);
+    void Seek(int64_t sequence);
+public:
+    // frameRate of 0 uses the rate stored in the source, or DEFAULT_VIDEO_FRAME_RATE if it has none
+    VideoTexture(const std::string& path, double frameRate, bool loop);
+    ~VideoTexture();
+    bool IsValid() const;
+    // Show the frame due at time seconds, upload finished decodes and queue more, call once per frame
+    void Update(double time);
+    void Bind(GLint unit) const;
+    int GetWidth() const;
+    int GetHeight() const;
+    VideoTextureStats GetStats() const;
+
+    VideoTexture(const VideoTexture& arg) = delete;
+    VideoTexture(const VideoTexture&& arg) = delete;
+    VideoTexture& operator=(const VideoTexture& arg) = delete;
+    VideoTexture& operator=(const VideoTexture&& arg) = delete;
+};
+
+#endif // !VIDEO_TEXTURE_H
@@ -0,0 +1,100 @@
+#include <opengl/VirtualFeedback.hpp>
+#include <algorithm>
+#include <cstring>
+
+VirtualFeedback::VirtualFeedback()
+{
+    glGenFramebuffers(1, &uFramebuffer);
+    glGenTextures(1, &uTexture);
+    glGenBuffers(1, &uPixelBuffer);
+}
+
+VirtualFeedback::~VirtualFeedback()
+{
+    if (mFence != nullptr) {
+        glDeleteSync(mFence);
+    }
+    glDeleteBuffers(1, &uPixelBuffer);
+    glDeleteTextures(1, &uTexture);
+    glDeleteFramebuffers(1, &uFramebuffer);
+}
+
+bool VirtualFeedback::Begin(int renderWidth, int renderHeight)
+{
+    // Skip while the last pass is still being read back, a second one would only queue up behind it
+    if (mFrame++ % VIRTUAL_FEEDBACK_INTERVAL != 0 || mFence != nullptr) {
+        return false;
+    }
+
+    int width = std::max(renderWidth / VIRTUAL_FEEDBACK_DIVISOR, 1);
+    int height = std::max(renderHeight / VIRTUAL_FEEDBACK_DIVISOR, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, uFramebuffer);
+    if (width != mWidth || height != mHeight) {
+        mWidth = width;
+        mHeight = height;
+        glBindTexture(GL_TEXTURE_2D, uTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, uTexture, 0);
+    }
+
+    // Fragment output 0 is the wallpaper's colour and is dropped, output 1 is the tile request
+    const GLenum drawBuffers[] = { GL_NONE, GL_COLOR_ATTACHMENT0 };
+    glDrawBuffers(2, drawBuffers);
+    glViewport(0, 0, mWidth, mHeight);
+    // An alpha of zero marks pixels that sampled no virtual texture
+    const GLfloat clear[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 1, clear);
+    return true;
+}
+
+void VirtualFeedback::End()
+{
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, uPixelBuffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(mWidth) * mHeight * 4, nullptr, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mReadWidth = mWidth;
+    mReadHeight = mHeight;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool VirtualFeedback::Collect(std::vector<uint32_t>* texels)
+{
+    if (mFence == nullptr) {
+        return false;
+    }
+    GLenum status = glClientWaitSync(mFence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    glDeleteSync(mFence);
+    mFence = nullptr;
+
+    size_t count = static_cast<size_t>(mReadWidth) * static_cast<size_t>(mReadHeight);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, uPixelBuffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(count * 4), GL_MAP_READ_BIT);
+    bool mappedOk = mapped != nullptr;
+    if (mappedOk) {
+        texels->resize(count);
+        std::memcpy(texels->data(), mapped, count * 4);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return mappedOk;
+}
+
+int VirtualFeedback::GetWidth() const
+{
+    return mWidth;
+}
+
+int VirtualFeedback::GetHeight() const
+{
+    return mHeight;
+}
@@ -0,0 +1,47 @@
+#ifndef VIRTUAL_FEEDBACK_H
+#define VIRTUAL_FEEDBACK_H
+
+#include <gl.h>
+#include <cstdint>
+#include <vector>
+
+// The feedback pass is rendered at this fraction of the render size along each axis
+constexpr int VIRTUAL_FEEDBACK_DIVISOR = 8;
+// Frames between feedback passes
+constexpr int VIRTUAL_FEEDBACK_INTERVAL = 4;
+
+/*
+Low resolution render target that records which virtual texture tile each pixel sampled. The shader library
+writes the request to fragment output 1, which is the only output drawn here. Results are read back through
+a pixel pack buffer and a fence so the render thread never waits on the GPU.
+*/
+class VirtualFeedback {
+private:
+    GLuint uFramebuffer = 0;
+    GLuint uTexture = 0;
+    GLuint uPixelBuffer = 0;
+    GLsync mFence = nullptr;
+    int mWidth = 0;
+    int mHeight = 0;
+    int mReadWidth = 0;
+    int mReadHeight = 0;
+    int mFrame = 0;
+public:
+    VirtualFeedback();
+    ~VirtualFeedback();
+    // Bind the feedback target if a pass is due this frame, sized for the given render dimensions
+    bool Begin(int renderWidth, int renderHeight);
+    // Start reading the pass back and rebind the default framebuffer
+    void End();
+    // Returns true and fills texels with one RGBA8 texel per feedback pixel once a readback has finished
+    bool Collect(std::vector<uint32_t>* texels);
+    int GetWidth() const;
+    int GetHeight() const;
+
+    VirtualFeedback(const VirtualFeedback& arg) = delete;
+    VirtualFeedback(const VirtualFeedback&& arg) = delete;
+    VirtualFeedback& operator=(const VirtualFeedback& arg) = delete;
+    VirtualFeedback& operator=(const VirtualFeedback&& arg) = delete;
+};
+
+#endif // !VIRTUAL_FEEDBACK_H
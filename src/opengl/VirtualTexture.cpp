@@ -0,0 +1,254 @@
+#include <opengl/VirtualTexture.hpp>
+#include <algorithm>
+#include <util/Log.hpp>
+
+static uint64_t TileKey(int level, int x, int y)
+{
+    return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(y) << 24) | static_cast<uint64_t>(x);
+}
+
+static int NextPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+VirtualTexture::VirtualTexture(const std::string& path, ThreadPool& pool, int pagesPerSide) : mPool(pool), mPagesPerSide(pagesPerSide)
+{
+    if (!mFile.Open(path)) {
+        return;
+    }
+    const std::vector<VirtualLevel>& levels = mFile.GetLevels();
+
+    int cacheSize = mPagesPerSide * VIRTUAL_PAGE_SIZE;
+    glGenTextures(1, &uPageTexture);
+    glBindTexture(GL_TEXTURE_2D, uPageTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Power of two sizes guarantee every mip level of the table is at least as big as that level's tile grid
+    int tableWidth = NextPowerOfTwo(levels.front().tilesX);
+    int tableHeight = NextPowerOfTwo(levels.front().tilesY);
+    glGenTextures(1, &uTableTexture);
+    glBindTexture(GL_TEXTURE_2D, uTableTexture);
+    for (size_t level = 0; level < levels.size(); level++) {
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, std::max(tableWidth >> level, 1), std::max(tableHeight >> level, 1),
+            0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    mPages.resize(static_cast<size_t>(mPagesPerSide) * static_cast<size_t>(mPagesPerSide));
+    for (const VirtualLevel& level : levels) {
+        mTable.emplace_back(static_cast<size_t>(level.tilesX) * static_cast<size_t>(level.tilesY), 0u);
+    }
+
+    // The single tile of the coarsest level is read straight away and never evicted
+    int root = static_cast<int>(levels.size()) - 1;
+    mPages[0].tile = TileKey(root, 0, 0);
+    mPages[0].used = true;
+    mPages[0].pinned = true;
+    mResident[mPages[0].tile] = 0;
+    UploadTile(0, mFile.GetTile(root, 0, 0));
+    RebuildTable();
+    mValid = true;
+    LOG_INFO("Opened {}x{} virtual texture {} with {} levels", mFile.GetWidth(), mFile.GetHeight(), path, levels.size());
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    // Reads in flight point into the mapping, which goes away with mFile
+    for (std::future<TileLoad>& load : mLoads) {
+        load.wait();
+    }
+    glDeleteTextures(1, &uPageTexture);
+    glDeleteTextures(1, &uTableTexture);
+}
+
+bool VirtualTexture::IsValid() const
+{
+    return mValid;
+}
+
+void VirtualTexture::UploadTile(size_t page, const unsigned char* pixels)
+{
+    int pageX = static_cast<int>(page) % mPagesPerSide;
+    int pageY = static_cast<int>(page) / mPagesPerSide;
+    glBindTexture(GL_TEXTURE_2D, uPageTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, pageX * VIRTUAL_PAGE_SIZE, pageY * VIRTUAL_PAGE_SIZE, VIRTUAL_PAGE_SIZE, VIRTUAL_PAGE_SIZE,
+        GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool VirtualTexture::FindPage(size_t* pageIn) const
+{
+    bool found = false;
+    for (size_t page = 0; page < mPages.size(); page++) {
+        if (!mPages[page].used) {
+            *pageIn = page;
+            return true;
+        }
+        if (mPages[page].pinned || mPages[page].lastUsed >= mLastRequestTime) {
+            continue;
+        }
+        if (!found || mPages[page].lastUsed < mPages[*pageIn].lastUsed) {
+            *pageIn = page;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void VirtualTexture::RebuildTable()
+{
+    // Walk from the coarsest level down so every tile can inherit its parent's entry
+    const std::vector<VirtualLevel>& levels = mFile.GetLevels();
+    for (size_t level = levels.size(); level-- > 0;) {
+        const VirtualLevel& virtualLevel = levels[level];
+        for (int y = 0; y < virtualLevel.tilesY; y++) {
+            for (int x = 0; x < virtualLevel.tilesX; x++) {
+                uint32_t& texel = mTable[level][static_cast<size_t>(y) * static_cast<size_t>(virtualLevel.tilesX) + static_cast<size_t>(x)];
+                auto resident = mResident.find(TileKey(static_cast<int>(level), x, y));
+                if (resident != mResident.end()) {
+                    uint32_t pageX = static_cast<uint32_t>(resident->second) % static_cast<uint32_t>(mPagesPerSide);
+                    uint32_t pageY = static_cast<uint32_t>(resident->second) / static_cast<uint32_t>(mPagesPerSide);
+                    texel = pageX | (pageY << 8) | (static_cast<uint32_t>(level) << 16) | 0xFF000000u;
+                }
+                else {
+                    const VirtualLevel& parent = levels[level + 1];
+                    texel = mTable[level + 1][static_cast<size_t>(y / 2) * static_cast<size_t>(parent.tilesX) + static_cast<size_t>(x / 2)];
+                }
+            }
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, uTableTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t level = 0; level < levels.size(); level++) {
+        glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, levels[level].tilesX, levels[level].tilesY, GL_RGBA, GL_UNSIGNED_BYTE, mTable[level].data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mTableDirty = false;
+}
+
+void VirtualTexture::RequestTiles(std::vector<VirtualTileRequest> requests, double now)
+{
+    if (!mValid) {
+        return;
+    }
+    mLastRequestTime = now;
+
+    // Coarse tiles first, they cover the most of the screen and are the fallback for everything finer
+    std::sort(requests.begin(), requests.end(), [](const VirtualTileRequest& a, const VirtualTileRequest& b) {
+        return a.level > b.level;
+    });
+    const std::vector<VirtualLevel>& levels = mFile.GetLevels();
+    for (const VirtualTileRequest& request : requests) {
+        if (request.level < 0 || request.level >= static_cast<int>(levels.size())) {
+            continue;
+        }
+        const VirtualLevel& level = levels[static_cast<size_t>(request.level)];
+        if (request.x < 0 || request.y < 0 || request.x >= level.tilesX || request.y >= level.tilesY) {
+            continue;
+        }
+
+        uint64_t tile = TileKey(request.level, request.x, request.y);
+        auto resident = mResident.find(tile);
+        if (resident != mResident.end()) {
+            mPages[resident->second].lastUsed = now;
+            continue;
+        }
+        if (mPending.contains(tile) || mPending.size() >= VIRTUAL_MAX_PENDING_TILES) {
+            continue;
+        }
+
+        // Reading through the mapping on the pool means any page faults happen off the render thread
+        mPending.insert(tile);
+        const unsigned char* source = mFile.GetTile(request.level, request.x, request.y);
+        mLoads.push_back(mPool.Submit([tile, source]() {
+            TileLoad load{};
+            load.tile = tile;
+            load.pixels.assign(source, source + VirtualTextureFile::GetTileBytes());
+            return load;
+        }));
+    }
+}
+
+void VirtualTexture::Update(double now)
+{
+    if (!mValid) {
+        return;
+    }
+    int uploads = 0;
+    for (auto it = mLoads.begin(); it != mLoads.end() && uploads < VIRTUAL_TILES_PER_FRAME;) {
+        if (!IsReady(*it)) {
+            ++it;
+            continue;
+        }
+        TileLoad load = it->get();
+        it = mLoads.erase(it);
+        mPending.erase(load.tile);
+
+        size_t page = 0;
+        if (!FindPage(&page)) {
+            // Everything resident is on screen, the request comes back with the next feedback if still wanted
+            continue;
+        }
+        if (mPages[page].used) {
+            mResident.erase(mPages[page].tile);
+        }
+        mPages[page].tile = load.tile;
+        mPages[page].used = true;
+        mPages[page].lastUsed = now;
+        mResident[load.tile] = page;
+        UploadTile(page, load.pixels.data());
+        mTableDirty = true;
+        uploads++;
+    }
+
+    if (mTableDirty) {
+        RebuildTable();
+    }
+}
+
+void VirtualTexture::Bind(GLint pageUnit, GLint tableUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(pageUnit));
+    glBindTexture(GL_TEXTURE_2D, uPageTexture);
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(tableUnit));
+    glBindTexture(GL_TEXTURE_2D, uTableTexture);
+}
+
+int VirtualTexture::GetWidth() const
+{
+    return mFile.GetWidth();
+}
+
+int VirtualTexture::GetHeight() const
+{
+    return mFile.GetHeight();
+}
+
+int VirtualTexture::GetLevelCount() const
+{
+    return static_cast<int>(mFile.GetLevels().size());
+}
+
+VirtualTextureStats VirtualTexture::GetStats() const
+{
+    VirtualTextureStats stats{};
+    stats.residentPages = mResident.size();
+    stats.totalPages = mPages.size();
+    stats.pendingTiles = mPending.size();
+    return stats;
+}
@@ -0,0 +1,93 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <gl.h>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <util/ThreadPool.hpp>
+#include <util/VirtualTextureFile.hpp>
+
+// Pages along each side of the page cache texture, this bounds GPU memory whatever the size of the image
+constexpr int VIRTUAL_PAGES_PER_SIDE = 16;
+// Tiles copied into the page cache per frame
+constexpr int VIRTUAL_TILES_PER_FRAME = 8;
+// Tiles being read from disk at once, requests past this wait for the next round of feedback
+constexpr size_t VIRTUAL_MAX_PENDING_TILES = 32;
+
+struct VirtualTileRequest {
+    int level = 0;
+    int x = 0;
+    int y = 0;
+};
+
+struct VirtualTextureStats {
+    size_t residentPages = 0;
+    size_t totalPages = 0;
+    size_t pendingTiles = 0;
+};
+
+/*
+A texture far larger than could ever be resident, streamed in tile by tile. Tiles live in pages of a fixed
+size cache texture and a table texture, with one mip level per level of the image, maps each tile to the
+page holding it or to the page of its nearest resident ancestor. The coarsest level is a single tile which
+is always resident, so every lookup finds something.
+*/
+class VirtualTexture {
+private:
+    struct Page {
+        uint64_t tile = 0;
+        bool used = false;
+        bool pinned = false;
+        double lastUsed = 0.0;
+    };
+
+    struct TileLoad {
+        uint64_t tile = 0;
+        std::vector<unsigned char> pixels;
+    };
+
+    VirtualTextureFile mFile;
+    ThreadPool& mPool;
+    GLuint uPageTexture = 0;
+    GLuint uTableTexture = 0;
+    int mPagesPerSide = VIRTUAL_PAGES_PER_SIDE;
+    std::vector<Page> mPages;
+    std::unordered_map<uint64_t, size_t> mResident;
+    std::unordered_set<uint64_t> mPending;
+    std::deque<std::future<TileLoad>> mLoads;
+    // RGBA8 table texels per level: page x, page y, level of the tile in that page
+    std::vector<std::vector<uint32_t>> mTable;
+    bool mTableDirty = true;
+    double mLastRequestTime = 0.0;
+    bool mValid = false;
+
+    void UploadTile(size_t page, const unsigned char* pixels);
+    // Pick a free page, or the least recently used one not sampled in the latest feedback
+    bool FindPage(size_t* pageIn) const;
+    void RebuildTable();
+public:
+    VirtualTexture(const std::string& path, ThreadPool& pool, int pagesPerSide = VIRTUAL_PAGES_PER_SIDE);
+    ~VirtualTexture();
+    bool IsValid() const;
+    // Mark requested tiles as in use and start reading any that aren't resident, coarsest first
+    void RequestTiles(std::vector<VirtualTileRequest> requests, double now);
+    // Copy finished reads into the page cache and update the table, call once per frame
+    void Update(double now);
+    void Bind(GLint pageUnit, GLint tableUnit) const;
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetLevelCount() const;
+    VirtualTextureStats GetStats() const;
+
+    VirtualTexture(const VirtualTexture& arg) = delete;
+    VirtualTexture(const VirtualTexture&& arg) = delete;
+    VirtualTexture& operator=(const VirtualTexture& arg) = delete;
+    VirtualTexture& operator=(const VirtualTexture&& arg) = delete;
+};
+
+#endif // !VIRTUAL_TEXTURE_H
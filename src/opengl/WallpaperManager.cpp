@@ -1,155 +1,90 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
+#include <opengl/TextureUnits.hpp>
 #include <opengl/WallpaperManager.hpp>
+#include <regex>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
+#include <util/Hash.hpp>
 #include <util/Log.hpp>
+#include <util/ShaderPreprocessor.hpp>
+#include <util/WallpaperFile.hpp>
 #include <yaml-cpp/yaml.h>
 
-#define DEFAULT_VERTEX_SHADER_PATH "vertex.glsl"
-
-WallpaperManager::WallpaperManager() {
-    LoadVertexShader();
+WallpaperManager::WallpaperManager(const Window& wallpaperWindow) {
+    pCostProbe = std::make_unique<CostProbe>();
+    pShaderSandbox = std::make_unique<ShaderSandbox>(GetExecutablePath(), DEFAULT_VERTEX_SHADER_PATH, DEFAULT_LIBRARY_SHADER_PATH);
+    pProgramBuilder = std::make_unique<ProgramBuilder>(DEFAULT_VERTEX_SHADER_PATH, DEFAULT_LIBRARY_SHADER_PATH, DEFAULT_PROGRAM_CACHE_DIRECTORY,
+        pShaderSandbox.get());
+    CreateVertexPipeline();
+    pWorker = std::make_unique<GLWorker>(wallpaperWindow);
+    pMipPool = std::make_unique<ThreadPool>();
+    pDecodePool = std::make_unique<ThreadPool>();
+    pUploader = std::make_unique<TextureUploader>();
+    pTextureCache = std::make_unique<TextureCache>(*pDecodePool, *pMipPool, *pUploader);
+    pNoiseTextures = std::make_unique<NoiseTextures>(*pDecodePool);
+    mNoiseUnits.fill(-1);
+    pVirtualFeedback = std::make_unique<VirtualFeedback>();
 }
 
 WallpaperManager::~WallpaperManager() {
-    glDeleteShader(uVertexShader);
-    glDeleteProgram(uShaderProgramID);
-}
-
-void WallpaperManager::LoadVertexShader()
-{
-    std::ifstream stream(DEFAULT_VERTEX_SHADER_PATH);
-
-    if (stream.fail()) {
-        throw std::runtime_error("Failed to open file stream to " DEFAULT_VERTEX_SHADER_PATH " to load default vertex shader.");
+    ClearSpecializedPrograms();
+    ClearTierPrograms();
+    for (std::future<GLuint>& discarded : mDiscardedPrograms) {
+        glDeleteProgram(discarded.get());
     }
-
-    std::stringstream ss;
-    ss << stream.rdbuf();
-    std::string vertexSource = ss.str();
-
-    CompileShader(GL_VERTEX_SHADER, vertexSource, &uVertexShader);
+    glDeleteProgramPipelines(1, &uPipeline);
 }
 
-bool WallpaperManager::ParseWallpaperSource(const std::string& path, WallpaperSources* out) const
+// Turn the wallpaper into a program writing function(p) for every texel of one slice of a volume. The source is the
+// preprocessed one, includes expanded and comments stripped, so neither is mistaken for a declaration. Its main is
+// defined out of the way by the GLSL preprocessor and a bake entry point added after it, writing through the
+// wallpaper's own colour output, so everything else it declares still compiles and links.
+static bool BuildSdfBakeSource(const std::string& source, const std::string& function, std::string* out)
 {
-    std::ifstream stream(path);
-
-    if (stream.fail()) {
-        LOG_ERROR("Failed to open wallpaper: " + path);
+    std::string stripped = StripShaderComments(source);
+    std::smatch output;
+    if (!std::regex_search(stripped, output, std::regex(R"(\bout\s+(?:(?:highp|mediump|lowp)\s+)?vec4\s+(\w+)\s*;)"))) {
+        LOG_ERROR("Shader has no vec4 output to bake {} through", function);
         return false;
     }
-
-    std::string line;
-    std::stringstream ss[2];
-    WallpaperSection type = WallpaperSection::NONE;
-
-    bool foundShaderSection = false;
-
-    while (getline(stream, line)) {
-        if (line.find("#section") != std::string::npos) {
-            if (line.find("metadata") != std::string::npos) {
-                type = WallpaperSection::METADATA;
-            }
-            else if (line.find("shader") != std::string::npos) {
-                foundShaderSection = true;
-                type = WallpaperSection::SHADER;
-            }
-        }
-        else if (type != WallpaperSection::NONE) {
-            ss[static_cast<int>(type)] << line << "\n";
-        }
-    }
-
-    if (!foundShaderSection) {
-        LOG_ERROR("Wallpaper file must contain #section shader!");
+    if (!std::regex_search(stripped, std::regex(R"(\bvoid\s+main\s*\()"))) {
+        LOG_ERROR("Shader has no main to replace when baking {}", function);
         return false;
     }
-
-    *out = {
-        ss[static_cast<int>(WallpaperSection::METADATA)].str(),
-        ss[static_cast<int>(WallpaperSection::SHADER)].str()
-    };
+    *out = InjectDefine(stripped, "main", "wallpaperMain") +
+        "\n#undef main\n"
+        "uniform vec3 iSdfBakeMin;\n"
+        "uniform vec3 iSdfBakeMax;\n"
+        "uniform float iSdfBakeResolution;\n"
+        "uniform float iSdfBakeSlice;\n"
+        "void main() {\n"
+        "    vec3 uvw = vec3(gl_FragCoord.xy, iSdfBakeSlice + 0.5) / iSdfBakeResolution;\n"
+        "    " + output[1].str() + " = vec4(" + function + "(mix(iSdfBakeMin, iSdfBakeMax, uvw)));\n"
+        "}\n";
     return true;
 }
 
-bool WallpaperManager::CompileShader(GLenum type, const std::string& source, GLuint* shaderIn) const
+void WallpaperManager::CreateVertexPipeline()
 {
-    GLuint id = glCreateShader(type);
-    const char* sourceCStr = source.c_str();
-    glShaderSource(id, 1, &sourceCStr, nullptr);
-    glCompileShader(id);
-
-    GLint result;
-    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-    if (result == GL_FALSE) {
-        GLint length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-
-        std::vector<GLchar> msg(length);
-        glGetShaderInfoLog(id, length, &length, msg.data());
-        if (type == GL_VERTEX_SHADER) {
-            LOG_ERROR("Failed to compile vertex shader");
-        }
-        else {
-            LOG_ERROR("Failed to compile fragment shader");
-        }
-        LOG_ERROR(msg.data());
-        glDeleteShader(id);
-        return false;
+    mUseSeparablePrograms = pProgramBuilder->UsesSeparablePrograms();
+    if (!mUseSeparablePrograms) {
+        return;
     }
 
-    *shaderIn = id;
-    return true;
+    // The pipeline keeps the vertex stage for good, wallpapers only ever swap the fragment stage
+    glGenProgramPipelines(1, &uPipeline);
+    glUseProgramStages(uPipeline, GL_VERTEX_SHADER_BIT, pProgramBuilder->GetVertexProgram());
+    glBindProgramPipeline(uPipeline);
 }
 
-bool WallpaperManager::ParseWallpaperMetadata(
-    const std::string& metadataYamlSource,
-    WallpaperMetadata& wallpaperMetadata,
-    std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
-    std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
-    std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
-) const {
-    YAML::Node node = YAML::Load(metadataYamlSource);
-
-    try {
-        YAML::Node nameNode = node["name"];
-        wallpaperMetadata.name = nameNode.as<std::string>();
-    }
-    catch (const YAML::KeyNotFound&) {
-        wallpaperMetadata.name = "";
-    }
-    catch (const YAML::BadConversion e) {
-        LOG_ERROR("Metadata 'name' must be a string!");
-        return false;
-    }
-
-    // Process float uniforms
-    YAML::Node uniforms = node["uniforms"];
-    auto floatUniformMetadata = uniforms["float"].as<std::unordered_map<std::string, UniformMetadata<GLfloat>>>();
-    for (auto it = floatUniformMetadata.begin(); it != floatUniformMetadata.end(); ++it) {
-        Uniform<GLfloat> uniform{};
-        uniform.metadata = it->second;
-        floatUniforms.insert(std::make_pair(it->first, uniform));
-    }
-
-    // Process int uniforms
-    auto intUniformMetadata = uniforms["int"].as<std::unordered_map<std::string, UniformMetadata<GLint>>>();
-    for (auto it = intUniformMetadata.begin(); it != intUniformMetadata.end(); ++it) {
-        Uniform<GLint> uniform{};
-        uniform.metadata = it->second;
-        intUniforms.insert(std::make_pair(it->first, uniform));
-    }
-
-    // Process bool uniforms
-    auto boolUniformMetadata = uniforms["bool"].as<std::unordered_map<std::string, UniformMetadata<GLboolean>>>();
-    for (auto it = boolUniformMetadata.begin(); it != boolUniformMetadata.end(); ++it) {
-        Uniform<GLboolean> uniform{};
-        uniform.metadata = it->second;
-        boolUniforms.insert(std::make_pair(it->first, uniform));
-    }
-    return true;
+GLuint WallpaperManager::CompileProgram(const std::string& fragmentSource, const std::vector<std::string>* files, double timeoutSeconds) const
+{
+    return pProgramBuilder->BuildProgram(fragmentSource, files, nullptr, nullptr, timeoutSeconds);
 }
 
 void WallpaperManager::AddIntUniform(std::string name, size_t count)
@@ -224,13 +159,6 @@ bool WallpaperManager::TrySetWallpaper(const std::string& path, WindowDimensions
         return false;
     }
 
-    // Try and compile the fragment shader
-    GLuint fragmentShader = 0;
-    bool compiled = CompileShader(GL_FRAGMENT_SHADER, wallpaperSources.fragmentShaderSource, &fragmentShader);
-    if (!compiled) {
-        return false;
-    }
-
     // Try and parse the metadata yaml
     std::unordered_map <std::string, Uniform<GLint>> intUniforms;
     std::unordered_map <std::string, Uniform<GLfloat>> floatUniforms;
@@ -244,51 +172,113 @@ bool WallpaperManager::TrySetWallpaper(const std::string& path, WindowDimensions
             metadataParsed = ParseWallpaperMetadata(wallpaperSources.metadataYamlSource, metadata, intUniforms, floatUniforms, boolUniforms);
         }
         catch (YAML::Exception e) {
-            glDeleteShader(fragmentShader);
             LOG_ERROR(e.what());
             return false;
         }
 
         if (!metadataParsed) {
-            glDeleteShader(fragmentShader);
             return false;
         }
     }
 
-    // Try and create the new prgoram
-    GLuint program = glCreateProgram();
-
-    glAttachShader(program, uVertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
+    std::string textureUnitError;
+    if (!CheckTextureUnits(metadata, wallpaperSources.fragmentShaderSource, &textureUnitError)) {
+        LOG_ERROR("Wallpaper {} {}", path, textureUnitError);
+        return false;
+    }
 
-    GLint valid = GL_FALSE;
-    glValidateProgram(program);
-    glGetProgramiv(program, GL_VALIDATE_STATUS, &valid);
+    // Try and compile the fragment shader, for the default quality tier if the wallpaper has tiers
+    std::string initialSource = wallpaperSources.fragmentShaderSource;
+    size_t initialTier = static_cast<size_t>(metadata.quality.defaultTier);
+    if (!metadata.quality.tiers.empty()) {
+        initialSource = InjectDefine(initialSource, metadata.quality.define, std::to_string(initialTier));
+    }
+    // Estimate how expensive the shader is before it goes on the desktop
+    ShaderCost estimatedCost = EstimateShaderCost(initialSource + "\n" + pProgramBuilder->GetLibrarySource());
+    double predictedMilliseconds = PredictFrameMilliseconds(estimatedCost, windowDimensions.width, windowDimensions.height, gpuGigaOps);
 
-    if (valid == GL_FALSE) {
-        LOG_TRACE("Failed to validate shader program for wallpaper " + path);
-        glDeleteProgram(program);
-        glDeleteShader(fragmentShader);
+    // Try and create the new program, loaded from the program cache if it was built before. The render thread waits on
+    // this one, so a shader too slow for the interactive timeout is refused instead of freezing the desktop for longer.
+    GLuint program = CompileProgram(initialSource, &wallpaperSources.shaderFiles, INTERACTIVE_SHADER_TIMEOUT_SECONDS);
+    if (program == 0) {
+        LOG_TRACE("Failed to build shader program for wallpaper " + path);
         return false;
     }
 
+    // Then measure it offscreen, and render it at a lower resolution or frame rate if it is over budget. The static
+    // estimate is only used if the measurement could not be made.
+    CostProbeResult measuredCost = ProbeProgramCost(program, windowDimensions, intUniforms, floatUniforms, boolUniforms);
+    float renderScale = 1.0f;
+    int frameCap = 0;
+    if (measuredCost.measured) {
+        if (!PickRenderSettings(path, measuredCost, windowDimensions, &renderScale, &frameCap)) {
+            glDeleteProgram(program);
+            return false;
+        }
+    }
+    else if (predictedMilliseconds > costBudgetMilliseconds) {
+        renderScale = std::clamp(static_cast<float>(std::sqrt(costBudgetMilliseconds / predictedMilliseconds)), MIN_RENDER_SCALE, 1.0f);
+        LOG_WARNING("Wallpaper {} is estimated at {:.0f} ops per pixel, {:.1f} ms per frame against a {:.1f} ms budget. Rendering at {:.0f}% resolution",
+            path, estimatedCost.TotalOps(), predictedMilliseconds, costBudgetMilliseconds, renderScale * 100.0f);
+    }
+
+    // A tier picked by hand only carries over a reload of the same wallpaper, and only if the tier still exists
+    if (path != mWallpaperPath || qualityOverride >= static_cast<int>(metadata.quality.tiers.size())) {
+        qualityOverride = -1;
+    }
+
     // We have made it without any errors so we are safe to remove previous shader
-    glDeleteShader(fragmentShader);
     UnloadCurrentWallpaper();
+    uDynamicProgramID = program;
     uShaderProgramID = program;
-    glUseProgram(uShaderProgramID);
+    BindProgram(uShaderProgramID);
+    mProgramSwitched = true;
+    mWindowDimensions = windowDimensions;
+    mWallpaperPath = path;
+    mEstimatedCost = estimatedCost;
+    mPredictedMilliseconds = predictedMilliseconds;
+    mMeasuredCost = measuredCost;
+    mRenderScale = renderScale;
+    mFrameCap = frameCap;
+    mFragmentShaderSource = wallpaperSources.fragmentShaderSource;
+    mShaderFiles = wallpaperSources.shaderFiles;
+    mLastUniformEdit = glfwGetTime();
     mMetadata = metadata;
+
+    // Every other quality tier is compiled in the background so switching tiers never waits on a compile
+    size_t tierCount = GetQualityTierCount();
+    mTierPrograms.assign(tierCount, 0);
+    mPendingTierPrograms.resize(tierCount);
+    mTierFrameMilliseconds.assign(tierCount, 0.0);
+    mTierPrograms[initialTier] = program;
+    mActiveTier = initialTier;
+    mTierSwitchTime = glfwGetTime();
+    mUnderBudgetSince = mTierSwitchTime;
+    mQualityReason = "default tier";
+    for (size_t tier = 0; tier < tierCount; tier++) {
+        if (tier != initialTier) {
+            mPendingTierPrograms[tier] = pWorker->Submit([this, source = BuildTierSource(tier), files = mShaderFiles]() -> GLuint {
+                return CompileProgram(source, &files);
+            });
+        }
+    }
     mIntUniforms = std::move(intUniforms);
     mFloatUniforms = std::move(floatUniforms);
     mBoolUniforms = std::move(boolUniforms);
+    LoadTextures(path);
+    LoadVirtualTextures(path);
+    LoadVideos(path);
+    LoadAudio(path);
+    LoadNoiseTextures();
+    LoadAtlas(path);
+    LoadSdfVolume();
 
     // Gather our shaders uniform values and store them in the mUniforms map
     mBuiltinUniformsLocations = BuiltinUniformsLocations{};
     GLint count;
     GLint size;
     GLenum type;
-    const GLsizei bufSize = 16;
+    const GLsizei bufSize = 64;
     GLchar name[bufSize];
     GLsizei length;
     glGetProgramiv(uShaderProgramID, GL_ACTIVE_UNIFORMS, &count);
@@ -296,7 +286,8 @@ bool WallpaperManager::TrySetWallpaper(const std::string& path, WindowDimensions
     {
         glGetActiveUniform(uShaderProgramID, static_cast<GLuint>(i), bufSize, &length, &size, &type, name);
         if (strcmp(name, "iResolution") == 0 && type == GL_FLOAT_VEC2) {
-            glUniform2f(glGetUniformLocation(uShaderProgramID, "iResolution"), static_cast<float>(windowDimensions.width), static_cast<float>(windowDimensions.height));
+            WindowDimensions renderDimensions = GetRenderDimensions();
+            glUniform2f(glGetUniformLocation(uShaderProgramID, "iResolution"), static_cast<float>(renderDimensions.width), static_cast<float>(renderDimensions.height));
         }
         else if (strcmp(name, "iTime") == 0 && type == GL_FLOAT) {
             mBuiltinUniformsLocations.time = glGetUniformLocation(uShaderProgramID, "iTime");
@@ -304,6 +295,19 @@ bool WallpaperManager::TrySetWallpaper(const std::string& path, WindowDimensions
         else if (strcmp(name, "iMouse") == 0 && type == GL_FLOAT_VEC2) {
             mBuiltinUniformsLocations.mousePos = glGetUniformLocation(uShaderProgramID, "iMouse");
         }
+        else if (strcmp(name, "iAudio") == 0 && type == GL_FLOAT_VEC4) {
+            mBuiltinUniformsLocations.audio = glGetUniformLocation(uShaderProgramID, "iAudio");
+            SetAudioUniforms();
+        }
+        else if (IsVirtualTextureUniform(name)) {
+            SetVirtualTextureUniforms(0.0f);
+        }
+        else if (IsAtlasUniform(name)) {
+            SetAtlasUniforms(uShaderProgramID);
+        }
+        else if (IsSdfUniform(name)) {
+            SetSdfUniforms();
+        }
         else {
             // insert into map non default uniforms for use in ImGUI menu
             switch (type) {
@@ -343,6 +347,13 @@ bool WallpaperManager::TrySetWallpaper(const std::string& path, WindowDimensions
                 AddBoolUniform(name, 1);
                 break;
             }
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_3D: {
+                if (!BindSamplerUniform(uShaderProgramID, name)) {
+                    LOG_WARNING("Sampler {} has no texture declared in the metadata", name);
+                }
+                break;
+            }
             }
         }
     }
@@ -353,9 +364,1276 @@ bool WallpaperManager::TrySetWallpaper(const std::string& path, WindowDimensions
 
 void WallpaperManager::UnloadCurrentWallpaper()
 {
-    glDeleteProgram(uShaderProgramID);
+    BindProgram(0);
+    ClearSpecializedPrograms();
+    ClearTierPrograms();
+    // Releasing the handles leaves the textures warm in the cache for the next wallpaper that uses them
+    mTextures.clear();
+    mVirtualTextures.clear();
+    mVideos.clear();
+    pAudio = nullptr;
+    mNoiseUnits.fill(-1);
+    mPendingAtlas = std::future<AtlasBuild>();
+    mAtlasLayout = AtlasLayout{};
+    mAtlasPages.clear();
+    ClearSdfVolume();
+    uDynamicProgramID = 0;
+    uShaderProgramID = 0;
+    mWallpaperPath.clear();
+    mFragmentShaderSource.clear();
+    mShaderFiles.clear();
     mMetadata = WallpaperMetadata{};
     mIntUniforms.clear();
     mFloatUniforms.clear();
     mBoolUniforms.clear();
 }
+
+void WallpaperManager::BindProgram(GLuint program) const
+{
+    if (mUseSeparablePrograms) {
+        // glUniform* calls go to the pipeline's active program, so that has to follow the fragment stage
+        glUseProgramStages(uPipeline, GL_FRAGMENT_SHADER_BIT, program);
+        glActiveShaderProgram(uPipeline, program);
+    }
+    else {
+        glUseProgram(program);
+    }
+}
+
+void WallpaperManager::UseProgram(GLuint program)
+{
+    uShaderProgramID = program;
+    BindProgram(uShaderProgramID);
+    mProgramSwitched = true;
+
+    // Uniform locations are per program, so they have to be looked up again after every switch
+    GLint resolution = glGetUniformLocation(uShaderProgramID, "iResolution");
+    if (resolution != -1) {
+        WindowDimensions renderDimensions = GetRenderDimensions();
+        glUniform2f(resolution, static_cast<float>(renderDimensions.width), static_cast<float>(renderDimensions.height));
+    }
+    mBuiltinUniformsLocations.time = glGetUniformLocation(uShaderProgramID, "iTime");
+    mBuiltinUniformsLocations.mousePos = glGetUniformLocation(uShaderProgramID, "iMouse");
+    mBuiltinUniformsLocations.audio = glGetUniformLocation(uShaderProgramID, "iAudio");
+
+    for (auto it = mIntUniforms.begin(); it != mIntUniforms.end(); ++it) {
+        it->second.location = glGetUniformLocation(uShaderProgramID, it->first.c_str());
+    }
+    for (auto it = mFloatUniforms.begin(); it != mFloatUniforms.end(); ++it) {
+        it->second.location = glGetUniformLocation(uShaderProgramID, it->first.c_str());
+    }
+    for (auto it = mBoolUniforms.begin(); it != mBoolUniforms.end(); ++it) {
+        it->second.location = glGetUniformLocation(uShaderProgramID, it->first.c_str());
+    }
+    for (const WallpaperTexture& wallpaperTexture : mTextures) {
+        BindSamplerUniform(uShaderProgramID, wallpaperTexture.uniformName);
+    }
+    for (const WallpaperVirtualTexture& virtualTexture : mVirtualTextures) {
+        BindSamplerUniform(uShaderProgramID, virtualTexture.uniformName);
+        BindSamplerUniform(uShaderProgramID, virtualTexture.uniformName + "Table");
+    }
+    for (const WallpaperVideo& video : mVideos) {
+        BindSamplerUniform(uShaderProgramID, video.uniformName);
+    }
+    if (pAudio != nullptr) {
+        BindSamplerUniform(uShaderProgramID, "iAudioTexture");
+    }
+    for (size_t i = 0; i < mNoiseUnits.size(); i++) {
+        if (mNoiseUnits[i] != -1) {
+            BindSamplerUniform(uShaderProgramID, GetNoiseUniformName(static_cast<NoiseKind>(i)));
+        }
+    }
+    SetVirtualTextureUniforms(0.0f);
+    SetAudioUniforms();
+    SetAtlasUniforms(uShaderProgramID);
+    SetSdfUniforms();
+}
+
+// Shortest text that reads back to exactly the same value, used both for cache keys and GLSL literals
+template<typename T>
+static std::string FormatValue(T value)
+{
+    char buf[32];
+    std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), value);
+    return std::string(buf, result.ptr);
+}
+
+static std::string FormatMilliseconds(double milliseconds)
+{
+    char buf[32];
+    std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), milliseconds, std::chars_format::fixed, 1);
+    return std::string(buf, result.ptr) + " ms";
+}
+
+std::string WallpaperManager::BuildTierSource(size_t tier) const
+{
+    if (mMetadata.quality.tiers.empty()) {
+        return mFragmentShaderSource;
+    }
+    return InjectDefine(mFragmentShaderSource, mMetadata.quality.define, std::to_string(tier));
+}
+
+std::string WallpaperManager::BuildUniformValueKey() const
+{
+    std::string key = "tier=" + std::to_string(mActiveTier) + ";";
+    for (auto it = mIntUniforms.begin(); it != mIntUniforms.end(); ++it) {
+        key += it->first + "=";
+        for (GLint value : it->second.elements) {
+            key += FormatValue(value) + ",";
+        }
+        key += ";";
+    }
+    for (auto it = mFloatUniforms.begin(); it != mFloatUniforms.end(); ++it) {
+        key += it->first + "=";
+        for (GLfloat value : it->second.elements) {
+            key += FormatValue(value) + ",";
+        }
+        key += ";";
+    }
+    for (auto it = mBoolUniforms.begin(); it != mBoolUniforms.end(); ++it) {
+        key += it->first + "=";
+        for (GLboolean value : it->second.elements) {
+            key += value ? "1," : "0,";
+        }
+        key += ";";
+    }
+    return key;
+}
+
+/*
+Replace each user uniform declaration with a constant of the same type holding its current value, e.g.
+"uniform float speed = 1.0;" becomes "const float speed = float(2.5);". Declarations that do not have the
+plain "uniform <type> <name>" form are left alone and keep being set as uniforms.
+*/
+static std::string SpecializeDeclaration(const std::string& source, const std::string& name, const std::string& values)
+{
+    std::regex declaration("uniform\\s+(\\w+)\\s+" + name + "\\b\\s*(=[^;]*)?;");
+    std::smatch match;
+    if (!std::regex_search(source, match, declaration)) {
+        return source;
+    }
+    std::string type = match[1].str();
+    return match.prefix().str() + "const " + type + " " + name + " = " + type + "(" + values + ");" + match.suffix().str();
+}
+
+std::string WallpaperManager::BuildSpecializedSource() const
+{
+    std::string source = BuildTierSource(mActiveTier);
+    for (auto it = mIntUniforms.begin(); it != mIntUniforms.end(); ++it) {
+        std::string values;
+        for (GLint value : it->second.elements) {
+            values += (values.empty() ? "" : ", ") + FormatValue(value);
+        }
+        source = SpecializeDeclaration(source, it->first, values);
+    }
+    for (auto it = mFloatUniforms.begin(); it != mFloatUniforms.end(); ++it) {
+        std::string values;
+        bool finite = true;
+        for (GLfloat value : it->second.elements) {
+            finite = finite && std::isfinite(value);
+            values += (values.empty() ? "" : ", ") + FormatValue(value);
+        }
+        if (finite) {
+            source = SpecializeDeclaration(source, it->first, values);
+        }
+    }
+    for (auto it = mBoolUniforms.begin(); it != mBoolUniforms.end(); ++it) {
+        source = SpecializeDeclaration(source, it->first, it->second.elements.at(0) ? "true" : "false");
+    }
+    return source;
+}
+
+void WallpaperManager::CollectBackgroundPrograms()
+{
+    // Programs compiled for a wallpaper that has since been unloaded are deleted once they finish
+    for (auto it = mDiscardedPrograms.begin(); it != mDiscardedPrograms.end();) {
+        if (IsReady(*it)) {
+            glDeleteProgram(it->get());
+            it = mDiscardedPrograms.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (size_t tier = 0; tier < mPendingTierPrograms.size(); tier++) {
+        if (IsReady(mPendingTierPrograms[tier])) {
+            mTierPrograms[tier] = mPendingTierPrograms[tier].get();
+            if (mTierPrograms[tier] == 0) {
+                LOG_WARNING("Failed to compile quality tier {}, it will not be used", mMetadata.quality.tiers.at(tier));
+            }
+        }
+    }
+
+    if (!IsReady(mPendingProgram)) {
+        return;
+    }
+
+    GLuint program = mPendingProgram.get();
+    if (program == 0) {
+        LOG_WARNING("Failed to compile specialized program, continuing with dynamic uniforms");
+        // Wait for the next edit rather than submitting the same source again
+        mFailedValueKeys.insert(mPendingValueKey);
+        mPendingValueKey.clear();
+        mLastUniformEdit = INFINITY;
+        return;
+    }
+
+    if (mSpecializedPrograms.size() >= MAX_SPECIALIZED_PROGRAMS) {
+        // The oldest variant can never be the active one as specializing only starts from the dynamic program
+        glDeleteProgram(mSpecializedPrograms.front().program);
+        mSpecializedPrograms.pop_front();
+    }
+    mSpecializedPrograms.push_back(SpecializedProgram{ mPendingValueKey, program });
+    mPendingValueKey.clear();
+}
+
+void WallpaperManager::ClearSpecializedPrograms()
+{
+    for (const SpecializedProgram& specialized : mSpecializedPrograms) {
+        glDeleteProgram(specialized.program);
+    }
+    mSpecializedPrograms.clear();
+    if (mPendingProgram.valid()) {
+        mDiscardedPrograms.push_back(std::move(mPendingProgram));
+    }
+    mPendingValueKey.clear();
+    mFailedValueKeys.clear();
+}
+
+void WallpaperManager::ClearTierPrograms()
+{
+    for (GLuint program : mTierPrograms) {
+        glDeleteProgram(program);
+    }
+    for (std::future<GLuint>& pending : mPendingTierPrograms) {
+        if (pending.valid()) {
+            mDiscardedPrograms.push_back(std::move(pending));
+        }
+    }
+    mTierPrograms.clear();
+    mPendingTierPrograms.clear();
+    mTierFrameMilliseconds.clear();
+    mActiveTier = 0;
+    mQualityReason.clear();
+}
+
+void WallpaperManager::SetQualityTier(size_t tier, const std::string& reason)
+{
+    mQualityReason = reason;
+    if (tier == mActiveTier) {
+        return;
+    }
+
+    LOG_INFO("Quality tier {} -> {}: {}", mMetadata.quality.tiers.at(mActiveTier), mMetadata.quality.tiers.at(tier), reason);
+    mActiveTier = tier;
+    mTierSwitchTime = glfwGetTime();
+    mUnderBudgetSince = mTierSwitchTime;
+    uDynamicProgramID = mTierPrograms[tier];
+    UseProgram(uDynamicProgramID);
+}
+
+void WallpaperManager::UpdateQualityTier(bool hasFrameTime, double gpuFrameMilliseconds)
+{
+    if (mTierPrograms.size() < 2) {
+        return;
+    }
+
+    if (qualityOverride >= 0) {
+        size_t tier = std::min(static_cast<size_t>(qualityOverride), mTierPrograms.size() - 1);
+        if (IsQualityTierReady(tier)) {
+            SetQualityTier(tier, "set from the control menu");
+        }
+        else {
+            mQualityReason = "waiting for " + mMetadata.quality.tiers.at(tier) + " to compile";
+        }
+        return;
+    }
+
+    double now = glfwGetTime();
+    if (!hasFrameTime || now - mTierSwitchTime < QUALITY_SETTLE_SECONDS) {
+        return;
+    }
+
+    // Remember what each tier costs so we never climb back into a tier that was already over budget
+    mTierFrameMilliseconds[mActiveTier] = gpuFrameMilliseconds;
+    double budget = mMetadata.quality.budgetMilliseconds;
+
+    if (gpuFrameMilliseconds > budget) {
+        for (size_t tier = mActiveTier; tier-- > 0;) {
+            if (IsQualityTierReady(tier)) {
+                SetQualityTier(tier, "GPU frame time " + FormatMilliseconds(gpuFrameMilliseconds) + " over " + FormatMilliseconds(budget) + " budget");
+                return;
+            }
+        }
+        mUnderBudgetSince = now;
+        return;
+    }
+
+    if (gpuFrameMilliseconds > budget * QUALITY_RAISE_HEADROOM) {
+        mUnderBudgetSince = now;
+        return;
+    }
+
+    size_t next = mActiveTier + 1;
+    if (now - mUnderBudgetSince < QUALITY_RAISE_DELAY_SECONDS || next >= mTierPrograms.size() || !IsQualityTierReady(next)) {
+        return;
+    }
+    if (mTierFrameMilliseconds[next] > budget) {
+        return;
+    }
+    SetQualityTier(next, "GPU frame time " + FormatMilliseconds(gpuFrameMilliseconds) + " well under " + FormatMilliseconds(budget) + " budget");
+}
+
+void WallpaperManager::UpdateSpecialization()
+{
+    if (!specializeUniforms || uShaderProgramID != uDynamicProgramID) {
+        return;
+    }
+    if (glfwGetTime() - mLastUniformEdit < SPECIALIZE_DELAY_SECONDS || mPendingProgram.valid()) {
+        return;
+    }
+
+    // Uniforms have been stable for long enough, swap in a cached variant or compile one in the background
+    std::string valueKey = BuildUniformValueKey();
+    for (const SpecializedProgram& specialized : mSpecializedPrograms) {
+        if (specialized.valueKey == valueKey) {
+            UseProgram(specialized.program);
+            LOG_TRACE("Using specialized program for uniform values " + valueKey);
+            return;
+        }
+    }
+
+    std::string source = BuildSpecializedSource();
+    if (source == BuildTierSource(mActiveTier) || mFailedValueKeys.count(valueKey) > 0) {
+        // Nothing could be specialized, or it already failed for these values, so make sure we don't try again every frame
+        mLastUniformEdit = INFINITY;
+        return;
+    }
+
+    mPendingValueKey = valueKey;
+    // Specialized programs are only good for one set of values, so they are kept out of the program cache
+    mPendingProgram = pWorker->Submit([this, source]() -> GLuint {
+        return pProgramBuilder->CompileProgram(source);
+    });
+}
+
+void WallpaperManager::Update(bool hasFrameTime, double gpuFrameMilliseconds)
+{
+    CollectBackgroundPrograms();
+    UpdateAtlas();
+    UpdateTextures();
+    UpdateVirtualTextures();
+    UpdateVideos();
+
+    if (!hasWallpaper) {
+        return;
+    }
+    UpdateQualityTier(hasFrameTime, gpuFrameMilliseconds);
+    UpdateSpecialization();
+    if (pAudio != nullptr && pAudio->Update()) {
+        SetAudioUniforms();
+    }
+    UpdateSdfVolume(hasFrameTime, gpuFrameMilliseconds);
+}
+
+void WallpaperManager::NotifyUniformsEdited()
+{
+    mLastUniformEdit = glfwGetTime();
+    // The volume no longer matches the function, which is evaluated directly until the edits settle and it is baked again
+    mSdfDirty = true;
+    mSdfBaked = false;
+    mSdfBakeAfter = mLastUniformEdit + SPECIALIZE_DELAY_SECONDS;
+    if (uShaderProgramID != uDynamicProgramID) {
+        UseProgram(uDynamicProgramID);
+        LOG_TRACE("Uniform edited, reverting to dynamic program");
+    }
+}
+
+// Copy the saved values back into uniforms with the same name and number of elements
+template<typename T>
+static void RestoreUniformValues(const std::unordered_map<std::string, std::vector<T>>& saved, std::unordered_map<std::string, Uniform<T>>& uniforms)
+{
+    for (auto it = uniforms.begin(); it != uniforms.end(); ++it) {
+        auto find = saved.find(it->first);
+        if (find != saved.end() && find->second.size() == it->second.elements.size()) {
+            it->second.elements = find->second;
+        }
+    }
+}
+
+bool WallpaperManager::ReloadWallpaper(WindowDimensions windowDimensions)
+{
+    if (!hasWallpaper) {
+        return false;
+    }
+    std::unordered_map<std::string, std::vector<GLint>> intValues;
+    std::unordered_map<std::string, std::vector<GLfloat>> floatValues;
+    std::unordered_map<std::string, std::vector<GLboolean>> boolValues;
+    for (auto it = mIntUniforms.begin(); it != mIntUniforms.end(); ++it) {
+        intValues.emplace(it->first, it->second.elements);
+    }
+    for (auto it = mFloatUniforms.begin(); it != mFloatUniforms.end(); ++it) {
+        floatValues.emplace(it->first, it->second.elements);
+    }
+    for (auto it = mBoolUniforms.begin(); it != mBoolUniforms.end(); ++it) {
+        boolValues.emplace(it->first, it->second.elements);
+    }
+
+    // Copied since loading clears the current path
+    std::string path = mWallpaperPath;
+    if (!TrySetWallpaper(path, windowDimensions)) {
+        LOG_WARNING("Reloading {} failed, keeping the previous version", path);
+        return false;
+    }
+    RestoreUniformValues(intValues, mIntUniforms);
+    RestoreUniformValues(floatValues, mFloatUniforms);
+    RestoreUniformValues(boolValues, mBoolUniforms);
+    NotifyUniformsEdited();
+    return true;
+}
+
+const std::string& WallpaperManager::GetWallpaperPath() const
+{
+    return mWallpaperPath;
+}
+
+std::vector<std::string> WallpaperManager::GetDependencyPaths() const
+{
+    std::vector<std::string> paths;
+    if (!hasWallpaper) {
+        return paths;
+    }
+    if (mShaderFiles.size() > 1) {
+        paths.insert(paths.end(), mShaderFiles.begin() + 1, mShaderFiles.end());
+    }
+    std::filesystem::path directory = std::filesystem::path(mWallpaperPath).parent_path();
+    for (auto it = mMetadata.textures.begin(); it != mMetadata.textures.end(); ++it) {
+        paths.push_back((directory / it->second.path).string());
+    }
+    for (auto it = mMetadata.virtualTextures.begin(); it != mMetadata.virtualTextures.end(); ++it) {
+        paths.push_back((directory / it->second).string());
+    }
+    for (auto it = mMetadata.videos.begin(); it != mMetadata.videos.end(); ++it) {
+        paths.push_back((directory / it->second.path).string());
+    }
+    for (auto it = mMetadata.sprites.begin(); it != mMetadata.sprites.end(); ++it) {
+        paths.push_back((directory / it->second).string());
+    }
+    if (!mMetadata.audio.empty()) {
+        paths.push_back((directory / mMetadata.audio).string());
+    }
+    return paths;
+}
+
+bool WallpaperManager::IsSpecialized() const
+{
+    return uShaderProgramID != uDynamicProgramID;
+}
+
+size_t WallpaperManager::GetQualityTierCount() const
+{
+    return std::max(mMetadata.quality.tiers.size(), static_cast<size_t>(1));
+}
+
+size_t WallpaperManager::GetQualityTier() const
+{
+    return mActiveTier;
+}
+
+bool WallpaperManager::IsQualityTierReady(size_t tier) const
+{
+    return tier < mTierPrograms.size() && mTierPrograms[tier] != 0;
+}
+
+const std::string& WallpaperManager::GetQualityReason() const
+{
+    return mQualityReason;
+}
+
+bool WallpaperManager::TakeProgramSwitch()
+{
+    bool switched = mProgramSwitched;
+    mProgramSwitched = false;
+    return switched;
+}
+
+const ShaderCost& WallpaperManager::GetEstimatedCost() const
+{
+    return mEstimatedCost;
+}
+
+double WallpaperManager::GetPredictedMilliseconds() const
+{
+    return mPredictedMilliseconds;
+}
+
+float WallpaperManager::GetRenderScale() const
+{
+    return mRenderScale;
+}
+
+void WallpaperManager::SetRenderScale(float scale)
+{
+    mRenderScale = std::clamp(scale, MIN_RENDER_SCALE, 1.0f);
+    if (hasWallpaper) {
+        // Re-apply the program so iResolution matches the new render size
+        UseProgram(uShaderProgramID);
+    }
+}
+
+const CostProbeResult& WallpaperManager::GetMeasuredCost() const
+{
+    return mMeasuredCost;
+}
+
+int WallpaperManager::GetFrameCap() const
+{
+    return mFrameCap;
+}
+
+void WallpaperManager::SetFrameCap(int framesPerSecond)
+{
+    mFrameCap = std::max(framesPerSecond, 0);
+}
+
+CostProbeResult WallpaperManager::ProbeProgramCost(GLuint program, WindowDimensions windowDimensions,
+    const std::unordered_map<std::string, Uniform<GLint>>& intUniforms, const std::unordered_map<std::string, Uniform<GLfloat>>& floatUniforms,
+    const std::unordered_map<std::string, Uniform<GLboolean>>& boolUniforms)
+{
+    CostProbeResult result = pCostProbe->MeasureProgram(program, windowDimensions, [this](GLuint probed) { BindProgram(probed); },
+        intUniforms, floatUniforms, boolUniforms);
+    // The wallpaper showing keeps being drawn until the new one replaces it
+    BindProgram(uShaderProgramID);
+    if (!result.measured) {
+        LOG_ERROR("Cost probe draw raised GL error 0x{:04X}, falling back to the static cost estimate", result.error);
+    }
+    LOG_TRACE("Cost probe took {:.1f} ms: {:.3f} ms per frame and {:.3f} ns per pixel, {:.2f} ms at {}x{}", result.probeMilliseconds,
+        result.fixedMilliseconds, result.nanosecondsPerPixel, result.fullMilliseconds, windowDimensions.width, windowDimensions.height);
+    return result;
+}
+
+bool WallpaperManager::PickRenderSettings(const std::string& path, const CostProbeResult& measuredCost, WindowDimensions windowDimensions,
+    float* renderScale, int* frameCap) const
+{
+    double scaledMilliseconds = 0.0;
+    if (!::PickRenderSettings(measuredCost, windowDimensions, costBudgetMilliseconds, renderScale, frameCap, &scaledMilliseconds)) {
+        LOG_ERROR("Wallpaper {} measured at {:.1f} ms per frame, {:.1f} ms even at {:.0f}% resolution. Not loading it", path,
+            measuredCost.fullMilliseconds, scaledMilliseconds, *renderScale * 100.0f);
+        return false;
+    }
+    if (measuredCost.fullMilliseconds > costBudgetMilliseconds) {
+        LOG_WARNING("Wallpaper {} measured at {:.1f} ms per frame against a {:.1f} ms budget. Rendering at {:.0f}% resolution{}", path,
+            measuredCost.fullMilliseconds, costBudgetMilliseconds, *renderScale * 100.0f,
+            *frameCap > 0 ? ", capped at " + std::to_string(*frameCap) + " fps" : std::string());
+    }
+    return true;
+}
+
+WindowDimensions WallpaperManager::GetRenderDimensions() const
+{
+    return WindowDimensions{
+        std::max(static_cast<int>(static_cast<float>(mWindowDimensions.width) * mRenderScale), 1),
+        std::max(static_cast<int>(static_cast<float>(mWindowDimensions.height) * mRenderScale), 1)
+    };
+}
+
+ProgramCacheStats WallpaperManager::GetProgramCacheStats() const
+{
+    return pProgramBuilder->GetCacheStats();
+}
+
+ShaderSandboxStats WallpaperManager::GetShaderSandboxStats() const
+{
+    return pShaderSandbox->GetStats();
+}
+
+ShaderSandbox* WallpaperManager::GetShaderSandbox() const
+{
+    return pShaderSandbox.get();
+}
+
+void WallpaperManager::LoadTextures(const std::string& wallpaperPath)
+{
+    std::filesystem::path directory = std::filesystem::path(wallpaperPath).parent_path();
+    GLint unit = 0;
+    for (auto it = mMetadata.textures.begin(); it != mMetadata.textures.end(); ++it) {
+        std::string imagePath = (directory / it->second.path).string();
+        WallpaperTexture wallpaperTexture{};
+        wallpaperTexture.uniformName = it->first;
+        wallpaperTexture.unit = unit++;
+        wallpaperTexture.pendingFile = pDecodePool->Submit([imagePath]() {
+            EncodedFile file{};
+            file.path = imagePath;
+            auto bytes = std::make_shared<std::vector<unsigned char>>();
+            if (ReadFileBytes(imagePath, bytes.get())) {
+                file.contentHash = HashBytes(bytes->data(), bytes->size());
+                file.bytes = std::move(bytes);
+            }
+            return file;
+        });
+        mTextures.push_back(std::move(wallpaperTexture));
+    }
+}
+
+void WallpaperManager::UpdateTextures()
+{
+    for (size_t i = 0; i < mTextures.size(); i++) {
+        WallpaperTexture& wallpaperTexture = mTextures[i];
+        if (!IsReady(wallpaperTexture.pendingFile)) {
+            continue;
+        }
+
+        EncodedFile file = wallpaperTexture.pendingFile.get();
+        if (file.bytes == nullptr) {
+            LOG_ERROR("Texture {} could not be read and will be left black", wallpaperTexture.uniformName);
+            continue;
+        }
+        const TextureSampling& sampling = mMetadata.textures.at(wallpaperTexture.uniformName).sampling;
+        wallpaperTexture.handle = pTextureCache->Acquire(file.contentHash, sampling, std::move(file.bytes), file.path);
+    }
+    pTextureCache->Update(glfwGetTime());
+    pUploader->Process();
+}
+
+bool WallpaperManager::BindSamplerUniform(GLuint program, const std::string& name) const
+{
+    for (const WallpaperTexture& wallpaperTexture : mTextures) {
+        if (wallpaperTexture.uniformName == name) {
+            GLint location = glGetUniformLocation(program, name.c_str());
+            if (location != -1) {
+                glUniform1i(location, wallpaperTexture.unit);
+            }
+            return true;
+        }
+    }
+    for (const WallpaperVirtualTexture& virtualTexture : mVirtualTextures) {
+        bool isPages = virtualTexture.uniformName == name;
+        if (isPages || virtualTexture.uniformName + "Table" == name) {
+            GLint location = glGetUniformLocation(program, name.c_str());
+            if (location != -1) {
+                glUniform1i(location, isPages ? virtualTexture.pageUnit : virtualTexture.tableUnit);
+            }
+            return true;
+        }
+    }
+    for (const WallpaperVideo& video : mVideos) {
+        if (video.uniformName == name) {
+            GLint location = glGetUniformLocation(program, name.c_str());
+            if (location != -1) {
+                glUniform1i(location, video.unit);
+            }
+            return true;
+        }
+    }
+    if (pAudio != nullptr && name == "iAudioTexture") {
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location != -1) {
+            glUniform1i(location, mAudioUnit);
+        }
+        return true;
+    }
+    for (size_t i = 0; i < mNoiseUnits.size(); i++) {
+        if (mNoiseUnits[i] != -1 && name == GetNoiseUniformName(static_cast<NoiseKind>(i))) {
+            GLint location = glGetUniformLocation(program, name.c_str());
+            if (location != -1) {
+                glUniform1i(location, mNoiseUnits[i]);
+            }
+            return true;
+        }
+    }
+    if (pSdfVolume != nullptr && name == "iSdf") {
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location != -1) {
+            glUniform1i(location, mSdfUnit);
+        }
+        return true;
+    }
+    if (mMetadata.sprites.contains(name)) {
+        // Points at the first page until the atlas is packed and the sprite's own page is known
+        SetAtlasUniforms(program);
+        return true;
+    }
+    return false;
+}
+
+void WallpaperManager::BindTextures() const
+{
+    // Units of textures that aren't ready are cleared, otherwise they would show whatever the last wallpaper bound there
+    for (const WallpaperTexture& wallpaperTexture : mTextures) {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(wallpaperTexture.unit));
+        if (wallpaperTexture.handle != nullptr && wallpaperTexture.handle->texture != nullptr && wallpaperTexture.handle->texture->IsReady()) {
+            wallpaperTexture.handle->texture->Bind();
+        }
+        else {
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+    for (const WallpaperVirtualTexture& virtualTexture : mVirtualTextures) {
+        virtualTexture.texture->Bind(virtualTexture.pageUnit, virtualTexture.tableUnit);
+    }
+    for (const WallpaperVideo& video : mVideos) {
+        video.texture->Bind(video.unit);
+    }
+    if (pAudio != nullptr) {
+        pAudio->Bind(mAudioUnit);
+    }
+    for (size_t i = 0; i < mNoiseUnits.size(); i++) {
+        if (mNoiseUnits[i] != -1) {
+            pNoiseTextures->Bind(static_cast<NoiseKind>(i), mNoiseUnits[i]);
+        }
+    }
+    // Sprites sample the first page until the atlas is packed
+    if (mAtlasPages.empty() && !mMetadata.sprites.empty()) {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(mAtlasUnit));
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    for (size_t i = 0; i < mAtlasPages.size(); i++) {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(mAtlasUnit) + static_cast<GLenum>(i));
+        if (mAtlasPages[i]->IsReady()) {
+            mAtlasPages[i]->Bind();
+        }
+        else {
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+    if (pSdfVolume != nullptr) {
+        pSdfVolume->Bind(mSdfUnit);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+size_t WallpaperManager::GetPendingTextureCount() const
+{
+    size_t pending = 0;
+    for (const WallpaperTexture& wallpaperTexture : mTextures) {
+        if (wallpaperTexture.handle != nullptr && wallpaperTexture.handle->failed) {
+            continue;
+        }
+        if (wallpaperTexture.handle == nullptr || wallpaperTexture.handle->texture == nullptr || !wallpaperTexture.handle->texture->IsReady()) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+TextureCacheStats WallpaperManager::GetTextureCacheStats() const
+{
+    return pTextureCache->GetStats();
+}
+
+void WallpaperManager::LoadVirtualTextures(const std::string& wallpaperPath)
+{
+    std::filesystem::path directory = std::filesystem::path(wallpaperPath).parent_path();
+    // Units follow on from the ordinary textures, two per virtual texture
+    GLint unit = static_cast<GLint>(mMetadata.textures.size());
+    for (auto it = mMetadata.virtualTextures.begin(); it != mMetadata.virtualTextures.end(); ++it) {
+        auto texture = std::make_unique<VirtualTexture>((directory / it->second).string(), *pDecodePool);
+        if (!texture->IsValid()) {
+            LOG_ERROR("Virtual texture {} could not be opened and will be left black", it->first);
+            continue;
+        }
+        WallpaperVirtualTexture virtualTexture{};
+        virtualTexture.uniformName = it->first;
+        virtualTexture.pageUnit = unit++;
+        virtualTexture.tableUnit = unit++;
+        virtualTexture.texture = std::move(texture);
+        mVirtualTextures.push_back(std::move(virtualTexture));
+    }
+}
+
+void WallpaperManager::UpdateVirtualTextures()
+{
+    if (mVirtualTextures.empty()) {
+        return;
+    }
+    double now = glfwGetTime();
+
+    if (pVirtualFeedback->Collect(&mFeedbackTexels)) {
+        // Most of the screen asks for the same few tiles, so drop duplicates before decoding them
+        std::sort(mFeedbackTexels.begin(), mFeedbackTexels.end());
+        mFeedbackTexels.erase(std::unique(mFeedbackTexels.begin(), mFeedbackTexels.end()), mFeedbackTexels.end());
+
+        std::vector<std::vector<VirtualTileRequest>> requests(mVirtualTextures.size());
+        for (uint32_t texel : mFeedbackTexels) {
+            // Written by libVirtualTexture: r and g are the low bits of the tile x and y, b holds their high
+            // bits and a is the texture index times 16 plus the level plus one, zero for no request
+            uint32_t a = texel >> 24;
+            if (a == 0 || a / 16 >= mVirtualTextures.size()) {
+                continue;
+            }
+            uint32_t b = (texel >> 16) & 0xFF;
+            VirtualTileRequest request{};
+            request.level = static_cast<int>(a % 16) - 1;
+            request.x = static_cast<int>((texel & 0xFF) | ((b & 0xF) << 8));
+            request.y = static_cast<int>(((texel >> 8) & 0xFF) | ((b >> 4) << 8));
+            std::vector<VirtualTileRequest>& textureRequests = requests[a / 16];
+            textureRequests.push_back(request);
+            // The parent is the fallback while a tile streams in, so keep it wanted too
+            textureRequests.push_back(VirtualTileRequest{ request.level + 1, request.x / 2, request.y / 2 });
+        }
+        for (size_t i = 0; i < mVirtualTextures.size(); i++) {
+            mVirtualTextures[i].texture->RequestTiles(std::move(requests[i]), now);
+        }
+    }
+
+    for (WallpaperVirtualTexture& virtualTexture : mVirtualTextures) {
+        virtualTexture.texture->Update(now);
+    }
+}
+
+bool WallpaperManager::IsVirtualTextureUniform(const std::string& name) const
+{
+    if (name == "iVirtualLodBias") {
+        return true;
+    }
+    for (const WallpaperVirtualTexture& virtualTexture : mVirtualTextures) {
+        if (virtualTexture.uniformName + "Info" == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WallpaperManager::SetVirtualTextureUniforms(float lodBias) const
+{
+    GLint bias = glGetUniformLocation(uShaderProgramID, "iVirtualLodBias");
+    if (bias != -1) {
+        glUniform1f(bias, lodBias);
+    }
+    for (size_t i = 0; i < mVirtualTextures.size(); i++) {
+        const VirtualTexture& texture = *mVirtualTextures[i].texture;
+        GLint info = glGetUniformLocation(uShaderProgramID, (mVirtualTextures[i].uniformName + "Info").c_str());
+        if (info != -1) {
+            glUniform4f(info, static_cast<float>(texture.GetWidth()), static_cast<float>(texture.GetHeight()),
+                static_cast<float>(texture.GetLevelCount() - 1), static_cast<float>(i));
+        }
+    }
+}
+
+bool WallpaperManager::BeginVirtualFeedback()
+{
+    if (!hasWallpaper || mVirtualTextures.empty()) {
+        return false;
+    }
+    WindowDimensions renderDimensions = GetRenderDimensions();
+    if (!pVirtualFeedback->Begin(renderDimensions.width, renderDimensions.height)) {
+        return false;
+    }
+
+    // Screen space derivatives are larger at the lower resolution, the bias asks for the level a full
+    // resolution frame would use instead
+    GLint resolution = glGetUniformLocation(uShaderProgramID, "iResolution");
+    if (resolution != -1) {
+        glUniform2f(resolution, static_cast<float>(pVirtualFeedback->GetWidth()), static_cast<float>(pVirtualFeedback->GetHeight()));
+    }
+    SetVirtualTextureUniforms(-std::log2(static_cast<float>(renderDimensions.width) / static_cast<float>(pVirtualFeedback->GetWidth())));
+    return true;
+}
+
+void WallpaperManager::EndVirtualFeedback()
+{
+    pVirtualFeedback->End();
+    GLint resolution = glGetUniformLocation(uShaderProgramID, "iResolution");
+    if (resolution != -1) {
+        WindowDimensions renderDimensions = GetRenderDimensions();
+        glUniform2f(resolution, static_cast<float>(renderDimensions.width), static_cast<float>(renderDimensions.height));
+    }
+    SetVirtualTextureUniforms(0.0f);
+}
+
+VirtualTextureStats WallpaperManager::GetVirtualTextureStats() const
+{
+    VirtualTextureStats stats{};
+    for (const WallpaperVirtualTexture& virtualTexture : mVirtualTextures) {
+        VirtualTextureStats textureStats = virtualTexture.texture->GetStats();
+        stats.residentPages += textureStats.residentPages;
+        stats.totalPages += textureStats.totalPages;
+        stats.pendingTiles += textureStats.pendingTiles;
+    }
+    return stats;
+}
+
+void WallpaperManager::LoadVideos(const std::string& wallpaperPath)
+{
+    std::filesystem::path directory = std::filesystem::path(wallpaperPath).parent_path();
+    // Units follow on from the virtual textures
+    GLint unit = static_cast<GLint>(mMetadata.textures.size() + 2 * mMetadata.virtualTextures.size());
+    for (auto it = mMetadata.videos.begin(); it != mMetadata.videos.end(); ++it) {
+        auto texture = std::make_unique<VideoTexture>((directory / it->second.path).string(), it->second.frameRate, it->second.loop);
+        if (!texture->IsValid()) {
+            LOG_ERROR("Video {} could not be opened and will be left black", it->first);
+            continue;
+        }
+        WallpaperVideo video{};
+        video.uniformName = it->first;
+        video.unit = unit++;
+        video.texture = std::move(texture);
+        mVideos.push_back(std::move(video));
+    }
+}
+
+void WallpaperManager::UpdateVideos()
+{
+    // Same clock as iTime so frames line up with everything else the shader animates
+    double time = glfwGetTime();
+    for (WallpaperVideo& video : mVideos) {
+        video.texture->Update(time);
+    }
+}
+
+VideoTextureStats WallpaperManager::GetVideoStats() const
+{
+    VideoTextureStats stats{};
+    for (const WallpaperVideo& video : mVideos) {
+        VideoTextureStats videoStats = video.texture->GetStats();
+        stats.shownFrames += videoStats.shownFrames;
+        stats.droppedFrames += videoStats.droppedFrames;
+        stats.lateFrames += videoStats.lateFrames;
+    }
+    return stats;
+}
+
+size_t WallpaperManager::GetVideoCount() const
+{
+    return mVideos.size();
+}
+
+void WallpaperManager::LoadAudio(const std::string& wallpaperPath)
+{
+    // Capturing costs a thread and a device stream, so only start it for shaders that read the results
+    if (!SourceReads(mFragmentShaderSource, "iAudio") && !SourceReads(mFragmentShaderSource, "iAudioTexture")) {
+        return;
+    }
+    std::string path;
+    if (!mMetadata.audio.empty()) {
+        path = (std::filesystem::path(wallpaperPath).parent_path() / mMetadata.audio).string();
+    }
+    std::unique_ptr<AudioSource> source = OpenAudioSource(path);
+    if (source == nullptr) {
+        LOG_ERROR("No audio source, iAudio and iAudioTexture will stay silent");
+        return;
+    }
+    // The unit after the videos
+    mAudioUnit = static_cast<GLint>(mMetadata.textures.size() + 2 * mMetadata.virtualTextures.size() + mMetadata.videos.size());
+    pAudio = std::make_unique<AudioTexture>(std::move(source));
+}
+
+void WallpaperManager::SetAudioUniforms() const
+{
+    if (pAudio == nullptr || mBuiltinUniformsLocations.audio == -1) {
+        return;
+    }
+    const std::array<float, 4>& bands = pAudio->GetBands();
+    glUniform4f(mBuiltinUniformsLocations.audio, bands[0], bands[1], bands[2], bands[3]);
+}
+
+void WallpaperManager::LoadNoiseTextures()
+{
+    // Units follow on from the audio texture, only taken by the kinds some tier reads
+    GLint unit = static_cast<GLint>(mMetadata.textures.size() + 2 * mMetadata.virtualTextures.size() + mMetadata.videos.size()) + 1;
+    for (size_t i = 0; i < mNoiseUnits.size(); i++) {
+        mNoiseUnits[i] = SourceReads(mFragmentShaderSource, GetNoiseUniformName(static_cast<NoiseKind>(i))) ? unit++ : -1;
+    }
+}
+
+bool WallpaperManager::HasAudio() const
+{
+    return pAudio != nullptr;
+}
+
+AudioStats WallpaperManager::GetAudioStats() const
+{
+    return pAudio == nullptr ? AudioStats{} : pAudio->GetStats();
+}
+
+void WallpaperManager::LoadAtlas(const std::string& wallpaperPath)
+{
+    // Units follow on from the last noise texture in use
+    mAtlasUnit = static_cast<GLint>(mMetadata.textures.size() + 2 * mMetadata.virtualTextures.size() + mMetadata.videos.size()) + 1;
+    for (GLint unit : mNoiseUnits) {
+        mAtlasUnit = std::max(mAtlasUnit, unit + 1);
+    }
+    if (mMetadata.sprites.empty()) {
+        return;
+    }
+
+    std::filesystem::path directory = std::filesystem::path(wallpaperPath).parent_path();
+    std::vector<std::string> paths;
+    for (auto it = mMetadata.sprites.begin(); it != mMetadata.sprites.end(); ++it) {
+        paths.push_back((directory / it->second).string());
+    }
+    MipOptions mipOptions{ MipFilter::Box, true, pMipPool.get() };
+    mPendingAtlas = pDecodePool->Submit([paths = std::move(paths), mipOptions]() {
+        AtlasBuild build{};
+        std::vector<Image> images(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!LoadImage(paths[i], &images[i])) {
+                return build;
+            }
+        }
+        if (!PackAtlas(images, &build.layout)) {
+            return build;
+        }
+        for (Image& page : BuildAtlasPages(images, build.layout)) {
+            build.pages.push_back(BuildTexturePayload(std::move(page), mipOptions));
+        }
+        return build;
+    });
+}
+
+void WallpaperManager::UpdateAtlas()
+{
+    if (!IsReady(mPendingAtlas)) {
+        return;
+    }
+    AtlasBuild build = mPendingAtlas.get();
+    if (build.pages.empty()) {
+        LOG_ERROR("Sprites could not be packed into an atlas and will be left black");
+        return;
+    }
+
+    // Clamped so the edge of a page never filters in the opposite edge, and limited to the levels the gutters keep clean
+    TextureSampling sampling{};
+    sampling.wrap = GL_CLAMP_TO_EDGE;
+    sampling.levelLimit = build.layout.levelCount;
+    for (TexturePayload& payload : build.pages) {
+        const TextureLevel& base = payload.levels.front();
+        auto texture = std::make_shared<Texture>(base.width, base.height, sampling);
+        pUploader->Enqueue(texture, std::move(payload));
+        mAtlasPages.push_back(std::move(texture));
+    }
+    mAtlasLayout = std::move(build.layout);
+    SetAtlasUniforms(uShaderProgramID);
+
+    AtlasStats stats = GetAtlasStats();
+    LOG_INFO("Packed {} sprites into {} atlas pages, {:.0f}% of texels used and {} texture binds saved",
+        stats.sprites, stats.pages, stats.efficiency * 100.0, stats.bindsSaved);
+}
+
+bool WallpaperManager::IsAtlasUniform(const std::string& name) const
+{
+    return name.ends_with("Rect") && mMetadata.sprites.contains(name.substr(0, name.size() - 4));
+}
+
+void WallpaperManager::SetAtlasUniforms(GLuint program) const
+{
+    size_t i = 0;
+    for (auto it = mMetadata.sprites.begin(); it != mMetadata.sprites.end(); ++it, i++) {
+        GLint sampler = glGetUniformLocation(program, it->first.c_str());
+        GLint rectLocation = glGetUniformLocation(program, (it->first + "Rect").c_str());
+        if (i >= mAtlasLayout.rects.size()) {
+            if (sampler != -1) {
+                glUniform1i(sampler, mAtlasUnit);
+            }
+            continue;
+        }
+        const AtlasRect& rect = mAtlasLayout.rects[i];
+        if (sampler != -1) {
+            glUniform1i(sampler, mAtlasUnit + rect.page);
+        }
+        if (rectLocation != -1) {
+            // Pages are uploaded bottom row first, so v runs up from the bottom of the page
+            const AtlasPage& page = mAtlasLayout.pages[static_cast<size_t>(rect.page)];
+            float width = static_cast<float>(page.width);
+            float height = static_cast<float>(page.height);
+            glUniform4f(rectLocation, static_cast<float>(rect.x) / width, 1.0f - static_cast<float>(rect.y + rect.height) / height,
+                static_cast<float>(rect.x + rect.width) / width, 1.0f - static_cast<float>(rect.y) / height);
+        }
+    }
+}
+
+AtlasStats WallpaperManager::GetAtlasStats() const
+{
+    AtlasStats stats{};
+    stats.sprites = mAtlasLayout.rects.size();
+    stats.pages = mAtlasLayout.pages.size();
+    stats.efficiency = mAtlasLayout.GetEfficiency();
+    stats.bindsSaved = stats.sprites - stats.pages;
+    return stats;
+}
+
+void WallpaperManager::LoadSdfVolume()
+{
+    if (mMetadata.sdf.function.empty()) {
+        return;
+    }
+    if (!SubmitSdfBakeProgram()) {
+        return;
+    }
+    // The unit after every atlas page
+    mSdfUnit = mAtlasUnit + ATLAS_MAX_PAGES;
+    pSdfVolume = std::make_unique<SdfVolume>(mMetadata.sdf.resolution);
+    mSdfDirty = true;
+    mSdfBakeAfter = 0.0;
+    mSdfSwitchTime = glfwGetTime();
+}
+
+bool WallpaperManager::SubmitSdfBakeProgram()
+{
+    std::string source;
+    if (!BuildSdfBakeSource(BuildTierSource(mActiveTier), mMetadata.sdf.function, &source)) {
+        LOG_ERROR("{} will not be baked, the shader keeps calling it", mMetadata.sdf.function);
+        return false;
+    }
+    mSdfTier = mActiveTier;
+    mPendingSdfProgram = pWorker->Submit([this, source]() -> GLuint {
+        return CompileProgram(source);
+    });
+    return true;
+}
+
+void WallpaperManager::UpdateSdfVolume(bool hasFrameTime, double gpuFrameMilliseconds)
+{
+    if (pSdfVolume == nullptr) {
+        return;
+    }
+    if (IsReady(mPendingSdfProgram)) {
+        glDeleteProgram(uSdfBakeProgram);
+        uSdfBakeProgram = mPendingSdfProgram.get();
+        if (uSdfBakeProgram == 0) {
+            LOG_ERROR("Failed to compile the program baking {}, the shader keeps calling it", mMetadata.sdf.function);
+        }
+    }
+    // A different tier can define the function differently, so the volume is baked again from its source
+    if (mSdfTier != mActiveTier && !mPendingSdfProgram.valid()) {
+        mSdfDirty = true;
+        mSdfBaked = false;
+        if (!SubmitSdfBakeProgram()) {
+            glDeleteProgram(uSdfBakeProgram);
+            uSdfBakeProgram = 0;
+            mSdfTier = mActiveTier;
+        }
+    }
+    // Waits for the textures the function may sample as well, so it isn't baked against ones still loading
+    bool texturesReady = GetPendingTextureCount() == 0 && !mPendingAtlas.valid();
+    if (uSdfBakeProgram != 0 && !mPendingSdfProgram.valid() && mSdfDirty && glfwGetTime() >= mSdfBakeAfter && texturesReady) {
+        BakeSdfVolume();
+    }
+    if (pSdfVolume->CollectBakeTime()) {
+        LOG_INFO("Baked {} into a {}^3 volume in {:.2f} ms, {:.1f} MB", mMetadata.sdf.function, pSdfVolume->GetResolution(),
+            pSdfVolume->GetBakeMilliseconds(), static_cast<double>(pSdfVolume->GetBytes()) / (1024.0 * 1024.0));
+    }
+
+    // Frame times are only taken once they have settled after switching between the volume and the function
+    double now = glfwGetTime();
+    bool sampling = useBakedSdf && mSdfBaked;
+    if (sampling != mSdfSampling) {
+        mSdfSampling = sampling;
+        mSdfSwitchTime = now;
+        SetSdfUniforms();
+    }
+    else if (hasFrameTime && now - mSdfSwitchTime >= QUALITY_SETTLE_SECONDS) {
+        (mSdfSampling ? mSdfBakedMilliseconds : mSdfAnalyticMilliseconds) = gpuFrameMilliseconds;
+    }
+}
+
+void WallpaperManager::BakeSdfVolume()
+{
+    const SdfMetadata& sdf = mMetadata.sdf;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    BindProgram(uSdfBakeProgram);
+    SetUserUniforms(uSdfBakeProgram);
+    BindSdfBakeSamplers();
+    BindTextures();
+    glUniform3f(glGetUniformLocation(uSdfBakeProgram, "iSdfBakeMin"), sdf.boundsMin[0], sdf.boundsMin[1], sdf.boundsMin[2]);
+    glUniform3f(glGetUniformLocation(uSdfBakeProgram, "iSdfBakeMax"), sdf.boundsMax[0], sdf.boundsMax[1], sdf.boundsMax[2]);
+    glUniform1f(glGetUniformLocation(uSdfBakeProgram, "iSdfBakeResolution"), static_cast<float>(sdf.resolution));
+    pSdfVolume->Bake(glGetUniformLocation(uSdfBakeProgram, "iSdfBakeSlice"));
+
+    BindProgram(uShaderProgramID);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    mSdfDirty = false;
+    mSdfBaked = true;
+}
+
+void WallpaperManager::BindSdfBakeSamplers() const
+{
+    // Samplers go to the units the wallpaper's textures are bound to. The volume can't be read while it is drawn
+    // into, so iSdf, and any sampler the wallpaper has no texture for, gets a unit of its own past the volume's
+    // with nothing bound, as two sampler types sharing a unit make the draw fail.
+    GLint spareUnit = mSdfUnit + 1;
+    GLint count = 0;
+    glGetProgramiv(uSdfBakeProgram, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; i++) {
+        GLchar name[64];
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(uSdfBakeProgram, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+        if (type != GL_SAMPLER_2D && type != GL_SAMPLER_3D && type != GL_SAMPLER_CUBE && type != GL_SAMPLER_2D_ARRAY) {
+            continue;
+        }
+        if (strcmp(name, "iSdf") == 0 || !BindSamplerUniform(uSdfBakeProgram, name)) {
+            glUniform1i(glGetUniformLocation(uSdfBakeProgram, name), spareUnit++);
+        }
+    }
+}
+
+void WallpaperManager::SetUserUniforms(GLuint program) const
+{
+    // The same values the render loop gives the wallpaper program
+    SetUniformValues(program, mIntUniforms, mFloatUniforms, mBoolUniforms);
+}
+
+bool WallpaperManager::IsSdfUniform(const std::string& name) const
+{
+    return pSdfVolume != nullptr && (name == "iSdfMin" || name == "iSdfMax" || name == "iSdfBaked");
+}
+
+void WallpaperManager::SetSdfUniforms() const
+{
+    if (pSdfVolume == nullptr) {
+        return;
+    }
+    const SdfMetadata& sdf = mMetadata.sdf;
+    GLint boundsMin = glGetUniformLocation(uShaderProgramID, "iSdfMin");
+    if (boundsMin != -1) {
+        glUniform3f(boundsMin, sdf.boundsMin[0], sdf.boundsMin[1], sdf.boundsMin[2]);
+    }
+    GLint boundsMax = glGetUniformLocation(uShaderProgramID, "iSdfMax");
+    if (boundsMax != -1) {
+        glUniform3f(boundsMax, sdf.boundsMax[0], sdf.boundsMax[1], sdf.boundsMax[2]);
+    }
+    GLint baked = glGetUniformLocation(uShaderProgramID, "iSdfBaked");
+    if (baked != -1) {
+        glUniform1i(baked, mSdfSampling ? 1 : 0);
+    }
+}
+
+void WallpaperManager::ClearSdfVolume()
+{
+    if (mPendingSdfProgram.valid()) {
+        mDiscardedPrograms.push_back(std::move(mPendingSdfProgram));
+    }
+    glDeleteProgram(uSdfBakeProgram);
+    uSdfBakeProgram = 0;
+    pSdfVolume = nullptr;
+    mSdfTier = 0;
+    mSdfDirty = false;
+    mSdfBakeAfter = 0.0;
+    mSdfBaked = false;
+    mSdfSampling = false;
+    mSdfBakedMilliseconds = 0.0;
+    mSdfAnalyticMilliseconds = 0.0;
+}
+
+bool WallpaperManager::HasSdfVolume() const
+{
+    return pSdfVolume != nullptr;
+}
+
+SdfStats WallpaperManager::GetSdfStats() const
+{
+    SdfStats stats{};
+    if (pSdfVolume == nullptr) {
+        return stats;
+    }
+    stats.resolution = pSdfVolume->GetResolution();
+    stats.bytes = pSdfVolume->GetBytes();
+    stats.bakeMilliseconds = pSdfVolume->GetBakeMilliseconds();
+    stats.bakedFrameMilliseconds = mSdfBakedMilliseconds;
+    stats.analyticFrameMilliseconds = mSdfAnalyticMilliseconds;
+    return stats;
+}
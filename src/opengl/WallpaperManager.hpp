@@ -7,58 +7,325 @@
 #include <opengl/Window.hpp>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <concepts>
+#include <deque>
+#include <future>
 #include <yaml-cpp/yaml.h>
+#include <map>
+#include <opengl/AudioTexture.hpp>
+#include <opengl/CostProbe.hpp>
+#include <opengl/GLWorker.hpp>
+#include <opengl/NoiseTextures.hpp>
+#include <opengl/ProgramBuilder.hpp>
+#include <opengl/SdfVolume.hpp>
+#include <opengl/ShaderSandbox.hpp>
+#include <opengl/Texture.hpp>
+#include <opengl/TextureCache.hpp>
+#include <opengl/TextureUploader.hpp>
 #include <opengl/Uniform.hpp>
+#include <opengl/VideoTexture.hpp>
+#include <opengl/VirtualFeedback.hpp>
+#include <opengl/VirtualTexture.hpp>
+#include <opengl/WallpaperMetadata.hpp>
+#include <util/Atlas.hpp>
+#include <util/Image.hpp>
+#include <util/ThreadPool.hpp>
+#include <util/ShaderCost.hpp>
+#include <util/WallpaperFile.hpp>
+
+// How long the uniform values must stay untouched before a specialized program is compiled for them
+constexpr double SPECIALIZE_DELAY_SECONDS = 2.0;
+// Maximum number of specialized programs kept per wallpaper
+constexpr size_t MAX_SPECIALIZED_PROGRAMS = 8;
+
+// Fraction of the budget a frame must stay under before trying the next tier up
+constexpr double QUALITY_RAISE_HEADROOM = 0.6;
+// How long frame times must stay under the headroom before raising the tier
+constexpr double QUALITY_RAISE_DELAY_SECONDS = 5.0;
+// Time given to a new tier for its frame times to settle before it is judged again
+constexpr double QUALITY_SETTLE_SECONDS = 1.0;
 
 struct BuiltinUniformsLocations {
     GLint time = static_cast<GLint>(GL_INVALID_INDEX);
     GLint mousePos = static_cast<GLint>(GL_INVALID_INDEX);
+    GLint audio = static_cast<GLint>(GL_INVALID_INDEX);
+};
+
+// Contents of an image file read on the thread pool, hashed so identical files share one texture
+struct EncodedFile {
+    std::string path;
+    uint64_t contentHash = 0;
+    std::shared_ptr<const std::vector<unsigned char>> bytes = nullptr;
+};
+
+/*
+A declared texture while its file is read on the thread pool, then a handle into the shared cache
+*/
+struct WallpaperTexture {
+    std::string uniformName;
+    GLint unit = 0;
+    std::future<EncodedFile> pendingFile;
+    TextureHandle handle = nullptr;
+};
+
+/*
+A virtual texture declared in the metadata. The shader reads it with libVirtualTexture through three
+uniforms derived from its name: <name> is the page cache, <name>Table the page table and <name>Info a vec4
+the engine fills in with the size, the last level and the texture's index.
+*/
+struct WallpaperVirtualTexture {
+    std::string uniformName;
+    GLint pageUnit = 0;
+    GLint tableUnit = 0;
+    std::unique_ptr<VirtualTexture> texture = nullptr;
+};
+
+struct WallpaperVideo {
+    std::string uniformName;
+    GLint unit = 0;
+    std::unique_ptr<VideoTexture> texture = nullptr;
+};
+
+/*
+Sprites packed on the thread pool, the layout and the mip chain of each page ready to upload. Empty if any
+sprite could not be loaded or packed.
+*/
+struct AtlasBuild {
+    AtlasLayout layout;
+    std::vector<TexturePayload> pages;
 };
 
-enum WallpaperSection {
-    NONE = -1,
-    METADATA = 0,
-    SHADER = 1
+/*
+Totals for the sprite atlas of the current wallpaper. Every sprite would otherwise be a texture of its own, so
+each page saves a bind for every sprite on it after the first.
+*/
+struct AtlasStats {
+    size_t sprites = 0;
+    size_t pages = 0;
+    double efficiency = 0.0;
+    size_t bindsSaved = 0;
 };
 
-struct WallpaperSources {
-    std::string metadataYamlSource;
-    std::string fragmentShaderSource;
+struct SdfStats {
+    int resolution = 0;
+    size_t bytes = 0;
+    // GPU time of the last bake, 0 until it has been read back
+    double bakeMilliseconds = 0.0;
+    // Smoothed GPU frame time reading the volume and calling the function, 0 until each has been measured
+    double bakedFrameMilliseconds = 0.0;
+    double analyticFrameMilliseconds = 0.0;
 };
 
-struct WallpaperMetadata {
-    std::string name;
+/*
+A program compiled with the user uniforms baked into constants, keyed by the uniform values it was
+compiled for.
+*/
+struct SpecializedProgram {
+    std::string valueKey;
+    GLuint program = 0;
 };
 
 class WallpaperManager
 {
 private:
     GLuint uShaderProgramID = 0;
-    GLuint uVertexShader = 0;
+    GLuint uDynamicProgramID = 0;
+    // New programs are built in worker processes first, so a shader that hangs or crashes the driver only loses a worker.
+    // Declared before the builder that uses it.
+    std::unique_ptr<ShaderSandbox> pShaderSandbox = nullptr;
+    // Compiles every program the wallpaper uses, through the program binary cache
+    std::unique_ptr<ProgramBuilder> pProgramBuilder = nullptr;
+    // Pipeline holding the builder's separable vertex program, unused when mUseSeparablePrograms is false
+    GLuint uPipeline = 0;
+    bool mUseSeparablePrograms = false;
     GLuint uFragmentShader = 0;
+    WindowDimensions mWindowDimensions{};
+    std::string mWallpaperPath;
+    std::string mFragmentShaderSource;
+    // The wallpaper file and the files its shader includes
+    std::vector<std::string> mShaderFiles;
+    ShaderCost mEstimatedCost{};
+    double mPredictedMilliseconds = 0.0;
+    // Every new program is timed offscreen before it goes on the desktop
+    std::unique_ptr<CostProbe> pCostProbe = nullptr;
+    CostProbeResult mMeasuredCost{};
+    float mRenderScale = 1.0f;
+    // Most frames per second the wallpaper is drawn at, 0 for every frame
+    int mFrameCap = 0;
 
-    void LoadVertexShader();
-    bool ParseWallpaperSource(const std::string& filepath, WallpaperSources* out) const;
-    bool CompileShader(GLenum type, const std::string& source, GLuint* shaderIn) const;
-    bool ParseWallpaperMetadata(
-        const std::string& metadataYamlSource,
-        WallpaperMetadata& wallpaperMetadata,
-        std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
-        std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
-        std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
-    ) const;
+    // Quality tier state, uDynamicProgramID is always the program of the active tier
+    std::vector<GLuint> mTierPrograms;
+    std::vector<std::future<GLuint>> mPendingTierPrograms;
+    std::vector<double> mTierFrameMilliseconds;
+    size_t mActiveTier = 0;
+    double mTierSwitchTime = 0.0;
+    double mUnderBudgetSince = 0.0;
+    std::string mQualityReason;
+    // Set whenever a different program starts being drawn, until the frame timer takes it
+    bool mProgramSwitched = false;
+
+    // Textures declared in the metadata, decoded on the pool and streamed in by the uploader
+    std::vector<WallpaperTexture> mTextures;
+    // Splits the rows of large mip levels, separate from the decode pool whose workers wait on it, and
+    // declared first so it outlives any decode still running
+    std::unique_ptr<ThreadPool> pMipPool = nullptr;
+    std::unique_ptr<ThreadPool> pDecodePool = nullptr;
+    std::unique_ptr<TextureUploader> pUploader = nullptr;
+    // Declared after the pool and uploader it uses so that it is destroyed before them
+    std::unique_ptr<TextureCache> pTextureCache = nullptr;
+
+    // Virtual textures stream tiles in on the decode pool, picked by a low resolution feedback pass
+    std::vector<WallpaperVirtualTexture> mVirtualTextures;
+    std::unique_ptr<VirtualFeedback> pVirtualFeedback = nullptr;
+    std::vector<uint32_t> mFeedbackTexels;
+
+    // Videos decode on a thread of their own each into a small ring of textures
+    std::vector<WallpaperVideo> mVideos;
+
+    // Analysed on a thread of its own, only running while the wallpaper reads iAudio or iAudioTexture
+    std::unique_ptr<AudioTexture> pAudio = nullptr;
+    GLint mAudioUnit = 0;
+
+    // Builtin noise shared by every wallpaper, and the unit each kind is bound to for the current one or -1 if unused
+    std::unique_ptr<NoiseTextures> pNoiseTextures = nullptr;
+    std::array<GLint, static_cast<size_t>(NoiseKind::Count)> mNoiseUnits{};
+
+    // Sprites share the atlas pages, which take the units after the noise. Each sprite's sampler and rect
+    // uniforms are set once the pages are packed.
+    std::future<AtlasBuild> mPendingAtlas;
+    AtlasLayout mAtlasLayout{};
+    std::vector<std::shared_ptr<Texture>> mAtlasPages;
+    GLint mAtlasUnit = 0;
+
+    // Signed distance volume baked on the GPU by a program compiled on the GL worker from the active tier's source.
+    // It is baked again once the uniforms have been left alone for a while, or the tier changes, and the function is
+    // evaluated directly until then. Frame times are kept for both ways of evaluating it to report the speedup.
+    std::unique_ptr<SdfVolume> pSdfVolume = nullptr;
+    std::future<GLuint> mPendingSdfProgram;
+    GLuint uSdfBakeProgram = 0;
+    // Tier the bake program was last submitted for
+    size_t mSdfTier = 0;
+    GLint mSdfUnit = 0;
+    bool mSdfDirty = false;
+    double mSdfBakeAfter = 0.0;
+    bool mSdfBaked = false;
+    bool mSdfSampling = false;
+    double mSdfSwitchTime = 0.0;
+    double mSdfBakedMilliseconds = 0.0;
+    double mSdfAnalyticMilliseconds = 0.0;
+
+    // Uniform specialization state
+    std::unique_ptr<GLWorker> pWorker = nullptr;
+    std::deque<SpecializedProgram> mSpecializedPrograms;
+    std::string mPendingValueKey;
+    // Values whose specialized program failed to build, not tried again until the wallpaper is reloaded
+    std::unordered_set<std::string> mFailedValueKeys;
+    std::future<GLuint> mPendingProgram;
+    std::vector<std::future<GLuint>> mDiscardedPrograms;
+    double mLastUniformEdit = 0.0;
+
+    void CreateVertexPipeline();
+    CostProbeResult ProbeProgramCost(GLuint program, WindowDimensions windowDimensions,
+        const std::unordered_map<std::string, Uniform<GLint>>& intUniforms, const std::unordered_map<std::string, Uniform<GLfloat>>& floatUniforms,
+        const std::unordered_map<std::string, Uniform<GLboolean>>& boolUniforms);
+    // Render scale and frame cap keeping a measured wallpaper within budget, false if it is too expensive to show at all
+    bool PickRenderSettings(const std::string& path, const CostProbeResult& measuredCost, WindowDimensions windowDimensions, float* renderScale,
+        int* frameCap) const;
+    GLuint CompileProgram(const std::string& fragmentSource, const std::vector<std::string>* files = nullptr, double timeoutSeconds = 0.0) const;
 
     void AddIntUniform(std::string name, size_t count);
     void AddFloatUniform(std::string name, size_t count);
     void AddBoolUniform(std::string name, size_t count);
 
+    void BindProgram(GLuint program) const;
+    void UseProgram(GLuint program);
+    std::string BuildTierSource(size_t tier) const;
+    std::string BuildUniformValueKey() const;
+    std::string BuildSpecializedSource() const;
+    void CollectBackgroundPrograms();
+    void ClearSpecializedPrograms();
+    void ClearTierPrograms();
+    void SetQualityTier(size_t tier, const std::string& reason);
+    void UpdateQualityTier(bool hasFrameTime, double gpuFrameMilliseconds);
+    void UpdateSpecialization();
+    void LoadTextures(const std::string& wallpaperPath);
+    void UpdateTextures();
+    // Point a sampler of the program at the unit its texture is bound to, false if the wallpaper has no texture by that name
+    bool BindSamplerUniform(GLuint program, const std::string& name) const;
+    void LoadVirtualTextures(const std::string& wallpaperPath);
+    void UpdateVirtualTextures();
+    bool IsVirtualTextureUniform(const std::string& name) const;
+    void SetVirtualTextureUniforms(float lodBias) const;
+    void LoadVideos(const std::string& wallpaperPath);
+    void UpdateVideos();
+    void LoadAudio(const std::string& wallpaperPath);
+    void SetAudioUniforms() const;
+    void LoadNoiseTextures();
+    void LoadAtlas(const std::string& wallpaperPath);
+    void UpdateAtlas();
+    bool IsAtlasUniform(const std::string& name) const;
+    void SetAtlasUniforms(GLuint program) const;
+    void LoadSdfVolume();
+    bool SubmitSdfBakeProgram();
+    void UpdateSdfVolume(bool hasFrameTime, double gpuFrameMilliseconds);
+    void BakeSdfVolume();
+    void BindSdfBakeSamplers() const;
+    void SetUserUniforms(GLuint program) const;
+    bool IsSdfUniform(const std::string& name) const;
+    void SetSdfUniforms() const;
+    void ClearSdfVolume();
+
 public:
-    WallpaperManager();
+    WallpaperManager(const Window& wallpaperWindow);
     ~WallpaperManager();
     bool TrySetWallpaper(const std::string& path, WindowDimensions);
+    // Load the current wallpaper again from disk, keeping the values of uniforms that are still declared the same
+    // way. The wallpaper already showing stays if the new version fails to load.
+    bool ReloadWallpaper(WindowDimensions);
     void UnloadCurrentWallpaper();
+    void Update(bool hasFrameTime, double gpuFrameMilliseconds);
+    void NotifyUniformsEdited();
+    const std::string& GetWallpaperPath() const;
+    // Files the current wallpaper reads besides its own, includes first then assets with directories for image sequences
+    std::vector<std::string> GetDependencyPaths() const;
+    // Bind every texture that has finished uploading to its texture unit
+    void BindTextures() const;
+    size_t GetPendingTextureCount() const;
+    TextureCacheStats GetTextureCacheStats() const;
+    // Set up the virtual texture feedback pass if one is due, the caller draws the wallpaper between the two
+    bool BeginVirtualFeedback();
+    void EndVirtualFeedback();
+    VirtualTextureStats GetVirtualTextureStats() const;
+    // Totals over every video of the current wallpaper
+    VideoTextureStats GetVideoStats() const;
+    size_t GetVideoCount() const;
+    bool HasAudio() const;
+    AudioStats GetAudioStats() const;
+    AtlasStats GetAtlasStats() const;
+    bool HasSdfVolume() const;
+    SdfStats GetSdfStats() const;
+    bool IsSpecialized() const;
+    size_t GetQualityTierCount() const;
+    size_t GetQualityTier() const;
+    bool IsQualityTierReady(size_t tier) const;
+    const std::string& GetQualityReason() const;
+    // True once after the wallpaper, its tier, its specialization or its render scale changes, GPU frame times taken
+    // before then measured a different program
+    bool TakeProgramSwitch();
+    const ShaderCost& GetEstimatedCost() const;
+    double GetPredictedMilliseconds() const;
+    const CostProbeResult& GetMeasuredCost() const;
+    float GetRenderScale() const;
+    void SetRenderScale(float scale);
+    int GetFrameCap() const;
+    void SetFrameCap(int framesPerSecond);
+    WindowDimensions GetRenderDimensions() const;
+    ProgramCacheStats GetProgramCacheStats() const;
+    ShaderSandboxStats GetShaderSandboxStats() const;
+    // Shared with anything else building programs with the engine's vertex shader and library
+    ShaderSandbox* GetShaderSandbox() const;
 
     std::unordered_map<std::string, Uniform<GLint>> mIntUniforms;
     std::unordered_map<std::string, Uniform<GLboolean>> mBoolUniforms;
@@ -67,6 +334,14 @@ public:
     WallpaperMetadata mMetadata{};
     BuiltinUniformsLocations mBuiltinUniformsLocations;
     bool hasWallpaper = false;
+    bool specializeUniforms = true;
+    // Read the baked volume instead of calling the wallpaper's distance function, for comparing the two
+    bool useBakedSdf = true;
+    // Index of a tier to force, or -1 to pick tiers automatically from the frame time budget
+    int qualityOverride = -1;
+    // Static cost model used to pick a render scale when a wallpaper loads
+    double costBudgetMilliseconds = DEFAULT_COST_BUDGET_MS;
+    double gpuGigaOps = DEFAULT_GPU_GIGAOPS;
 
     WallpaperManager(const WallpaperManager& arg) = delete;
     WallpaperManager(const WallpaperManager&& arg) = delete;
@@ -74,48 +349,4 @@ public:
     WallpaperManager& operator=(const WallpaperManager&& arg) = delete;
 };
 
-namespace YAML {
-    template<>
-    struct convert<UniformMetadata<GLboolean>> {
-        static Node encode(const UniformMetadata<GLboolean>& rhs) {
-            Node node;
-            node["name"] = rhs.name;
-            return node;
-        }
-
-        static bool decode(const Node& node, UniformMetadata<GLboolean>& rhs) {
-            if (!node.IsMap()) {
-                return false;
-            }
-
-            rhs.name = node["name"].as<std::string>();
-            return true;
-        }
-    };
-
-
-    template<typename T>
-    struct convert<UniformMetadata<T>> {
-        static Node encode(const UniformMetadata<T>& rhs) {
-            Node node;
-            node["name"] = rhs.name;
-            node["min"] = rhs.min;
-            node["max"] = rhs.max;
-            return node;
-        }
-
-        static bool decode(const Node& node, UniformMetadata<T>& rhs) {
-            if (!node.IsMap()) {
-                return false;
-            }
-
-            rhs.name = node["name"].as<std::string>();
-            rhs.min = node["min"].as<T>();
-            rhs.max = node["max"].as<T>();
-
-            return true;
-        }
-    };
-}
-
 #endif // !SHADER_MANAGER_H
@@ -0,0 +1,769 @@
+#include <opengl/WallpaperMetadata.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+#include <util/Log.hpp>
+
+// Checks shared by both parsers, run once everything has been read
+static bool ValidateWallpaperMetadata(const WallpaperMetadata& wallpaperMetadata)
+{
+    const QualityMetadata& quality = wallpaperMetadata.quality;
+    if (!quality.define.empty()) {
+        if (quality.tiers.empty()) {
+            LOG_ERROR("Metadata 'quality' must declare at least one tier!");
+            return false;
+        }
+        if (quality.defaultTier < 0 || quality.defaultTier >= static_cast<int>(quality.tiers.size())) {
+            LOG_ERROR("Metadata 'quality.default' must be the index of a tier!");
+            return false;
+        }
+    }
+    if (wallpaperMetadata.virtualTextures.size() > MAX_VIRTUAL_TEXTURES) {
+        LOG_ERROR("Metadata 'virtualTextures' can declare at most {} textures!", MAX_VIRTUAL_TEXTURES);
+        return false;
+    }
+    const SdfMetadata& sdf = wallpaperMetadata.sdf;
+    if (!sdf.function.empty()) {
+        if (sdf.resolution < 2 || sdf.resolution > MAX_SDF_RESOLUTION) {
+            LOG_ERROR("Metadata 'sdf.resolution' must be between 2 and {}!", MAX_SDF_RESOLUTION);
+            return false;
+        }
+        for (size_t axis = 0; axis < 3; axis++) {
+            if (sdf.boundsMax[axis] <= sdf.boundsMin[axis]) {
+                LOG_ERROR("Metadata 'sdf.max' must be greater than 'sdf.min' on every axis!");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ParseWallpaperMetadata(
+    const std::string& metadataYamlSource,
+    WallpaperMetadata& wallpaperMetadata,
+    std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
+    std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
+    std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
+) {
+    MetadataDecodeResult result = DecodeWallpaperMetadata(metadataYamlSource, wallpaperMetadata, intUniforms, floatUniforms, boolUniforms);
+    if (result != MetadataDecodeResult::Unsupported) {
+        return result == MetadataDecodeResult::Decoded;
+    }
+
+    LOG_TRACE("Metadata uses YAML the decoder doesn't handle, parsing it with yaml-cpp");
+    wallpaperMetadata = WallpaperMetadata{};
+    intUniforms.clear();
+    floatUniforms.clear();
+    boolUniforms.clear();
+    return ParseWallpaperMetadataYaml(metadataYamlSource, wallpaperMetadata, intUniforms, floatUniforms, boolUniforms);
+}
+
+/*
+The decoder handles the block style YAML wallpapers are written in: nested "key: value" mappings, plain and
+quoted scalars, single line flow sequences, empty flow maps and comments. Anything else, such as block
+sequences, anchors, tags or multi line scalars, is left to yaml-cpp. Values are written straight into the
+metadata and uniform registry as each line is reached.
+*/
+struct MetadataLine {
+    int number = 0;
+    int indent = 0;
+    // Raw text, quoted keys and values keep their quotes
+    std::string_view key;
+    // Empty when the line opens a block
+    std::string_view value;
+};
+
+static std::string_view Trim(std::string_view text)
+{
+    size_t begin = text.find_first_not_of(' ');
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    size_t end = text.find_last_not_of(' ');
+    return text.substr(begin, end - begin + 1);
+}
+
+// Length of the quoted scalar at the start of text including both quotes, 0 if it isn't closed
+static size_t QuotedLength(std::string_view text)
+{
+    char quote = text[0];
+    for (size_t i = 1; i < text.size(); i++) {
+        if (quote == '"' && text[i] == '\\') {
+            i++;
+        }
+        else if (text[i] == quote) {
+            // Two single quotes are an escaped quote inside a single quoted scalar
+            if (quote == '\'' && i + 1 < text.size() && text[i + 1] == '\'') {
+                i++;
+                continue;
+            }
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// True if nothing but a comment follows a scalar
+static bool IsRestEmpty(std::string_view rest)
+{
+    rest = Trim(rest);
+    return rest.empty() || rest[0] == '#';
+}
+
+static bool IsIndicator(char c)
+{
+    return std::strchr("-?:,[]{}#&*!|>'\"%@`", c) != nullptr;
+}
+
+static MetadataDecodeResult SplitMetadataLine(std::string_view text, int number, std::vector<MetadataLine>* lines)
+{
+    if (!text.empty() && text.back() == '\r') {
+        text.remove_suffix(1);
+    }
+    size_t indent = text.find_first_not_of(' ');
+    if (indent == std::string_view::npos || text[indent] == '#') {
+        return MetadataDecodeResult::Decoded;
+    }
+    if (text[indent] == '\t') {
+        return MetadataDecodeResult::Unsupported;
+    }
+
+    MetadataLine line{};
+    line.number = number;
+    line.indent = static_cast<int>(indent);
+    std::string_view content = text.substr(indent);
+
+    // The key, which ends at the first colon followed by a space or the end of the line
+    size_t colon = std::string_view::npos;
+    if (content[0] == '"' || content[0] == '\'') {
+        size_t length = QuotedLength(content);
+        if (length == 0 || length >= content.size() || content[length] != ':') {
+            return MetadataDecodeResult::Unsupported;
+        }
+        colon = length;
+    }
+    else if (!IsIndicator(content[0])) {
+        for (size_t i = 0; i < content.size(); i++) {
+            if (content[i] == ':' && (i + 1 == content.size() || content[i + 1] == ' ')) {
+                colon = i;
+                break;
+            }
+            if (content[i] == '#' && content[i - 1] == ' ') {
+                break;
+            }
+        }
+    }
+    if (colon == std::string_view::npos) {
+        return MetadataDecodeResult::Unsupported;
+    }
+    line.key = Trim(content.substr(0, colon));
+
+    std::string_view value = Trim(content.substr(colon + 1));
+    if (value.empty() || value[0] == '#') {
+        value = {};
+    }
+    else if (value[0] == '"' || value[0] == '\'') {
+        size_t length = QuotedLength(value);
+        if (length == 0 || !IsRestEmpty(value.substr(length))) {
+            return MetadataDecodeResult::Unsupported;
+        }
+        value = value.substr(0, length);
+    }
+    else if (value[0] == '[' || value[0] == '{') {
+        // Flow collections must close on the same line, quoted items are skipped over so brackets inside them don't count
+        char close = value[0] == '[' ? ']' : '}';
+        size_t end = std::string_view::npos;
+        for (size_t i = 1; i < value.size(); i++) {
+            if (value[i] == '"' || value[i] == '\'') {
+                size_t length = QuotedLength(value.substr(i));
+                if (length == 0) {
+                    return MetadataDecodeResult::Unsupported;
+                }
+                i += length - 1;
+            }
+            else if (value[i] == '[' || value[i] == '{') {
+                return MetadataDecodeResult::Unsupported;
+            }
+            else if (value[i] == close) {
+                end = i;
+                break;
+            }
+        }
+        if (end == std::string_view::npos || !IsRestEmpty(value.substr(end + 1))) {
+            return MetadataDecodeResult::Unsupported;
+        }
+        value = value.substr(0, end + 1);
+        if (close == '}') {
+            // Only empty flow maps are handled
+            if (!Trim(value.substr(1, value.size() - 2)).empty()) {
+                return MetadataDecodeResult::Unsupported;
+            }
+            value = "{}";
+        }
+    }
+    else if (IsIndicator(value[0]) && value[0] != '-') {
+        return MetadataDecodeResult::Unsupported;
+    }
+    else {
+        size_t comment = value.find(" #");
+        if (comment != std::string_view::npos) {
+            value = Trim(value.substr(0, comment));
+        }
+        if (value.find(": ") != std::string_view::npos) {
+            return MetadataDecodeResult::Unsupported;
+        }
+    }
+    line.value = value;
+    lines->push_back(line);
+    return MetadataDecodeResult::Decoded;
+}
+
+// Plain scalars are returned as they are, quoted ones are unescaped into scratch
+static bool DecodeScalar(std::string_view raw, std::string* scratch, std::string_view* out)
+{
+    if (raw.empty() || (raw[0] != '"' && raw[0] != '\'')) {
+        *out = raw;
+        return true;
+    }
+    scratch->clear();
+    std::string_view inner = raw.substr(1, raw.size() - 2);
+    for (size_t i = 0; i < inner.size(); i++) {
+        if (raw[0] == '\'' && inner[i] == '\'') {
+            i++;
+        }
+        else if (raw[0] == '"' && inner[i] == '\\') {
+            i++;
+            switch (inner[i]) {
+            case 'n':
+                scratch->push_back('\n');
+                continue;
+            case 't':
+                scratch->push_back('\t');
+                continue;
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            default:
+                return false;
+            }
+        }
+        scratch->push_back(inner[i]);
+    }
+    *out = *scratch;
+    return true;
+}
+
+template<typename T>
+static bool DecodeNumber(std::string_view raw, T* out)
+{
+    if (!raw.empty() && raw[0] == '+') {
+        raw.remove_prefix(1);
+    }
+    const char* end = raw.data() + raw.size();
+    std::from_chars_result result = std::from_chars(raw.data(), end, *out);
+    return !raw.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+static bool DecodeBool(std::string_view raw, bool* out)
+{
+    for (const char* word : { "true", "True", "TRUE", "yes", "Yes", "YES", "on", "On", "ON" }) {
+        if (raw == word) {
+            *out = true;
+            return true;
+        }
+    }
+    for (const char* word : { "false", "False", "FALSE", "no", "No", "NO", "off", "Off", "OFF" }) {
+        if (raw == word) {
+            *out = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Calls visit(item) for each raw item of a flow sequence, which the line splitter has already checked is closed
+template<typename F>
+static bool ForEachFlowItem(std::string_view raw, F&& visit)
+{
+    if (raw.empty() || raw[0] != '[') {
+        return false;
+    }
+    std::string_view inner = Trim(raw.substr(1, raw.size() - 2));
+    while (!inner.empty()) {
+        size_t length = inner.find(',');
+        if (inner[0] == '"' || inner[0] == '\'') {
+            length = QuotedLength(inner);
+            if (length < inner.size() && Trim(inner.substr(length))[0] != ',') {
+                return false;
+            }
+            length = inner.find(',', length);
+        }
+        std::string_view item = Trim(inner.substr(0, length));
+        if (item.empty() || !visit(item)) {
+            return false;
+        }
+        inner = length == std::string_view::npos ? std::string_view{} : Trim(inner.substr(length + 1));
+    }
+    return true;
+}
+
+class MetadataDecoder {
+private:
+    const std::vector<MetadataLine>& mLines;
+    std::string mScratch;
+    std::string mKeyScratch;
+
+    static MetadataDecodeResult Fail(const MetadataLine& line, const char* message)
+    {
+        LOG_ERROR("Metadata line {}: '{}' {}", line.number, line.key, message);
+        return MetadataDecodeResult::Failed;
+    }
+
+    // Calls visit(key, line, childrenBegin, childrenEnd) for every entry of the block [begin, end), which all
+    // have to share the indent of the first
+    template<typename F>
+    MetadataDecodeResult ForEachEntry(size_t begin, size_t end, F&& visit)
+    {
+        if (begin == end) {
+            return MetadataDecodeResult::Decoded;
+        }
+        int indent = mLines[begin].indent;
+        for (size_t i = begin; i < end;) {
+            const MetadataLine& line = mLines[i];
+            if (line.indent != indent) {
+                return MetadataDecodeResult::Unsupported;
+            }
+            size_t next = i + 1;
+            while (next < end && mLines[next].indent > indent) {
+                next++;
+            }
+            // A scalar followed by more indented lines is a multi line scalar
+            if (!line.value.empty() && next != i + 1) {
+                return MetadataDecodeResult::Unsupported;
+            }
+            std::string_view key;
+            if (!DecodeScalar(line.key, &mKeyScratch, &key)) {
+                return MetadataDecodeResult::Unsupported;
+            }
+            MetadataDecodeResult result = visit(key, line, i + 1, next);
+            if (result != MetadataDecodeResult::Decoded) {
+                return result;
+            }
+            i = next;
+        }
+        return MetadataDecodeResult::Decoded;
+    }
+
+    // Calls visit on the children of a line that should open a mapping, which can also be written as {}
+    template<typename F>
+    MetadataDecodeResult ForEachChild(const MetadataLine& line, size_t begin, size_t end, F&& visit)
+    {
+        if (line.value == "{}") {
+            return MetadataDecodeResult::Decoded;
+        }
+        if (!line.value.empty()) {
+            return Fail(line, "must be a map");
+        }
+        return ForEachEntry(begin, end, std::forward<F>(visit));
+    }
+
+    MetadataDecodeResult String(const MetadataLine& line, std::string* out)
+    {
+        std::string_view value;
+        if (line.value.empty() || line.value[0] == '[' || line.value == "{}") {
+            return MetadataDecodeResult::Unsupported;
+        }
+        if (!DecodeScalar(line.value, &mScratch, &value)) {
+            return MetadataDecodeResult::Unsupported;
+        }
+        out->assign(value);
+        return MetadataDecodeResult::Decoded;
+    }
+
+    // Scalars yaml-cpp would still convert, such as 0x10, .inf or y, are left to it along with the ones it rejects,
+    // so the two parsers never disagree on which wallpapers load
+    template<typename T>
+    MetadataDecodeResult Number(const MetadataLine& line, T* out)
+    {
+        std::string_view value;
+        if (!DecodeScalar(line.value, &mScratch, &value)) {
+            return MetadataDecodeResult::Unsupported;
+        }
+        return DecodeNumber(value, out) ? MetadataDecodeResult::Decoded : MetadataDecodeResult::Unsupported;
+    }
+
+    MetadataDecodeResult Bool(const MetadataLine& line, bool* out)
+    {
+        std::string_view value;
+        if (!DecodeScalar(line.value, &mScratch, &value)) {
+            return MetadataDecodeResult::Unsupported;
+        }
+        return DecodeBool(value, out) ? MetadataDecodeResult::Decoded : MetadataDecodeResult::Unsupported;
+    }
+
+    MetadataDecodeResult Vector3(const MetadataLine& line, std::array<float, 3>* out)
+    {
+        size_t count = 0;
+        bool decoded = ForEachFlowItem(line.value, [&](std::string_view item) {
+            return count < 3 && DecodeNumber(item, &(*out)[count++]);
+        });
+        return decoded && count == 3 ? MetadataDecodeResult::Decoded : MetadataDecodeResult::Unsupported;
+    }
+
+    MetadataDecodeResult Quality(const MetadataLine& quality, size_t begin, size_t end, QualityMetadata* out)
+    {
+        bool hasDefault = false;
+        MetadataDecodeResult result = ForEachChild(quality, begin, end, [&](std::string_view key, const MetadataLine& line, size_t, size_t) {
+            if (key == "define") {
+                return String(line, &out->define);
+            }
+            if (key == "tiers") {
+                out->tiers.clear();
+                bool decoded = ForEachFlowItem(line.value, [&](std::string_view item) {
+                    std::string_view tier;
+                    if (!DecodeScalar(item, &mScratch, &tier)) {
+                        return false;
+                    }
+                    out->tiers.emplace_back(tier);
+                    return true;
+                });
+                return decoded ? MetadataDecodeResult::Decoded : MetadataDecodeResult::Unsupported;
+            }
+            if (key == "default") {
+                hasDefault = true;
+                return Number(line, &out->defaultTier);
+            }
+            if (key == "budget") {
+                return Number(line, &out->budgetMilliseconds);
+            }
+            return MetadataDecodeResult::Decoded;
+        });
+        if (result == MetadataDecodeResult::Decoded && out->define.empty()) {
+            return Fail(quality, "must declare a define");
+        }
+        if (!hasDefault) {
+            out->defaultTier = static_cast<int>(out->tiers.size()) - 1;
+        }
+        return result;
+    }
+
+    MetadataDecodeResult Texture(const MetadataLine& texture, size_t begin, size_t end, TextureMetadata* out)
+    {
+        if (!texture.value.empty()) {
+            return String(texture, &out->path);
+        }
+        return ForEachEntry(begin, end, [&](std::string_view key, const MetadataLine& line, size_t, size_t) {
+            std::string_view value;
+            if (key == "path") {
+                return String(line, &out->path);
+            }
+            if (key == "mipmaps") {
+                return Bool(line, &out->sampling.mipmaps);
+            }
+            if (key == "srgb") {
+                return Bool(line, &out->sampling.srgb);
+            }
+            if (!DecodeScalar(line.value, &mScratch, &value)) {
+                return MetadataDecodeResult::Unsupported;
+            }
+            if (key == "filter") {
+                if (value != "linear" && value != "nearest") {
+                    return Fail(line, "must be linear or nearest");
+                }
+                out->sampling.filter = value == "nearest" ? GL_NEAREST : GL_LINEAR;
+            }
+            else if (key == "wrap") {
+                if (value != "repeat" && value != "clamp" && value != "mirror") {
+                    return Fail(line, "must be repeat, clamp or mirror");
+                }
+                out->sampling.wrap = value == "clamp" ? GL_CLAMP_TO_EDGE : value == "mirror" ? GL_MIRRORED_REPEAT : GL_REPEAT;
+            }
+            else if (key == "mipFilter") {
+                if (value != "box" && value != "kaiser") {
+                    return Fail(line, "must be box or kaiser");
+                }
+                out->sampling.mipFilter = value == "kaiser" ? MipFilter::Kaiser : MipFilter::Box;
+            }
+            return MetadataDecodeResult::Decoded;
+        });
+    }
+
+    MetadataDecodeResult Video(const MetadataLine& video, size_t begin, size_t end, VideoMetadata* out)
+    {
+        if (!video.value.empty()) {
+            return String(video, &out->path);
+        }
+        MetadataDecodeResult result = ForEachEntry(begin, end, [&](std::string_view key, const MetadataLine& line, size_t, size_t) {
+            if (key == "path") {
+                return String(line, &out->path);
+            }
+            if (key == "fps") {
+                return Number(line, &out->frameRate);
+            }
+            if (key == "loop") {
+                return Bool(line, &out->loop);
+            }
+            return MetadataDecodeResult::Decoded;
+        });
+        if (result == MetadataDecodeResult::Decoded && out->frameRate < 0.0) {
+            return Fail(video, "must not have a negative fps");
+        }
+        return result;
+    }
+
+    MetadataDecodeResult Sdf(const MetadataLine& sdf, size_t begin, size_t end, SdfMetadata* out)
+    {
+        MetadataDecodeResult result = ForEachChild(sdf, begin, end, [&](std::string_view key, const MetadataLine& line, size_t, size_t) {
+            if (key == "function") {
+                return String(line, &out->function);
+            }
+            if (key == "resolution") {
+                return Number(line, &out->resolution);
+            }
+            if (key == "min") {
+                return Vector3(line, &out->boundsMin);
+            }
+            if (key == "max") {
+                return Vector3(line, &out->boundsMax);
+            }
+            return MetadataDecodeResult::Decoded;
+        });
+        if (result == MetadataDecodeResult::Decoded && out->function.empty()) {
+            return Fail(sdf, "must name a function");
+        }
+        return result;
+    }
+
+    // Path per uniform name, as virtual textures and sprites are declared
+    MetadataDecodeResult Paths(const MetadataLine& section, size_t begin, size_t end, std::map<std::string, std::string>* out)
+    {
+        return ForEachChild(section, begin, end, [&](std::string_view key, const MetadataLine& line, size_t, size_t) {
+            return String(line, &(*out)[std::string(key)]);
+        });
+    }
+
+    template<typename T>
+    MetadataDecodeResult Uniforms(const MetadataLine& section, size_t begin, size_t end, std::unordered_map<std::string, Uniform<T>>* out)
+    {
+        return ForEachChild(section, begin, end, [&](std::string_view name, const MetadataLine& uniformLine, size_t uniformBegin, size_t uniformEnd) {
+            Uniform<T>& uniform = (*out)[std::string(name)];
+            uniform.metadata.name = name;
+            // Sliders missing a range get the same one as uniforms the metadata doesn't mention
+            if constexpr (std::is_same_v<T, GLint>) {
+                uniform.metadata.min = DEFAULT_INT_SLIDER_MIN;
+                uniform.metadata.max = DEFAULT_INT_SLIDER_MAX;
+            }
+            else if constexpr (std::is_same_v<T, GLfloat>) {
+                uniform.metadata.min = DEFAULT_FLOAT_SLIDER_MIN;
+                uniform.metadata.max = DEFAULT_FLOAT_SLIDER_MAX;
+            }
+            return ForEachChild(uniformLine, uniformBegin, uniformEnd, [&](std::string_view key, const MetadataLine& line, size_t, size_t) {
+                if (key == "name") {
+                    return String(line, &uniform.metadata.name);
+                }
+                if constexpr (!std::is_same_v<T, GLboolean>) {
+                    if (key == "min") {
+                        return Number(line, &uniform.metadata.min);
+                    }
+                    if (key == "max") {
+                        return Number(line, &uniform.metadata.max);
+                    }
+                }
+                return MetadataDecodeResult::Decoded;
+            });
+        });
+    }
+
+public:
+    MetadataDecoder(const std::vector<MetadataLine>& lines) : mLines(lines) {}
+
+    MetadataDecodeResult Decode(
+        WallpaperMetadata& wallpaperMetadata,
+        std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
+        std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
+        std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms)
+    {
+        return ForEachEntry(0, mLines.size(), [&](std::string_view key, const MetadataLine& line, size_t begin, size_t end) {
+            if (key == "name") {
+                return String(line, &wallpaperMetadata.name);
+            }
+            if (key == "quality") {
+                return Quality(line, begin, end, &wallpaperMetadata.quality);
+            }
+            if (key == "textures") {
+                return ForEachChild(line, begin, end, [&](std::string_view name, const MetadataLine& texture, size_t textureBegin, size_t textureEnd) {
+                    return Texture(texture, textureBegin, textureEnd, &wallpaperMetadata.textures[std::string(name)]);
+                });
+            }
+            if (key == "virtualTextures") {
+                return Paths(line, begin, end, &wallpaperMetadata.virtualTextures);
+            }
+            if (key == "videos") {
+                return ForEachChild(line, begin, end, [&](std::string_view name, const MetadataLine& video, size_t videoBegin, size_t videoEnd) {
+                    return Video(video, videoBegin, videoEnd, &wallpaperMetadata.videos[std::string(name)]);
+                });
+            }
+            if (key == "audio") {
+                return String(line, &wallpaperMetadata.audio);
+            }
+            if (key == "sprites") {
+                return Paths(line, begin, end, &wallpaperMetadata.sprites);
+            }
+            if (key == "sdf") {
+                return Sdf(line, begin, end, &wallpaperMetadata.sdf);
+            }
+            if (key == "uniforms") {
+                return ForEachChild(line, begin, end, [&](std::string_view type, const MetadataLine& section, size_t sectionBegin, size_t sectionEnd) {
+                    if (type == "float") {
+                        return Uniforms(section, sectionBegin, sectionEnd, &floatUniforms);
+                    }
+                    if (type == "int") {
+                        return Uniforms(section, sectionBegin, sectionEnd, &intUniforms);
+                    }
+                    if (type == "bool") {
+                        return Uniforms(section, sectionBegin, sectionEnd, &boolUniforms);
+                    }
+                    return MetadataDecodeResult::Decoded;
+                });
+            }
+            // Keys the engine doesn't know are ignored, as yaml-cpp ignores them
+            return MetadataDecodeResult::Decoded;
+        });
+    }
+};
+
+MetadataDecodeResult DecodeWallpaperMetadata(
+    std::string_view metadataYamlSource,
+    WallpaperMetadata& wallpaperMetadata,
+    std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
+    std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
+    std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
+) {
+    std::vector<MetadataLine> lines;
+    int number = 1;
+    while (!metadataYamlSource.empty()) {
+        size_t lineEnd = metadataYamlSource.find('\n');
+        std::string_view text = metadataYamlSource.substr(0, lineEnd);
+        if (text.starts_with("---") || text.starts_with("...") || text.starts_with("%")) {
+            return MetadataDecodeResult::Unsupported;
+        }
+        MetadataDecodeResult result = SplitMetadataLine(text, number++, &lines);
+        if (result != MetadataDecodeResult::Decoded) {
+            return result;
+        }
+        metadataYamlSource = lineEnd == std::string_view::npos ? std::string_view{} : metadataYamlSource.substr(lineEnd + 1);
+    }
+    if (!lines.empty() && lines.front().indent != 0) {
+        return MetadataDecodeResult::Unsupported;
+    }
+
+    MetadataDecoder decoder(lines);
+    MetadataDecodeResult result = decoder.Decode(wallpaperMetadata, intUniforms, floatUniforms, boolUniforms);
+    if (result != MetadataDecodeResult::Decoded) {
+        return result;
+    }
+    return ValidateWallpaperMetadata(wallpaperMetadata) ? MetadataDecodeResult::Decoded : MetadataDecodeResult::Failed;
+}
+
+static bool HasSection(const YAML::Node& node)
+{
+    return node && !node.IsNull();
+}
+
+template<typename T>
+static void ReadUniformSection(const YAML::Node& section, std::unordered_map<std::string, Uniform<T>>& uniforms)
+{
+    if (!HasSection(section)) {
+        return;
+    }
+    auto uniformMetadata = section.as<std::unordered_map<std::string, UniformMetadata<T>>>();
+    for (auto it = uniformMetadata.begin(); it != uniformMetadata.end(); ++it) {
+        Uniform<T> uniform{};
+        uniform.metadata = it->second;
+        if (!section[it->first]["name"]) {
+            uniform.metadata.name = it->first;
+        }
+        uniforms.insert(std::make_pair(it->first, uniform));
+    }
+}
+
+bool ParseWallpaperMetadataYaml(
+    const std::string& metadataYamlSource,
+    WallpaperMetadata& wallpaperMetadata,
+    std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
+    std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
+    std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
+) {
+    YAML::Node node = YAML::Load(metadataYamlSource);
+
+    try {
+        YAML::Node nameNode = node["name"];
+        wallpaperMetadata.name = nameNode.as<std::string>();
+    }
+    catch (const YAML::KeyNotFound&) {
+        wallpaperMetadata.name = "";
+    }
+    catch (const YAML::BadConversion&) {
+        LOG_ERROR("Metadata 'name' must be a string!");
+        return false;
+    }
+
+    // Process quality tiers
+    if (YAML::Node quality = node["quality"]) {
+        wallpaperMetadata.quality.define = quality["define"].as<std::string>();
+        wallpaperMetadata.quality.tiers = quality["tiers"].as<std::vector<std::string>>();
+        int lastTier = static_cast<int>(wallpaperMetadata.quality.tiers.size()) - 1;
+        wallpaperMetadata.quality.defaultTier = quality["default"] ? quality["default"].as<int>() : lastTier;
+        if (quality["budget"]) {
+            wallpaperMetadata.quality.budgetMilliseconds = quality["budget"].as<double>();
+        }
+    }
+
+    // Process textures
+    if (YAML::Node textures = node["textures"]) {
+        wallpaperMetadata.textures = textures.as<std::map<std::string, TextureMetadata>>();
+    }
+    if (YAML::Node virtualTextures = node["virtualTextures"]) {
+        wallpaperMetadata.virtualTextures = virtualTextures.as<std::map<std::string, std::string>>();
+    }
+    if (YAML::Node videos = node["videos"]) {
+        wallpaperMetadata.videos = videos.as<std::map<std::string, VideoMetadata>>();
+    }
+    if (YAML::Node audio = node["audio"]) {
+        wallpaperMetadata.audio = audio.as<std::string>();
+    }
+    if (YAML::Node sprites = node["sprites"]) {
+        wallpaperMetadata.sprites = sprites.as<std::map<std::string, std::string>>();
+    }
+    if (YAML::Node sdf = node["sdf"]) {
+        SdfMetadata& sdfMetadata = wallpaperMetadata.sdf;
+        sdfMetadata.function = sdf["function"].as<std::string>();
+        if (sdf["resolution"]) {
+            sdfMetadata.resolution = sdf["resolution"].as<int>();
+        }
+        for (const char* key : { "min", "max" }) {
+            if (!sdf[key]) {
+                continue;
+            }
+            std::vector<float> bound = sdf[key].as<std::vector<float>>();
+            if (bound.size() != 3) {
+                LOG_ERROR("Metadata 'sdf.{}' must have 3 components!", key);
+                return false;
+            }
+            std::copy(bound.begin(), bound.end(), (strcmp(key, "min") == 0 ? sdfMetadata.boundsMin : sdfMetadata.boundsMax).begin());
+        }
+    }
+
+    // Uniform sections that are missing or left empty are skipped, the decoder reads both as empty maps
+    YAML::Node uniforms = node["uniforms"];
+    if (!HasSection(uniforms)) {
+        return ValidateWallpaperMetadata(wallpaperMetadata);
+    }
+
+    ReadUniformSection(uniforms["float"], floatUniforms);
+    ReadUniformSection(uniforms["int"], intUniforms);
+    ReadUniformSection(uniforms["bool"], boolUniforms);
+    return ValidateWallpaperMetadata(wallpaperMetadata);
+}
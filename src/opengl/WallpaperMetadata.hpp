@@ -0,0 +1,238 @@
+#ifndef WALLPAPER_METADATA_H
+#define WALLPAPER_METADATA_H
+
+#include <gl.h>
+#include <array>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+#include <opengl/SdfVolume.hpp>
+#include <opengl/Texture.hpp>
+#include <opengl/Uniform.hpp>
+
+// GPU frame time budget used when a wallpaper declares quality tiers without one
+constexpr double DEFAULT_QUALITY_BUDGET_MS = 16.0;
+
+// Virtual textures per wallpaper. The feedback pass has 4 bits to say which one a tile is from, but each takes two
+// of the 16 texture units GL 3.3 guarantees, so 4 leaves room for everything else.
+constexpr size_t MAX_VIRTUAL_TEXTURES = 4;
+
+/*
+Optional quality tiers declared in the metadata. Each tier is compiled as its own program with
+"#define <define> <tier>" injected after the #version line.
+*/
+struct QualityMetadata {
+    std::string define;
+    std::vector<std::string> tiers;
+    int defaultTier = 0;
+    double budgetMilliseconds = DEFAULT_QUALITY_BUDGET_MS;
+};
+
+/*
+A texture declared in the metadata, bound to the sampler2D uniform with the same name. The path is
+relative to the wallpaper file.
+*/
+struct TextureMetadata {
+    std::string path;
+    TextureSampling sampling;
+};
+
+/*
+A video declared in the metadata, either a .y4m file or a directory of images played in name order, bound to
+the sampler2D uniform with the same name and played in step with iTime
+*/
+struct VideoMetadata {
+    std::string path;
+    // Frames per second, 0 uses the rate stored in the file
+    double frameRate = 0.0;
+    bool loop = true;
+};
+
+/*
+A signed distance function in the shader baked into a volume, which the shader reads through iSdf (a sampler3D),
+iSdfMin and iSdfMax (vec3 bounds) and iSdfBaked (a bool saying whether the volume should be used yet)
+*/
+struct SdfMetadata {
+    // Name of a float function(vec3) in the shader, empty for wallpapers without a volume
+    std::string function;
+    int resolution = DEFAULT_SDF_RESOLUTION;
+    std::array<float, 3> boundsMin{ -1.0f, -1.0f, -1.0f };
+    std::array<float, 3> boundsMax{ 1.0f, 1.0f, 1.0f };
+};
+
+struct WallpaperMetadata {
+    std::string name;
+    QualityMetadata quality;
+    std::map<std::string, TextureMetadata> textures;
+    // Uniform name to .wpvt file, relative to the wallpaper file
+    std::map<std::string, std::string> virtualTextures;
+    std::map<std::string, VideoMetadata> videos;
+    // .wav file played into iAudio and iAudioTexture, relative to the wallpaper file. Empty captures system audio.
+    std::string audio;
+    // Uniform name to small image packed into a shared atlas, relative to the wallpaper file
+    std::map<std::string, std::string> sprites;
+    SdfMetadata sdf;
+};
+
+enum class MetadataDecodeResult {
+    Decoded,
+    // The metadata is invalid, the error has been logged
+    Failed,
+    // The metadata uses YAML the decoder doesn't handle, nothing written to the outputs should be used
+    Unsupported
+};
+
+/*
+Parse the metadata section of a wallpaper into the metadata and the uniform registry. The streaming decoder is
+tried first and yaml-cpp is only used for YAML it doesn't handle, in which case YAML::Exception can be thrown.
+*/
+bool ParseWallpaperMetadata(
+    const std::string& metadataYamlSource,
+    WallpaperMetadata& wallpaperMetadata,
+    std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
+    std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
+    std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
+);
+// Single pass over the lines of the metadata, writing each value straight into its field or uniform
+MetadataDecodeResult DecodeWallpaperMetadata(
+    std::string_view metadataYamlSource,
+    WallpaperMetadata& wallpaperMetadata,
+    std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
+    std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
+    std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
+);
+// Build a yaml-cpp document and convert it, handles any YAML but throws YAML::Exception on mistakes
+bool ParseWallpaperMetadataYaml(
+    const std::string& metadataYamlSource,
+    WallpaperMetadata& wallpaperMetadata,
+    std::unordered_map <std::string, Uniform<GLint>>& intUniforms,
+    std::unordered_map <std::string, Uniform<GLfloat>>& floatUniforms,
+    std::unordered_map <std::string, Uniform<GLboolean>>& boolUniforms
+);
+
+namespace YAML {
+    template<>
+    struct convert<TextureMetadata> {
+        static Node encode(const TextureMetadata& rhs) {
+            Node node;
+            node["path"] = rhs.path;
+            node["filter"] = rhs.sampling.filter == GL_NEAREST ? "nearest" : "linear";
+            node["wrap"] = rhs.sampling.wrap == GL_CLAMP_TO_EDGE ? "clamp" : rhs.sampling.wrap == GL_MIRRORED_REPEAT ? "mirror" : "repeat";
+            node["mipmaps"] = rhs.sampling.mipmaps;
+            node["mipFilter"] = rhs.sampling.mipFilter == MipFilter::Kaiser ? "kaiser" : "box";
+            node["srgb"] = rhs.sampling.srgb;
+            return node;
+        }
+
+        static bool decode(const Node& node, TextureMetadata& rhs) {
+            if (node.IsScalar()) {
+                rhs.path = node.as<std::string>();
+                return true;
+            }
+            if (!node.IsMap()) {
+                return false;
+            }
+
+            rhs.path = node["path"].as<std::string>();
+            std::string filter = node["filter"] ? node["filter"].as<std::string>() : "linear";
+            std::string wrap = node["wrap"] ? node["wrap"].as<std::string>() : "repeat";
+            std::string mipFilter = node["mipFilter"] ? node["mipFilter"].as<std::string>() : "box";
+            if (filter != "linear" && filter != "nearest") {
+                return false;
+            }
+            if (wrap != "repeat" && wrap != "clamp" && wrap != "mirror") {
+                return false;
+            }
+            if (mipFilter != "box" && mipFilter != "kaiser") {
+                return false;
+            }
+            rhs.sampling.filter = filter == "nearest" ? GL_NEAREST : GL_LINEAR;
+            rhs.sampling.wrap = wrap == "clamp" ? GL_CLAMP_TO_EDGE : wrap == "mirror" ? GL_MIRRORED_REPEAT : GL_REPEAT;
+            rhs.sampling.mipmaps = node["mipmaps"] ? node["mipmaps"].as<bool>() : true;
+            rhs.sampling.mipFilter = mipFilter == "kaiser" ? MipFilter::Kaiser : MipFilter::Box;
+            rhs.sampling.srgb = node["srgb"] ? node["srgb"].as<bool>() : true;
+            return true;
+        }
+    };
+
+    template<>
+    struct convert<VideoMetadata> {
+        static Node encode(const VideoMetadata& rhs) {
+            Node node;
+            node["path"] = rhs.path;
+            node["fps"] = rhs.frameRate;
+            node["loop"] = rhs.loop;
+            return node;
+        }
+
+        static bool decode(const Node& node, VideoMetadata& rhs) {
+            if (node.IsScalar()) {
+                rhs.path = node.as<std::string>();
+                return true;
+            }
+            if (!node.IsMap()) {
+                return false;
+            }
+
+            rhs.path = node["path"].as<std::string>();
+            rhs.frameRate = node["fps"] ? node["fps"].as<double>() : 0.0;
+            rhs.loop = node["loop"] ? node["loop"].as<bool>() : true;
+            return rhs.frameRate >= 0.0;
+        }
+    };
+
+    template<>
+    struct convert<UniformMetadata<GLboolean>> {
+        static Node encode(const UniformMetadata<GLboolean>& rhs) {
+            Node node;
+            node["name"] = rhs.name;
+            return node;
+        }
+
+        static bool decode(const Node& node, UniformMetadata<GLboolean>& rhs) {
+            if (!node.IsMap()) {
+                return false;
+            }
+
+            // Left empty when missing, the caller names it after the uniform
+            if (node["name"]) {
+                rhs.name = node["name"].as<std::string>();
+            }
+            return true;
+        }
+    };
+
+
+    template<typename T>
+    struct convert<UniformMetadata<T>> {
+        static Node encode(const UniformMetadata<T>& rhs) {
+            Node node;
+            node["name"] = rhs.name;
+            node["min"] = rhs.min;
+            node["max"] = rhs.max;
+            return node;
+        }
+
+        static bool decode(const Node& node, UniformMetadata<T>& rhs) {
+            if (!node.IsMap()) {
+                return false;
+            }
+
+            if (node["name"]) {
+                rhs.name = node["name"].as<std::string>();
+            }
+            // Sliders missing a range get the same one as uniforms the metadata doesn't mention
+            constexpr bool isInt = std::is_same_v<T, GLint>;
+            rhs.min = node["min"] ? node["min"].as<T>() : static_cast<T>(isInt ? DEFAULT_INT_SLIDER_MIN : DEFAULT_FLOAT_SLIDER_MIN);
+            rhs.max = node["max"] ? node["max"].as<T>() : static_cast<T>(isInt ? DEFAULT_INT_SLIDER_MAX : DEFAULT_FLOAT_SLIDER_MAX);
+
+            return true;
+        }
+    };
+}
+
+#endif // !WALLPAPER_METADATA_H
@@ -1,13 +1,13 @@
 #include <opengl/Window.hpp>
 #include <stdexcept>
 
-Window::Window(unsigned int width, unsigned int height, const char* name) {
+Window::Window(unsigned int width, unsigned int height, const char* name, const Window* share) {
     // Create our window, and add its callbacks
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    pWindow = glfwCreateWindow(width, height, name, NULL, NULL);
+    pWindow = glfwCreateWindow(width, height, name, NULL, share == nullptr ? NULL : share->GetWindow());
 
     if (pWindow == NULL)
     {
@@ -13,7 +13,7 @@ class Window {
 private:
     GLFWwindow* pWindow = nullptr;
 public:
-    Window(unsigned int width, unsigned int height, const char* title);
+    Window(unsigned int width, unsigned int height, const char* title, const Window* share = nullptr);
     ~Window();
     void Bind() const;
     void Unbind() const;
@@ -0,0 +1,150 @@
+/*
+Command line tool that times expanding the includes of a deep tree of shader modules.
+
+Usage: IncludeBench [--depth D] [--fanout F] [--lines N] [--iterations N] [--directory DIR]
+
+A tree of modules D levels deep is written to the directory, each including F modules from the level below and one
+module shared by all of them. The tree is then preprocessed cold, warm with every module cached, and again after one
+leaf is edited, where only that leaf should be read again.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <util/Log.hpp>
+#include <util/ShaderPreprocessor.hpp>
+
+struct BenchOptions {
+    int depth = 6;
+    int fanout = 3;
+    int lines = 40;
+    int iterations = 100;
+    std::string directory = "cache/includebench";
+};
+
+static bool ParseArguments(int argc, char** argv, BenchOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--depth" && hasValue) {
+            options->depth = std::atoi(argv[++i]);
+        }
+        else if (arg == "--fanout" && hasValue) {
+            options->fanout = std::atoi(argv[++i]);
+        }
+        else if (arg == "--lines" && hasValue) {
+            options->lines = std::atoi(argv[++i]);
+        }
+        else if (arg == "--iterations" && hasValue) {
+            options->iterations = std::atoi(argv[++i]);
+        }
+        else if (arg == "--directory" && hasValue) {
+            options->directory = argv[++i];
+        }
+        else {
+            return false;
+        }
+    }
+    return options->depth > 0 && options->fanout > 0 && options->lines >= 0 && options->iterations > 0;
+}
+
+static void WriteModule(const std::filesystem::path& path, const std::string& name, int lines, const std::vector<std::string>& includes)
+{
+    std::ofstream stream(path);
+    stream << "#include \"common.glsl\"\n";
+    for (const std::string& include : includes) {
+        stream << "#include \"" << include << "\"\n";
+    }
+    for (int i = 0; i < lines; i++) {
+        stream << "float " << name << "_" << i << "(float x) { return x * " << i << ".0 + 1.0; }\n";
+    }
+}
+
+// Writes the module and everything below it, returning its file name and counting the modules written
+static std::string WriteTree(const std::filesystem::path& directory, const std::string& name, int depth, const BenchOptions& options,
+    size_t* count, std::string* leaf)
+{
+    std::vector<std::string> includes;
+    if (depth < options.depth) {
+        for (int i = 0; i < options.fanout; i++) {
+            includes.push_back(WriteTree(directory, name + "_" + std::to_string(i), depth + 1, options, count, leaf));
+        }
+    }
+    else {
+        *leaf = name + ".glsl";
+    }
+    WriteModule(directory / (name + ".glsl"), name, options.lines, includes);
+    (*count)++;
+    return name + ".glsl";
+}
+
+static double TimePreprocess(const std::string& source, const std::string& path, PreprocessedShader* out)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (!PreprocessShader(source, path, 1, out)) {
+        return -1.0;
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    Log::Init();
+    BenchOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::printf("Usage: IncludeBench [--depth D] [--fanout F] [--lines N] [--iterations N] [--directory DIR]\n");
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path directory = options.directory;
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        LOG_ERROR("Could not create {}", options.directory);
+        return EXIT_FAILURE;
+    }
+    size_t count = 0;
+    std::string leaf;
+    std::string root = WriteTree(directory, "m", 1, options, &count, &leaf);
+    WriteModule(directory / "common.glsl", "common", options.lines, {});
+    count++;
+
+    std::string source = "#version 330 core\n#include \"" + root + "\"\nout vec4 fragColor;\nvoid main() { fragColor = vec4(1.0); }\n";
+    std::string path = (directory / "bench.wallpaper").string();
+    PreprocessedShader shader{};
+    double coldMilliseconds = TimePreprocess(source, path, &shader);
+    if (coldMilliseconds < 0.0) {
+        return EXIT_FAILURE;
+    }
+    size_t coldParsed = shader.modulesParsed;
+
+    double warmMilliseconds = 0.0;
+    for (int i = 0; i < options.iterations; i++) {
+        warmMilliseconds += TimePreprocess(source, path, &shader);
+    }
+    warmMilliseconds /= options.iterations;
+    size_t warmParsed = shader.modulesParsed;
+
+    // A longer file so the edit is seen even where modified times are coarse
+    WriteModule(directory / leaf, "edited", options.lines + 1, {});
+    double editedMilliseconds = TimePreprocess(source, path, &shader);
+
+    std::printf("%zu modules %d deep, %zu lines and %zu bytes expanded\n", count, options.depth,
+        static_cast<size_t>(std::count(shader.source.begin(), shader.source.end(), '\n')), shader.source.size());
+    std::printf("cold   %8.3f ms, %zu read\n", coldMilliseconds, coldParsed);
+    std::printf("warm   %8.3f ms, %zu read\n", warmMilliseconds, warmParsed);
+    std::printf("edited %8.3f ms, %zu read\n", editedMilliseconds, shader.modulesParsed);
+    bool success = shader.files.size() == count + 1 && coldParsed == count && warmParsed == 0 && shader.modulesParsed == 1;
+    if (!success) {
+        LOG_ERROR("Expected {} modules read cold, none warm and one after the edit", count);
+    }
+    std::filesystem::remove_all(directory, error);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,255 @@
+/*
+Command line tool that times the streaming metadata decoder against the yaml-cpp document parser.
+
+Usage: MetadataBench [--iterations N] [wallpaper or directory]...
+
+Metadata blocks are taken from the given .wallpaper files and any found under the given directories. With no
+paths a synthetic corpus is generated covering every section of the schema. Every block is parsed both ways
+and the results compared, so the bench also checks the decoder agrees with yaml-cpp.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <opengl/WallpaperMetadata.hpp>
+#include <util/Log.hpp>
+#include <util/WallpaperFile.hpp>
+
+struct BenchOptions {
+    int iterations = 200;
+    std::vector<std::string> paths;
+};
+
+struct ParsedMetadata {
+    bool parsed = false;
+    WallpaperMetadata metadata;
+    std::unordered_map<std::string, Uniform<GLint>> intUniforms;
+    std::unordered_map<std::string, Uniform<GLfloat>> floatUniforms;
+    std::unordered_map<std::string, Uniform<GLboolean>> boolUniforms;
+};
+
+static bool ParseArguments(int argc, char** argv, BenchOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--iterations" && hasValue) {
+            options->iterations = std::atoi(argv[++i]);
+        }
+        else if (arg.starts_with("--")) {
+            return false;
+        }
+        else {
+            options->paths.push_back(arg);
+        }
+    }
+    return options->iterations > 0;
+}
+
+static void AddWallpaper(const std::filesystem::path& path, std::vector<std::string>* corpus)
+{
+    WallpaperSources sources{};
+    if (ParseWallpaperSource(path.string(), &sources) && !sources.metadataYamlSource.empty()) {
+        corpus->push_back(sources.metadataYamlSource);
+    }
+}
+
+// Metadata the way wallpapers are written, growing from a name and a couple of sliders to every section
+static std::vector<std::string> BuildSyntheticCorpus()
+{
+    std::vector<std::string> corpus;
+    for (int size : { 1, 4, 16, 64 }) {
+        std::string yaml = "name: \"Synthetic " + std::to_string(size) + "\" # generated\n";
+        if (size >= 4) {
+            yaml += "quality:\n  define: QUALITY\n  tiers: [Low, 'Medium', \"High\"]\n  budget: 12.5\n";
+            yaml += "audio: sounds/test.wav\n";
+            yaml += "sdf:\n  function: map\n  resolution: 96\n  min: [-2.0, -1.5, -2.0]\n  max: [2, 1.5, 2]\n";
+        }
+        yaml += "textures:\n";
+        for (int i = 0; i < size; i++) {
+            if (i % 2 == 0) {
+                yaml += "  iChannel" + std::to_string(i) + ": images/image" + std::to_string(i) + ".png\n";
+            }
+            else {
+                yaml += "  iChannel" + std::to_string(i) + ":\n    path: 'images/it''s " + std::to_string(i) + ".jpg'\n"
+                    "    filter: nearest\n    wrap: mirror\n    mipmaps: false\n    mipFilter: kaiser\n    srgb: no\n";
+            }
+        }
+        yaml += "videos:\n  iVideo0: videos/waves.y4m\n  iVideo1:\n    path: videos/timelapse\n    fps: 24\n    loop: false\n";
+        yaml += "sprites:\n";
+        for (int i = 0; i < size; i++) {
+            yaml += "  iSprite" + std::to_string(i) + ": sprites/sprite" + std::to_string(i) + ".png\n";
+        }
+        yaml += "uniforms:\n  float:\n";
+        for (int i = 0; i < size; i++) {
+            yaml += "    float" + std::to_string(i) + ":\n      name: Float " + std::to_string(i) + "\n      min: -" + std::to_string(i) + ".5\n      max: 1e3\n";
+        }
+        yaml += "  int:\n";
+        for (int i = 0; i < size; i++) {
+            yaml += "    int" + std::to_string(i) + ":\n      name: \"Int \\\"" + std::to_string(i) + "\\\"\"\n      min: -" + std::to_string(i) + "\n      max: 100\n";
+        }
+        yaml += size == 1 ? "  bool: {}\n" : "  bool:\n    enabled:\n      name: Enabled\n";
+        corpus.push_back(yaml);
+    }
+    // Uniform sections are optional, missing or empty
+    corpus.push_back("name: No uniforms\n");
+    corpus.push_back("name: Float uniforms only\nuniforms:\n  float:\n    speed:\n      name: Speed\n");
+    corpus.push_back("name: Empty uniforms\nuniforms:\n  int:\n  bool:\n");
+    return corpus;
+}
+
+template<typename T>
+static bool SameUniforms(const std::unordered_map<std::string, Uniform<T>>& a, const std::unordered_map<std::string, Uniform<T>>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (auto it = a.begin(); it != a.end(); ++it) {
+        auto other = b.find(it->first);
+        if (other == b.end() || other->second.metadata.name != it->second.metadata.name) {
+            return false;
+        }
+        if constexpr (!std::is_same_v<T, GLboolean>) {
+            if (other->second.metadata.min != it->second.metadata.min || other->second.metadata.max != it->second.metadata.max) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool SameMetadata(const ParsedMetadata& a, const ParsedMetadata& b)
+{
+    const WallpaperMetadata& x = a.metadata;
+    const WallpaperMetadata& y = b.metadata;
+    if (a.parsed != b.parsed || x.name != y.name || x.audio != y.audio || x.virtualTextures != y.virtualTextures || x.sprites != y.sprites) {
+        return false;
+    }
+    if (x.quality.define != y.quality.define || x.quality.tiers != y.quality.tiers || x.quality.defaultTier != y.quality.defaultTier ||
+        x.quality.budgetMilliseconds != y.quality.budgetMilliseconds) {
+        return false;
+    }
+    if (x.sdf.function != y.sdf.function || x.sdf.resolution != y.sdf.resolution || x.sdf.boundsMin != y.sdf.boundsMin || x.sdf.boundsMax != y.sdf.boundsMax) {
+        return false;
+    }
+    if (x.textures.size() != y.textures.size() || x.videos.size() != y.videos.size()) {
+        return false;
+    }
+    for (auto it = x.textures.begin(); it != x.textures.end(); ++it) {
+        auto other = y.textures.find(it->first);
+        if (other == y.textures.end() || other->second.path != it->second.path) {
+            return false;
+        }
+        const TextureSampling& s = it->second.sampling;
+        const TextureSampling& t = other->second.sampling;
+        if (s.filter != t.filter || s.wrap != t.wrap || s.mipmaps != t.mipmaps || s.mipFilter != t.mipFilter || s.srgb != t.srgb) {
+            return false;
+        }
+    }
+    for (auto it = x.videos.begin(); it != x.videos.end(); ++it) {
+        auto other = y.videos.find(it->first);
+        if (other == y.videos.end() || other->second.path != it->second.path || other->second.frameRate != it->second.frameRate ||
+            other->second.loop != it->second.loop) {
+            return false;
+        }
+    }
+    return SameUniforms(a.intUniforms, b.intUniforms) && SameUniforms(a.floatUniforms, b.floatUniforms) && SameUniforms(a.boolUniforms, b.boolUniforms);
+}
+
+template<typename F>
+static double TimeMicroseconds(int iterations, F&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        function();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv)
+{
+    Log::Init();
+    BenchOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::printf("Usage: MetadataBench [--iterations N] [wallpaper or directory]...\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> corpus;
+    for (const std::string& path : options.paths) {
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+                if (entry.path().extension() == ".wallpaper") {
+                    AddWallpaper(entry.path(), &corpus);
+                }
+            }
+        }
+        else {
+            AddWallpaper(path, &corpus);
+        }
+    }
+    if (options.paths.empty()) {
+        corpus = BuildSyntheticCorpus();
+    }
+    if (corpus.empty()) {
+        LOG_ERROR("No metadata blocks found");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%-8s %8s %12s %12s %8s  %s\n", "block", "bytes", "decoder us", "yaml-cpp us", "speedup", "result");
+    double decoderTotal = 0.0;
+    double yamlTotal = 0.0;
+    size_t fallbacks = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        const std::string& source = corpus[i];
+
+        // Results from the first run of each are compared, the yaml-cpp path can throw where the decoder logs
+        ParsedMetadata decoded{};
+        MetadataDecodeResult result = DecodeWallpaperMetadata(source, decoded.metadata, decoded.intUniforms, decoded.floatUniforms, decoded.boolUniforms);
+        decoded.parsed = result == MetadataDecodeResult::Decoded;
+        ParsedMetadata reference{};
+        try {
+            reference.parsed = ParseWallpaperMetadataYaml(source, reference.metadata, reference.intUniforms, reference.floatUniforms, reference.boolUniforms);
+        }
+        catch (const YAML::Exception& e) {
+            LOG_WARNING("yaml-cpp rejected block {}: {}", i, e.what());
+        }
+
+        double decoderMicroseconds = TimeMicroseconds(options.iterations, [&]() {
+            ParsedMetadata parsed{};
+            ParseWallpaperMetadata(source, parsed.metadata, parsed.intUniforms, parsed.floatUniforms, parsed.boolUniforms);
+        });
+        double yamlMicroseconds = TimeMicroseconds(options.iterations, [&]() {
+            ParsedMetadata parsed{};
+            try {
+                ParseWallpaperMetadataYaml(source, parsed.metadata, parsed.intUniforms, parsed.floatUniforms, parsed.boolUniforms);
+            }
+            catch (const YAML::Exception&) {
+            }
+        });
+        decoderTotal += decoderMicroseconds;
+        yamlTotal += yamlMicroseconds;
+
+        const char* status = "match";
+        if (result == MetadataDecodeResult::Unsupported) {
+            status = "fallback";
+            fallbacks++;
+        }
+        else if (!SameMetadata(decoded, reference)) {
+            status = "MISMATCH";
+            mismatches++;
+        }
+        std::printf("%-8zu %8zu %12.2f %12.2f %7.1fx  %s\n", i, source.size(), decoderMicroseconds, yamlMicroseconds,
+            yamlMicroseconds / decoderMicroseconds, status);
+    }
+    std::printf("%zu blocks, %.2f us decoding against %.2f us with yaml-cpp (%.1fx), %zu fell back, %zu mismatched\n",
+        corpus.size(), decoderTotal, yamlTotal, yamlTotal / decoderTotal, fallbacks, mismatches);
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
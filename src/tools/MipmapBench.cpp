@@ -0,0 +1,154 @@
+/*
+Command line tool that measures CPU mip generation throughput against the driver's glGenerateMipmap.
+
+Usage: MipmapBench [--size N] [--iterations N]
+
+A synthetic N x N RGBA image is reduced to 1x1 with every filter, with and without gamma correction, on one
+thread and split over a pool. Throughput is base image megapixels per second. The driver path uploads the
+same image to a hidden window's context and times glGenerateMipmap up to a glFinish.
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <gl.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <util/Log.hpp>
+#include <util/Mipmap.hpp>
+#include <util/Timing.hpp>
+
+struct BenchOptions {
+    int size = 4096;
+    int iterations = 5;
+};
+
+static bool ParseArguments(int argc, char** argv, BenchOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue) {
+            options->size = std::atoi(argv[++i]);
+        }
+        else if (arg == "--iterations" && hasValue) {
+            options->iterations = std::atoi(argv[++i]);
+        }
+        else {
+            return false;
+        }
+    }
+    return options->size > 0 && options->iterations > 0;
+}
+
+static void PrintResult(const char* label, double megapixels, double milliseconds)
+{
+    std::printf("  %-28s %9.2f ms %9.1f MP/s\n", label, milliseconds, megapixels / (milliseconds / 1000.0));
+}
+
+// Gradients with some high frequency detail so the filters have something to do
+static Image MakeTestImage(int size)
+{
+    Image image{};
+    image.width = size;
+    image.height = size;
+    image.pixels.resize(image.RowBytes() * static_cast<size_t>(size));
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            unsigned char* pixel = image.pixels.data() + image.RowBytes() * static_cast<size_t>(y) + static_cast<size_t>(x) * Image::CHANNELS;
+            pixel[0] = static_cast<unsigned char>(x * 255 / size);
+            pixel[1] = static_cast<unsigned char>(y * 255 / size);
+            pixel[2] = static_cast<unsigned char>(((x ^ y) & 8) ? 255 : 0);
+            pixel[3] = 255;
+        }
+    }
+    return image;
+}
+
+static bool BenchDriver(const Image& image, int iterations, double megapixels)
+{
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "MipmapBench", NULL, NULL);
+    if (window == NULL) {
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGL(static_cast<GLADloadfunc>(glfwGetProcAddress))) {
+        glfwDestroyWindow(window);
+        return false;
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+    glFinish();
+
+    std::vector<double> timings;
+    for (int i = 0; i < iterations; i++) {
+        timings.push_back(TimeMilliseconds([]() {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glFinish();
+        }));
+    }
+    std::printf("driver (%s)\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    PrintResult("glGenerateMipmap", megapixels, Median(timings));
+
+    glDeleteTextures(1, &texture);
+    glfwDestroyWindow(window);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Log::Init();
+
+    BenchOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::fprintf(stderr, "Usage: MipmapBench [--size N] [--iterations N]\n");
+        return EXIT_FAILURE;
+    }
+
+    Image image = MakeTestImage(options.size);
+    double megapixels = static_cast<double>(options.size) * options.size / 1e6;
+    ThreadPool pool{};
+
+    struct Variant {
+        const char* label;
+        MipFilter filter;
+        bool srgb;
+    };
+    const Variant variants[] = {
+        { "box", MipFilter::Box, false },
+        { "box srgb", MipFilter::Box, true },
+        { "kaiser", MipFilter::Kaiser, false },
+        { "kaiser srgb", MipFilter::Kaiser, true },
+    };
+
+    for (int threaded = 0; threaded < 2; threaded++) {
+        std::printf("cpu, %zu thread(s)\n", threaded ? pool.GetThreadCount() + 1 : 1);
+        for (const Variant& variant : variants) {
+            MipOptions mipOptions{ variant.filter, variant.srgb, threaded ? &pool : nullptr };
+            std::vector<double> timings;
+            for (int i = 0; i < options.iterations; i++) {
+                timings.push_back(TimeMilliseconds([&]() {
+                    std::vector<Image> mips;
+                    GenerateMipChain(image, &mips, mipOptions);
+                }));
+            }
+            PrintResult(variant.label, megapixels, Median(timings));
+        }
+    }
+
+    if (!glfwInit() || !BenchDriver(image, options.iterations, megapixels)) {
+        LOG_WARNING("Could not create an OpenGL context, skipping the driver path");
+    }
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
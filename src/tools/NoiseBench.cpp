@@ -0,0 +1,327 @@
+/*
+Command line tool that times builtin noise generation and measures what sampling it saves over computing noise
+in the shader.
+
+Usage: NoiseBench [--width N] [--height N] [--iterations N] [--library PATH]
+
+Every noise kind is generated on one thread and split over a pool. Then pairs of fragment shaders that differ only
+in computing noise with the shader library or fetching it from the noise textures are drawn full screen into an
+offscreen framebuffer on a hidden window. One pair is the sound fallback of the bundled default.wallpaper, the other
+a per pixel fbm. Each is reported with its static op estimate and measured GPU time per pixel.
+*/
+
+#include <gl.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <util/Log.hpp>
+#include <util/Noise.hpp>
+#include <util/ShaderCost.hpp>
+#include <util/Timing.hpp>
+
+struct BenchOptions {
+    int width = 1920;
+    int height = 1080;
+    int iterations = 20;
+    std::string libraryPath = "lib/common.glsl";
+};
+
+struct NoiseWorkload {
+    const char* label;
+    const char* proceduralBody;
+    const char* textureBody;
+};
+
+static const char* BENCH_VERTEX_SHADER = R"(#version 330 core
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+static const char* BENCH_FRAGMENT_HEADER = R"(#version 330 core
+out vec4 FragColor;
+uniform float iTime;
+uniform sampler2D iNoiseValue;
+uniform sampler3D iNoiseValue3D;
+float libNoise(vec3 p);
+float libNoise(vec2 p);
+)";
+
+static const NoiseWorkload WORKLOADS[] = {
+    {
+        "default.wallpaper sound",
+        R"(void main() {
+    float time = iTime;
+    float freqs[4];
+    freqs[0] = libNoise(vec3(0.01 * 100.0, 0.25, time / 10.0));
+    freqs[1] = libNoise(vec3(0.07 * 100.0, 0.25, time / 10.0));
+    freqs[2] = libNoise(vec3(0.15 * 100.0, 0.25, time / 10.0));
+    freqs[3] = libNoise(vec3(0.30 * 100.0, 0.25, time / 10.0));
+    FragColor = vec4(freqs[0] + freqs[1], freqs[2], freqs[3], 1.0);
+}
+)",
+        R"(void main() {
+    float time = iTime;
+    float freqs[4];
+    freqs[0] = texture(iNoiseValue3D, vec3(0.01 * 100.0, 0.25, time / 10.0) / 16.0).x;
+    freqs[1] = texture(iNoiseValue3D, vec3(0.07 * 100.0, 0.25, time / 10.0) / 16.0).x;
+    freqs[2] = texture(iNoiseValue3D, vec3(0.15 * 100.0, 0.25, time / 10.0) / 16.0).x;
+    freqs[3] = texture(iNoiseValue3D, vec3(0.30 * 100.0, 0.25, time / 10.0) / 16.0).x;
+    FragColor = vec4(freqs[0] + freqs[1], freqs[2], freqs[3], 1.0);
+}
+)",
+    },
+    {
+        "fbm, 6 octaves per pixel",
+        R"(void main() {
+    vec2 p = gl_FragCoord.xy * 0.01 + iTime;
+    float value = 0.0;
+    float amplitude = 0.5;
+    for (int i = 0; i < 6; i++) {
+        value += amplitude * libNoise(p);
+        p *= 2.0;
+        amplitude *= 0.5;
+    }
+    FragColor = vec4(vec3(value), 1.0);
+}
+)",
+        R"(void main() {
+    vec2 p = gl_FragCoord.xy * 0.01 + iTime;
+    float value = 0.0;
+    float amplitude = 0.5;
+    for (int i = 0; i < 6; i++) {
+        value += amplitude * texture(iNoiseValue, p / 32.0).x;
+        p *= 2.0;
+        amplitude *= 0.5;
+    }
+    FragColor = vec4(vec3(value), 1.0);
+}
+)",
+    },
+};
+
+static bool ParseArguments(int argc, char** argv, BenchOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--width" && hasValue) {
+            options->width = std::atoi(argv[++i]);
+        }
+        else if (arg == "--height" && hasValue) {
+            options->height = std::atoi(argv[++i]);
+        }
+        else if (arg == "--iterations" && hasValue) {
+            options->iterations = std::atoi(argv[++i]);
+        }
+        else if (arg == "--library" && hasValue) {
+            options->libraryPath = argv[++i];
+        }
+        else {
+            return false;
+        }
+    }
+    return options->width > 0 && options->height > 0 && options->iterations > 0;
+}
+
+static void BenchGeneration(int iterations)
+{
+    ThreadPool pool{};
+    for (int threaded = 0; threaded < 2; threaded++) {
+        std::printf("generation, %zu thread(s)\n", threaded ? pool.GetThreadCount() + 1 : 1);
+        for (int kind = 0; kind < static_cast<int>(NoiseKind::Count); kind++) {
+            std::vector<double> timings;
+            for (int i = 0; i < std::min(iterations, 3); i++) {
+                timings.push_back(TimeMilliseconds([&]() {
+                    GenerateNoise(static_cast<NoiseKind>(kind), threaded ? &pool : nullptr);
+                }));
+            }
+            std::printf("  %-28s %9.2f ms\n", GetNoiseUniformName(static_cast<NoiseKind>(kind)), Median(timings));
+        }
+    }
+}
+
+static GLuint CompileShader(GLenum type, const std::string& source)
+{
+    GLuint shader = glCreateShader(type);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    GLint success = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success != GL_TRUE) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        LOG_ERROR("Shader failed to compile: {}", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint LinkProgram(GLuint vertexShader, GLuint libraryShader, const std::string& fragmentSource)
+{
+    GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (fragmentShader == 0) {
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, libraryShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(fragmentShader);
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success != GL_TRUE) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        LOG_ERROR("Program failed to link: {}", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static GLuint CreateNoiseTexture(NoiseKind kind)
+{
+    NoiseVolume volume = GenerateNoise(kind);
+    GLenum target = volume.depth > 1 ? GL_TEXTURE_3D : GL_TEXTURE_2D;
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(target, texture);
+    if (target == GL_TEXTURE_3D) {
+        glTexImage3D(target, 0, GL_RGBA8, volume.width, volume.height, volume.depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, volume.pixels.data());
+    }
+    else {
+        glTexImage2D(target, 0, GL_RGBA8, volume.width, volume.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, volume.pixels.data());
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(target);
+    return texture;
+}
+
+// Median time to draw a full screen pass with the program, after a warm up draw
+static double TimeProgram(GLuint program, int iterations)
+{
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "iNoiseValue"), 0);
+    glUniform1i(glGetUniformLocation(program, "iNoiseValue3D"), 1);
+    GLint time = glGetUniformLocation(program, "iTime");
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glFinish();
+    std::vector<double> timings;
+    for (int i = 0; i < iterations; i++) {
+        glUniform1f(time, static_cast<float>(i) * 0.016f);
+        timings.push_back(TimeMilliseconds([]() {
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glFinish();
+        }));
+    }
+    return Median(timings);
+}
+
+static bool BenchSampling(const BenchOptions& options)
+{
+    std::ifstream libraryFile(options.libraryPath);
+    if (libraryFile.fail()) {
+        LOG_ERROR("Could not open shader library {}", options.libraryPath);
+        return false;
+    }
+    std::stringstream libraryStream;
+    libraryStream << libraryFile.rdbuf();
+    std::string librarySource = libraryStream.str();
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "NoiseBench", NULL, NULL);
+    if (window == NULL) {
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGL(static_cast<GLADloadfunc>(glfwGetProcAddress))) {
+        glfwDestroyWindow(window);
+        return false;
+    }
+
+    GLuint target = 0;
+    glGenTextures(1, &target);
+    glBindTexture(GL_TEXTURE_2D, target);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, options.width, options.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    glViewport(0, 0, options.width, options.height);
+    GLuint vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+
+    glActiveTexture(GL_TEXTURE0);
+    GLuint noise2D = CreateNoiseTexture(NoiseKind::Value);
+    glActiveTexture(GL_TEXTURE1);
+    GLuint noise3D = CreateNoiseTexture(NoiseKind::Value3D);
+
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, BENCH_VERTEX_SHADER);
+    GLuint libraryShader = CompileShader(GL_FRAGMENT_SHADER, librarySource);
+    double pixels = static_cast<double>(options.width) * options.height;
+    std::printf("sampling at %dx%d (%s)\n", options.width, options.height, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    std::printf("  %-28s %12s %12s %12s\n", "", "est. ops/px", "ms/frame", "ns/px");
+    for (const NoiseWorkload& workload : WORKLOADS) {
+        std::string proceduralSource = std::string(BENCH_FRAGMENT_HEADER) + workload.proceduralBody;
+        std::string textureSource = std::string(BENCH_FRAGMENT_HEADER) + workload.textureBody;
+        GLuint procedural = LinkProgram(vertexShader, libraryShader, proceduralSource);
+        GLuint textured = LinkProgram(vertexShader, libraryShader, textureSource);
+        if (procedural == 0 || textured == 0) {
+            continue;
+        }
+        double proceduralOps = EstimateShaderCost(proceduralSource + librarySource).TotalOps();
+        double textureOps = EstimateShaderCost(textureSource + librarySource).TotalOps();
+        double proceduralMilliseconds = TimeProgram(procedural, options.iterations);
+        double textureMilliseconds = TimeProgram(textured, options.iterations);
+        std::printf("%s\n", workload.label);
+        std::printf("  %-28s %12.0f %12.3f %12.4f\n", "shader library", proceduralOps, proceduralMilliseconds, proceduralMilliseconds * 1e6 / pixels);
+        std::printf("  %-28s %12.0f %12.3f %12.4f\n", "noise texture", textureOps, textureMilliseconds, textureMilliseconds * 1e6 / pixels);
+        std::printf("  %-28s %12.0f %12.3f %12.4f\n", "saved", proceduralOps - textureOps, proceduralMilliseconds - textureMilliseconds,
+            (proceduralMilliseconds - textureMilliseconds) * 1e6 / pixels);
+        glDeleteProgram(procedural);
+        glDeleteProgram(textured);
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(libraryShader);
+    glDeleteTextures(1, &noise2D);
+    glDeleteTextures(1, &noise3D);
+    glDeleteTextures(1, &target);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteVertexArrays(1, &vertexArray);
+    glfwDestroyWindow(window);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Log::Init();
+
+    BenchOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::fprintf(stderr, "Usage: NoiseBench [--width N] [--height N] [--iterations N] [--library PATH]\n");
+        return EXIT_FAILURE;
+    }
+
+    BenchGeneration(options.iterations);
+    if (!glfwInit() || !BenchSampling(options)) {
+        LOG_WARNING("Could not create an OpenGL context, skipping the sampling benchmark");
+    }
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
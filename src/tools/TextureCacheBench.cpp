@@ -0,0 +1,133 @@
+/*
+Command line tool that measures how much the texture disk cache saves per texture.
+
+Usage: TextureCacheBench [--iterations N] [--cache DIR] <image>...
+
+For every image the cold path (decode, build the mip chain on the CPU and write the texture file) is timed
+against the warm path (map the texture file and touch every byte, as the uploader would). Warm timings are
+taken with the file in the OS page cache, so the first load after a reboot will sit between the two.
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <util/Hash.hpp>
+#include <util/Image.hpp>
+#include <util/Log.hpp>
+#include <util/TextureFile.hpp>
+#include <util/Timing.hpp>
+
+struct BenchOptions {
+    int iterations = 5;
+    std::string cacheDirectory = "cache/bench";
+    std::vector<std::string> paths;
+};
+
+static bool ParseArguments(int argc, char** argv, BenchOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--iterations" && hasValue) {
+            options->iterations = std::atoi(argv[++i]);
+        }
+        else if (arg == "--cache" && hasValue) {
+            options->cacheDirectory = argv[++i];
+        }
+        else if (arg.starts_with("--")) {
+            return false;
+        }
+        else {
+            options->paths.push_back(arg);
+        }
+    }
+    return !options->paths.empty() && options->iterations > 0;
+}
+
+int main(int argc, char** argv) {
+    Log::Init();
+
+    BenchOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::fprintf(stderr, "Usage: TextureCacheBench [--iterations N] [--cache DIR] <image>...\n");
+        return EXIT_FAILURE;
+    }
+    std::filesystem::create_directories(options.cacheDirectory);
+
+    std::printf("%-32s %11s %8s %10s %10s %8s\n", "image", "size", "MB", "cold ms", "warm ms", "speedup");
+    bool success = true;
+    for (const std::string& path : options.paths) {
+        std::vector<unsigned char> encoded;
+        if (!ReadFileBytes(path, &encoded)) {
+            LOG_ERROR("Could not read {}", path);
+            success = false;
+            continue;
+        }
+        uint64_t contentHash = HashBytes(encoded.data(), encoded.size());
+        std::string texturePath = (std::filesystem::path(options.cacheDirectory) / (HashToHex(contentHash) + ".wptx")).string();
+
+        int width = 0;
+        int height = 0;
+        size_t bytes = 0;
+        bool loaded = true;
+        std::vector<double> cold;
+        for (int i = 0; i < options.iterations && loaded; i++) {
+            cold.push_back(TimeMilliseconds([&]() {
+                Image image{};
+                if (!DecodeImage(encoded.data(), encoded.size(), &image)) {
+                    loaded = false;
+                    return;
+                }
+                width = image.width;
+                height = image.height;
+                TexturePayload payload = BuildTexturePayload(std::move(image));
+                bytes = payload.Bytes();
+                loaded = WriteTextureFile(texturePath, contentHash, payload);
+            }));
+        }
+        if (!loaded) {
+            success = false;
+            continue;
+        }
+
+        std::vector<double> warm;
+        unsigned int checksum = 0;
+        for (int i = 0; i < options.iterations && loaded; i++) {
+            warm.push_back(TimeMilliseconds([&]() {
+                TexturePayload payload{};
+                if (!ReadTextureFile(texturePath, contentHash, &payload)) {
+                    loaded = false;
+                    return;
+                }
+                // Read every byte so the time includes paging the file in, not just creating the mapping
+                for (const TextureLevel& level : payload.levels) {
+                    for (size_t offset = 0; offset < level.size; offset += 64) {
+                        checksum += level.pixels[offset];
+                    }
+                }
+            }));
+        }
+        if (!loaded) {
+            LOG_ERROR("Could not read back {}", texturePath);
+            success = false;
+            continue;
+        }
+
+        double coldMilliseconds = Median(cold);
+        double warmMilliseconds = Median(warm);
+        std::string size = std::to_string(width) + "x" + std::to_string(height);
+        std::printf("%-32s %11s %8.1f %10.2f %10.2f %7.1fx\n", std::filesystem::path(path).filename().string().c_str(), size.c_str(),
+            static_cast<double>(bytes) / (1024.0 * 1024.0), coldMilliseconds, warmMilliseconds, coldMilliseconds / std::max(warmMilliseconds, 0.001));
+        // Keeps the touch loop from being optimised away
+        if (checksum == 1) {
+            std::printf(" ");
+        }
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
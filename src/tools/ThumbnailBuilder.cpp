@@ -0,0 +1,176 @@
+/*
+Command line tool that renders thumbnails for a wallpaper library into the thumbnail cache.
+
+Usage: ThumbnailBuilder [--cache DIR] [--vertex PATH] [--library PATH] [--force] [--sandbox] <wallpaper or directory>...
+
+Every wallpaper is rendered on a hidden window through the same renderer the control menu uses: a few renders in
+flight at once, read back through pixel buffers and downscaled and written on the thread pool. Wallpapers that
+already have a thumbnail are skipped unless --force is given. Programs go through the engine's program cache, so
+wallpapers rendered here load faster in the engine too. With --sandbox new programs are built in shader worker
+processes first, as the engine does, so a wallpaper that hangs or crashes the driver fails instead. Reports the GL renderer and the throughput, so
+running it against a software implementation such as Mesa's llvmpipe gives the worst case.
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <gl.h>
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opengl/ShaderSandbox.hpp>
+#include <opengl/ThumbnailRenderer.hpp>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+
+struct BuildOptions {
+    std::string cacheDirectory = DEFAULT_THUMBNAIL_CACHE_DIRECTORY;
+    std::string vertexPath = DEFAULT_VERTEX_SHADER_PATH;
+    std::string libraryPath = DEFAULT_LIBRARY_SHADER_PATH;
+    bool force = false;
+    bool sandbox = false;
+    std::vector<std::string> paths;
+};
+
+static bool ParseArguments(int argc, char** argv, BuildOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--cache" && hasValue) {
+            options->cacheDirectory = argv[++i];
+        }
+        else if (arg == "--vertex" && hasValue) {
+            options->vertexPath = argv[++i];
+        }
+        else if (arg == "--library" && hasValue) {
+            options->libraryPath = argv[++i];
+        }
+        else if (arg == "--force") {
+            options->force = true;
+        }
+        else if (arg == "--sandbox") {
+            options->sandbox = true;
+        }
+        else if (arg.starts_with("--")) {
+            return false;
+        }
+        else {
+            options->paths.push_back(arg);
+        }
+    }
+    return !options->paths.empty();
+}
+
+static void AddWallpaper(const std::filesystem::path& path, std::vector<std::filesystem::path>* wallpapers)
+{
+    if (path.extension() == ".wallpaper") {
+        wallpapers->push_back(path);
+    }
+}
+
+static bool BuildThumbnails(const BuildOptions& options)
+{
+    std::vector<std::filesystem::path> wallpapers;
+    for (const std::string& path : options.paths) {
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+                AddWallpaper(entry.path(), &wallpapers);
+            }
+        }
+        else {
+            AddWallpaper(path, &wallpapers);
+        }
+    }
+    if (wallpapers.empty()) {
+        LOG_ERROR("No wallpapers found");
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "ThumbnailBuilder", NULL, NULL);
+    if (window == NULL) {
+        LOG_ERROR("Failed to create a hidden window");
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGL(static_cast<GLADloadfunc>(glfwGetProcAddress))) {
+        glfwDestroyWindow(window);
+        LOG_ERROR("Failed to initialise GLAD");
+        return false;
+    }
+
+    bool built = true;
+    {
+        ThreadPool pool;
+        std::unique_ptr<ShaderSandbox> sandbox = nullptr;
+        if (options.sandbox) {
+            sandbox = std::make_unique<ShaderSandbox>(GetExecutablePath(), options.vertexPath, options.libraryPath);
+        }
+        ThumbnailRenderer renderer(pool, options.vertexPath, options.libraryPath, options.cacheDirectory, DEFAULT_PROGRAM_CACHE_DIRECTORY,
+            sandbox.get());
+        for (const std::filesystem::path& path : wallpapers) {
+            // Keyed the same way as the catalog, by the hash of the whole file
+            std::ifstream stream(path, std::ios::binary);
+            std::string source{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+            uint64_t contentHash = HashBytes(source.data(), source.size());
+            if (options.force) {
+                std::error_code error;
+                std::filesystem::remove(renderer.GetThumbnailPath(contentHash), error);
+            }
+            renderer.Enqueue(path.string(), contentHash);
+        }
+
+        size_t queued = renderer.GetStats().queued;
+        std::printf("Rendering %zu of %zu wallpapers at %dx%d on %s\n", queued, wallpapers.size(), THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT,
+            reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        while (!renderer.IsIdle()) {
+            renderer.Process(THUMBNAIL_SLOTS);
+            std::this_thread::yield();
+        }
+
+        const ThumbnailStats& stats = renderer.GetStats();
+        std::printf("%zu rendered, %zu failed in %.2f s, %.1f thumbnails/s\n", stats.rendered, stats.failed, stats.busySeconds,
+            stats.ThumbnailsPerSecond());
+        built = stats.failed == 0;
+    }
+    glfwDestroyWindow(window);
+    return built;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string(argv[1]) == SHADER_WORKER_ARGUMENT) {
+        return RunShaderWorker(argc, argv);
+    }
+    Log::Init();
+    BuildOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::printf("Usage: ThumbnailBuilder [--cache DIR] [--vertex PATH] [--library PATH] [--force] [--sandbox] <wallpaper or directory>...\n");
+        return EXIT_FAILURE;
+    }
+    if (!glfwInit()) {
+        LOG_ERROR("Failed to initialise GLFW");
+        return EXIT_FAILURE;
+    }
+    bool built = false;
+    try {
+        built = BuildThumbnails(options);
+    }
+    catch (const std::runtime_error& e) {
+        LOG_ERROR(e.what());
+    }
+    glfwTerminate();
+    return built ? EXIT_SUCCESS : EXIT_FAILURE;
+}
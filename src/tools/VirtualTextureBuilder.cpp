@@ -0,0 +1,70 @@
+/*
+Command line tool that cuts a large image into a virtual texture file for the virtualTextures metadata section.
+
+Usage: VirtualTextureBuilder [--linear] [--kaiser] <image> <output.wpvt>
+
+The whole source image has to be decoded once here. Only the tiles a wallpaper samples are ever loaded at run
+time, so the engine itself never holds the image in memory.
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <util/Image.hpp>
+#include <util/Log.hpp>
+#include <util/VirtualTextureFile.hpp>
+
+int main(int argc, char** argv) {
+    Log::Init();
+
+    MipOptions options{};
+    std::string inputPath;
+    std::string outputPath;
+    bool validArguments = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--linear") {
+            options.srgb = false;
+        }
+        else if (arg == "--kaiser") {
+            options.filter = MipFilter::Kaiser;
+        }
+        else if (arg.starts_with("--")) {
+            validArguments = false;
+        }
+        else if (inputPath.empty()) {
+            inputPath = arg;
+        }
+        else if (outputPath.empty()) {
+            outputPath = arg;
+        }
+        else {
+            validArguments = false;
+        }
+    }
+    if (!validArguments || inputPath.empty() || outputPath.empty()) {
+        std::fprintf(stderr, "Usage: VirtualTextureBuilder [--linear] [--kaiser] <image> <output.wpvt>\n");
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Image image{};
+    if (!LoadImage(inputPath, &image)) {
+        return EXIT_FAILURE;
+    }
+    ThreadPool pool{};
+    options.pool = &pool;
+    std::vector<VirtualLevel> levels = GetVirtualLevels(image.width, image.height);
+    if (!WriteVirtualTextureFile(outputPath, std::move(image), options)) {
+        return EXIT_FAILURE;
+    }
+
+    size_t tiles = levels.back().firstTile + static_cast<size_t>(levels.back().tilesX) * static_cast<size_t>(levels.back().tilesY);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Wrote %s: %dx%d, %zu levels, %zu tiles, %.1f MB in %.1f s\n", outputPath.c_str(), levels.front().width, levels.front().height,
+        levels.size(), tiles, static_cast<double>(tiles * VirtualTextureFile::GetTileBytes()) / (1024.0 * 1024.0), seconds);
+    return EXIT_SUCCESS;
+}
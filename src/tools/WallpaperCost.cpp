@@ -0,0 +1,127 @@
+/*
+Command line tool that statically estimates the per pixel cost of wallpapers before they are rolled out.
+
+Usage: WallpaperCost [--width W] [--height H] [--budget MS] [--gigaops G] [--library PATH] <file.wallpaper>...
+
+Every quality tier declared in a wallpaper's metadata is estimated separately. The exit code is non zero
+if any wallpaper fails to parse or any tier is predicted to go over the budget.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <util/Log.hpp>
+#include <util/ShaderCost.hpp>
+#include <util/WallpaperFile.hpp>
+#include <yaml-cpp/yaml.h>
+
+struct EstimateOptions {
+    int width = 1920;
+    int height = 1080;
+    double budgetMilliseconds = DEFAULT_COST_BUDGET_MS;
+    double gigaOps = DEFAULT_GPU_GIGAOPS;
+    // Shader library linked into every wallpaper, so calls into it are costed too
+    std::string libraryPath = "lib/common.glsl";
+    std::vector<std::string> paths;
+};
+
+static bool ParseArguments(int argc, char** argv, EstimateOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--width" && hasValue) {
+            options->width = std::atoi(argv[++i]);
+        }
+        else if (arg == "--height" && hasValue) {
+            options->height = std::atoi(argv[++i]);
+        }
+        else if (arg == "--budget" && hasValue) {
+            options->budgetMilliseconds = std::atof(argv[++i]);
+        }
+        else if (arg == "--gigaops" && hasValue) {
+            options->gigaOps = std::atof(argv[++i]);
+        }
+        else if (arg == "--library" && hasValue) {
+            options->libraryPath = argv[++i];
+        }
+        else if (arg.starts_with("--")) {
+            return false;
+        }
+        else {
+            options->paths.push_back(arg);
+        }
+    }
+    return !options->paths.empty() && options->width > 0 && options->height > 0 && options->gigaOps > 0.0;
+}
+
+// Returns false if the tier is over budget
+static bool PrintEstimate(const EstimateOptions& options, const std::string& label, const ShaderCost& cost)
+{
+    double milliseconds = PredictFrameMilliseconds(cost, options.width, options.height, options.gigaOps);
+    bool withinBudget = milliseconds <= options.budgetMilliseconds;
+    std::printf("  %-12s %8.0f ops  alu %8.0f  transcendental %6.0f  texture %5.0f  branch %5.0f  loop iterations %6.0f  %7.2f ms %s\n",
+        label.c_str(), cost.TotalOps(), cost.aluOps, cost.transcendentalCalls, cost.textureFetches, cost.branches,
+        cost.loopIterations, milliseconds, withinBudget ? "" : "OVER BUDGET");
+    return withinBudget;
+}
+
+int main(int argc, char** argv) {
+    Log::Init();
+
+    EstimateOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::fprintf(stderr, "Usage: WallpaperCost [--width W] [--height H] [--budget MS] [--gigaops G] [--library PATH] <file.wallpaper>...\n");
+        return EXIT_FAILURE;
+    }
+
+    std::string librarySource;
+    std::ifstream library(options.libraryPath);
+    if (library.fail()) {
+        LOG_WARNING("Shader library {} not found, calls into it will be costed as single ops", options.libraryPath);
+    }
+    else {
+        std::stringstream ss;
+        ss << library.rdbuf();
+        librarySource = "\n" + ss.str();
+    }
+
+    std::printf("Predicting at %dx%d, %.0f GOP/s, %.1f ms budget\n", options.width, options.height, options.gigaOps, options.budgetMilliseconds);
+
+    bool success = true;
+    for (const std::string& path : options.paths) {
+        WallpaperSources sources{};
+        if (!ParseWallpaperSource(path, &sources)) {
+            success = false;
+            continue;
+        }
+        std::printf("%s\n", path.c_str());
+
+        std::string define;
+        std::vector<std::string> tiers;
+        try {
+            YAML::Node quality = YAML::Load(sources.metadataYamlSource)["quality"];
+            if (quality) {
+                define = quality["define"].as<std::string>();
+                tiers = quality["tiers"].as<std::vector<std::string>>();
+            }
+        }
+        catch (const YAML::Exception& e) {
+            LOG_ERROR("{}: {}", path, e.what());
+            success = false;
+            continue;
+        }
+
+        if (tiers.empty()) {
+            success &= PrintEstimate(options, "default", EstimateShaderCost(sources.fragmentShaderSource + librarySource));
+        }
+        for (size_t tier = 0; tier < tiers.size(); tier++) {
+            ShaderCost cost = EstimateShaderCost(sources.fragmentShaderSource + librarySource, { { define, std::to_string(tier) } });
+            success &= PrintEstimate(options, tiers[tier], cost);
+        }
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
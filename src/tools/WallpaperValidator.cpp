@@ -0,0 +1,424 @@
+/*
+Command line tool that checks every wallpaper in a library parses, decodes and compiles before it is rolled out.
+
+Usage: WallpaperValidator [--jobs N] [--report FILE] [--warm-cache] [--cache DIR] [--sandbox] [--timeout SECONDS]
+                          [--vertex PATH] [--library PATH] [--resolution WxH] [--budget MS] <wallpaper or directory>...
+
+Wallpapers are split between N workers, each with a hidden context of its own, and go through the same checks the
+engine makes when loading one: the shader section is preprocessed, the metadata decoded, the texture units counted
+against the GPU's, every quality tier compiled and linked, and the tier it starts at measured by the cost probe at
+the given resolution, 1920x1080 by default, and refused if it is too expensive to show within the budget. With --warm-cache the linked programs are saved to the program cache so the engine loads them instead
+of compiling on first use, otherwise nothing is read from or written to the cache. With --sandbox every program is
+built in one of N shader worker processes the way the engine does, so a wallpaper that hangs or crashes the driver
+fails with a timeout or a crash instead of taking the validator down. A JSON report of every wallpaper with its
+failure and timings is written to FILE. The exit code is non zero if any wallpaper fails.
+*/
+
+#include <gl.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opengl/CostProbe.hpp>
+#include <opengl/ProgramBuilder.hpp>
+#include <opengl/ShaderSandbox.hpp>
+#include <opengl/TextureUnits.hpp>
+#include <opengl/WallpaperMetadata.hpp>
+#include <util/Log.hpp>
+#include <util/ShaderCost.hpp>
+#include <util/Timing.hpp>
+#include <util/WallpaperFile.hpp>
+
+struct ValidateOptions {
+    size_t jobs = 0;
+    std::string reportPath;
+    bool warmCache = false;
+    std::string cacheDirectory = DEFAULT_PROGRAM_CACHE_DIRECTORY;
+    bool sandbox = false;
+    double timeoutSeconds = DEFAULT_SHADER_TIMEOUT_SECONDS;
+    std::string vertexPath = DEFAULT_VERTEX_SHADER_PATH;
+    std::string libraryPath = DEFAULT_LIBRARY_SHADER_PATH;
+    WindowDimensions resolution{ 1920, 1080 };
+    double budgetMilliseconds = DEFAULT_COST_BUDGET_MS;
+    std::vector<std::string> paths;
+};
+
+struct ValidationResult {
+    std::string path;
+    // Empty if the wallpaper passed, otherwise the step it failed at and why
+    std::string failedStage;
+    std::string error;
+    size_t programs = 0;
+    size_t cachedPrograms = 0;
+    double parseMilliseconds = 0.0;
+    double compileMilliseconds = 0.0;
+    // Measured by the cost probe at the full resolution, 0 if it could not be
+    double frameMilliseconds = 0.0;
+    size_t worker = 0;
+};
+
+static bool ParseArguments(int argc, char** argv, ValidateOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--jobs" && hasValue) {
+            options->jobs = static_cast<size_t>(std::max(std::atoi(argv[++i]), 1));
+        }
+        else if (arg == "--report" && hasValue) {
+            options->reportPath = argv[++i];
+        }
+        else if (arg == "--warm-cache") {
+            options->warmCache = true;
+        }
+        else if (arg == "--cache" && hasValue) {
+            options->cacheDirectory = argv[++i];
+        }
+        else if (arg == "--sandbox") {
+            options->sandbox = true;
+        }
+        else if (arg == "--timeout" && hasValue) {
+            options->timeoutSeconds = std::max(std::atof(argv[++i]), 0.1);
+        }
+        else if (arg == "--vertex" && hasValue) {
+            options->vertexPath = argv[++i];
+        }
+        else if (arg == "--library" && hasValue) {
+            options->libraryPath = argv[++i];
+        }
+        else if (arg == "--resolution" && hasValue) {
+            WindowDimensions& resolution = options->resolution;
+            if (std::sscanf(argv[++i], "%dx%d", &resolution.width, &resolution.height) != 2 || resolution.width <= 0 || resolution.height <= 0) {
+                return false;
+            }
+        }
+        else if (arg == "--budget" && hasValue) {
+            options->budgetMilliseconds = std::max(std::atof(argv[++i]), 0.1);
+        }
+        else if (arg.starts_with("--")) {
+            return false;
+        }
+        else {
+            options->paths.push_back(arg);
+        }
+    }
+    return !options->paths.empty();
+}
+
+static void AddWallpaper(const std::filesystem::path& path, std::vector<std::string>* wallpapers)
+{
+    if (path.extension() == ".wallpaper") {
+        wallpapers->push_back(path.string());
+    }
+}
+
+// The steps TrySetWallpaper takes up to putting the program on screen, for every quality tier rather than just the first.
+// Bind makes a program the one the probe draws.
+static ValidationResult ValidateWallpaper(const ProgramBuilder& builder, CostProbe& probe, const std::function<void(GLuint)>& bind,
+    const ValidateOptions& options, const std::string& path)
+{
+    ValidationResult result{};
+    result.path = path;
+    auto start = std::chrono::steady_clock::now();
+    WallpaperSources sources{};
+    if (!ParseWallpaperSource(path, &sources)) {
+        result.failedStage = "parse";
+        result.error = "could not read the wallpaper or resolve its includes";
+        return result;
+    }
+
+    WallpaperMetadata metadata{};
+    std::unordered_map<std::string, Uniform<GLint>> intUniforms;
+    std::unordered_map<std::string, Uniform<GLfloat>> floatUniforms;
+    std::unordered_map<std::string, Uniform<GLboolean>> boolUniforms;
+    if (!sources.metadataYamlSource.empty()) {
+        bool decoded = false;
+        try {
+            decoded = ParseWallpaperMetadata(sources.metadataYamlSource, metadata, intUniforms, floatUniforms, boolUniforms);
+        }
+        catch (const YAML::Exception& e) {
+            result.error = e.what();
+        }
+        if (!decoded) {
+            result.failedStage = "metadata";
+            if (result.error.empty()) {
+                result.error = "metadata did not decode";
+            }
+            return result;
+        }
+    }
+    result.parseMilliseconds = MillisecondsSince(start);
+
+    if (!CheckTextureUnits(metadata, sources.fragmentShaderSource, &result.error)) {
+        result.failedStage = "textures";
+        return result;
+    }
+
+    start = std::chrono::steady_clock::now();
+    size_t tierCount = std::max<size_t>(metadata.quality.tiers.size(), 1);
+    size_t initialTier = metadata.quality.tiers.empty() ? 0 : static_cast<size_t>(metadata.quality.defaultTier);
+    for (size_t tier = 0; tier < tierCount; tier++) {
+        std::string source = sources.fragmentShaderSource;
+        if (!metadata.quality.tiers.empty()) {
+            source = InjectDefine(source, metadata.quality.define, std::to_string(tier));
+        }
+        bool cached = false;
+        std::string log;
+        GLuint program = builder.BuildProgram(source, &sources.shaderFiles, &log, &cached);
+        if (program == 0) {
+            result.failedStage = metadata.quality.tiers.empty() ? "compile" : "compile " + metadata.quality.tiers[tier];
+            result.error = log;
+            break;
+        }
+        if (tier == initialTier) {
+            // As at load, a wallpaper the probe could not measure is let through on the static estimate
+            CostProbeResult cost = probe.MeasureProgram(program, options.resolution, bind, intUniforms, floatUniforms, boolUniforms);
+            float renderScale = 1.0f;
+            int frameCap = 0;
+            double scaledMilliseconds = 0.0;
+            if (cost.measured) {
+                result.frameMilliseconds = cost.fullMilliseconds;
+                if (!PickRenderSettings(cost, options.resolution, options.budgetMilliseconds, &renderScale, &frameCap, &scaledMilliseconds)) {
+                    char error[128];
+                    std::snprintf(error, sizeof(error), "measured at %.1f ms per frame, %.1f ms even at %.0f%% resolution",
+                        cost.fullMilliseconds, scaledMilliseconds, renderScale * 100.0f);
+                    result.failedStage = "cost";
+                    result.error = error;
+                    glDeleteProgram(program);
+                    break;
+                }
+            }
+        }
+        glDeleteProgram(program);
+        result.programs++;
+        result.cachedPrograms += cached ? 1 : 0;
+    }
+    result.compileMilliseconds = MillisecondsSince(start);
+    return result;
+}
+
+static std::string EscapeJson(const std::string& value)
+{
+    std::string escaped;
+    for (char c : value) {
+        switch (c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\r':
+            escaped += "\\r";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+static bool WriteReport(const std::string& path, const std::vector<ValidationResult>& results, size_t jobs, double seconds, const std::string& renderer)
+{
+    std::ofstream stream(path, std::ios::trunc);
+    if (stream.fail()) {
+        LOG_ERROR("Could not create report {}", path);
+        return false;
+    }
+    size_t failed = static_cast<size_t>(std::count_if(results.begin(), results.end(), [](const ValidationResult& result) {
+        return !result.failedStage.empty();
+    }));
+    char timing[64];
+    std::snprintf(timing, sizeof(timing), "%.3f", seconds);
+    stream << "{\n  \"renderer\": \"" << EscapeJson(renderer) << "\",\n  \"jobs\": " << jobs << ",\n  \"seconds\": " << timing
+        << ",\n  \"wallpapers\": " << results.size() << ",\n  \"failed\": " << failed << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const ValidationResult& result = results[i];
+        char timings[128];
+        std::snprintf(timings, sizeof(timings), "\"parseMs\": %.3f, \"compileMs\": %.3f, \"frameMs\": %.3f", result.parseMilliseconds,
+            result.compileMilliseconds, result.frameMilliseconds);
+        stream << "    { \"path\": \"" << EscapeJson(result.path) << "\", \"ok\": " << (result.failedStage.empty() ? "true" : "false")
+            << ", \"stage\": \"" << EscapeJson(result.failedStage) << "\", \"error\": \"" << EscapeJson(result.error)
+            << "\", \"programs\": " << result.programs << ", \"cachedPrograms\": " << result.cachedPrograms << ", " << timings
+            << ", \"worker\": " << result.worker << " }" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    stream << "  ]\n}\n";
+    return static_cast<bool>(stream);
+}
+
+static bool ValidateLibrary(const ValidateOptions& options)
+{
+    std::vector<std::string> wallpapers;
+    for (const std::string& path : options.paths) {
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+                AddWallpaper(entry.path(), &wallpapers);
+            }
+        }
+        else {
+            AddWallpaper(path, &wallpapers);
+        }
+    }
+    if (wallpapers.empty()) {
+        LOG_ERROR("No wallpapers found");
+        return false;
+    }
+
+    // GLFW only creates windows on the main thread, each worker then makes its own context current
+    size_t jobs = options.jobs > 0 ? options.jobs : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    jobs = std::min(jobs, wallpapers.size());
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    std::vector<GLFWwindow*> windows;
+    for (size_t i = 0; i < jobs; i++) {
+        GLFWwindow* window = glfwCreateWindow(1, 1, "WallpaperValidator", NULL, NULL);
+        if (window == NULL) {
+            break;
+        }
+        windows.push_back(window);
+    }
+    if (windows.empty()) {
+        LOG_ERROR("Failed to create a hidden window");
+        return false;
+    }
+    glfwMakeContextCurrent(windows.front());
+    if (!gladLoadGL(static_cast<GLADloadfunc>(glfwGetProcAddress))) {
+        LOG_ERROR("Failed to initialise GLAD");
+        for (GLFWwindow* window : windows) {
+            glfwDestroyWindow(window);
+        }
+        return false;
+    }
+    std::string renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    glfwMakeContextCurrent(NULL);
+    std::printf("Validating %zu wallpapers with %zu worker(s) on %s\n", wallpapers.size(), windows.size(), renderer.c_str());
+
+    std::vector<ValidationResult> results(wallpapers.size());
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> setupFailed = false;
+    std::string cacheDirectory = options.warmCache ? options.cacheDirectory : std::string();
+    // One shader worker per job, started with this executable
+    std::unique_ptr<ShaderSandbox> sandbox = nullptr;
+    if (options.sandbox) {
+        sandbox = std::make_unique<ShaderSandbox>(GetExecutablePath(), options.vertexPath, options.libraryPath, windows.size(),
+            options.timeoutSeconds);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t worker = 0; worker < windows.size(); worker++) {
+        workers.emplace_back([&, worker]() {
+            glfwMakeContextCurrent(windows[worker]);
+            try {
+                ProgramBuilder builder(options.vertexPath, options.libraryPath, cacheDirectory, sandbox.get());
+                CostProbe probe;
+                // Bound the way WallpaperManager binds its programs, through a pipeline with the builder's vertex program if it has one
+                GLuint pipeline = 0;
+                if (builder.UsesSeparablePrograms()) {
+                    glGenProgramPipelines(1, &pipeline);
+                    glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, builder.GetVertexProgram());
+                    glBindProgramPipeline(pipeline);
+                }
+                auto bind = [pipeline](GLuint program) {
+                    if (pipeline != 0) {
+                        glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, program);
+                        glActiveShaderProgram(pipeline, program);
+                    }
+                    else {
+                        glUseProgram(program);
+                    }
+                };
+                for (size_t i = next++; i < wallpapers.size(); i = next++) {
+                    results[i] = ValidateWallpaper(builder, probe, bind, options, wallpapers[i]);
+                    results[i].worker = worker;
+                }
+                glDeleteProgramPipelines(1, &pipeline);
+            }
+            catch (const std::runtime_error& e) {
+                LOG_ERROR(e.what());
+                setupFailed = true;
+            }
+            glfwMakeContextCurrent(NULL);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (GLFWwindow* window : windows) {
+        glfwDestroyWindow(window);
+    }
+    if (setupFailed) {
+        return false;
+    }
+
+    size_t failed = 0;
+    size_t programs = 0;
+    size_t cachedPrograms = 0;
+    for (const ValidationResult& result : results) {
+        programs += result.programs;
+        cachedPrograms += result.cachedPrograms;
+        if (!result.failedStage.empty()) {
+            std::printf("FAILED %s (%s)\n", result.path.c_str(), result.failedStage.c_str());
+            failed++;
+        }
+    }
+    std::printf("%zu of %zu wallpapers passed, %zu programs (%zu from the cache) in %.2f s, %.1f wallpapers/s\n", results.size() - failed,
+        results.size(), programs, cachedPrograms, seconds, static_cast<double>(results.size()) / seconds);
+    if (sandbox != nullptr) {
+        ShaderSandboxStats sandboxStats = sandbox->GetStats();
+        std::printf("Shader sandbox: %zu workers started, %zu built, %zu failed, %zu timed out, %zu crashed, slowest %.1f ms\n",
+            sandboxStats.workersStarted, sandboxStats.compiled, sandboxStats.failed, sandboxStats.timedOut, sandboxStats.crashed,
+            sandboxStats.slowestMilliseconds);
+    }
+    if (!options.reportPath.empty() && !WriteReport(options.reportPath, results, windows.size(), seconds, renderer)) {
+        return false;
+    }
+    return failed == 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string(argv[1]) == SHADER_WORKER_ARGUMENT) {
+        return RunShaderWorker(argc, argv);
+    }
+    Log::Init();
+    ValidateOptions options{};
+    if (!ParseArguments(argc, argv, &options)) {
+        std::printf("Usage: WallpaperValidator [--jobs N] [--report FILE] [--warm-cache] [--cache DIR] [--sandbox] [--timeout SECONDS] "
+            "[--vertex PATH] [--library PATH] [--resolution WxH] [--budget MS] <wallpaper or directory>...\n");
+        return EXIT_FAILURE;
+    }
+    if (!glfwInit()) {
+        LOG_ERROR("Failed to initialise GLFW");
+        return EXIT_FAILURE;
+    }
+    bool validated = ValidateLibrary(options);
+    glfwTerminate();
+    return validated ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+#include <util/Atlas.hpp>
+#include <algorithm>
+#include <cstring>
+#include <util/Log.hpp>
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <imstb_rectpack.h>
+
+double AtlasLayout::GetEfficiency() const
+{
+    size_t imageTexels = 0;
+    for (const AtlasRect& rect : rects) {
+        imageTexels += static_cast<size_t>(rect.width) * static_cast<size_t>(rect.height);
+    }
+    size_t pageTexels = 0;
+    for (const AtlasPage& page : pages) {
+        pageTexels += static_cast<size_t>(page.width) * static_cast<size_t>(page.height);
+    }
+    return pageTexels == 0 ? 0.0 : static_cast<double>(imageTexels) / static_cast<double>(pageTexels);
+}
+
+static int RoundUp(int value, int multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+bool PackAtlas(const std::vector<Image>& images, AtlasLayout* layout, int maxSize, int maxPages, int gutter)
+{
+    // A gutter of g texels still covers a whole texel after floor(log2(g)) halvings, as long as every image
+    // starts on a multiple of the texel size at that level
+    layout->levelCount = 1;
+    while ((1 << layout->levelCount) <= gutter) {
+        layout->levelCount++;
+    }
+    int alignment = 1 << (layout->levelCount - 1);
+
+    // Rects are packed in units of the alignment so that every position comes out aligned
+    std::vector<stbrp_rect> remaining;
+    size_t paddedArea = 0;
+    for (size_t i = 0; i < images.size(); i++) {
+        int width = RoundUp(images[i].width + gutter * 2, alignment);
+        int height = RoundUp(images[i].height + gutter * 2, alignment);
+        if (width > maxSize || height > maxSize) {
+            LOG_ERROR("{}x{} image is too big for a {}x{} atlas page", images[i].width, images[i].height, maxSize, maxSize);
+            return false;
+        }
+        stbrp_rect rect{};
+        rect.id = static_cast<int>(i);
+        rect.w = width / alignment;
+        rect.h = height / alignment;
+        remaining.push_back(rect);
+        paddedArea += static_cast<size_t>(width) * static_cast<size_t>(height);
+    }
+
+    layout->rects.assign(images.size(), AtlasRect{});
+    layout->pages.clear();
+    while (!remaining.empty()) {
+        if (static_cast<int>(layout->pages.size()) == maxPages) {
+            LOG_ERROR("{} images did not fit in {} {}x{} atlas pages", remaining.size(), maxPages, maxSize, maxSize);
+            return false;
+        }
+        // Start from the smallest square that could hold what is left and grow until it fits or hits the limit
+        int size = alignment;
+        while (size < maxSize && static_cast<size_t>(size) * static_cast<size_t>(size) < paddedArea) {
+            size *= 2;
+        }
+        size = std::min(size, maxSize);
+        std::vector<stbrp_node> nodes(static_cast<size_t>(size / alignment));
+        while (true) {
+            stbrp_context context{};
+            stbrp_init_target(&context, size / alignment, size / alignment, nodes.data(), static_cast<int>(nodes.size()));
+            for (stbrp_rect& rect : remaining) {
+                rect.was_packed = 0;
+            }
+            if (stbrp_pack_rects(&context, remaining.data(), static_cast<int>(remaining.size())) == 1 || size >= maxSize) {
+                break;
+            }
+            size = std::min(size * 2, maxSize);
+            nodes.resize(static_cast<size_t>(size / alignment));
+        }
+
+        // The page is cut off below the last row in use
+        AtlasPage page{ size, 0 };
+        std::vector<stbrp_rect> leftOver;
+        for (const stbrp_rect& rect : remaining) {
+            if (!rect.was_packed) {
+                leftOver.push_back(rect);
+                continue;
+            }
+            const Image& image = images[static_cast<size_t>(rect.id)];
+            layout->rects[static_cast<size_t>(rect.id)] = AtlasRect{ static_cast<int>(layout->pages.size()),
+                rect.x * alignment + gutter, rect.y * alignment + gutter, image.width, image.height };
+            page.height = std::max(page.height, (rect.y + rect.h) * alignment);
+            paddedArea -= static_cast<size_t>(rect.w) * static_cast<size_t>(rect.h) * static_cast<size_t>(alignment * alignment);
+        }
+        if (leftOver.size() == remaining.size()) {
+            LOG_ERROR("Atlas packing made no progress with {} images left", remaining.size());
+            return false;
+        }
+        layout->pages.push_back(page);
+        remaining = std::move(leftOver);
+    }
+    return true;
+}
+
+std::vector<Image> BuildAtlasPages(const std::vector<Image>& images, const AtlasLayout& layout, int gutter)
+{
+    std::vector<Image> pages(layout.pages.size());
+    for (size_t i = 0; i < pages.size(); i++) {
+        pages[i].width = layout.pages[i].width;
+        pages[i].height = layout.pages[i].height;
+        pages[i].pixels.assign(pages[i].RowBytes() * static_cast<size_t>(pages[i].height), 0);
+    }
+    for (size_t i = 0; i < images.size(); i++) {
+        const Image& image = images[i];
+        const AtlasRect& rect = layout.rects[i];
+        Image& page = pages[static_cast<size_t>(rect.page)];
+        // Every gutter texel repeats the nearest edge texel of the image, so filtering at the edge sees the image
+        for (int y = -gutter; y < image.height + gutter; y++) {
+            int sourceY = std::clamp(y, 0, image.height - 1);
+            const unsigned char* source = image.pixels.data() + image.RowBytes() * static_cast<size_t>(sourceY);
+            unsigned char* destination = page.pixels.data() + page.RowBytes() * static_cast<size_t>(rect.y + y);
+            for (int x = -gutter; x < image.width + gutter; x++) {
+                int sourceX = std::clamp(x, 0, image.width - 1);
+                std::memcpy(destination + static_cast<size_t>(rect.x + x) * Image::CHANNELS, source + static_cast<size_t>(sourceX) * Image::CHANNELS, Image::CHANNELS);
+            }
+        }
+    }
+    return pages;
+}
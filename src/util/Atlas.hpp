@@ -0,0 +1,47 @@
+#ifndef ATLAS_HPP
+#define ATLAS_HPP
+
+#include <cstddef>
+#include <vector>
+#include <util/Image.hpp>
+
+// Largest atlas page, images that don't fit together in one page spill onto more
+constexpr int ATLAS_MAX_SIZE = 2048;
+// Each page takes a texture unit of its own
+constexpr int ATLAS_MAX_PAGES = 4;
+// Edge texels repeated around every image. Images are also aligned so that each stays in texels of its own for
+// as many mip levels as the gutter survives halving, which is how many levels an atlas keeps.
+constexpr int ATLAS_GUTTER = 4;
+
+// Where an image ended up, in texels of its page from the top left, not counting the gutter
+struct AtlasRect {
+    int page = 0;
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+struct AtlasPage {
+    int width = 0;
+    int height = 0;
+};
+
+struct AtlasLayout {
+    // One per packed image, in the order they were given
+    std::vector<AtlasRect> rects;
+    std::vector<AtlasPage> pages;
+    // Mip levels that can be sampled without neighbouring images bleeding in, including the base
+    int levelCount = 1;
+
+    // Fraction of the pages' texels covered by images
+    double GetEfficiency() const;
+};
+
+// Pack images into as few pages as possible, false if any image is too big for a page or they need more than maxPages
+bool PackAtlas(const std::vector<Image>& images, AtlasLayout* layout, int maxSize = ATLAS_MAX_SIZE, int maxPages = ATLAS_MAX_PAGES,
+    int gutter = ATLAS_GUTTER);
+// Copy images into their pages with the gutters filled from each image's edges
+std::vector<Image> BuildAtlasPages(const std::vector<Image>& images, const AtlasLayout& layout, int gutter = ATLAS_GUTTER);
+
+#endif // !ATLAS_HPP
@@ -0,0 +1,101 @@
+#include <util/AudioAnalyzer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+#include <util/Fft.hpp>
+#include <util/Log.hpp>
+
+// Upper frequencies of the bass and mid bands, treble runs from the top of mid to the end of the spectrum
+constexpr float AUDIO_BASS_HZ = 250.0f;
+constexpr float AUDIO_MID_HZ = 4000.0f;
+
+AudioAnalyzer::AudioAnalyzer(std::unique_ptr<AudioSource> source) : pSource(std::move(source))
+{
+    mThread = std::thread(&AudioAnalyzer::AnalyzeLoop, this);
+}
+
+AudioAnalyzer::~AudioAnalyzer()
+{
+    mStopping = true;
+    mThread.join();
+}
+
+const AudioFrame* AudioAnalyzer::Acquire()
+{
+    if ((mMiddle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+        return nullptr;
+    }
+    mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & ~FRESH_BIT;
+    return &mFrames[static_cast<size_t>(mFront)];
+}
+
+// Mean of the spectrum between two frequencies
+static float AverageBand(const std::array<float, AUDIO_SPECTRUM_SIZE>& spectrum, float lowHz, float highHz, int sampleRate)
+{
+    float binHz = static_cast<float>(sampleRate) / AUDIO_FFT_SIZE;
+    size_t first = std::clamp(static_cast<size_t>(lowHz / binHz), size_t{ 1 }, AUDIO_SPECTRUM_SIZE - 1);
+    size_t last = std::clamp(static_cast<size_t>(highHz / binHz), first + 1, AUDIO_SPECTRUM_SIZE);
+    float sum = 0.0f;
+    for (size_t i = first; i < last; i++) {
+        sum += spectrum[i];
+    }
+    return sum / static_cast<float>(last - first);
+}
+
+void AudioAnalyzer::AnalyzeLoop()
+{
+    Fft fft(AUDIO_FFT_SIZE);
+    std::array<float, AUDIO_FFT_SIZE> window{};
+    for (size_t i = 0; i < AUDIO_FFT_SIZE; i++) {
+        window[i] = 0.5f - 0.5f * static_cast<float>(std::cos(2.0 * std::numbers::pi * static_cast<double>(i) / AUDIO_FFT_SIZE));
+    }
+    std::array<float, AUDIO_FFT_SIZE> windowed{};
+    std::array<float, AUDIO_SPECTRUM_SIZE> magnitudes{};
+    std::array<float, AUDIO_SPECTRUM_SIZE> smoothed{};
+    // The newest AUDIO_FFT_SIZE samples, oldest first
+    std::vector<float> history(AUDIO_FFT_SIZE, 0.0f);
+    std::vector<float> samples;
+
+    while (!mStopping) {
+        samples.clear();
+        double captureTime = 0.0;
+        if (!pSource->Read(&samples, &captureTime)) {
+            LOG_ERROR("Audio source failed, audio uniforms will stay silent");
+            break;
+        }
+        if (samples.empty()) {
+            continue;
+        }
+        size_t incoming = std::min(samples.size(), AUDIO_FFT_SIZE);
+        std::copy(history.begin() + static_cast<std::ptrdiff_t>(incoming), history.end(), history.begin());
+        std::copy(samples.end() - static_cast<std::ptrdiff_t>(incoming), samples.end(), history.end() - static_cast<std::ptrdiff_t>(incoming));
+
+        float sumOfSquares = 0.0f;
+        for (size_t i = 0; i < AUDIO_FFT_SIZE; i++) {
+            windowed[i] = history[i] * window[i];
+            sumOfSquares += history[i] * history[i];
+        }
+        fft.Forward(windowed.data(), magnitudes.data());
+
+        AudioFrame& frame = mFrames[static_cast<size_t>(mBack)];
+        for (size_t i = 0; i < AUDIO_SPECTRUM_SIZE; i++) {
+            smoothed[i] = AUDIO_SMOOTHING * smoothed[i] + (1.0f - AUDIO_SMOOTHING) * magnitudes[i] / AUDIO_FFT_SIZE;
+            float decibels = 20.0f * std::log10(std::max(smoothed[i], 1e-12f));
+            frame.spectrum[i] = std::clamp((decibels - AUDIO_MIN_DECIBELS) / (AUDIO_MAX_DECIBELS - AUDIO_MIN_DECIBELS), 0.0f, 1.0f);
+        }
+        for (size_t i = 0; i < AUDIO_WAVEFORM_SIZE; i++) {
+            frame.waveform[i] = std::clamp(0.5f + 0.5f * history[AUDIO_FFT_SIZE - AUDIO_WAVEFORM_SIZE + i], 0.0f, 1.0f);
+        }
+        int sampleRate = pSource->GetSampleRate();
+        frame.bands[0] = AverageBand(frame.spectrum, 0.0f, AUDIO_BASS_HZ, sampleRate);
+        frame.bands[1] = AverageBand(frame.spectrum, AUDIO_BASS_HZ, AUDIO_MID_HZ, sampleRate);
+        frame.bands[2] = AverageBand(frame.spectrum, AUDIO_MID_HZ, static_cast<float>(sampleRate) / 2.0f, sampleRate);
+        frame.bands[3] = std::sqrt(sumOfSquares / AUDIO_FFT_SIZE);
+        frame.captureTime = captureTime;
+
+        mBack = mMiddle.exchange(mBack | FRESH_BIT, std::memory_order_acq_rel) & ~FRESH_BIT;
+    }
+    // Sources are destroyed on the thread that read them, see AudioSource
+    pSource.reset();
+}
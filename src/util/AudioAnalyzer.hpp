@@ -0,0 +1,65 @@
+#ifndef AUDIO_ANALYZER_HPP
+#define AUDIO_ANALYZER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <util/AudioSource.hpp>
+
+// Samples in each transform, giving half as many spectrum bins
+constexpr size_t AUDIO_FFT_SIZE = 1024;
+constexpr size_t AUDIO_SPECTRUM_SIZE = AUDIO_FFT_SIZE / 2;
+constexpr size_t AUDIO_WAVEFORM_SIZE = 512;
+// Weight kept from the previous spectrum each analysis, as with the web audio analyser node
+constexpr float AUDIO_SMOOTHING = 0.8f;
+// Decibel range mapped onto 0 to 1 in the spectrum
+constexpr float AUDIO_MIN_DECIBELS = -100.0f;
+constexpr float AUDIO_MAX_DECIBELS = -30.0f;
+
+/*
+One analysis of the newest audio. Spectrum and waveform are in 0 to 1, the waveform centred on 0.5.
+*/
+struct AudioFrame {
+    std::array<float, AUDIO_SPECTRUM_SIZE> spectrum{};
+    std::array<float, AUDIO_WAVEFORM_SIZE> waveform{};
+    // Average bass, mid and treble spectrum levels and the RMS volume
+    std::array<float, 4> bands{};
+    // When the newest sample in the analysis was captured, on GetAudioClock
+    double captureTime = 0.0;
+};
+
+/*
+Reads a source on a thread of its own and runs a windowed FFT over the latest samples every time more arrive.
+Results go through a triple buffer, so the analysis never waits on the render thread or the other way around:
+the writer fills its own frame then swaps it with the shared middle one, and the reader swaps the middle one for
+its own only when the writer has published since.
+*/
+class AudioAnalyzer {
+private:
+    // Set alongside the middle frame's index when it holds a frame the reader hasn't seen
+    static constexpr int FRESH_BIT = 4;
+
+    std::unique_ptr<AudioSource> pSource = nullptr;
+    std::array<AudioFrame, 3> mFrames{};
+    int mBack = 0;
+    std::atomic<int> mMiddle = 1;
+    int mFront = 2;
+    std::atomic<bool> mStopping = false;
+    std::thread mThread;
+
+    void AnalyzeLoop();
+public:
+    AudioAnalyzer(std::unique_ptr<AudioSource> source);
+    ~AudioAnalyzer();
+    // The newest frame if one was published since the last call, otherwise nullptr. Only one thread may call this.
+    const AudioFrame* Acquire();
+
+    AudioAnalyzer(const AudioAnalyzer& arg) = delete;
+    AudioAnalyzer(const AudioAnalyzer&& arg) = delete;
+    AudioAnalyzer& operator=(const AudioAnalyzer& arg) = delete;
+    AudioAnalyzer& operator=(const AudioAnalyzer&& arg) = delete;
+};
+
+#endif // !AUDIO_ANALYZER_HPP
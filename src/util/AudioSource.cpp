@@ -0,0 +1,263 @@
+#include <util/AudioSource.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <util/Image.hpp>
+#include <util/Log.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mmreg.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#endif
+
+// How long a read waits for more audio when there is none
+constexpr std::chrono::milliseconds AUDIO_POLL_INTERVAL(5);
+
+double GetAudioClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename T>
+static T ReadLittleEndian(const unsigned char* data)
+{
+    T value{};
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+bool WavFileSource::Open(const std::string& path)
+{
+    std::vector<unsigned char> bytes;
+    if (!ReadFileBytes(path, &bytes)) {
+        return false;
+    }
+    if (bytes.size() < 12 || std::memcmp(bytes.data(), "RIFF", 4) != 0 || std::memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+        LOG_ERROR("{} is not a wav file", path);
+        return false;
+    }
+
+    uint16_t format = 0;
+    uint16_t channels = 0;
+    uint16_t bitsPerSample = 0;
+    const unsigned char* data = nullptr;
+    size_t dataSize = 0;
+    size_t offset = 12;
+    while (offset + 8 <= bytes.size()) {
+        const unsigned char* chunk = bytes.data() + offset;
+        size_t chunkSize = std::min<size_t>(ReadLittleEndian<uint32_t>(chunk + 4), bytes.size() - offset - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+            format = ReadLittleEndian<uint16_t>(chunk + 8);
+            channels = ReadLittleEndian<uint16_t>(chunk + 10);
+            mSampleRate = static_cast<int>(ReadLittleEndian<uint32_t>(chunk + 12));
+            bitsPerSample = ReadLittleEndian<uint16_t>(chunk + 22);
+            // Extensible formats keep the real format tag at the start of the sub format GUID
+            if (format == 0xFFFE && chunkSize >= 40) {
+                format = ReadLittleEndian<uint16_t>(chunk + 32);
+            }
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0) {
+            data = chunk + 8;
+            dataSize = chunkSize;
+        }
+        // Chunks are padded to an even size
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    bool pcm16 = format == 1 && bitsPerSample == 16;
+    bool float32 = format == 3 && bitsPerSample == 32;
+    if (data == nullptr || channels == 0 || mSampleRate <= 0 || (!pcm16 && !float32)) {
+        LOG_ERROR("{} must be 16 bit PCM or 32 bit float", path);
+        return false;
+    }
+
+    // Mixed down to mono, which is all the analysis uses
+    size_t frameBytes = static_cast<size_t>(channels) * bitsPerSample / 8;
+    size_t frames = dataSize / frameBytes;
+    mSamples.resize(frames);
+    for (size_t frame = 0; frame < frames; frame++) {
+        float sum = 0.0f;
+        for (uint16_t channel = 0; channel < channels; channel++) {
+            const unsigned char* sample = data + frame * frameBytes + channel * bitsPerSample / 8;
+            sum += pcm16 ? ReadLittleEndian<int16_t>(sample) * (1.0f / 32768.0f) : ReadLittleEndian<float>(sample);
+        }
+        mSamples[frame] = sum / channels;
+    }
+    if (mSamples.empty()) {
+        LOG_ERROR("{} has no samples", path);
+        return false;
+    }
+    LOG_INFO("Opened {} with {} Hz audio, {:.1f} seconds long", path, mSampleRate, static_cast<double>(frames) / mSampleRate);
+    return true;
+}
+
+bool WavFileSource::Read(std::vector<float>* samples, double* captureTime)
+{
+    std::this_thread::sleep_for(AUDIO_POLL_INTERVAL);
+    double now = GetAudioClock();
+    if (mStartTime < 0.0) {
+        mStartTime = now;
+    }
+    // A sample counts as captured at the moment it would have been played
+    size_t due = static_cast<size_t>((now - mStartTime) * mSampleRate);
+    for (; mPlayed < due; mPlayed++) {
+        samples->push_back(mSamples[mPlayed % mSamples.size()]);
+    }
+    *captureTime = mStartTime + static_cast<double>(mPlayed) / mSampleRate;
+    return true;
+}
+
+int WavFileSource::GetSampleRate() const
+{
+    return mSampleRate;
+}
+
+#ifdef _WIN32
+template<typename T>
+static void SafeRelease(T** object)
+{
+    if (*object != nullptr) {
+        (*object)->Release();
+        *object = nullptr;
+    }
+}
+
+LoopbackCaptureSource::~LoopbackCaptureSource()
+{
+    if (mStarted) {
+        pClient->Stop();
+    }
+    SafeRelease(&pCapture);
+    SafeRelease(&pClient);
+    SafeRelease(&pDevice);
+    if (mComInitialized) {
+        CoUninitialize();
+    }
+}
+
+bool LoopbackCaptureSource::Start()
+{
+    HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    mComInitialized = SUCCEEDED(result);
+    IMMDeviceEnumerator* enumerator = nullptr;
+    result = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator), reinterpret_cast<void**>(&enumerator));
+    if (FAILED(result)) {
+        LOG_ERROR("Failed to create audio device enumerator: {:#x}", static_cast<unsigned long>(result));
+        return false;
+    }
+    result = enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &pDevice);
+    SafeRelease(&enumerator);
+    if (FAILED(result)) {
+        LOG_ERROR("No default audio output device to capture: {:#x}", static_cast<unsigned long>(result));
+        return false;
+    }
+    result = pDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, reinterpret_cast<void**>(&pClient));
+    if (FAILED(result)) {
+        LOG_ERROR("Failed to activate audio client: {:#x}", static_cast<unsigned long>(result));
+        return false;
+    }
+
+    WAVEFORMATEX* format = nullptr;
+    if (FAILED(pClient->GetMixFormat(&format))) {
+        LOG_ERROR("Failed to get audio mix format");
+        return false;
+    }
+    mSampleRate = static_cast<int>(format->nSamplesPerSec);
+    mChannels = format->nChannels;
+    WORD formatTag = format->wFormatTag;
+    if (formatTag == WAVE_FORMAT_EXTENSIBLE) {
+        // KSDATAFORMAT sub format GUIDs start with the plain format tag
+        formatTag = static_cast<WORD>(reinterpret_cast<WAVEFORMATEXTENSIBLE*>(format)->SubFormat.Data1);
+    }
+    mFloatSamples = formatTag == WAVE_FORMAT_IEEE_FLOAT && format->wBitsPerSample == 32;
+    bool pcm16 = formatTag == WAVE_FORMAT_PCM && format->wBitsPerSample == 16;
+    if (!mFloatSamples && !pcm16) {
+        LOG_ERROR("Unsupported audio mix format with {} bit samples", format->wBitsPerSample);
+        CoTaskMemFree(format);
+        return false;
+    }
+
+    // 20ms buffer in 100ns units, the shortest shared mode reliably gives
+    result = pClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK, 200000, 0, format, nullptr);
+    CoTaskMemFree(format);
+    if (FAILED(result)) {
+        LOG_ERROR("Failed to initialize loopback capture: {:#x}", static_cast<unsigned long>(result));
+        return false;
+    }
+    result = pClient->GetService(__uuidof(IAudioCaptureClient), reinterpret_cast<void**>(&pCapture));
+    if (FAILED(result) || FAILED(pClient->Start())) {
+        LOG_ERROR("Failed to start loopback capture: {:#x}", static_cast<unsigned long>(result));
+        return false;
+    }
+    mStarted = true;
+    LOG_INFO("Capturing system audio at {} Hz with {} channels", mSampleRate, mChannels);
+    return true;
+}
+
+bool LoopbackCaptureSource::Read(std::vector<float>* samples, double* captureTime)
+{
+    if (!mStarted && !Start()) {
+        return false;
+    }
+
+    UINT32 packetFrames = 0;
+    if (FAILED(pCapture->GetNextPacketSize(&packetFrames))) {
+        return false;
+    }
+    if (packetFrames == 0) {
+        std::this_thread::sleep_for(AUDIO_POLL_INTERVAL);
+        return true;
+    }
+    while (packetFrames > 0) {
+        BYTE* data = nullptr;
+        UINT32 frames = 0;
+        DWORD flags = 0;
+        UINT64 devicePosition = 0;
+        UINT64 qpcPosition = 0;
+        if (FAILED(pCapture->GetBuffer(&data, &frames, &flags, &devicePosition, &qpcPosition))) {
+            return false;
+        }
+        for (UINT32 frame = 0; frame < frames; frame++) {
+            float sum = 0.0f;
+            if ((flags & AUDCLNT_BUFFERFLAGS_SILENT) == 0) {
+                for (int channel = 0; channel < mChannels; channel++) {
+                    size_t index = static_cast<size_t>(frame) * mChannels + channel;
+                    sum += mFloatSamples ? reinterpret_cast<const float*>(data)[index] : reinterpret_cast<const int16_t*>(data)[index] * (1.0f / 32768.0f);
+                }
+            }
+            samples->push_back(sum / mChannels);
+        }
+        // The position is the performance counter in 100ns units when the first frame was captured, which is
+        // the same counter steady_clock reads on Windows
+        *captureTime = static_cast<double>(qpcPosition) * 1e-7 + static_cast<double>(frames) / mSampleRate;
+        pCapture->ReleaseBuffer(frames);
+        if (FAILED(pCapture->GetNextPacketSize(&packetFrames))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int LoopbackCaptureSource::GetSampleRate() const
+{
+    return mSampleRate;
+}
+#endif
+
+std::unique_ptr<AudioSource> OpenAudioSource(const std::string& path)
+{
+    if (!path.empty()) {
+        auto source = std::make_unique<WavFileSource>();
+        return source->Open(path) ? std::move(source) : nullptr;
+    }
+#ifdef _WIN32
+    return std::make_unique<LoopbackCaptureSource>();
+#else
+    LOG_ERROR("System audio capture is only supported on Windows");
+    return nullptr;
+#endif
+}
@@ -0,0 +1,72 @@
+#ifndef AUDIO_SOURCE_HPP
+#define AUDIO_SOURCE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+struct IMMDevice;
+struct IAudioClient;
+struct IAudioCaptureClient;
+#endif
+
+// Seconds on the clock audio capture times are measured against
+double GetAudioClock();
+
+/*
+A stream of mono samples. Sources are read and destroyed on the analysis thread, so any that need per thread
+setup do it on the first read.
+*/
+class AudioSource {
+public:
+    virtual ~AudioSource() = default;
+    // Append samples that have arrived since the last call, waiting a few milliseconds if there are none yet.
+    // captureTime is set to when the newest sample was captured. Returns false if the source has failed.
+    virtual bool Read(std::vector<float>* samples, double* captureTime) = 0;
+    // Only known once a read has succeeded for sources that start lazily
+    virtual int GetSampleRate() const = 0;
+};
+
+/*
+16 bit PCM or 32 bit float .wav file played back in real time on a loop, for testing without a capture device
+*/
+class WavFileSource : public AudioSource {
+private:
+    std::vector<float> mSamples;
+    int mSampleRate = 0;
+    double mStartTime = -1.0;
+    size_t mPlayed = 0;
+public:
+    bool Open(const std::string& path);
+    bool Read(std::vector<float>* samples, double* captureTime) override;
+    int GetSampleRate() const override;
+};
+
+#ifdef _WIN32
+/*
+Whatever the default output device is playing, captured through WASAPI loopback in shared mode
+*/
+class LoopbackCaptureSource : public AudioSource {
+private:
+    IMMDevice* pDevice = nullptr;
+    IAudioClient* pClient = nullptr;
+    IAudioCaptureClient* pCapture = nullptr;
+    int mSampleRate = 0;
+    int mChannels = 0;
+    bool mFloatSamples = true;
+    bool mStarted = false;
+    bool mComInitialized = false;
+
+    bool Start();
+public:
+    ~LoopbackCaptureSource() override;
+    bool Read(std::vector<float>* samples, double* captureTime) override;
+    int GetSampleRate() const override;
+};
+#endif
+
+// Open a .wav file, or capture system audio if path is empty
+std::unique_ptr<AudioSource> OpenAudioSource(const std::string& path);
+
+#endif // !AUDIO_SOURCE_HPP
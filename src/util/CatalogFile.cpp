@@ -0,0 +1,199 @@
+#include <util/CatalogFile.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <util/Log.hpp>
+#include <util/MappedFile.hpp>
+
+static const char CATALOG_FILE_MAGIC[4] = { 'W', 'P', 'C', 'T' };
+// Two empty strings, the hash, time, size, valid flag and uniform count, the least any entry takes
+constexpr size_t CATALOG_MIN_ENTRY_SIZE = 2 * sizeof(uint32_t) + 3 * sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+struct CatalogFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t rootLength;
+};
+
+class CatalogWriter {
+private:
+    std::vector<char> mBytes;
+public:
+    template<typename T>
+    void Put(T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        mBytes.insert(mBytes.end(), bytes, bytes + sizeof(T));
+    }
+
+    void PutString(const std::string& value) {
+        Put(static_cast<uint32_t>(value.size()));
+        mBytes.insert(mBytes.end(), value.begin(), value.end());
+    }
+
+    const std::vector<char>& GetBytes() const {
+        return mBytes;
+    }
+};
+
+// Reads values out of the mapping in order, every read is bounds checked and a failed read stops all later ones
+class CatalogReader {
+private:
+    const unsigned char* mData = nullptr;
+    size_t mSize = 0;
+    size_t mOffset = 0;
+    bool mFailed = false;
+public:
+    CatalogReader(const unsigned char* data, size_t size) : mData(data), mSize(size) {}
+
+    template<typename T>
+    T Get() {
+        T value{};
+        if (mFailed || mSize - mOffset < sizeof(T)) {
+            mFailed = true;
+            return value;
+        }
+        std::memcpy(&value, mData + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return value;
+    }
+
+    std::string GetString() {
+        uint32_t length = Get<uint32_t>();
+        if (mFailed || mSize - mOffset < length) {
+            mFailed = true;
+            return {};
+        }
+        std::string value(reinterpret_cast<const char*>(mData + mOffset), length);
+        mOffset += length;
+        return value;
+    }
+
+    // Stop all later reads, for values that were read whole but can't be right
+    void Fail() {
+        mFailed = true;
+    }
+
+    bool Failed() const {
+        return mFailed;
+    }
+
+    size_t GetRemaining() const {
+        return mSize - mOffset;
+    }
+
+    bool AtEnd() const {
+        return mOffset == mSize;
+    }
+};
+
+bool WriteCatalogFile(const std::string& path, const std::string& root, const std::vector<CatalogEntry>& entries)
+{
+    CatalogFileHeader header{};
+    std::memcpy(header.magic, CATALOG_FILE_MAGIC, sizeof(header.magic));
+    header.version = CATALOG_FILE_VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.rootLength = static_cast<uint32_t>(root.size());
+
+    CatalogWriter writer;
+    for (const CatalogEntry& entry : entries) {
+        writer.PutString(entry.path);
+        writer.PutString(entry.name);
+        writer.Put(entry.contentHash);
+        writer.Put(entry.modifiedTime);
+        writer.Put(entry.size);
+        writer.Put(static_cast<uint8_t>(entry.valid));
+        writer.Put(static_cast<uint32_t>(entry.uniforms.size()));
+        for (const CatalogUniform& uniform : entry.uniforms) {
+            writer.PutString(uniform.uniform);
+            writer.PutString(uniform.name);
+            writer.Put(static_cast<uint8_t>(uniform.type));
+            writer.Put(uniform.min);
+            writer.Put(uniform.max);
+        }
+    }
+
+    // Written to a temporary file and renamed over the old one so a crash mid write never leaves half a catalog
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (stream.fail()) {
+            LOG_WARNING("Could not create catalog file {}", path);
+            return false;
+        }
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(root.data(), static_cast<std::streamsize>(root.size()));
+        stream.write(writer.GetBytes().data(), static_cast<std::streamsize>(writer.GetBytes().size()));
+        if (!stream) {
+            LOG_WARNING("Could not write catalog file {}", path);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        LOG_WARNING("Could not replace catalog file {}: {}", path, error.message());
+        return false;
+    }
+    return true;
+}
+
+bool ReadCatalogFile(const std::string& path, const std::string& root, std::vector<CatalogEntry>* out)
+{
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+
+    CatalogFileHeader header{};
+    if (file.GetSize() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, CATALOG_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != CATALOG_FILE_VERSION) {
+        return false;
+    }
+    if (file.GetSize() - sizeof(header) < header.rootLength ||
+        root.compare(0, std::string::npos, reinterpret_cast<const char*>(file.GetData() + sizeof(header)), header.rootLength) != 0) {
+        return false;
+    }
+
+    size_t dataOffset = sizeof(header) + header.rootLength;
+    CatalogReader reader(file.GetData() + dataOffset, file.GetSize() - dataOffset);
+    std::vector<CatalogEntry> entries;
+    // The count is only trusted as far as the bytes left could hold, a corrupt one would otherwise ask for gigabytes
+    entries.reserve(std::min<size_t>(header.entryCount, reader.GetRemaining() / CATALOG_MIN_ENTRY_SIZE));
+    for (uint32_t i = 0; i < header.entryCount && !reader.Failed(); i++) {
+        CatalogEntry entry{};
+        entry.path = reader.GetString();
+        entry.name = reader.GetString();
+        entry.contentHash = reader.Get<uint64_t>();
+        entry.modifiedTime = reader.Get<int64_t>();
+        entry.size = reader.Get<uint64_t>();
+        entry.valid = reader.Get<uint8_t>() != 0;
+        uint32_t uniformCount = reader.Get<uint32_t>();
+        for (uint32_t j = 0; j < uniformCount && !reader.Failed(); j++) {
+            CatalogUniform uniform{};
+            uniform.uniform = reader.GetString();
+            uniform.name = reader.GetString();
+            uint8_t type = reader.Get<uint8_t>();
+            if (type > static_cast<uint8_t>(CatalogUniformType::Bool)) {
+                reader.Fail();
+            }
+            uniform.type = static_cast<CatalogUniformType>(type);
+            uniform.min = reader.Get<float>();
+            uniform.max = reader.Get<float>();
+            entry.uniforms.push_back(std::move(uniform));
+        }
+        entries.push_back(std::move(entry));
+    }
+    if (reader.Failed() || !reader.AtEnd()) {
+        LOG_WARNING("Catalog file {} is truncated or corrupt", path);
+        return false;
+    }
+    *out = std::move(entries);
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef CATALOG_FILE_HPP
+#define CATALOG_FILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bumped whenever the layout changes, files with any other version are rebuilt from scratch
+constexpr uint32_t CATALOG_FILE_VERSION = 1;
+
+enum class CatalogUniformType : uint8_t {
+    Int = 0,
+    Float = 1,
+    Bool = 2
+};
+
+/*
+A uniform a wallpaper exposes on the control menu. Int ranges are stored as floats, which holds them exactly
+for any range a slider would be given.
+*/
+struct CatalogUniform {
+    std::string uniform;
+    std::string name;
+    CatalogUniformType type = CatalogUniformType::Float;
+    float min = 0.0f;
+    float max = 0.0f;
+};
+
+/*
+What the catalog knows about one .wallpaper file without opening it. The modified time and size are compared
+against the file system to tell whether the rest needs indexing again.
+*/
+struct CatalogEntry {
+    // Relative to the library root, always with forward slashes
+    std::string path;
+    std::string name;
+    uint64_t contentHash = 0;
+    // Ticks of std::filesystem::file_time_type
+    int64_t modifiedTime = 0;
+    uint64_t size = 0;
+    // False if the file has no shader section or its metadata didn't parse, it is kept so it isn't retried until it changes
+    bool valid = false;
+    // Sorted by uniform name
+    std::vector<CatalogUniform> uniforms;
+};
+
+/*
+Catalog files hold a header followed by every entry packed back to back, strings prefixed with their length.
+The library root is stored so a catalog is never applied to the wrong directory.
+*/
+bool WriteCatalogFile(const std::string& path, const std::string& root, const std::vector<CatalogEntry>& entries);
+// Map and unpack a catalog file, false if it is missing, for a different root, from another version or corrupt
+bool ReadCatalogFile(const std::string& path, const std::string& root, std::vector<CatalogEntry>* out);
+
+#endif // !CATALOG_FILE_HPP
@@ -0,0 +1,404 @@
+#include <util/ChildProcess.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#ifdef _WIN32
+#include <Windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <filesystem>
+#endif
+
+// How long a child whose input was closed gets to exit on its own before it is killed
+constexpr auto CHILD_EXIT_WAIT = std::chrono::seconds(1);
+
+// Processes are started one at a time so no child inherits the pipe ends meant for another
+static std::mutex sStartMutex;
+
+ChildProcess::~ChildProcess()
+{
+    Close();
+}
+
+#ifdef _WIN32
+static std::string QuoteArgument(const std::string& argument)
+{
+    return "\"" + argument + "\"";
+}
+
+bool ChildProcess::Start(const std::string& executable, const std::vector<std::string>& arguments)
+{
+    Close();
+    std::lock_guard<std::mutex> lock(sStartMutex);
+    SECURITY_ATTRIBUTES attributes{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+    HANDLE childInput = nullptr;
+    HANDLE input = nullptr;
+    HANDLE output = nullptr;
+    HANDLE childOutput = nullptr;
+    if (!CreatePipe(&childInput, &input, &attributes, 0)) {
+        return false;
+    }
+    if (!CreatePipe(&output, &childOutput, &attributes, 0)) {
+        CloseHandle(childInput);
+        CloseHandle(input);
+        return false;
+    }
+    // Only the child's ends are inherited
+    SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+
+    std::string commandLine = QuoteArgument(executable);
+    for (const std::string& argument : arguments) {
+        commandLine += " " + QuoteArgument(argument);
+    }
+    STARTUPINFOA startup{};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = childInput;
+    startup.hStdOutput = childOutput;
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    PROCESS_INFORMATION process{};
+    BOOL started = CreateProcessA(executable.c_str(), commandLine.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr,
+        &startup, &process);
+    CloseHandle(childInput);
+    CloseHandle(childOutput);
+    if (!started) {
+        CloseHandle(input);
+        CloseHandle(output);
+        return false;
+    }
+    CloseHandle(process.hThread);
+    mProcess = process.hProcess;
+    mInput = input;
+    mOutput = output;
+    return true;
+}
+
+bool ChildProcess::Write(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        DWORD written = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1 << 20));
+        if (mInput == nullptr || !WriteFile(mInput, bytes, chunk, &written, nullptr)) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool ChildProcess::Read(void* data, size_t size, std::chrono::steady_clock::time_point deadline)
+{
+    // Anonymous pipes can't be read with a timeout, so wait for data to arrive before reading it. Peeking fails
+    // once the child has exited and everything it wrote has been read.
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        DWORD available = 0;
+        if (mOutput == nullptr || !PeekNamedPipe(mOutput, nullptr, 0, nullptr, &available, nullptr)) {
+            return false;
+        }
+        if (available == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            WaitForSingleObject(mProcess, 1);
+            continue;
+        }
+        DWORD read = 0;
+        if (!ReadFile(mOutput, bytes, static_cast<DWORD>(std::min<size_t>(size, available)), &read, nullptr)) {
+            return false;
+        }
+        bytes += read;
+        size -= read;
+    }
+    return true;
+}
+
+void ChildProcess::Kill()
+{
+    if (mProcess != nullptr) {
+        TerminateProcess(mProcess, EXIT_FAILURE);
+        WaitForSingleObject(mProcess, INFINITE);
+    }
+    Close();
+}
+
+bool ChildProcess::IsRunning()
+{
+    return mProcess != nullptr && WaitForSingleObject(mProcess, 0) == WAIT_TIMEOUT;
+}
+
+void ChildProcess::Close()
+{
+    if (mInput != nullptr) {
+        CloseHandle(mInput);
+        mInput = nullptr;
+    }
+    if (mProcess != nullptr) {
+        if (WaitForSingleObject(mProcess, static_cast<DWORD>(std::chrono::milliseconds(CHILD_EXIT_WAIT).count())) == WAIT_TIMEOUT) {
+            TerminateProcess(mProcess, EXIT_FAILURE);
+            WaitForSingleObject(mProcess, INFINITE);
+        }
+        CloseHandle(mProcess);
+        mProcess = nullptr;
+    }
+    if (mOutput != nullptr) {
+        CloseHandle(mOutput);
+        mOutput = nullptr;
+    }
+}
+
+std::string GetExecutablePath()
+{
+    std::string path(MAX_PATH, '\0');
+    while (true) {
+        DWORD length = GetModuleFileNameA(nullptr, path.data(), static_cast<DWORD>(path.size()));
+        if (length == 0) {
+            return std::string();
+        }
+        if (length < path.size()) {
+            path.resize(length);
+            return path;
+        }
+        path.resize(path.size() * 2);
+    }
+}
+
+static int sParentOutput = -1;
+
+bool OpenParentChannel()
+{
+    fflush(stdout);
+    sParentOutput = _dup(_fileno(stdout));
+    if (sParentOutput < 0 || _dup2(_fileno(stderr), _fileno(stdout)) != 0) {
+        return false;
+    }
+    // The console logger writes to the standard output handle rather than the C stream
+    SetStdHandle(STD_OUTPUT_HANDLE, GetStdHandle(STD_ERROR_HANDLE));
+    _setmode(sParentOutput, _O_BINARY);
+    _setmode(_fileno(stdin), _O_BINARY);
+    return true;
+}
+
+bool ReadFromParent(void* data, size_t size)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        int read = _read(_fileno(stdin), bytes, static_cast<unsigned int>(std::min<size_t>(size, 1 << 20)));
+        if (read <= 0) {
+            return false;
+        }
+        bytes += read;
+        size -= static_cast<size_t>(read);
+    }
+    return true;
+}
+
+bool WriteToParent(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        int written = _write(sParentOutput, bytes, static_cast<unsigned int>(std::min<size_t>(size, 1 << 20)));
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+#else
+bool ChildProcess::Start(const std::string& executable, const std::vector<std::string>& arguments)
+{
+    Close();
+    std::lock_guard<std::mutex> lock(sStartMutex);
+    // A child that dies while being written to must fail the write rather than kill this process
+    signal(SIGPIPE, SIG_IGN);
+    int input[2];
+    int output[2];
+    if (pipe2(input, O_CLOEXEC) != 0) {
+        return false;
+    }
+    if (pipe2(output, O_CLOEXEC) != 0) {
+        close(input[0]);
+        close(input[1]);
+        return false;
+    }
+
+    // Built before forking, the child may only make async signal safe calls until it execs
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(executable.c_str()));
+    for (const std::string& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t process = fork();
+    if (process == 0) {
+        dup2(input[0], STDIN_FILENO);
+        dup2(output[1], STDOUT_FILENO);
+        execv(executable.c_str(), argv.data());
+        _exit(127);
+    }
+    close(input[0]);
+    close(output[1]);
+    if (process < 0) {
+        close(input[1]);
+        close(output[0]);
+        return false;
+    }
+    mProcess = process;
+    mInput = input[1];
+    mOutput = output[0];
+    return true;
+}
+
+bool ChildProcess::Write(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = mInput >= 0 ? write(mInput, bytes, size) : -1;
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool ChildProcess::Read(void* data, size_t size, std::chrono::steady_clock::time_point deadline)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        if (mOutput < 0) {
+            return false;
+        }
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd descriptor{ mOutput, POLLIN, 0 };
+        int ready = poll(&descriptor, 1, static_cast<int>(std::max<long long>(remaining.count(), 0)));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        ssize_t read = ::read(mOutput, bytes, size);
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read <= 0) {
+            return false;
+        }
+        bytes += read;
+        size -= static_cast<size_t>(read);
+    }
+    return true;
+}
+
+void ChildProcess::Kill()
+{
+    if (mProcess > 0) {
+        kill(mProcess, SIGKILL);
+        waitpid(mProcess, nullptr, 0);
+        mProcess = -1;
+    }
+    Close();
+}
+
+bool ChildProcess::IsRunning()
+{
+    if (mProcess > 0 && waitpid(mProcess, nullptr, WNOHANG) != 0) {
+        mProcess = -1;
+    }
+    return mProcess > 0;
+}
+
+void ChildProcess::Close()
+{
+    if (mInput >= 0) {
+        close(mInput);
+        mInput = -1;
+    }
+    if (mProcess > 0) {
+        auto deadline = std::chrono::steady_clock::now() + CHILD_EXIT_WAIT;
+        while (waitpid(mProcess, nullptr, WNOHANG) == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(mProcess, SIGKILL);
+                waitpid(mProcess, nullptr, 0);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        mProcess = -1;
+    }
+    if (mOutput >= 0) {
+        close(mOutput);
+        mOutput = -1;
+    }
+}
+
+std::string GetExecutablePath()
+{
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", error);
+    return error ? std::string() : path.string();
+}
+
+static int sParentOutput = -1;
+
+bool OpenParentChannel()
+{
+    fflush(stdout);
+    sParentOutput = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+    return sParentOutput >= 0 && dup2(STDERR_FILENO, STDOUT_FILENO) >= 0;
+}
+
+bool ReadFromParent(void* data, size_t size)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t read = ::read(STDIN_FILENO, bytes, size);
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read <= 0) {
+            return false;
+        }
+        bytes += read;
+        size -= static_cast<size_t>(read);
+    }
+    return true;
+}
+
+bool WriteToParent(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(sParentOutput, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+#endif
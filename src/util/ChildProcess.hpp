@@ -0,0 +1,53 @@
+#ifndef CHILD_PROCESS_HPP
+#define CHILD_PROCESS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+A child process the parent talks to over its standard input and output. Reads wait no longer than a deadline, so
+a child that hangs is noticed and can be killed, and a child that dies shows up as a failed read or write.
+*/
+class ChildProcess {
+private:
+#ifdef _WIN32
+    void* mProcess = nullptr;
+    void* mInput = nullptr;
+    void* mOutput = nullptr;
+#else
+    int mProcess = -1;
+    int mInput = -1;
+    int mOutput = -1;
+#endif
+
+    void Close();
+public:
+    ChildProcess() = default;
+    ~ChildProcess();
+    // Start the executable with its standard error shared with this process
+    bool Start(const std::string& executable, const std::vector<std::string>& arguments);
+    bool Write(const void* data, size_t size);
+    // Read exactly size bytes, false if the child exits, the pipe breaks or the deadline passes first
+    bool Read(void* data, size_t size, std::chrono::steady_clock::time_point deadline);
+    // Kill the child if it is still running and wait for it to exit
+    void Kill();
+    bool IsRunning();
+
+    ChildProcess(const ChildProcess& arg) = delete;
+    ChildProcess(const ChildProcess&& arg) = delete;
+    ChildProcess& operator=(const ChildProcess& arg) = delete;
+    ChildProcess& operator=(const ChildProcess&& arg) = delete;
+};
+
+// Path of the running executable, for starting another copy of it as a worker
+std::string GetExecutablePath();
+
+// In a worker process, keep standard input and output for talking to the parent and point standard output at
+// standard error, so nothing else printed can corrupt the messages. Call before anything is logged.
+bool OpenParentChannel();
+bool ReadFromParent(void* data, size_t size);
+bool WriteToParent(const void* data, size_t size);
+
+#endif // !CHILD_PROCESS_HPP
@@ -0,0 +1,96 @@
+#include <util/Fft.hpp>
+#include <cmath>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FFT_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+Fft::Fft(size_t size) : mSize(size), mBitReverse(size), mTwiddleReal(size), mTwiddleImaginary(size), mReal(size), mImaginary(size)
+{
+    int bits = 0;
+    while ((size_t{ 1 } << bits) < size) {
+        bits++;
+    }
+    for (size_t i = 0; i < size; i++) {
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < bits; bit++) {
+            reversed |= ((static_cast<uint32_t>(i) >> bit) & 1u) << (bits - 1 - bit);
+        }
+        mBitReverse[i] = reversed;
+    }
+    for (size_t half = 1; half < size; half *= 2) {
+        for (size_t k = 0; k < half; k++) {
+            double angle = -std::numbers::pi * static_cast<double>(k) / static_cast<double>(half);
+            mTwiddleReal[half - 1 + k] = static_cast<float>(std::cos(angle));
+            mTwiddleImaginary[half - 1 + k] = static_cast<float>(std::sin(angle));
+        }
+    }
+}
+
+void Fft::Forward(const float* samples, float* magnitudes)
+{
+    float* re = mReal.data();
+    float* im = mImaginary.data();
+    for (size_t i = 0; i < mSize; i++) {
+        re[mBitReverse[i]] = samples[i];
+        im[i] = 0.0f;
+    }
+
+    for (size_t half = 1; half < mSize; half *= 2) {
+        const float* twiddleRe = mTwiddleReal.data() + half - 1;
+        const float* twiddleIm = mTwiddleImaginary.data() + half - 1;
+        for (size_t start = 0; start < mSize; start += half * 2) {
+            size_t k = 0;
+#ifdef FFT_USE_SSE2
+            for (; k + 4 <= half; k += 4) {
+                float* aRe = re + start + k;
+                float* aIm = im + start + k;
+                float* bRe = aRe + half;
+                float* bIm = aIm + half;
+                __m128 wr = _mm_loadu_ps(twiddleRe + k);
+                __m128 wi = _mm_loadu_ps(twiddleIm + k);
+                __m128 xr = _mm_loadu_ps(bRe);
+                __m128 xi = _mm_loadu_ps(bIm);
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+                __m128 ar = _mm_loadu_ps(aRe);
+                __m128 ai = _mm_loadu_ps(aIm);
+                _mm_storeu_ps(bRe, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(bIm, _mm_sub_ps(ai, ti));
+                _mm_storeu_ps(aRe, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(aIm, _mm_add_ps(ai, ti));
+            }
+#endif
+            for (; k < half; k++) {
+                size_t a = start + k;
+                size_t b = a + half;
+                float tr = re[b] * twiddleRe[k] - im[b] * twiddleIm[k];
+                float ti = re[b] * twiddleIm[k] + im[b] * twiddleRe[k];
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    size_t bins = mSize / 2;
+    size_t i = 0;
+#ifdef FFT_USE_SSE2
+    for (; i + 4 <= bins; i += 4) {
+        __m128 r = _mm_loadu_ps(re + i);
+        __m128 m = _mm_loadu_ps(im + i);
+        _mm_storeu_ps(magnitudes + i, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m))));
+    }
+#endif
+    for (; i < bins; i++) {
+        magnitudes[i] = std::sqrt(re[i] * re[i] + im[i] * im[i]);
+    }
+}
+
+size_t Fft::GetSize() const
+{
+    return mSize;
+}
@@ -0,0 +1,28 @@
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Radix 2 FFT of a fixed power of two size, with the twiddle factors and bit reversal worked out up front.
+The working arrays are kept split into real and imaginary parts so the butterflies vectorize four at a time.
+*/
+class Fft {
+private:
+    size_t mSize = 0;
+    std::vector<uint32_t> mBitReverse;
+    // Twiddles for the stage with butterflies h apart start at h - 1
+    std::vector<float> mTwiddleReal;
+    std::vector<float> mTwiddleImaginary;
+    std::vector<float> mReal;
+    std::vector<float> mImaginary;
+public:
+    explicit Fft(size_t size);
+    // Transform size real samples and write the magnitude of the first size / 2 bins
+    void Forward(const float* samples, float* magnitudes);
+    size_t GetSize() const;
+};
+
+#endif // !FFT_HPP
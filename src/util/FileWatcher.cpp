@@ -0,0 +1,192 @@
+#include <util/FileWatcher.hpp>
+#include <algorithm>
+#include <util/Log.hpp>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Normalised so a path can be compared against the ones reported by the OS
+static std::string NormalisePath(const std::filesystem::path& path)
+{
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::weakly_canonical(path, error);
+    return (error ? path : absolute).lexically_normal().string();
+}
+
+FileWatcher::FileWatcher() = default;
+
+FileWatcher::~FileWatcher()
+{
+    Clear();
+}
+
+void FileWatcher::Watch(const std::vector<std::string>& paths)
+{
+    Clear();
+    std::vector<std::filesystem::path> directories;
+    for (const std::string& path : paths) {
+        std::string normalised = NormalisePath(path);
+        mPaths.emplace(normalised, path);
+        std::error_code error;
+        std::filesystem::path directory = std::filesystem::is_directory(normalised, error) ? std::filesystem::path(normalised) :
+            std::filesystem::path(normalised).parent_path();
+        if (std::find(directories.begin(), directories.end(), directory) == directories.end()) {
+            directories.push_back(directory);
+        }
+    }
+    for (const std::filesystem::path& directory : directories) {
+        AddDirectory(directory);
+    }
+}
+
+#ifdef _WIN32
+struct FileWatcher::DirectoryWatch {
+    std::filesystem::path directory;
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped{};
+    alignas(DWORD) unsigned char buffer[16 * 1024];
+};
+
+static bool ReadChanges(HANDLE handle, OVERLAPPED* overlapped, unsigned char* buffer, DWORD size)
+{
+    ResetEvent(overlapped->hEvent);
+    return ReadDirectoryChangesW(handle, buffer, size, FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+        nullptr, overlapped, nullptr) != 0;
+}
+
+void FileWatcher::AddDirectory(const std::filesystem::path& directory)
+{
+    auto watch = std::make_unique<DirectoryWatch>();
+    watch->directory = directory;
+    watch->handle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (watch->handle == INVALID_HANDLE_VALUE) {
+        LOG_WARNING("Could not watch {} for changes", directory.string());
+        return;
+    }
+    watch->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!ReadChanges(watch->handle, &watch->overlapped, watch->buffer, sizeof(watch->buffer))) {
+        LOG_WARNING("Could not watch {} for changes", directory.string());
+        CloseHandle(watch->overlapped.hEvent);
+        CloseHandle(watch->handle);
+        return;
+    }
+    mDirectories.push_back(std::move(watch));
+}
+
+void FileWatcher::Clear()
+{
+    for (std::unique_ptr<DirectoryWatch>& watch : mDirectories) {
+        // The pending read has to finish being cancelled before its buffer goes away
+        DWORD bytes = 0;
+        CancelIoEx(watch->handle, &watch->overlapped);
+        GetOverlappedResult(watch->handle, &watch->overlapped, &bytes, TRUE);
+        CloseHandle(watch->overlapped.hEvent);
+        CloseHandle(watch->handle);
+    }
+    mDirectories.clear();
+    mPaths.clear();
+}
+
+void FileWatcher::Poll(std::vector<std::string>* changed)
+{
+    for (std::unique_ptr<DirectoryWatch>& watch : mDirectories) {
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(watch->handle, &watch->overlapped, &bytes, FALSE)) {
+            continue;
+        }
+        if (bytes == 0) {
+            // The buffer overflowed, so anything in the directory may have changed
+            for (auto it = mPaths.begin(); it != mPaths.end(); ++it) {
+                if (std::filesystem::path(it->first).parent_path() == watch->directory || it->first == watch->directory.string()) {
+                    Report(*watch, it->first, changed);
+                }
+            }
+        }
+        for (DWORD offset = 0; bytes > 0;) {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(watch->buffer + offset);
+            std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+            Report(*watch, watch->directory / name, changed);
+            if (info->NextEntryOffset == 0) {
+                break;
+            }
+            offset += info->NextEntryOffset;
+        }
+        ReadChanges(watch->handle, &watch->overlapped, watch->buffer, sizeof(watch->buffer));
+    }
+}
+#else
+struct FileWatcher::DirectoryWatch {
+    std::filesystem::path directory;
+    int descriptor = -1;
+};
+
+void FileWatcher::AddDirectory(const std::filesystem::path& directory)
+{
+    if (mDescriptor == -1) {
+        mDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (mDescriptor == -1) {
+            LOG_WARNING("Could not start watching for file changes");
+            return;
+        }
+    }
+    int descriptor = inotify_add_watch(mDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_TO);
+    if (descriptor == -1) {
+        LOG_WARNING("Could not watch {} for changes", directory.string());
+        return;
+    }
+    auto watch = std::make_unique<DirectoryWatch>();
+    watch->directory = directory;
+    watch->descriptor = descriptor;
+    mDirectories.push_back(std::move(watch));
+}
+
+void FileWatcher::Clear()
+{
+    // Closing the inotify instance removes every watch on it
+    if (mDescriptor != -1) {
+        close(mDescriptor);
+        mDescriptor = -1;
+    }
+    mDirectories.clear();
+    mPaths.clear();
+}
+
+void FileWatcher::Poll(std::vector<std::string>* changed)
+{
+    if (mDescriptor == -1) {
+        return;
+    }
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true) {
+        ssize_t length = read(mDescriptor, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            for (const std::unique_ptr<DirectoryWatch>& watch : mDirectories) {
+                if (watch->descriptor == event->wd) {
+                    Report(*watch, event->len > 0 ? watch->directory / event->name : watch->directory, changed);
+                }
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+}
+#endif
+
+void FileWatcher::Report(const DirectoryWatch& watch, const std::filesystem::path& path, std::vector<std::string>* changed) const
+{
+    // A watched directory changes whenever anything inside it does
+    std::string directory = watch.directory.string();
+    auto find = mPaths.find(mPaths.contains(directory) ? directory : path.lexically_normal().string());
+    if (find != mPaths.end() && std::find(changed->begin(), changed->end(), find->second) == changed->end()) {
+        changed->push_back(find->second);
+    }
+}
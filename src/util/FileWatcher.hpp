@@ -0,0 +1,40 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Reports changes to a set of files and directories without blocking. The directory each file is in is watched
+rather than the file, so editors that save by writing a new file and renaming it over the old one are still seen.
+Uses ReadDirectoryChangesW on Windows and inotify elsewhere.
+*/
+class FileWatcher {
+private:
+    struct DirectoryWatch;
+    std::vector<std::unique_ptr<DirectoryWatch>> mDirectories;
+    // Normalised paths being watched and how they were given, changes to anything else in their directories are ignored
+    std::unordered_map<std::string, std::string> mPaths;
+#ifndef _WIN32
+    int mDescriptor = -1;
+#endif
+    void AddDirectory(const std::filesystem::path& directory);
+    void Report(const DirectoryWatch& watch, const std::filesystem::path& path, std::vector<std::string>* changed) const;
+public:
+    FileWatcher();
+    ~FileWatcher();
+    // Replace everything being watched. Directories in the list count as changed when anything inside them is.
+    void Watch(const std::vector<std::string>& paths);
+    void Clear();
+    // Append every watched path changed since the last call, each at most once and as it was passed to Watch
+    void Poll(std::vector<std::string>* changed);
+    FileWatcher(const FileWatcher& arg) = delete;
+    FileWatcher(const FileWatcher&& arg) = delete;
+    FileWatcher& operator=(const FileWatcher& arg) = delete;
+    FileWatcher& operator=(const FileWatcher&& arg) = delete;
+};
+
+#endif // !FILE_WATCHER_HPP
@@ -0,0 +1,15 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit FNV-1a, used to key caches by file content
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+uint64_t HashString(const std::string& value, uint64_t seed = 14695981039346656037ull);
+
+// Fixed width lowercase hex, suitable for use in file names
+std::string HashToHex(uint64_t hash);
+
+#endif // !HASH_HPP
@@ -0,0 +1,70 @@
+#include <util/Image.hpp>
+#include <algorithm>
+#include <fstream>
+#include <stb_image.h>
+#include <util/Log.hpp>
+
+size_t Image::RowBytes() const
+{
+    return static_cast<size_t>(width) * CHANNELS;
+}
+
+bool Image::Empty() const
+{
+    return pixels.empty();
+}
+
+bool LoadImage(const std::string& path, Image* out)
+{
+    int width, height, numComponents;
+    stbi_uc* data = stbi_load(path.c_str(), &width, &height, &numComponents, Image::CHANNELS);
+    if (data == nullptr) {
+        LOG_ERROR("Failed to load image at path {}: {}", path, stbi_failure_reason());
+        return false;
+    }
+
+    out->width = width;
+    out->height = height;
+    out->pixels.assign(data, data + static_cast<size_t>(width) * static_cast<size_t>(height) * Image::CHANNELS);
+    stbi_image_free(data);
+    return true;
+}
+
+bool DecodeImage(const unsigned char* data, size_t size, Image* out)
+{
+    int width, height, numComponents;
+    stbi_uc* decoded = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &numComponents, Image::CHANNELS);
+    if (decoded == nullptr) {
+        LOG_ERROR("Failed to decode image: {}", stbi_failure_reason());
+        return false;
+    }
+
+    out->width = width;
+    out->height = height;
+    out->pixels.assign(decoded, decoded + static_cast<size_t>(width) * static_cast<size_t>(height) * Image::CHANNELS);
+    stbi_image_free(decoded);
+    return true;
+}
+
+void FlipRows(Image* image)
+{
+    size_t rowBytes = image->RowBytes();
+    for (int top = 0, bottom = image->height - 1; top < bottom; top++, bottom--) {
+        std::swap_ranges(
+            image->pixels.begin() + static_cast<std::ptrdiff_t>(rowBytes * static_cast<size_t>(top)),
+            image->pixels.begin() + static_cast<std::ptrdiff_t>(rowBytes * static_cast<size_t>(top + 1)),
+            image->pixels.begin() + static_cast<std::ptrdiff_t>(rowBytes * static_cast<size_t>(bottom)));
+    }
+}
+
+bool ReadFileBytes(const std::string& path, std::vector<unsigned char>* out)
+{
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (stream.fail()) {
+        return false;
+    }
+    std::streamsize size = stream.tellg();
+    stream.seekg(0);
+    out->resize(static_cast<size_t>(size));
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(out->data()), size));
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+#include <string>
+#include <vector>
+
+/*
+Decoded 8 bit RGBA image in CPU memory, rows are tightly packed from the top of the image down
+*/
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    static constexpr int CHANNELS = 4;
+
+    size_t RowBytes() const;
+    bool Empty() const;
+};
+
+// Decode any image format stb_image supports into RGBA. Safe to call from worker threads.
+bool LoadImage(const std::string& path, Image* out);
+bool DecodeImage(const unsigned char* data, size_t size, Image* out);
+
+// Reverse the row order, converting between top down images and bottom up OpenGL textures
+void FlipRows(Image* image);
+
+// Read a whole file into memory
+bool ReadFileBytes(const std::string& path, std::vector<unsigned char>* out);
+
+#endif // !IMAGE_HPP
@@ -0,0 +1,107 @@
+#include <util/MappedFile.hpp>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    mFile = file;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        Close();
+        return false;
+    }
+    mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr) {
+        Close();
+        return false;
+    }
+    mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (mData == nullptr) {
+        Close();
+        return false;
+    }
+    mSize = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr) {
+        UnmapViewOfFile(mData);
+    }
+    if (mMapping != nullptr) {
+        CloseHandle(mMapping);
+    }
+    if (mFile != nullptr) {
+        CloseHandle(mFile);
+    }
+    mData = nullptr;
+    mMapping = nullptr;
+    mFile = nullptr;
+    mSize = 0;
+}
+#else
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+    mDescriptor = open(path.c_str(), O_RDONLY);
+    if (mDescriptor == -1) {
+        return false;
+    }
+
+    struct stat status{};
+    if (fstat(mDescriptor, &status) != 0 || status.st_size == 0) {
+        Close();
+        return false;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, mDescriptor, 0);
+    if (mapped == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    mData = static_cast<const unsigned char*>(mapped);
+    mSize = static_cast<size_t>(status.st_size);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr) {
+        munmap(const_cast<unsigned char*>(mData), mSize);
+    }
+    if (mDescriptor != -1) {
+        close(mDescriptor);
+    }
+    mData = nullptr;
+    mDescriptor = -1;
+    mSize = 0;
+}
+#endif
+
+const unsigned char* MappedFile::GetData() const
+{
+    return mData;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return mSize;
+}
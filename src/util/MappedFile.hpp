@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/*
+Read only memory mapping of a whole file. Pages are loaded by the OS as they are touched, so opening a
+large file is cheap and the data can be copied straight out of the mapping.
+*/
+class MappedFile {
+private:
+    const unsigned char* mData = nullptr;
+    size_t mSize = 0;
+#ifdef _WIN32
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#else
+    int mDescriptor = -1;
+#endif
+
+    void Close();
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    bool Open(const std::string& path);
+    const unsigned char* GetData() const;
+    size_t GetSize() const;
+
+    MappedFile(const MappedFile& arg) = delete;
+    MappedFile(const MappedFile&& arg) = delete;
+    MappedFile& operator=(const MappedFile& arg) = delete;
+    MappedFile& operator=(const MappedFile&& arg) = delete;
+};
+
+#endif // !MAPPED_FILE_HPP
@@ -0,0 +1,279 @@
+#include <util/Mipmap.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Resolution of the table used to encode linear values back to sRGB
+constexpr int LINEAR_TO_SRGB_ENTRIES = 4096;
+constexpr int MAX_FILTER_TAPS = 6;
+
+/*
+A separable filter for halving an image. Output pixel x reads source pixels 2x + offset for every tap,
+clamped to the edge of the image.
+*/
+struct DownsampleFilter {
+    int taps = 0;
+    std::array<int, MAX_FILTER_TAPS> offsets{};
+    std::array<float, MAX_FILTER_TAPS> weights{};
+};
+
+// Zeroth order modified Bessel function of the first kind, used by the Kaiser window
+static double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static const DownsampleFilter& GetFilter(MipFilter filter)
+{
+    static const DownsampleFilter box = []() {
+        DownsampleFilter result{};
+        result.taps = 2;
+        result.offsets = { 0, 1 };
+        result.weights = { 0.5f, 0.5f };
+        return result;
+    }();
+    static const DownsampleFilter kaiser = []() {
+        // Sinc at the half rate cutoff windowed over three source pixels either side of the output centre
+        const double alpha = 4.0;
+        const double radius = 3.0;
+        const double pi = 3.14159265358979323846;
+        DownsampleFilter result{};
+        result.taps = MAX_FILTER_TAPS;
+        double total = 0.0;
+        std::array<double, MAX_FILTER_TAPS> weights{};
+        for (int i = 0; i < MAX_FILTER_TAPS; i++) {
+            result.offsets[static_cast<size_t>(i)] = i - 2;
+            double distance = (i - 2) - 0.5;
+            double t = distance / 2.0;
+            double sinc = std::sin(pi * t) / (pi * t);
+            double window = BesselI0(alpha * std::sqrt(1.0 - (distance / radius) * (distance / radius))) / BesselI0(alpha);
+            weights[static_cast<size_t>(i)] = sinc * window;
+            total += sinc * window;
+        }
+        for (int i = 0; i < MAX_FILTER_TAPS; i++) {
+            result.weights[static_cast<size_t>(i)] = static_cast<float>(weights[static_cast<size_t>(i)] / total);
+        }
+        return result;
+    }();
+    return filter == MipFilter::Kaiser ? kaiser : box;
+}
+
+static const std::array<float, 256>& GetSrgbToLinearTable()
+{
+    static const std::array<float, 256> table = []() {
+        std::array<float, 256> result{};
+        for (int i = 0; i < 256; i++) {
+            double c = i / 255.0;
+            result[static_cast<size_t>(i)] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+        }
+        return result;
+    }();
+    return table;
+}
+
+static const std::array<unsigned char, LINEAR_TO_SRGB_ENTRIES>& GetLinearToSrgbTable()
+{
+    static const std::array<unsigned char, LINEAR_TO_SRGB_ENTRIES> table = []() {
+        std::array<unsigned char, LINEAR_TO_SRGB_ENTRIES> result{};
+        for (int i = 0; i < LINEAR_TO_SRGB_ENTRIES; i++) {
+            double c = static_cast<double>(i) / (LINEAR_TO_SRGB_ENTRIES - 1);
+            double encoded = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+            result[static_cast<size_t>(i)] = static_cast<unsigned char>(std::clamp(encoded * 255.0 + 0.5, 0.0, 255.0));
+        }
+        return result;
+    }();
+    return table;
+}
+
+// Convert a row of 8 bit RGBA into floats, linearising colour if the image is sRGB
+static void DecodeRow(const unsigned char* source, int width, bool srgb, float* destination)
+{
+    if (srgb) {
+        const std::array<float, 256>& table = GetSrgbToLinearTable();
+        for (int x = 0; x < width * Image::CHANNELS; x += Image::CHANNELS) {
+            destination[x + 0] = table[source[x + 0]];
+            destination[x + 1] = table[source[x + 1]];
+            destination[x + 2] = table[source[x + 2]];
+            destination[x + 3] = source[x + 3] * (1.0f / 255.0f);
+        }
+        return;
+    }
+#ifdef MIPMAP_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    for (int x = 0; x < width; x++) {
+        int packed = 0;
+        std::copy(source + x * Image::CHANNELS, source + (x + 1) * Image::CHANNELS, reinterpret_cast<unsigned char*>(&packed));
+        __m128i bytes = _mm_cvtsi32_si128(packed);
+        __m128i words = _mm_unpacklo_epi8(bytes, zero);
+        __m128i dwords = _mm_unpacklo_epi16(words, zero);
+        _mm_storeu_ps(destination + x * Image::CHANNELS, _mm_mul_ps(_mm_cvtepi32_ps(dwords), scale));
+    }
+#else
+    for (int x = 0; x < width * Image::CHANNELS; x++) {
+        destination[x] = source[x] * (1.0f / 255.0f);
+    }
+#endif
+}
+
+// Convert a row of floats back to 8 bit RGBA, re-encoding colour as sRGB if the image is sRGB
+static void EncodeRow(const float* source, int width, bool srgb, unsigned char* destination)
+{
+    if (srgb) {
+        const std::array<unsigned char, LINEAR_TO_SRGB_ENTRIES>& table = GetLinearToSrgbTable();
+        for (int x = 0; x < width * Image::CHANNELS; x += Image::CHANNELS) {
+            for (int c = 0; c < 3; c++) {
+                float value = std::clamp(source[x + c], 0.0f, 1.0f);
+                destination[x + c] = table[static_cast<size_t>(value * (LINEAR_TO_SRGB_ENTRIES - 1) + 0.5f)];
+            }
+            destination[x + 3] = static_cast<unsigned char>(std::clamp(source[x + 3], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        return;
+    }
+#ifdef MIPMAP_USE_SSE2
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (int x = 0; x < width; x++) {
+        // cvtps rounds to nearest and the saturating packs clamp to [0, 255]
+        __m128i dwords = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(source + x * Image::CHANNELS), scale));
+        __m128i words = _mm_packs_epi32(dwords, dwords);
+        int packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&packed);
+        std::copy(bytes, bytes + Image::CHANNELS, destination + x * Image::CHANNELS);
+    }
+#else
+    for (int x = 0; x < width * Image::CHANNELS; x++) {
+        destination[x] = static_cast<unsigned char>(std::clamp(source[x], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+#endif
+}
+
+// Filter a decoded row horizontally into half as many pixels
+static void FilterRow(const float* source, int sourceWidth, int width, const DownsampleFilter& filter, float* destination)
+{
+    for (int x = 0; x < width; x++) {
+#ifdef MIPMAP_USE_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for (int tap = 0; tap < filter.taps; tap++) {
+            int sx = std::clamp(x * 2 + filter.offsets[static_cast<size_t>(tap)], 0, sourceWidth - 1);
+            __m128 pixel = _mm_loadu_ps(source + sx * Image::CHANNELS);
+            sum = _mm_add_ps(sum, _mm_mul_ps(pixel, _mm_set1_ps(filter.weights[static_cast<size_t>(tap)])));
+        }
+        _mm_storeu_ps(destination + x * Image::CHANNELS, sum);
+#else
+        float sum[Image::CHANNELS] = {};
+        for (int tap = 0; tap < filter.taps; tap++) {
+            int sx = std::clamp(x * 2 + filter.offsets[static_cast<size_t>(tap)], 0, sourceWidth - 1);
+            for (int c = 0; c < Image::CHANNELS; c++) {
+                sum[c] += source[sx * Image::CHANNELS + c] * filter.weights[static_cast<size_t>(tap)];
+            }
+        }
+        std::copy(sum, sum + Image::CHANNELS, destination + x * Image::CHANNELS);
+#endif
+    }
+}
+
+// Add weight times a row of floats onto an accumulator row
+static void AccumulateRow(const float* source, size_t count, float weight, float* destination)
+{
+    size_t i = 0;
+#ifdef MIPMAP_USE_SSE2
+    __m128 scale = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), scale)));
+    }
+#endif
+    for (; i < count; i++) {
+        destination[i] += source[i] * weight;
+    }
+}
+
+/*
+Produce output rows [firstRow, lastRow) of the downsampled image. Horizontally filtered source rows are kept
+in a small ring so rows shared by neighbouring output rows are only filtered once.
+*/
+static void DownsampleRows(const Image& source, Image* destination, const MipOptions& options, int firstRow, int lastRow)
+{
+    const DownsampleFilter& filter = GetFilter(options.filter);
+    size_t floatsPerRow = static_cast<size_t>(destination->width) * Image::CHANNELS;
+    std::vector<float> decoded(static_cast<size_t>(source.width) * Image::CHANNELS);
+    std::vector<float> accumulator(floatsPerRow);
+
+    // Every output row needs filter.taps source rows and the next output row starts two rows further on
+    const int slots = filter.taps + 2;
+    std::vector<float> filtered(floatsPerRow * static_cast<size_t>(slots));
+    std::vector<int> slotRows(static_cast<size_t>(slots), -1);
+    int nextSlot = 0;
+
+    for (int y = firstRow; y < lastRow; y++) {
+        std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+        for (int tap = 0; tap < filter.taps; tap++) {
+            int sy = std::clamp(y * 2 + filter.offsets[static_cast<size_t>(tap)], 0, source.height - 1);
+            auto found = std::find(slotRows.begin(), slotRows.end(), sy);
+            size_t slot = static_cast<size_t>(found - slotRows.begin());
+            if (found == slotRows.end()) {
+                slot = static_cast<size_t>(nextSlot);
+                nextSlot = (nextSlot + 1) % slots;
+                DecodeRow(source.pixels.data() + source.RowBytes() * static_cast<size_t>(sy), source.width, options.srgb, decoded.data());
+                FilterRow(decoded.data(), source.width, destination->width, filter, filtered.data() + floatsPerRow * slot);
+                slotRows[slot] = sy;
+            }
+            AccumulateRow(filtered.data() + floatsPerRow * slot, floatsPerRow, filter.weights[static_cast<size_t>(tap)], accumulator.data());
+        }
+        EncodeRow(accumulator.data(), destination->width, options.srgb, destination->pixels.data() + destination->RowBytes() * static_cast<size_t>(y));
+    }
+}
+
+Image DownsampleImage(const Image& source, const MipOptions& options)
+{
+    Image destination{};
+    destination.width = std::max(source.width / 2, 1);
+    destination.height = std::max(source.height / 2, 1);
+    destination.pixels.resize(destination.RowBytes() * static_cast<size_t>(destination.height));
+
+    if (options.pool == nullptr || destination.height <= MIP_ROWS_PER_TASK) {
+        DownsampleRows(source, &destination, options, 0, destination.height);
+        return destination;
+    }
+
+    // The calling thread takes the first band itself rather than sitting idle
+    std::vector<std::future<void>> bands;
+    for (int row = MIP_ROWS_PER_TASK; row < destination.height; row += MIP_ROWS_PER_TASK) {
+        int lastRow = std::min(row + MIP_ROWS_PER_TASK, destination.height);
+        bands.push_back(options.pool->Submit([&source, &destination, &options, row, lastRow]() {
+            DownsampleRows(source, &destination, options, row, lastRow);
+        }));
+    }
+    DownsampleRows(source, &destination, options, 0, MIP_ROWS_PER_TASK);
+    for (std::future<void>& band : bands) {
+        band.get();
+    }
+    return destination;
+}
+
+void GenerateMipChain(const Image& base, std::vector<Image>* mips, const MipOptions& options)
+{
+    // Reserve up front, each level is filtered from the previous one so the vector must not reallocate
+    size_t levelCount = 0;
+    for (int size = std::max(base.width, base.height); size > 1; size /= 2) {
+        levelCount++;
+    }
+    mips->reserve(mips->size() + levelCount);
+
+    const Image* source = &base;
+    while (source->width > 1 || source->height > 1) {
+        mips->push_back(DownsampleImage(*source, options));
+        source = &mips->back();
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef MIPMAP_HPP
+#define MIPMAP_HPP
+
+#include <vector>
+#include <util/Image.hpp>
+#include <util/ThreadPool.hpp>
+
+// Output rows of a level given to each task when generating mips on a pool
+constexpr int MIP_ROWS_PER_TASK = 32;
+
+enum class MipFilter {
+    // Averages each 2x2 block, what glGenerateMipmap does on most drivers
+    Box,
+    // 6 tap Kaiser windowed sinc, keeps detail sharper over many levels at about three times the cost
+    Kaiser
+};
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Box;
+    // Filter colour in linear light, for images holding sRGB colour. Alpha is always filtered as stored.
+    bool srgb = true;
+    // Rows of each level are split across this pool if set. It must not be the pool the caller is running
+    // on, or every worker could end up waiting on tasks queued behind it.
+    ThreadPool* pool = nullptr;
+};
+
+// Halve an RGBA image in each dimension, clamped to 1
+Image DownsampleImage(const Image& source, const MipOptions& options = {});
+
+// Filter the image down to 1x1, appending every level after the base to mips, which must not hold base
+void GenerateMipChain(const Image& base, std::vector<Image>* mips, const MipOptions& options = {});
+
+#endif // !MIPMAP_HPP
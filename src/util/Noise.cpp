@@ -0,0 +1,355 @@
+#include <util/Noise.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
+#include <numbers>
+
+constexpr int NOISE_CHANNELS = 4;
+// Rows, or slices of a volume, generated per pool task
+constexpr int NOISE_ROWS_PER_TASK = 16;
+// Width of the Gaussian used to measure clustering when building blue noise
+constexpr float BLUE_NOISE_SIGMA = 1.5f;
+// Fraction of texels set in the initial blue noise pattern
+constexpr int BLUE_NOISE_INITIAL_DIVISOR = 10;
+
+const char* GetNoiseUniformName(NoiseKind kind)
+{
+    switch (kind) {
+    case NoiseKind::White:
+        return "iNoiseWhite";
+    case NoiseKind::Blue:
+        return "iNoiseBlue";
+    case NoiseKind::Value:
+        return "iNoiseValue";
+    case NoiseKind::Perlin:
+        return "iNoisePerlin";
+    case NoiseKind::Value3D:
+        return "iNoiseValue3D";
+    case NoiseKind::Perlin3D:
+        return "iNoisePerlin3D";
+    default:
+        return "";
+    }
+}
+
+bool IsNoise3D(NoiseKind kind)
+{
+    return kind == NoiseKind::Value3D || kind == NoiseKind::Perlin3D;
+}
+
+// Integer hash with good avalanche, from Chris Wellons' hash prospector
+static uint32_t HashInt(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t HashLattice(int x, int y, int z, int channel)
+{
+    uint32_t hash = HashInt(static_cast<uint32_t>(channel) + 0x9e3779b9u * static_cast<uint32_t>(NOISE_VERSION));
+    hash = HashInt(hash + static_cast<uint32_t>(z));
+    hash = HashInt(hash + static_cast<uint32_t>(y));
+    return HashInt(hash + static_cast<uint32_t>(x));
+}
+
+static float HashToUnit(uint32_t hash)
+{
+    return static_cast<float>(hash >> 8) * (1.0f / 16777216.0f);
+}
+
+static unsigned char ToByte(float value)
+{
+    return static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static float Smooth(float t)
+{
+    return t * t * (3.0f - 2.0f * t);
+}
+
+static float Quintic(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static float Lerp(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+// Lattice cell and offset into it of a texel centre, wrapped to the period so the texture tiles
+struct LatticePoint {
+    int cell = 0;
+    int next = 0;
+    float offset = 0.0f;
+};
+
+static LatticePoint GetLatticePoint(int texel, int size, int period)
+{
+    float position = (static_cast<float>(texel) + 0.5f) * static_cast<float>(period) / static_cast<float>(size);
+    LatticePoint point{};
+    point.cell = static_cast<int>(std::floor(position));
+    point.offset = position - static_cast<float>(point.cell);
+    point.cell %= period;
+    point.next = (point.cell + 1) % period;
+    return point;
+}
+
+static float Gradient2D(int x, int y, int channel, float dx, float dy)
+{
+    float angle = HashToUnit(HashLattice(x, y, 0, channel)) * 2.0f * std::numbers::pi_v<float>;
+    return std::cos(angle) * dx + std::sin(angle) * dy;
+}
+
+static float Gradient3D(int x, int y, int z, int channel, float dx, float dy, float dz)
+{
+    // Ken Perlin's twelve cube edge directions
+    switch (HashLattice(x, y, z, channel) % 12) {
+    case 0: return dx + dy;
+    case 1: return -dx + dy;
+    case 2: return dx - dy;
+    case 3: return -dx - dy;
+    case 4: return dx + dz;
+    case 5: return -dx + dz;
+    case 6: return dx - dz;
+    case 7: return -dx - dz;
+    case 8: return dy + dz;
+    case 9: return -dy + dz;
+    case 10: return dy - dz;
+    default: return -dy - dz;
+    }
+}
+
+static float SampleValue2D(const LatticePoint& x, const LatticePoint& y, int channel)
+{
+    float u = Smooth(x.offset);
+    float v = Smooth(y.offset);
+    float bottom = Lerp(HashToUnit(HashLattice(x.cell, y.cell, 0, channel)), HashToUnit(HashLattice(x.next, y.cell, 0, channel)), u);
+    float top = Lerp(HashToUnit(HashLattice(x.cell, y.next, 0, channel)), HashToUnit(HashLattice(x.next, y.next, 0, channel)), u);
+    return Lerp(bottom, top, v);
+}
+
+static float SamplePerlin2D(const LatticePoint& x, const LatticePoint& y, int channel)
+{
+    float u = Quintic(x.offset);
+    float v = Quintic(y.offset);
+    float bottom = Lerp(Gradient2D(x.cell, y.cell, channel, x.offset, y.offset), Gradient2D(x.next, y.cell, channel, x.offset - 1.0f, y.offset), u);
+    float top = Lerp(Gradient2D(x.cell, y.next, channel, x.offset, y.offset - 1.0f), Gradient2D(x.next, y.next, channel, x.offset - 1.0f, y.offset - 1.0f), u);
+    // Gradient noise in two dimensions stays within +-sqrt(1/2)
+    return 0.5f + Lerp(bottom, top, v) * std::numbers::sqrt2_v<float> * 0.5f;
+}
+
+static float SampleValue3D(const LatticePoint& x, const LatticePoint& y, const LatticePoint& z, int channel)
+{
+    float u = Smooth(x.offset);
+    float v = Smooth(y.offset);
+    float w = Smooth(z.offset);
+    std::array<float, 2> layers{};
+    for (int layer = 0; layer < 2; layer++) {
+        int cz = layer == 0 ? z.cell : z.next;
+        float bottom = Lerp(HashToUnit(HashLattice(x.cell, y.cell, cz, channel)), HashToUnit(HashLattice(x.next, y.cell, cz, channel)), u);
+        float top = Lerp(HashToUnit(HashLattice(x.cell, y.next, cz, channel)), HashToUnit(HashLattice(x.next, y.next, cz, channel)), u);
+        layers[static_cast<size_t>(layer)] = Lerp(bottom, top, v);
+    }
+    return Lerp(layers[0], layers[1], w);
+}
+
+static float SamplePerlin3D(const LatticePoint& x, const LatticePoint& y, const LatticePoint& z, int channel)
+{
+    float u = Quintic(x.offset);
+    float v = Quintic(y.offset);
+    float w = Quintic(z.offset);
+    std::array<float, 2> layers{};
+    for (int layer = 0; layer < 2; layer++) {
+        int cz = layer == 0 ? z.cell : z.next;
+        float dz = z.offset - static_cast<float>(layer);
+        float bottom = Lerp(Gradient3D(x.cell, y.cell, cz, channel, x.offset, y.offset, dz),
+            Gradient3D(x.next, y.cell, cz, channel, x.offset - 1.0f, y.offset, dz), u);
+        float top = Lerp(Gradient3D(x.cell, y.next, cz, channel, x.offset, y.offset - 1.0f, dz),
+            Gradient3D(x.next, y.next, cz, channel, x.offset - 1.0f, y.offset - 1.0f, dz), u);
+        layers[static_cast<size_t>(layer)] = Lerp(bottom, top, v);
+    }
+    // The edge gradients have length sqrt(2), which keeps the result within about +-1
+    return 0.5f + 0.5f * Lerp(layers[0], layers[1], w);
+}
+
+// Run function over [0, count) in bands, the calling thread takes the first band itself
+template<typename F>
+static void ParallelFor(int count, ThreadPool* pool, F&& function)
+{
+    if (pool == nullptr || count <= NOISE_ROWS_PER_TASK) {
+        function(0, count);
+        return;
+    }
+    std::vector<std::future<void>> bands;
+    for (int first = NOISE_ROWS_PER_TASK; first < count; first += NOISE_ROWS_PER_TASK) {
+        int last = std::min(first + NOISE_ROWS_PER_TASK, count);
+        bands.push_back(pool->Submit([&function, first, last]() { function(first, last); }));
+    }
+    function(0, NOISE_ROWS_PER_TASK);
+    for (std::future<void>& band : bands) {
+        band.get();
+    }
+}
+
+/*
+Void and cluster blue noise (Ulichney 1993) for one channel. Energy is a toroidal Gaussian sum over the set
+texels, so the tightest cluster is the set texel with the most energy and the largest void the empty texel with
+the least. Texels are ranked by the order they are removed from, then added to, a well spread initial pattern.
+*/
+static void GenerateBlueNoiseChannel(int channel, NoiseVolume* volume)
+{
+    constexpr int size = BLUE_NOISE_SIZE;
+    constexpr int count = size * size;
+    static_assert((size & (size - 1)) == 0, "Blue noise wraps offsets with a mask");
+
+    std::vector<float> gaussian(count);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float dx = static_cast<float>(std::min(x, size - x));
+            float dy = static_cast<float>(std::min(y, size - y));
+            gaussian[static_cast<size_t>(y * size + x)] = std::exp(-(dx * dx + dy * dy) / (2.0f * BLUE_NOISE_SIGMA * BLUE_NOISE_SIGMA));
+        }
+    }
+    auto splat = [&gaussian](std::vector<float>& energy, int texel, float sign) {
+        int tx = texel % size;
+        int ty = texel / size;
+        for (int y = 0; y < size; y++) {
+            const float* row = gaussian.data() + ((y - ty) & (size - 1)) * size;
+            float* destination = energy.data() + y * size;
+            for (int x = 0; x < size; x++) {
+                destination[x] += sign * row[(x - tx) & (size - 1)];
+            }
+        }
+    };
+    auto find = [](const std::vector<unsigned char>& pattern, const std::vector<float>& energy, bool cluster) {
+        int best = -1;
+        for (int i = 0; i < count; i++) {
+            if ((pattern[static_cast<size_t>(i)] != 0) == cluster && (best < 0 || (cluster ? energy[static_cast<size_t>(i)] > energy[static_cast<size_t>(best)]
+                : energy[static_cast<size_t>(i)] < energy[static_cast<size_t>(best)]))) {
+                best = i;
+            }
+        }
+        return best;
+    };
+
+    std::vector<unsigned char> pattern(count, 0);
+    std::vector<float> energy(count, 0.0f);
+    int ones = 0;
+    for (uint32_t i = 0; ones < count / BLUE_NOISE_INITIAL_DIVISOR; i++) {
+        int texel = static_cast<int>(HashLattice(static_cast<int>(i), 0, 0, channel) % count);
+        if (pattern[static_cast<size_t>(texel)] == 0) {
+            pattern[static_cast<size_t>(texel)] = 1;
+            splat(energy, texel, 1.0f);
+            ones++;
+        }
+    }
+    // Spread the initial pattern by moving the tightest cluster into the largest void until that changes nothing
+    for (int i = 0; i < count; i++) {
+        int cluster = find(pattern, energy, true);
+        pattern[static_cast<size_t>(cluster)] = 0;
+        splat(energy, cluster, -1.0f);
+        int gap = find(pattern, energy, false);
+        pattern[static_cast<size_t>(gap)] = 1;
+        splat(energy, gap, 1.0f);
+        if (gap == cluster) {
+            break;
+        }
+    }
+
+    std::vector<int> rank(count, 0);
+    std::vector<unsigned char> removing = pattern;
+    std::vector<float> removingEnergy = energy;
+    for (int remaining = ones; remaining > 0; remaining--) {
+        int cluster = find(removing, removingEnergy, true);
+        removing[static_cast<size_t>(cluster)] = 0;
+        splat(removingEnergy, cluster, -1.0f);
+        rank[static_cast<size_t>(cluster)] = remaining - 1;
+    }
+    for (int filled = ones; filled < count; filled++) {
+        int gap = find(pattern, energy, false);
+        pattern[static_cast<size_t>(gap)] = 1;
+        splat(energy, gap, 1.0f);
+        rank[static_cast<size_t>(gap)] = filled;
+    }
+
+    for (int i = 0; i < count; i++) {
+        volume->pixels[static_cast<size_t>(i) * NOISE_CHANNELS + static_cast<size_t>(channel)] = static_cast<unsigned char>(rank[static_cast<size_t>(i)] * 256 / count);
+    }
+}
+
+NoiseVolume GenerateNoise(NoiseKind kind, ThreadPool* pool)
+{
+    NoiseVolume volume{};
+    int size = kind == NoiseKind::Blue ? BLUE_NOISE_SIZE : IsNoise3D(kind) ? NOISE_3D_SIZE : NOISE_2D_SIZE;
+    volume.width = size;
+    volume.height = size;
+    volume.depth = IsNoise3D(kind) ? size : 1;
+    volume.pixels.resize(static_cast<size_t>(size) * size * volume.depth * NOISE_CHANNELS);
+    unsigned char* pixels = volume.pixels.data();
+
+    switch (kind) {
+    case NoiseKind::Blue: {
+        // Each channel is a separate run of the whole algorithm, so they parallelize without any banding
+        std::vector<std::future<void>> channels;
+        for (int channel = 1; channel < NOISE_CHANNELS && pool != nullptr; channel++) {
+            channels.push_back(pool->Submit([channel, &volume]() { GenerateBlueNoiseChannel(channel, &volume); }));
+        }
+        GenerateBlueNoiseChannel(0, &volume);
+        for (int channel = 1; channel < NOISE_CHANNELS && pool == nullptr; channel++) {
+            GenerateBlueNoiseChannel(channel, &volume);
+        }
+        for (std::future<void>& channel : channels) {
+            channel.get();
+        }
+        break;
+    }
+    case NoiseKind::White:
+    case NoiseKind::Value:
+    case NoiseKind::Perlin: {
+        ParallelFor(size, pool, [kind, size, pixels](int firstRow, int lastRow) {
+            for (int y = firstRow; y < lastRow; y++) {
+                LatticePoint py = GetLatticePoint(y, size, NOISE_2D_PERIOD);
+                for (int x = 0; x < size; x++) {
+                    LatticePoint px = GetLatticePoint(x, size, NOISE_2D_PERIOD);
+                    unsigned char* pixel = pixels + (static_cast<size_t>(y) * size + x) * NOISE_CHANNELS;
+                    for (int channel = 0; channel < NOISE_CHANNELS; channel++) {
+                        float value = kind == NoiseKind::White ? HashToUnit(HashLattice(x, y, 0, channel))
+                            : kind == NoiseKind::Value ? SampleValue2D(px, py, channel) : SamplePerlin2D(px, py, channel);
+                        pixel[channel] = ToByte(value);
+                    }
+                }
+            }
+        });
+        break;
+    }
+    case NoiseKind::Value3D:
+    case NoiseKind::Perlin3D: {
+        ParallelFor(size, pool, [kind, size, pixels](int firstSlice, int lastSlice) {
+            for (int z = firstSlice; z < lastSlice; z++) {
+                LatticePoint pz = GetLatticePoint(z, size, NOISE_3D_PERIOD);
+                for (int y = 0; y < size; y++) {
+                    LatticePoint py = GetLatticePoint(y, size, NOISE_3D_PERIOD);
+                    for (int x = 0; x < size; x++) {
+                        LatticePoint px = GetLatticePoint(x, size, NOISE_3D_PERIOD);
+                        unsigned char* pixel = pixels + ((static_cast<size_t>(z) * size + y) * size + x) * NOISE_CHANNELS;
+                        for (int channel = 0; channel < NOISE_CHANNELS; channel++) {
+                            float value = kind == NoiseKind::Value3D ? SampleValue3D(px, py, pz, channel) : SamplePerlin3D(px, py, pz, channel);
+                            pixel[channel] = ToByte(value);
+                        }
+                    }
+                }
+            }
+        });
+        break;
+    }
+    default:
+        break;
+    }
+    return volume;
+}
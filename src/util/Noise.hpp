@@ -0,0 +1,44 @@
+#ifndef NOISE_HPP
+#define NOISE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <util/ThreadPool.hpp>
+
+// Bumped whenever generation changes so cached noise is rebuilt
+constexpr uint32_t NOISE_VERSION = 1;
+constexpr int NOISE_2D_SIZE = 256;
+constexpr int NOISE_3D_SIZE = 64;
+constexpr int BLUE_NOISE_SIZE = 64;
+// Lattice cells across each tileable noise texture, so texture(sampler, p / period) stands in for noise(p)
+constexpr int NOISE_2D_PERIOD = 32;
+constexpr int NOISE_3D_PERIOD = 16;
+
+/*
+Noise the engine precomputes and binds to builtin samplers. Every texture is RGBA8 and tiles seamlessly, with an
+independent noise in each channel.
+*/
+enum class NoiseKind {
+    White,
+    Blue,
+    Value,
+    Perlin,
+    Value3D,
+    Perlin3D,
+    Count,
+};
+
+struct NoiseVolume {
+    int width = 0;
+    int height = 0;
+    // 1 for 2D textures
+    int depth = 1;
+    std::vector<unsigned char> pixels;
+};
+
+const char* GetNoiseUniformName(NoiseKind kind);
+bool IsNoise3D(NoiseKind kind);
+// Generate noise on the calling thread, splitting the work over pool if there is one
+NoiseVolume GenerateNoise(NoiseKind kind, ThreadPool* pool = nullptr);
+
+#endif // !NOISE_HPP
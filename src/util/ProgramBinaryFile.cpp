@@ -0,0 +1,77 @@
+#include <util/ProgramBinaryFile.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <util/Hash.hpp>
+#include <util/Log.hpp>
+#include <util/MappedFile.hpp>
+
+static const char PROGRAM_BINARY_FILE_MAGIC[4] = { 'W', 'P', 'P', 'B' };
+
+struct ProgramBinaryFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+bool WriteProgramBinaryFile(const std::string& path, uint64_t key, const ProgramBinary& binary)
+{
+    ProgramBinaryFileHeader header{};
+    std::memcpy(header.magic, PROGRAM_BINARY_FILE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_BINARY_FILE_VERSION;
+    header.key = key;
+    header.format = binary.format;
+    header.size = binary.data.size();
+
+    // Unique to this thread, validation runs many writers at once
+    std::string temporaryPath = path + "." + HashToHex(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (stream.fail()) {
+            LOG_WARNING("Could not create program binary file {}", path);
+            return false;
+        }
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(binary.data.data()), static_cast<std::streamsize>(binary.data.size()));
+        if (!stream) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool ReadProgramBinaryFile(const std::string& path, uint64_t key, ProgramBinary* out)
+{
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+
+    ProgramBinaryFileHeader header{};
+    if (file.GetSize() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, PROGRAM_BINARY_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != PROGRAM_BINARY_FILE_VERSION
+        || header.key != key) {
+        return false;
+    }
+    if (header.size == 0 || header.size != file.GetSize() - sizeof(header)) {
+        LOG_WARNING("Program binary file {} is truncated or corrupt", path);
+        return false;
+    }
+    out->format = header.format;
+    out->data.assign(file.GetData() + sizeof(header), file.GetData() + file.GetSize());
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef PROGRAM_BINARY_FILE_HPP
+#define PROGRAM_BINARY_FILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bumped whenever the layout, or how programs are linked, changes. Files with any other version are rebuilt.
+constexpr uint32_t PROGRAM_BINARY_FILE_VERSION = 2;
+
+/*
+A linked program as returned by glGetProgramBinary, only meaningful to the driver that produced it
+*/
+struct ProgramBinary {
+    uint32_t format = 0;
+    std::vector<unsigned char> data;
+};
+
+/*
+Program binary files hold a header and the driver's binary, keyed by the hash of the sources and driver the
+program was built from. The file is written under a temporary name and renamed into place, so processes
+building the same program at once never see each other's partial writes.
+*/
+bool WriteProgramBinaryFile(const std::string& path, uint64_t key, const ProgramBinary& binary);
+// False if the file is missing, was built from different sources or is from an older version
+bool ReadProgramBinaryFile(const std::string& path, uint64_t key, ProgramBinary* out);
+
+#endif // !PROGRAM_BINARY_FILE_HPP
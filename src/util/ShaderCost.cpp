@@ -0,0 +1,575 @@
+#include <util/ShaderCost.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <optional>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+double ShaderCost::TotalOps() const
+{
+    return aluOps + transcendentalCalls * TRANSCENDENTAL_OP_WEIGHT + textureFetches * TEXTURE_FETCH_OP_WEIGHT + branches * BRANCH_OP_WEIGHT;
+}
+
+ShaderCost& ShaderCost::operator+=(const ShaderCost& other)
+{
+    aluOps += other.aluOps;
+    transcendentalCalls += other.transcendentalCalls;
+    textureFetches += other.textureFetches;
+    branches += other.branches;
+    loopIterations += other.loopIterations;
+    return *this;
+}
+
+ShaderCost ShaderCost::operator*(double scale) const
+{
+    return ShaderCost{
+        aluOps * scale,
+        transcendentalCalls * scale,
+        textureFetches * scale,
+        branches * scale,
+        loopIterations * scale
+    };
+}
+
+double PredictFrameMilliseconds(const ShaderCost& cost, int width, int height, double gigaOps)
+{
+    double pixels = static_cast<double>(width) * static_cast<double>(height);
+    return cost.TotalOps() * pixels / (gigaOps * 1.0e9) * 1.0e3;
+}
+
+static const std::unordered_set<std::string> TRANSCENDENTAL_FUNCTIONS = {
+    "sin", "cos", "tan", "asin", "acos", "atan", "sinh", "cosh", "tanh",
+    "exp", "exp2", "log", "log2", "pow", "sqrt", "inversesqrt"
+};
+
+static const std::unordered_set<std::string> TEXTURE_FUNCTIONS = {
+    "texture", "textureLod", "textureGrad", "textureOffset", "textureProj", "texelFetch", "texelFetchOffset",
+    "textureGather", "texture2D", "texture3D", "textureCube"
+};
+
+// Constructors and casts that compile down to nothing
+static const std::unordered_set<std::string> FREE_FUNCTIONS = {
+    "float", "int", "uint", "bool", "vec2", "vec3", "vec4", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3", "uvec4",
+    "bvec2", "bvec3", "bvec4", "mat2", "mat3", "mat4", "return"
+};
+
+static const std::unordered_set<std::string> ALU_OPERATORS = {
+    "+", "-", "*", "/", "%", "+=", "-=", "*=", "/=", "++", "--",
+    "<", ">", "<=", ">=", "==", "!=", "&&", "||", "!"
+};
+
+static std::vector<std::string> Tokenize(const std::string& source)
+{
+    static const std::unordered_set<std::string> twoCharOperators = {
+        "++", "--", "+=", "-=", "*=", "/=", "<=", ">=", "==", "!=", "&&", "||"
+    };
+
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < source.size()) {
+        unsigned char c = static_cast<unsigned char>(source[i]);
+        if (std::isspace(c)) {
+            i++;
+        }
+        else if (std::isalpha(c) || c == '_') {
+            size_t start = i;
+            while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_')) {
+                i++;
+            }
+            tokens.push_back(source.substr(start, i - start));
+        }
+        else if (std::isdigit(c) || (c == '.' && i + 1 < source.size() && std::isdigit(static_cast<unsigned char>(source[i + 1])))) {
+            size_t start = i;
+            while (i < source.size()) {
+                char n = source[i];
+                bool exponentSign = (n == '+' || n == '-') && (source[i - 1] == 'e' || source[i - 1] == 'E');
+                if (!std::isalnum(static_cast<unsigned char>(n)) && n != '.' && !exponentSign) {
+                    break;
+                }
+                i++;
+            }
+            tokens.push_back(source.substr(start, i - start));
+        }
+        else if (i + 1 < source.size() && twoCharOperators.contains(source.substr(i, 2))) {
+            tokens.push_back(source.substr(i, 2));
+            i += 2;
+        }
+        else {
+            tokens.push_back(std::string(1, source[i]));
+            i++;
+        }
+    }
+    return tokens;
+}
+
+// Index of the bracket closing the one at index open, or end if it is never closed
+static size_t FindClosing(const std::vector<std::string>& tokens, size_t open, size_t end)
+{
+    const std::string& opening = tokens[open];
+    std::string closing = opening == "(" ? ")" : opening == "{" ? "}" : "]";
+    int depth = 0;
+    for (size_t i = open; i < end; i++) {
+        if (tokens[i] == opening) {
+            depth++;
+        }
+        else if (tokens[i] == closing && --depth == 0) {
+            return i;
+        }
+    }
+    return end;
+}
+
+/*
+Evaluates the arithmetic expressions found in loop headers, following object like #defines. Anything
+else, like a uniform or a function call, makes the expression unknown. Conditions of #if and #elif
+also take comparisons, logical operators and defined(), and read names that aren't defined as 0.
+*/
+class ConstantEvaluator {
+private:
+    const std::unordered_map<std::string, std::string>& mDefines;
+    std::vector<std::string> mTokens;
+    size_t mPos = 0;
+    int mExpansions = 0;
+    bool mCondition = false;
+
+    std::optional<double> Primary() {
+        if (mPos >= mTokens.size()) {
+            return std::nullopt;
+        }
+        std::string token = mTokens[mPos++];
+        if (mCondition && token == "defined") {
+            bool parenthesised = mPos < mTokens.size() && mTokens[mPos] == "(";
+            mPos += parenthesised ? 1 : 0;
+            if (mPos >= mTokens.size()) {
+                return std::nullopt;
+            }
+            bool defined = mDefines.contains(mTokens[mPos++]);
+            if (parenthesised && (mPos >= mTokens.size() || mTokens[mPos++] != ")")) {
+                return std::nullopt;
+            }
+            return defined ? 1.0 : 0.0;
+        }
+        if (mCondition && token == "!") {
+            std::optional<double> value = Primary();
+            return value ? std::optional<double>(*value == 0.0 ? 1.0 : 0.0) : std::nullopt;
+        }
+        if (token == "(") {
+            std::optional<double> value = mCondition ? Or() : Sum();
+            if (mPos >= mTokens.size() || mTokens[mPos++] != ")") {
+                return std::nullopt;
+            }
+            return value;
+        }
+        if (token == "-") {
+            std::optional<double> value = Primary();
+            return value ? std::optional<double>(-*value) : std::nullopt;
+        }
+        if (std::isdigit(static_cast<unsigned char>(token[0])) || token[0] == '.') {
+            return std::strtod(token.c_str(), nullptr);
+        }
+        auto define = mDefines.find(token);
+        if (define == mDefines.end() && mCondition && (std::isalpha(static_cast<unsigned char>(token[0])) || token[0] == '_')) {
+            return 0.0;
+        }
+        if (define == mDefines.end() || ++mExpansions > 32) {
+            return std::nullopt;
+        }
+        // Splice the macro body in place of its name
+        std::vector<std::string> expansion = Tokenize("(" + define->second + ")");
+        mTokens.erase(mTokens.begin() + static_cast<std::ptrdiff_t>(mPos) - 1);
+        mTokens.insert(mTokens.begin() + static_cast<std::ptrdiff_t>(mPos) - 1, expansion.begin(), expansion.end());
+        mPos--;
+        return Primary();
+    }
+
+    std::optional<double> Product() {
+        std::optional<double> value = Primary();
+        while (value && mPos < mTokens.size() && (mTokens[mPos] == "*" || mTokens[mPos] == "/")) {
+            bool multiply = mTokens[mPos++] == "*";
+            std::optional<double> rhs = Primary();
+            if (!rhs || (!multiply && *rhs == 0.0)) {
+                return std::nullopt;
+            }
+            value = multiply ? *value * *rhs : *value / *rhs;
+        }
+        return value;
+    }
+
+    std::optional<double> Sum() {
+        std::optional<double> value = Product();
+        while (value && mPos < mTokens.size() && (mTokens[mPos] == "+" || mTokens[mPos] == "-")) {
+            bool add = mTokens[mPos++] == "+";
+            std::optional<double> rhs = Product();
+            if (!rhs) {
+                return std::nullopt;
+            }
+            value = add ? *value + *rhs : *value - *rhs;
+        }
+        return value;
+    }
+
+    std::optional<double> Comparison() {
+        std::optional<double> value = Sum();
+        while (value && mPos < mTokens.size()) {
+            const std::string& op = mTokens[mPos];
+            if (op != "<" && op != ">" && op != "<=" && op != ">=" && op != "==" && op != "!=") {
+                break;
+            }
+            mPos++;
+            std::optional<double> rhs = Sum();
+            if (!rhs) {
+                return std::nullopt;
+            }
+            bool result = op == "<" ? *value < *rhs : op == ">" ? *value > *rhs : op == "<=" ? *value <= *rhs
+                : op == ">=" ? *value >= *rhs : op == "==" ? *value == *rhs : *value != *rhs;
+            value = result ? 1.0 : 0.0;
+        }
+        return value;
+    }
+
+    std::optional<double> And() {
+        std::optional<double> value = Comparison();
+        while (value && mPos < mTokens.size() && mTokens[mPos] == "&&") {
+            mPos++;
+            std::optional<double> rhs = Comparison();
+            if (!rhs) {
+                return std::nullopt;
+            }
+            value = *value != 0.0 && *rhs != 0.0 ? 1.0 : 0.0;
+        }
+        return value;
+    }
+
+    std::optional<double> Or() {
+        std::optional<double> value = And();
+        while (value && mPos < mTokens.size() && mTokens[mPos] == "||") {
+            mPos++;
+            std::optional<double> rhs = And();
+            if (!rhs) {
+                return std::nullopt;
+            }
+            value = *value != 0.0 || *rhs != 0.0 ? 1.0 : 0.0;
+        }
+        return value;
+    }
+public:
+    ConstantEvaluator(const std::unordered_map<std::string, std::string>& defines) : mDefines(defines) {}
+
+    std::optional<double> Evaluate(std::vector<std::string> tokens) {
+        mTokens = std::move(tokens);
+        mPos = 0;
+        mExpansions = 0;
+        mCondition = false;
+        std::optional<double> value = Sum();
+        return mPos == mTokens.size() ? value : std::nullopt;
+    }
+
+    std::optional<double> EvaluateCondition(std::vector<std::string> tokens) {
+        mTokens = std::move(tokens);
+        mPos = 0;
+        mExpansions = 0;
+        mCondition = true;
+        std::optional<double> value = Or();
+        return mPos == mTokens.size() ? value : std::nullopt;
+    }
+};
+
+// Value of an #if or #elif expression against the defines so far, which include the quality tier's. One that can't be
+// evaluated, such as a function like macro, counts as true so its branch is costed rather than dropped.
+static bool IsConditionTrue(const std::string& expression, const std::unordered_map<std::string, std::string>& defines)
+{
+    ConstantEvaluator evaluator(defines);
+    std::optional<double> value = evaluator.EvaluateCondition(Tokenize(expression));
+    return !value || *value != 0.0;
+}
+
+// Remove comments and resolve #define and the conditionals, returning the remaining source without directives
+static std::string Preprocess(const std::string& source, std::unordered_map<std::string, std::string>& defines)
+{
+    std::string stripped;
+    stripped.reserve(source.size());
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source.compare(i, 2, "//") == 0) {
+            while (i < source.size() && source[i] != '\n') {
+                i++;
+            }
+            stripped += '\n';
+        }
+        else if (source.compare(i, 2, "/*") == 0) {
+            size_t end = source.find("*/", i + 2);
+            i = end == std::string::npos ? source.size() : end + 1;
+            stripped += ' ';
+        }
+        else {
+            stripped += source[i];
+        }
+    }
+
+    std::unordered_set<std::string> externalDefines;
+    for (auto it = defines.begin(); it != defines.end(); ++it) {
+        externalDefines.insert(it->first);
+    }
+
+    std::stringstream in(stripped);
+    std::string out;
+    std::string line;
+    // One entry per open conditional: whether the lines under it are kept, and whether one of its branches already was
+    struct Conditional {
+        bool active = false;
+        bool taken = false;
+    };
+    std::vector<Conditional> conditions;
+    while (std::getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        bool active = conditions.empty() || conditions.back().active;
+        if (start == std::string::npos || line[start] != '#') {
+            if (active) {
+                out += line + "\n";
+            }
+            continue;
+        }
+
+        std::stringstream directive(line.substr(start + 1));
+        std::string keyword;
+        directive >> keyword;
+        std::string expression;
+        std::getline(directive, expression);
+        std::string name;
+        std::stringstream(expression) >> name;
+        bool parentActive = conditions.size() < 2 || conditions[conditions.size() - 2].active;
+        if (keyword == "define" && active) {
+            // Function like macros are skipped, they never decide a trip count in practice
+            if (name.find('(') == std::string::npos && !externalDefines.contains(name)) {
+                defines[name] = expression.substr(expression.find(name) + name.size());
+            }
+        }
+        else if (keyword == "undef" && active && !externalDefines.contains(name)) {
+            defines.erase(name);
+        }
+        else if (keyword == "ifdef" || keyword == "ifndef") {
+            bool defined = defines.contains(name);
+            bool taken = active && (keyword == "ifdef" ? defined : !defined);
+            conditions.push_back({ taken, taken });
+        }
+        else if (keyword == "if") {
+            bool taken = active && IsConditionTrue(expression, defines);
+            conditions.push_back({ taken, taken });
+        }
+        else if (keyword == "elif" && !conditions.empty()) {
+            // The directive's own parent is the one above the conditional it continues
+            Conditional& condition = conditions.back();
+            condition.active = parentActive && !condition.taken && IsConditionTrue(expression, defines);
+            condition.taken = condition.taken || condition.active;
+        }
+        else if (keyword == "else" && !conditions.empty()) {
+            Conditional& condition = conditions.back();
+            condition.active = parentActive && !condition.taken;
+            condition.taken = true;
+        }
+        else if (keyword == "endif" && !conditions.empty()) {
+            conditions.pop_back();
+        }
+    }
+    return out;
+}
+
+class ShaderCostEstimator {
+private:
+    std::vector<std::string> mTokens;
+    std::unordered_map<std::string, std::string> mDefines;
+    // Body token range of every function, overloads share a name and are costed as the most expensive one
+    std::unordered_map<std::string, std::vector<std::pair<size_t, size_t>>> mFunctions;
+    std::unordered_map<std::string, ShaderCost> mFunctionCosts;
+    std::unordered_set<std::string> mInProgress;
+
+    void FindFunctions() {
+        size_t depth = 0;
+        for (size_t i = 0; i + 1 < mTokens.size(); i++) {
+            if (mTokens[i] == "{") {
+                depth++;
+            }
+            else if (mTokens[i] == "}" && depth > 0) {
+                depth--;
+            }
+            else if (depth == 0 && mTokens[i + 1] == "(" && i > 0 && std::isalpha(static_cast<unsigned char>(mTokens[i - 1][0]))) {
+                size_t close = FindClosing(mTokens, i + 1, mTokens.size());
+                if (close + 1 < mTokens.size() && mTokens[close + 1] == "{") {
+                    size_t bodyEnd = FindClosing(mTokens, close + 1, mTokens.size());
+                    mFunctions[mTokens[i]].push_back({ close + 2, bodyEnd });
+                    i = bodyEnd;
+                }
+            }
+        }
+    }
+
+    double TripCount(size_t begin, size_t end) {
+        std::vector<std::vector<std::string>> clauses(1);
+        for (size_t i = begin; i < end; i++) {
+            if (mTokens[i] == ";") {
+                clauses.emplace_back();
+            }
+            else {
+                clauses.back().push_back(mTokens[i]);
+            }
+        }
+        if (clauses.size() != 3) {
+            return DEFAULT_LOOP_TRIP_COUNT;
+        }
+
+        // Initialiser: [type] var = start
+        const std::vector<std::string>& init = clauses[0];
+        auto assign = std::find(init.begin(), init.end(), "=");
+        if (assign == init.end() || assign == init.begin()) {
+            return DEFAULT_LOOP_TRIP_COUNT;
+        }
+        std::string variable = *(assign - 1);
+        ConstantEvaluator evaluator(mDefines);
+        std::optional<double> start = evaluator.Evaluate(std::vector<std::string>(assign + 1, init.end()));
+
+        // Condition: var op limit
+        const std::vector<std::string>& condition = clauses[1];
+        if (condition.size() < 3 || condition[0] != variable) {
+            return DEFAULT_LOOP_TRIP_COUNT;
+        }
+        std::string comparison = condition[1];
+        std::optional<double> limit = evaluator.Evaluate(std::vector<std::string>(condition.begin() + 2, condition.end()));
+
+        // Increment: ++var, var++, var += step and their decrementing forms
+        const std::vector<std::string>& increment = clauses[2];
+        std::optional<double> step;
+        if (increment.size() == 2 && (increment[0] == "++" || increment[1] == "++")) {
+            step = 1.0;
+        }
+        else if (increment.size() == 2 && (increment[0] == "--" || increment[1] == "--")) {
+            step = -1.0;
+        }
+        else if (increment.size() >= 3 && increment[0] == variable && (increment[1] == "+=" || increment[1] == "-=")) {
+            step = evaluator.Evaluate(std::vector<std::string>(increment.begin() + 2, increment.end()));
+            if (step && increment[1] == "-=") {
+                step = -*step;
+            }
+        }
+
+        if (!start || !limit || !step || *step == 0.0) {
+            return DEFAULT_LOOP_TRIP_COUNT;
+        }
+
+        double span = (*limit - *start) / *step;
+        if (comparison == "<" || comparison == ">" || comparison == "!=") {
+            return std::max(std::ceil(span), 0.0);
+        }
+        if (comparison == "<=" || comparison == ">=") {
+            return std::max(std::floor(span) + 1.0, 0.0);
+        }
+        return DEFAULT_LOOP_TRIP_COUNT;
+    }
+
+    // Token range of the statement or block starting at begin, and the index to continue from after it
+    std::pair<size_t, size_t> StatementRange(size_t begin, size_t end) {
+        if (begin < end && mTokens[begin] == "{") {
+            size_t close = FindClosing(mTokens, begin, end);
+            return { begin + 1, close };
+        }
+        size_t i = begin;
+        int depth = 0;
+        while (i < end && !(depth == 0 && mTokens[i] == ";")) {
+            if (mTokens[i] == "(" || mTokens[i] == "{") {
+                depth++;
+            }
+            else if (mTokens[i] == ")" || mTokens[i] == "}") {
+                depth--;
+            }
+            i++;
+        }
+        return { begin, i };
+    }
+
+    ShaderCost CostOfRange(size_t begin, size_t end) {
+        ShaderCost cost{};
+        for (size_t i = begin; i < end; i++) {
+            const std::string& token = mTokens[i];
+
+            if ((token == "for" || token == "while") && i + 1 < end && mTokens[i + 1] == "(") {
+                size_t headerEnd = FindClosing(mTokens, i + 1, end);
+                double trips = token == "for" ? TripCount(i + 2, headerEnd) : DEFAULT_LOOP_TRIP_COUNT;
+                auto [bodyBegin, bodyEnd] = StatementRange(headerEnd + 1, end);
+                ShaderCost iteration = CostOfRange(i + 2, headerEnd);
+                iteration += CostOfRange(bodyBegin, bodyEnd);
+                iteration.loopIterations += 1.0;
+                cost += iteration * trips;
+                i = bodyEnd;
+                continue;
+            }
+            if (token == "do") {
+                auto [bodyBegin, bodyEnd] = StatementRange(i + 1, end);
+                ShaderCost iteration = CostOfRange(bodyBegin, bodyEnd);
+                iteration.loopIterations += 1.0;
+                cost += iteration * DEFAULT_LOOP_TRIP_COUNT;
+                i = bodyEnd;
+                continue;
+            }
+            if (token == "if" || token == "?") {
+                cost.branches += 1.0;
+                continue;
+            }
+            if (ALU_OPERATORS.contains(token)) {
+                cost.aluOps += 1.0;
+                continue;
+            }
+            if (i + 1 < end && mTokens[i + 1] == "(" && std::isalpha(static_cast<unsigned char>(token[0]))) {
+                if (TRANSCENDENTAL_FUNCTIONS.contains(token)) {
+                    cost.transcendentalCalls += 1.0;
+                }
+                else if (TEXTURE_FUNCTIONS.contains(token)) {
+                    cost.textureFetches += 1.0;
+                }
+                else if (mFunctions.contains(token)) {
+                    cost += CostOfFunction(token);
+                }
+                else if (!FREE_FUNCTIONS.contains(token) && token != "while") {
+                    cost.aluOps += 1.0;
+                }
+            }
+        }
+        return cost;
+    }
+
+public:
+    ShaderCostEstimator(const std::string& source, const std::unordered_map<std::string, std::string>& defines) : mDefines(defines) {
+        mTokens = Tokenize(Preprocess(source, mDefines));
+        FindFunctions();
+    }
+
+    ShaderCost CostOfFunction(const std::string& name) {
+        auto cached = mFunctionCosts.find(name);
+        if (cached != mFunctionCosts.end()) {
+            return cached->second;
+        }
+        auto function = mFunctions.find(name);
+        // GLSL forbids recursion, but don't loop forever on a shader that tries it anyway
+        if (function == mFunctions.end() || mInProgress.contains(name)) {
+            return ShaderCost{};
+        }
+
+        mInProgress.insert(name);
+        ShaderCost highest{};
+        for (const auto& [begin, end] : function->second) {
+            ShaderCost overload = CostOfRange(begin, end);
+            if (overload.TotalOps() > highest.TotalOps()) {
+                highest = overload;
+            }
+        }
+        mInProgress.erase(name);
+        mFunctionCosts[name] = highest;
+        return highest;
+    }
+};
+
+ShaderCost EstimateShaderCost(const std::string& source, const std::unordered_map<std::string, std::string>& defines)
+{
+    ShaderCostEstimator estimator(source, defines);
+    return estimator.CostOfFunction("main");
+}
@@ -0,0 +1,49 @@
+#ifndef SHADER_COST_HPP
+#define SHADER_COST_HPP
+
+#include <string>
+#include <unordered_map>
+
+// Rough ALU throughput assumed when turning an op count into time, in billions of operations per second
+constexpr double DEFAULT_GPU_GIGAOPS = 2000.0;
+// Predicted GPU time per frame above which a wallpaper is considered too expensive
+constexpr double DEFAULT_COST_BUDGET_MS = 8.0;
+// Iterations assumed for loops whose trip count can't be worked out statically
+constexpr double DEFAULT_LOOP_TRIP_COUNT = 16.0;
+
+// Relative cost of operations compared to a simple ALU op
+constexpr double TRANSCENDENTAL_OP_WEIGHT = 4.0;
+constexpr double TEXTURE_FETCH_OP_WEIGHT = 8.0;
+constexpr double BRANCH_OP_WEIGHT = 2.0;
+
+/*
+Static estimate of the per pixel work a fragment shader does. Counts are per invocation of main with
+every loop running its full trip count and both sides of every branch taken, so it is an upper bound
+rather than a measurement.
+*/
+struct ShaderCost {
+    double aluOps = 0.0;
+    double transcendentalCalls = 0.0;
+    double textureFetches = 0.0;
+    double branches = 0.0;
+    double loopIterations = 0.0;
+
+    // Approximate ALU op count with transcendental, texture and branch work weighted by their usual cost
+    double TotalOps() const;
+
+    ShaderCost& operator+=(const ShaderCost& other);
+    ShaderCost operator*(double scale) const;
+};
+
+/*
+Estimate the cost of GLSL fragment shader source. Object like #defines are followed when working out
+loop trip counts, and #ifdef/#ifndef/#if/#elif/#else blocks are resolved against them so only the
+branch that would compile is counted. An #if condition that can't be evaluated keeps its first branch.
+Extra defines, such as a quality tier, can be passed in and take precedence over the source.
+*/
+ShaderCost EstimateShaderCost(const std::string& source, const std::unordered_map<std::string, std::string>& defines = {});
+
+// Predicted GPU time in milliseconds to shade one frame at the given resolution
+double PredictFrameMilliseconds(const ShaderCost& cost, int width, int height, double gigaOps = DEFAULT_GPU_GIGAOPS);
+
+#endif // !SHADER_COST_HPP
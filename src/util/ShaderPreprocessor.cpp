@@ -0,0 +1,226 @@
+#include <util/ShaderPreprocessor.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <util/Log.hpp>
+
+// A run of lines from one file, then the file included on the line after them if any
+struct ShaderChunk {
+    std::string text;
+    std::string include;
+    int includeLine = 0;
+};
+
+struct ShaderModule {
+    std::filesystem::file_time_type modifiedTime{};
+    uintmax_t size = 0;
+    std::vector<ShaderChunk> chunks;
+};
+
+// Modules shared by every shader preprocessed in the process, keyed by path
+static std::mutex sModuleMutex;
+static std::unordered_map<std::string, std::shared_ptr<const ShaderModule>> sModules;
+
+// Returns the quoted path of an include directive, or an empty string if the line is not one
+static std::string ParseIncludeDirective(const std::string& line)
+{
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 1, "#") != 0) {
+        return std::string();
+    }
+    size_t directive = line.find_first_not_of(" \t", start + 1);
+    if (directive == std::string::npos || line.compare(directive, 7, "include") != 0) {
+        return std::string();
+    }
+    size_t open = line.find_first_of("\"<", directive + 7);
+    if (open == std::string::npos) {
+        return std::string();
+    }
+    size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+    if (close == std::string::npos) {
+        return std::string();
+    }
+    return line.substr(open + 1, close - open - 1);
+}
+
+static bool ResolveInclude(const std::string& name, const std::filesystem::path& directory, std::string* out)
+{
+    std::error_code error;
+    for (const std::filesystem::path& candidate : { directory / name, std::filesystem::path(name) }) {
+        if (std::filesystem::is_regular_file(candidate, error)) {
+            *out = candidate.lexically_normal().generic_string();
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool SplitChunks(const std::string& source, const std::string& path, int firstLine, std::vector<ShaderChunk>* out)
+{
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::istringstream stream(source);
+    std::string line;
+    ShaderChunk chunk{};
+    for (int lineNumber = firstLine; getline(stream, line); lineNumber++) {
+        std::string name = ParseIncludeDirective(line);
+        if (name.empty()) {
+            chunk.text += line;
+            chunk.text += '\n';
+            continue;
+        }
+        if (!ResolveInclude(name, directory, &chunk.include)) {
+            LOG_ERROR("Could not find {} included from {}:{}", name, path, lineNumber);
+            return false;
+        }
+        chunk.includeLine = lineNumber;
+        out->push_back(std::move(chunk));
+        chunk = ShaderChunk{};
+    }
+    out->push_back(std::move(chunk));
+    return true;
+}
+
+static std::shared_ptr<const ShaderModule> LoadModule(const std::string& path, PreprocessedShader* out)
+{
+    std::error_code error;
+    std::filesystem::file_time_type modifiedTime = std::filesystem::last_write_time(path, error);
+    uintmax_t size = std::filesystem::file_size(path, error);
+    {
+        std::lock_guard<std::mutex> lock(sModuleMutex);
+        auto find = sModules.find(path);
+        if (find != sModules.end() && find->second->modifiedTime == modifiedTime && find->second->size == size) {
+            out->modulesCached++;
+            return find->second;
+        }
+    }
+
+    std::ifstream stream(path);
+    if (stream.fail()) {
+        LOG_ERROR("Failed to open shader module: " + path);
+        return nullptr;
+    }
+    std::stringstream source;
+    source << stream.rdbuf();
+    auto module = std::make_shared<ShaderModule>();
+    module->modifiedTime = modifiedTime;
+    module->size = size;
+    if (!SplitChunks(source.str(), path, 1, &module->chunks)) {
+        return nullptr;
+    }
+    out->modulesParsed++;
+    std::lock_guard<std::mutex> lock(sModuleMutex);
+    sModules[path] = module;
+    return module;
+}
+
+// Write the chunks of one file, expanding each include the first time it is seen
+static bool EmitChunks(const std::vector<ShaderChunk>& chunks, size_t fileIndex, std::unordered_set<std::string>& included, PreprocessedShader* out)
+{
+    for (const ShaderChunk& chunk : chunks) {
+        out->source += chunk.text;
+        if (chunk.include.empty()) {
+            continue;
+        }
+        // Already included files leave a blank line in place of the directive so the line numbers still follow on
+        if (!included.insert(chunk.include).second) {
+            out->source += '\n';
+            continue;
+        }
+        std::shared_ptr<const ShaderModule> module = LoadModule(chunk.include, out);
+        if (module == nullptr) {
+            return false;
+        }
+        size_t moduleIndex = out->files.size();
+        out->files.push_back(chunk.include);
+        out->source += "#line 1 " + std::to_string(moduleIndex) + "\n";
+        if (!EmitChunks(module->chunks, moduleIndex, included, out)) {
+            return false;
+        }
+        out->source += "#line " + std::to_string(chunk.includeLine + 1) + " " + std::to_string(fileIndex) + "\n";
+    }
+    return true;
+}
+
+bool PreprocessShader(const std::string& source, const std::string& path, int firstLine, PreprocessedShader* out)
+{
+    auto start = std::chrono::steady_clock::now();
+    *out = PreprocessedShader{};
+    std::vector<ShaderChunk> chunks;
+    if (!SplitChunks(source, path, firstLine, &chunks)) {
+        return false;
+    }
+    out->files.push_back(std::filesystem::path(path).lexically_normal().generic_string());
+
+    // Nothing may come before #version, so the first line number goes after it
+    ShaderChunk& first = chunks.front();
+    size_t version = first.text.find("#version");
+    size_t versionEnd = version == std::string::npos ? std::string::npos : first.text.find('\n', version);
+    if (versionEnd == std::string::npos) {
+        first.text = "#line " + std::to_string(firstLine) + " 0\n" + first.text;
+    }
+    else {
+        int nextLine = firstLine + static_cast<int>(std::count(first.text.begin(), first.text.begin() + versionEnd, '\n')) + 1;
+        first.text.insert(versionEnd + 1, "#line " + std::to_string(nextLine) + " 0\n");
+    }
+
+    std::unordered_set<std::string> included;
+    included.insert(out->files.front());
+    if (!EmitChunks(chunks, 0, included, out)) {
+        return false;
+    }
+    out->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+std::string AnnotateShaderLog(const std::string& log, const std::vector<std::string>& files)
+{
+    // Drivers start lines with "0(12)", "0:12" or "ERROR: 0:12" where 0 is the source string number
+    static const std::regex location(R"(^((?:ERROR|WARNING): )?(\d{1,6})([:(]\d+))");
+    std::istringstream stream(log);
+    std::string line;
+    std::string annotated;
+    while (getline(stream, line)) {
+        std::smatch match;
+        if (std::regex_search(line, match, location)) {
+            size_t index = std::stoul(match[2].str());
+            if (index < files.size()) {
+                line = match[1].str() + files[index] + match[3].str() + match.suffix().str();
+            }
+        }
+        annotated += line;
+        annotated += '\n';
+    }
+    return annotated;
+}
+
+std::string StripShaderComments(const std::string& source)
+{
+    std::string out;
+    out.reserve(source.size());
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source.compare(i, 2, "//") == 0) {
+            while (i + 1 < source.size() && source[i + 1] != '\n') {
+                i++;
+            }
+            out += ' ';
+        }
+        else if (source.compare(i, 2, "/*") == 0) {
+            size_t end = source.find("*/", i + 2);
+            end = end == std::string::npos ? source.size() : end + 2;
+            out += ' ';
+            out.append(static_cast<size_t>(std::count(source.begin() + static_cast<std::ptrdiff_t>(i), source.begin() + static_cast<std::ptrdiff_t>(end), '\n')), '\n');
+            i = end - 1;
+        }
+        else {
+            out += source[i];
+        }
+    }
+    return out;
+}
@@ -0,0 +1,33 @@
+#ifndef SHADER_PREPROCESSOR_HPP
+#define SHADER_PREPROCESSOR_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct PreprocessedShader {
+    std::string source;
+    // Every file the source was assembled from, the position of each is its source string number in the
+    // #line directives and so in compile errors. The file the shader came from is 0.
+    std::vector<std::string> files;
+    // Included files read from disk this time and those reused from the module cache
+    size_t modulesParsed = 0;
+    size_t modulesCached = 0;
+    double milliseconds = 0.0;
+};
+
+/*
+Expand the #include "path" directives in a shader. Paths are looked up next to the including file, then from the
+working directory where the engine's lib directory is. Every file is included at most once however many times it
+is asked for, so shared modules need no include guards of their own, and #line directives keep compile errors
+pointing at the right line of the right file. Included files are kept in a cache for the life of the process and
+only read again once their modified time or size changes.
+*/
+bool PreprocessShader(const std::string& source, const std::string& path, int firstLine, PreprocessedShader* out);
+// Replace the source string numbers at the start of compile log lines with the names of the files they stand for
+std::string AnnotateShaderLog(const std::string& log, const std::vector<std::string>& files);
+// Replace every comment with a space, keeping the newlines inside block comments so lines don't move, for searching a
+// shader's declarations without matching the text of a comment
+std::string StripShaderComments(const std::string& source);
+
+#endif // !SHADER_PREPROCESSOR_HPP
@@ -0,0 +1,137 @@
+#include <util/TextureFile.hpp>
+#include <cstring>
+#include <iterator>
+#include <fstream>
+#include <util/Log.hpp>
+#include <util/MappedFile.hpp>
+
+static const char TEXTURE_FILE_MAGIC[4] = { 'W', 'P', 'T', 'X' };
+
+struct TextureFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t format;
+    uint32_t levelCount;
+};
+
+struct TextureFileLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static size_t AlignOffset(size_t offset)
+{
+    return (offset + TEXTURE_FILE_ALIGNMENT - 1) / TEXTURE_FILE_ALIGNMENT * TEXTURE_FILE_ALIGNMENT;
+}
+
+size_t TextureLevel::RowBytes() const
+{
+    return static_cast<size_t>(width) * Image::CHANNELS;
+}
+
+bool TexturePayload::Empty() const
+{
+    return levels.empty();
+}
+
+size_t TexturePayload::Bytes() const
+{
+    size_t bytes = 0;
+    for (const TextureLevel& level : levels) {
+        bytes += level.size;
+    }
+    return bytes;
+}
+
+TexturePayload BuildTexturePayload(Image image, const MipOptions& options)
+{
+    std::vector<Image> mips;
+    GenerateMipChain(image, &mips, options);
+    auto images = std::make_shared<std::vector<Image>>();
+    images->reserve(mips.size() + 1);
+    images->push_back(std::move(image));
+    std::move(mips.begin(), mips.end(), std::back_inserter(*images));
+
+    TexturePayload payload{};
+    for (Image& level : *images) {
+        FlipRows(&level);
+        payload.levels.push_back(TextureLevel{ level.width, level.height, level.pixels.data(), level.pixels.size() });
+    }
+    payload.storage = std::move(images);
+    return payload;
+}
+
+bool WriteTextureFile(const std::string& path, uint64_t sourceHash, const TexturePayload& payload)
+{
+    TextureFileHeader header{};
+    std::memcpy(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_FILE_VERSION;
+    header.sourceHash = sourceHash;
+    header.format = static_cast<uint32_t>(payload.format);
+    header.levelCount = static_cast<uint32_t>(payload.levels.size());
+
+    std::vector<TextureFileLevel> table;
+    size_t offset = AlignOffset(sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * payload.levels.size());
+    for (const TextureLevel& level : payload.levels) {
+        table.push_back(TextureFileLevel{ static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height), offset, level.size });
+        offset = AlignOffset(offset + level.size);
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (stream.fail()) {
+        LOG_WARNING("Could not create texture file {}", path);
+        return false;
+    }
+    static const char padding[TEXTURE_FILE_ALIGNMENT] = {};
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(sizeof(TextureFileLevel) * table.size()));
+    size_t written = sizeof(header) + sizeof(TextureFileLevel) * table.size();
+    for (size_t i = 0; i < payload.levels.size(); i++) {
+        stream.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+        stream.write(reinterpret_cast<const char*>(payload.levels[i].pixels), static_cast<std::streamsize>(payload.levels[i].size));
+        written = table[i].offset + table[i].size;
+    }
+    return static_cast<bool>(stream);
+}
+
+bool ReadTextureFile(const std::string& path, uint64_t sourceHash, TexturePayload* out)
+{
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(path)) {
+        return false;
+    }
+
+    TextureFileHeader header{};
+    if (file->GetSize() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file->GetData(), sizeof(header));
+    if (std::memcmp(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != TEXTURE_FILE_VERSION
+        || header.sourceHash != sourceHash || header.format != static_cast<uint32_t>(TextureFileFormat::RGBA8)) {
+        return false;
+    }
+    size_t tableEnd = sizeof(header) + sizeof(TextureFileLevel) * static_cast<size_t>(header.levelCount);
+    if (header.levelCount == 0 || file->GetSize() < tableEnd) {
+        return false;
+    }
+
+    TexturePayload payload{};
+    payload.format = static_cast<TextureFileFormat>(header.format);
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        TextureFileLevel level{};
+        std::memcpy(&level, file->GetData() + sizeof(header) + sizeof(TextureFileLevel) * i, sizeof(level));
+        uint64_t expectedSize = static_cast<uint64_t>(level.width) * level.height * Image::CHANNELS;
+        if (level.size != expectedSize || level.offset > file->GetSize() || level.size > file->GetSize() - level.offset) {
+            LOG_WARNING("Texture file {} is truncated or corrupt", path);
+            return false;
+        }
+        payload.levels.push_back(TextureLevel{ static_cast<int>(level.width), static_cast<int>(level.height),
+            file->GetData() + level.offset, static_cast<size_t>(level.size) });
+    }
+    payload.storage = std::move(file);
+    *out = std::move(payload);
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef TEXTURE_FILE_HPP
+#define TEXTURE_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <util/Image.hpp>
+#include <util/Mipmap.hpp>
+
+// Bumped whenever the layout changes, files with any other version are rebuilt
+constexpr uint32_t TEXTURE_FILE_VERSION = 1;
+// Offset alignment of each level's pixel data inside the file
+constexpr size_t TEXTURE_FILE_ALIGNMENT = 16;
+
+// Pixel layout of the levels in a texture file. Only uncompressed RGBA8 is written so far, the field
+// leaves room for block compressed payloads without another version bump.
+enum class TextureFileFormat : uint32_t {
+    RGBA8 = 0
+};
+
+/*
+One mip level of texture data, rows run from the bottom of the image up as OpenGL expects
+*/
+struct TextureLevel {
+    int width = 0;
+    int height = 0;
+    const unsigned char* pixels = nullptr;
+    size_t size = 0;
+
+    size_t RowBytes() const;
+};
+
+/*
+GPU ready texture data for every mip level. The levels point into storage, which is either decoded images
+in memory or a mapping of a texture file, and stays alive as long as any copy of the payload does.
+*/
+struct TexturePayload {
+    TextureFileFormat format = TextureFileFormat::RGBA8;
+    std::vector<TextureLevel> levels;
+    std::shared_ptr<const void> storage = nullptr;
+
+    bool Empty() const;
+    size_t Bytes() const;
+};
+
+// Build the full mip chain of a decoded image on the CPU and flip it into OpenGL row order
+TexturePayload BuildTexturePayload(Image image, const MipOptions& options = {});
+
+/*
+Texture files hold a header, a table of levels and then the pixel data of each level, so they can be mapped
+and uploaded without any parsing. They are keyed by the hash of the source file they were built from.
+*/
+bool WriteTextureFile(const std::string& path, uint64_t sourceHash, const TexturePayload& payload);
+// Map a texture file, false if it is missing, was built from a different source or is from an older version
+bool ReadTextureFile(const std::string& path, uint64_t sourceHash, TexturePayload* out);
+
+#endif // !TEXTURE_FILE_HPP
@@ -0,0 +1,49 @@
+#include <util/ThreadPool.hpp>
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0) {
+        size_t hardwareThreads = static_cast<size_t>(std::thread::hardware_concurrency());
+        threadCount = std::max(hardwareThreads, static_cast<size_t>(2)) - 1;
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        mThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    for (std::thread& thread : mThreads) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return mThreads.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            // Queued tasks are abandoned on shutdown, their futures report a broken promise
+            if (mStopping) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop();
+        }
+        task();
+    }
+}
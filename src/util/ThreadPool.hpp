@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+Fixed size pool of worker threads for CPU work such as decoding images. Tasks are run in the order they
+are submitted and their results are handed back through futures.
+*/
+class ThreadPool {
+private:
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::queue<std::function<void()>> mTasks;
+    bool mStopping = false;
+
+    void WorkerLoop();
+public:
+    // A thread count of 0 uses one thread per hardware thread, leaving one for the render loop
+    ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+    size_t GetThreadCount() const;
+
+    template<typename F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+        std::future<R> future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.emplace([packaged]() { (*packaged)(); });
+        }
+        mCondition.notify_one();
+        return future;
+    }
+
+    ThreadPool(const ThreadPool& arg) = delete;
+    ThreadPool(const ThreadPool&& arg) = delete;
+    ThreadPool& operator=(const ThreadPool& arg) = delete;
+    ThreadPool& operator=(const ThreadPool&& arg) = delete;
+};
+
+// Returns true if a future has a value ready without blocking
+template<typename T>
+bool IsReady(const std::future<T>& future) {
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+#endif // !THREAD_POOL_HPP
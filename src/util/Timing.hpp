@@ -0,0 +1,37 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+inline double MillisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+inline double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return MillisecondsBetween(start, std::chrono::steady_clock::now());
+}
+
+// Wall clock time of one call of the function
+template<typename F>
+double TimeMilliseconds(F&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return MillisecondsSince(start);
+}
+
+// Median of a set of timings, less noisy than the mean for the handful of runs a benchmark can afford. 0 when there are none
+inline double Median(std::vector<double> timings)
+{
+    if (timings.empty()) {
+        return 0.0;
+    }
+    std::sort(timings.begin(), timings.end());
+    return timings[timings.size() / 2];
+}
+
+#endif // !TIMING_HPP
@@ -0,0 +1,154 @@
+#include <util/TrigramIndex.hpp>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+
+static char FoldCase(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Up to three bytes in the low 24 bits with the length above them, so runs of different lengths never collide
+static uint32_t PackGram(const char* text, size_t length)
+{
+    uint32_t gram = static_cast<uint32_t>(length) << 24;
+    for (size_t i = 0; i < length; i++) {
+        gram |= static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << (8 * (2 - i));
+    }
+    return gram;
+}
+
+// First element of a sorted range not less than value, searching forward from the start in growing steps so that
+// walking one list in step with another costs no more than a merge or a binary search, whichever is cheaper
+static const uint32_t* Gallop(const uint32_t* first, const uint32_t* last, uint32_t value)
+{
+    size_t step = 1;
+    while (static_cast<size_t>(last - first) > step && first[step] < value) {
+        first += step;
+        step *= 2;
+    }
+    return std::lower_bound(first, first + std::min(step + 1, static_cast<size_t>(last - first)), value);
+}
+
+void TrigramIndex::Build(std::vector<std::string> documents)
+{
+    auto start = std::chrono::steady_clock::now();
+    mText.clear();
+    mStarts.clear();
+    mTrigrams.clear();
+    mOffsets.clear();
+    mPostings.clear();
+
+    // Documents are added in id order, so each list comes out sorted without sorting the postings themselves
+    std::unordered_map<uint32_t, std::vector<uint32_t>> lists;
+    std::vector<uint32_t> documentTrigrams;
+    for (size_t id = 0; id < documents.size(); id++) {
+        std::string& text = documents[id];
+        std::transform(text.begin(), text.end(), text.begin(), FoldCase);
+        mStarts.push_back(static_cast<uint32_t>(mText.size()));
+        mText.append(text);
+
+        documentTrigrams.clear();
+        for (size_t i = 0; i < text.size(); i++) {
+            for (size_t length = 1; length <= 3 && i + length <= text.size(); length++) {
+                documentTrigrams.push_back(PackGram(text.data() + i, length));
+            }
+        }
+        std::sort(documentTrigrams.begin(), documentTrigrams.end());
+        documentTrigrams.erase(std::unique(documentTrigrams.begin(), documentTrigrams.end()), documentTrigrams.end());
+        for (uint32_t trigram : documentTrigrams) {
+            lists[trigram].push_back(static_cast<uint32_t>(id));
+        }
+    }
+    mStarts.push_back(static_cast<uint32_t>(mText.size()));
+
+    size_t postingCount = 0;
+    mTrigrams.reserve(lists.size());
+    for (const auto& list : lists) {
+        mTrigrams.push_back(list.first);
+        postingCount += list.second.size();
+    }
+    mPostings.reserve(postingCount);
+    std::sort(mTrigrams.begin(), mTrigrams.end());
+    for (uint32_t trigram : mTrigrams) {
+        const std::vector<uint32_t>& list = lists[trigram];
+        mOffsets.push_back(static_cast<uint32_t>(mPostings.size()));
+        mPostings.insert(mPostings.end(), list.begin(), list.end());
+    }
+    mOffsets.push_back(static_cast<uint32_t>(mPostings.size()));
+    mText.shrink_to_fit();
+    mOffsets.shrink_to_fit();
+
+    mStats = {};
+    mStats.documents = documents.size();
+    mStats.trigrams = mTrigrams.size();
+    mStats.postings = mPostings.size();
+    mStats.bytes = mText.capacity() + sizeof(uint32_t) * (mStarts.capacity() + mTrigrams.capacity() + mOffsets.capacity() + mPostings.capacity());
+    mStats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TrigramIndex::Search(std::string_view query, std::vector<uint32_t>* out) const
+{
+    out->clear();
+    std::string folded(query);
+    std::transform(folded.begin(), folded.end(), folded.begin(), FoldCase);
+    if (folded.empty()) {
+        for (size_t id = 0; id < GetDocumentCount(); id++) {
+            out->push_back(static_cast<uint32_t>(id));
+        }
+        return;
+    }
+    // Posting list of each distinct trigram in the query, any trigram no document has means no matches. Queries of
+    // three bytes or less are a single list which is the answer as it stands.
+    std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+    for (size_t i = 0; i + std::min<size_t>(folded.size(), 3) <= folded.size(); i++) {
+        uint32_t trigram = PackGram(folded.data() + i, std::min<size_t>(folded.size(), 3));
+        auto it = std::lower_bound(mTrigrams.begin(), mTrigrams.end(), trigram);
+        if (it == mTrigrams.end() || *it != trigram) {
+            return;
+        }
+        size_t index = static_cast<size_t>(it - mTrigrams.begin());
+        lists.emplace_back(mPostings.data() + mOffsets[index], mPostings.data() + mOffsets[index + 1]);
+    }
+    if (folded.size() <= 3) {
+        out->assign(lists[0].first, lists[0].second);
+        return;
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+        return a.second - a.first < b.second - b.first;
+    });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    // Walk the shortest list, searching forward through the others so each is only passed over once
+    std::vector<const uint32_t*> cursors;
+    for (size_t i = 1; i < lists.size(); i++) {
+        cursors.push_back(lists[i].first);
+    }
+    for (const uint32_t* candidate = lists[0].first; candidate != lists[0].second; ++candidate) {
+        bool inAll = true;
+        for (size_t i = 0; i < cursors.size() && inAll; i++) {
+            cursors[i] = Gallop(cursors[i], lists[i + 1].second, *candidate);
+            inAll = cursors[i] != lists[i + 1].second && *cursors[i] == *candidate;
+        }
+        // The trigrams can all appear without being next to each other, so the text has the final say
+        if (inAll && GetText(*candidate).find(folded) != std::string_view::npos) {
+            out->push_back(*candidate);
+        }
+    }
+}
+
+std::string_view TrigramIndex::GetText(uint32_t id) const
+{
+    return std::string_view(mText).substr(mStarts[id], mStarts[id + 1] - mStarts[id]);
+}
+
+size_t TrigramIndex::GetDocumentCount() const
+{
+    return mStarts.empty() ? 0 : mStarts.size() - 1;
+}
+
+const TrigramIndexStats& TrigramIndex::GetStats() const
+{
+    return mStats;
+}
@@ -0,0 +1,44 @@
+#ifndef TRIGRAM_INDEX_HPP
+#define TRIGRAM_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct TrigramIndexStats {
+    size_t documents = 0;
+    size_t trigrams = 0;
+    size_t postings = 0;
+    // Everything the index holds, including its lowercase copy of the documents
+    size_t bytes = 0;
+    double buildMilliseconds = 0.0;
+};
+
+/*
+Case insensitive substring search over a fixed set of documents. Every distinct run of three bytes in a document
+is a trigram with a sorted list of the documents containing it. A query only has to check the documents in the
+intersection of its trigrams' lists, so lookups stay fast however many documents there are. Runs of one and two
+bytes are listed too, so shorter queries are a single lookup. Case folding is ASCII only.
+*/
+class TrigramIndex {
+private:
+    // Lowercase copy of every document back to back, used to confirm candidates, and where each one starts
+    std::string mText;
+    std::vector<uint32_t> mStarts;
+    // Sorted trigrams, bigrams and single bytes, and where each one's documents start in mPostings
+    std::vector<uint32_t> mTrigrams;
+    std::vector<uint32_t> mOffsets;
+    std::vector<uint32_t> mPostings;
+    TrigramIndexStats mStats{};
+    std::string_view GetText(uint32_t id) const;
+public:
+    void Build(std::vector<std::string> documents);
+    // Ids of every document containing the query in ascending order, an empty query matches every document
+    void Search(std::string_view query, std::vector<uint32_t>* out) const;
+    size_t GetDocumentCount() const;
+    const TrigramIndexStats& GetStats() const;
+};
+
+#endif // !TRIGRAM_INDEX_HPP
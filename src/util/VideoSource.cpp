@@ -0,0 +1,209 @@
+#include <util/VideoSource.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <util/Image.hpp>
+#include <util/Log.hpp>
+
+bool ImageSequenceSource::Open(const std::string& directory)
+{
+    std::error_code error;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga")) {
+            mPaths.push_back(entry.path().string());
+        }
+    }
+    if (error || mPaths.empty()) {
+        LOG_ERROR("Image sequence {} has no frames", directory);
+        return false;
+    }
+    std::sort(mPaths.begin(), mPaths.end());
+
+    Image first{};
+    if (!LoadImage(mPaths.front(), &first)) {
+        return false;
+    }
+    mWidth = first.width;
+    mHeight = first.height;
+    return true;
+}
+
+bool ImageSequenceSource::ReadFrame(int frame, unsigned char* destination)
+{
+    Image image{};
+    if (!LoadImage(mPaths[static_cast<size_t>(frame)], &image)) {
+        return false;
+    }
+    if (image.width != mWidth || image.height != mHeight) {
+        LOG_ERROR("Frame {} is {}x{}, the sequence is {}x{}", mPaths[static_cast<size_t>(frame)], image.width, image.height, mWidth, mHeight);
+        return false;
+    }
+    size_t rowBytes = image.RowBytes();
+    for (int y = 0; y < mHeight; y++) {
+        std::memcpy(destination + rowBytes * static_cast<size_t>(mHeight - 1 - y), image.pixels.data() + rowBytes * static_cast<size_t>(y), rowBytes);
+    }
+    return true;
+}
+
+int ImageSequenceSource::GetFrameCount() const
+{
+    return static_cast<int>(mPaths.size());
+}
+
+int ImageSequenceSource::GetWidth() const
+{
+    return mWidth;
+}
+
+int ImageSequenceSource::GetHeight() const
+{
+    return mHeight;
+}
+
+double ImageSequenceSource::GetFrameRate() const
+{
+    return 0.0;
+}
+
+// Find the end of the header line starting at offset, or npos if there is none
+static size_t FindLineEnd(const MappedFile& file, size_t offset)
+{
+    const unsigned char* end = static_cast<const unsigned char*>(std::memchr(file.GetData() + offset, '\n', file.GetSize() - offset));
+    return end == nullptr ? std::string::npos : static_cast<size_t>(end - file.GetData());
+}
+
+bool Y4mSource::Open(const std::string& path)
+{
+    if (!mFile.Open(path)) {
+        LOG_ERROR("Could not open video {}", path);
+        return false;
+    }
+    size_t headerEnd = FindLineEnd(mFile, 0);
+    std::string header = headerEnd == std::string::npos ? "" : std::string(reinterpret_cast<const char*>(mFile.GetData()), headerEnd);
+    if (!header.starts_with("YUV4MPEG2 ")) {
+        LOG_ERROR("{} is not a YUV4MPEG2 file", path);
+        return false;
+    }
+
+    std::istringstream tokens(header.substr(10));
+    std::string token;
+    while (tokens >> token) {
+        std::string value = token.substr(1);
+        switch (token[0]) {
+        case 'W': {
+            mWidth = std::atoi(value.c_str());
+            break;
+        }
+        case 'H': {
+            mHeight = std::atoi(value.c_str());
+            break;
+        }
+        case 'F': {
+            size_t colon = value.find(':');
+            double denominator = colon == std::string::npos ? 1.0 : std::atof(value.c_str() + colon + 1);
+            mFrameRate = denominator > 0.0 ? std::atof(value.c_str()) / denominator : 0.0;
+            break;
+        }
+        case 'C': {
+            if (value.starts_with("444")) {
+                mSubsampledChroma = false;
+            }
+            else if (!value.starts_with("420")) {
+                LOG_ERROR("{} uses {} chroma, only 420 and 444 are supported", path, value);
+                return false;
+            }
+            break;
+        }
+        case 'I': {
+            if (value != "p" && value != "?") {
+                LOG_WARNING("{} is interlaced and will be shown as progressive", path);
+            }
+            break;
+        }
+        }
+    }
+    if (mWidth <= 0 || mHeight <= 0) {
+        LOG_ERROR("{} has no frame size", path);
+        return false;
+    }
+
+    // Every frame has a header line that may carry its own parameters, so walk them to find the frames
+    size_t chromaWidth = mSubsampledChroma ? static_cast<size_t>((mWidth + 1) / 2) : static_cast<size_t>(mWidth);
+    size_t chromaHeight = mSubsampledChroma ? static_cast<size_t>((mHeight + 1) / 2) : static_cast<size_t>(mHeight);
+    size_t frameBytes = static_cast<size_t>(mWidth) * static_cast<size_t>(mHeight) + 2 * chromaWidth * chromaHeight;
+    size_t offset = headerEnd + 1;
+    while (offset + 5 <= mFile.GetSize() && std::memcmp(mFile.GetData() + offset, "FRAME", 5) == 0) {
+        size_t lineEnd = FindLineEnd(mFile, offset);
+        if (lineEnd == std::string::npos || lineEnd + 1 + frameBytes > mFile.GetSize()) {
+            break;
+        }
+        mFrameOffsets.push_back(lineEnd + 1);
+        offset = lineEnd + 1 + frameBytes;
+    }
+    if (mFrameOffsets.empty()) {
+        LOG_ERROR("{} has no complete frames", path);
+        return false;
+    }
+    return true;
+}
+
+bool Y4mSource::ReadFrame(int frame, unsigned char* destination)
+{
+    const unsigned char* luma = mFile.GetData() + mFrameOffsets[static_cast<size_t>(frame)];
+    int chromaWidth = mSubsampledChroma ? (mWidth + 1) / 2 : mWidth;
+    int chromaHeight = mSubsampledChroma ? (mHeight + 1) / 2 : mHeight;
+    const unsigned char* cb = luma + static_cast<size_t>(mWidth) * static_cast<size_t>(mHeight);
+    const unsigned char* cr = cb + static_cast<size_t>(chromaWidth) * static_cast<size_t>(chromaHeight);
+    int shift = mSubsampledChroma ? 1 : 0;
+
+    // BT.601 limited range in 16.16 fixed point
+    for (int y = 0; y < mHeight; y++) {
+        const unsigned char* lumaRow = luma + static_cast<size_t>(y) * static_cast<size_t>(mWidth);
+        const unsigned char* cbRow = cb + static_cast<size_t>(y >> shift) * static_cast<size_t>(chromaWidth);
+        const unsigned char* crRow = cr + static_cast<size_t>(y >> shift) * static_cast<size_t>(chromaWidth);
+        unsigned char* row = destination + static_cast<size_t>(mHeight - 1 - y) * static_cast<size_t>(mWidth) * 4;
+        for (int x = 0; x < mWidth; x++) {
+            int c = (lumaRow[x] - 16) * 76309;
+            int d = cbRow[x >> shift] - 128;
+            int e = crRow[x >> shift] - 128;
+            row[x * 4 + 0] = static_cast<unsigned char>(std::clamp((c + 104597 * e + 32768) >> 16, 0, 255));
+            row[x * 4 + 1] = static_cast<unsigned char>(std::clamp((c - 25675 * d - 53279 * e + 32768) >> 16, 0, 255));
+            row[x * 4 + 2] = static_cast<unsigned char>(std::clamp((c + 132201 * d + 32768) >> 16, 0, 255));
+            row[x * 4 + 3] = 255;
+        }
+    }
+    return true;
+}
+
+int Y4mSource::GetFrameCount() const
+{
+    return static_cast<int>(mFrameOffsets.size());
+}
+
+int Y4mSource::GetWidth() const
+{
+    return mWidth;
+}
+
+int Y4mSource::GetHeight() const
+{
+    return mHeight;
+}
+
+double Y4mSource::GetFrameRate() const
+{
+    return mFrameRate;
+}
+
+std::unique_ptr<VideoSource> OpenVideoSource(const std::string& path)
+{
+    if (std::filesystem::is_directory(path)) {
+        auto source = std::make_unique<ImageSequenceSource>();
+        return source->Open(path) ? std::move(source) : nullptr;
+    }
+    auto source = std::make_unique<Y4mSource>();
+    return source->Open(path) ? std::move(source) : nullptr;
+}
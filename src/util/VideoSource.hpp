@@ -0,0 +1,66 @@
+#ifndef VIDEO_SOURCE_HPP
+#define VIDEO_SOURCE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <util/MappedFile.hpp>
+
+/*
+Random access source of video frames, decoded to RGBA8 with rows running bottom up as OpenGL expects.
+ReadFrame is called from a decode thread but never from two threads at once.
+*/
+class VideoSource {
+public:
+    virtual ~VideoSource() = default;
+    // Decode a frame into width * height * 4 bytes of destination
+    virtual bool ReadFrame(int frame, unsigned char* destination) = 0;
+    virtual int GetFrameCount() const = 0;
+    virtual int GetWidth() const = 0;
+    virtual int GetHeight() const = 0;
+    // Frames per second stored in the file, 0 if it doesn't have one
+    virtual double GetFrameRate() const = 0;
+};
+
+/*
+A directory of still images played back in file name order. Every image must be the size of the first.
+*/
+class ImageSequenceSource : public VideoSource {
+private:
+    std::vector<std::string> mPaths;
+    int mWidth = 0;
+    int mHeight = 0;
+public:
+    bool Open(const std::string& directory);
+    bool ReadFrame(int frame, unsigned char* destination) override;
+    int GetFrameCount() const override;
+    int GetWidth() const override;
+    int GetHeight() const override;
+    double GetFrameRate() const override;
+};
+
+/*
+Uncompressed YUV4MPEG2 stream with 4:2:0 or 4:4:4 chroma. The file is mapped and indexed when opened so
+frames can be read in any order, and converted from BT.601 limited range YUV to RGB as they are read.
+*/
+class Y4mSource : public VideoSource {
+private:
+    MappedFile mFile;
+    std::vector<size_t> mFrameOffsets;
+    int mWidth = 0;
+    int mHeight = 0;
+    bool mSubsampledChroma = true;
+    double mFrameRate = 0.0;
+public:
+    bool Open(const std::string& path);
+    bool ReadFrame(int frame, unsigned char* destination) override;
+    int GetFrameCount() const override;
+    int GetWidth() const override;
+    int GetHeight() const override;
+    double GetFrameRate() const override;
+};
+
+// Open a .y4m file, or a directory as an image sequence
+std::unique_ptr<VideoSource> OpenVideoSource(const std::string& path);
+
+#endif // !VIDEO_SOURCE_HPP
@@ -0,0 +1,163 @@
+#include <util/VirtualTextureFile.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <util/Log.hpp>
+
+static const char VIRTUAL_TEXTURE_FILE_MAGIC[4] = { 'W', 'P', 'V', 'T' };
+// Tile data starts on a page boundary so tiles map cleanly
+constexpr size_t VIRTUAL_TEXTURE_DATA_ALIGNMENT = 4096;
+
+struct VirtualTextureFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileSize;
+    uint32_t tileBorder;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+static size_t GetDataOffset(size_t levelCount)
+{
+    size_t tableEnd = sizeof(VirtualTextureFileHeader) + sizeof(uint32_t) * 4 * levelCount;
+    return (tableEnd + VIRTUAL_TEXTURE_DATA_ALIGNMENT - 1) / VIRTUAL_TEXTURE_DATA_ALIGNMENT * VIRTUAL_TEXTURE_DATA_ALIGNMENT;
+}
+
+std::vector<VirtualLevel> GetVirtualLevels(int width, int height)
+{
+    std::vector<VirtualLevel> levels;
+    size_t firstTile = 0;
+    while (true) {
+        VirtualLevel level{};
+        level.width = width;
+        level.height = height;
+        level.tilesX = (width + VIRTUAL_TILE_SIZE - 1) / VIRTUAL_TILE_SIZE;
+        level.tilesY = (height + VIRTUAL_TILE_SIZE - 1) / VIRTUAL_TILE_SIZE;
+        level.firstTile = firstTile;
+        firstTile += static_cast<size_t>(level.tilesX) * static_cast<size_t>(level.tilesY);
+        levels.push_back(level);
+        if (level.tilesX == 1 && level.tilesY == 1) {
+            return levels;
+        }
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+}
+
+bool VirtualTextureFile::Open(const std::string& path)
+{
+    if (!mFile.Open(path)) {
+        LOG_ERROR("Could not open virtual texture {}", path);
+        return false;
+    }
+
+    VirtualTextureFileHeader header{};
+    if (mFile.GetSize() < sizeof(header)) {
+        LOG_ERROR("Virtual texture {} is truncated", path);
+        return false;
+    }
+    std::memcpy(&header, mFile.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, VIRTUAL_TEXTURE_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != VIRTUAL_TEXTURE_FILE_VERSION) {
+        LOG_ERROR("{} is not a version {} virtual texture", path, VIRTUAL_TEXTURE_FILE_VERSION);
+        return false;
+    }
+    if (header.tileSize != VIRTUAL_TILE_SIZE || header.tileBorder != VIRTUAL_TILE_BORDER || header.width == 0 || header.height == 0) {
+        LOG_ERROR("Virtual texture {} was built with {} pixel tiles, {} are expected", path, header.tileSize, VIRTUAL_TILE_SIZE);
+        return false;
+    }
+
+    // The level table is fully determined by the size, so it is rebuilt rather than trusted
+    mWidth = static_cast<int>(header.width);
+    mHeight = static_cast<int>(header.height);
+    mLevels = GetVirtualLevels(mWidth, mHeight);
+    mDataOffset = GetDataOffset(mLevels.size());
+    const VirtualLevel& last = mLevels.back();
+    size_t tileCount = last.firstTile + static_cast<size_t>(last.tilesX) * static_cast<size_t>(last.tilesY);
+    if (header.levelCount != mLevels.size() || mFile.GetSize() < mDataOffset + tileCount * GetTileBytes()) {
+        LOG_ERROR("Virtual texture {} is truncated or corrupt", path);
+        mLevels.clear();
+        return false;
+    }
+    return true;
+}
+
+int VirtualTextureFile::GetWidth() const
+{
+    return mWidth;
+}
+
+int VirtualTextureFile::GetHeight() const
+{
+    return mHeight;
+}
+
+const std::vector<VirtualLevel>& VirtualTextureFile::GetLevels() const
+{
+    return mLevels;
+}
+
+const unsigned char* VirtualTextureFile::GetTile(int level, int x, int y) const
+{
+    const VirtualLevel& virtualLevel = mLevels[static_cast<size_t>(level)];
+    size_t index = virtualLevel.firstTile + static_cast<size_t>(y) * static_cast<size_t>(virtualLevel.tilesX) + static_cast<size_t>(x);
+    return mFile.GetData() + mDataOffset + index * GetTileBytes();
+}
+
+size_t VirtualTextureFile::GetTileBytes()
+{
+    return static_cast<size_t>(VIRTUAL_PAGE_SIZE) * VIRTUAL_PAGE_SIZE * Image::CHANNELS;
+}
+
+bool WriteVirtualTextureFile(const std::string& path, Image image, const MipOptions& options)
+{
+    std::vector<VirtualLevel> levels = GetVirtualLevels(image.width, image.height);
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (stream.fail()) {
+        LOG_ERROR("Could not create virtual texture {}", path);
+        return false;
+    }
+    VirtualTextureFileHeader header{};
+    std::memcpy(header.magic, VIRTUAL_TEXTURE_FILE_MAGIC, sizeof(header.magic));
+    header.version = VIRTUAL_TEXTURE_FILE_VERSION;
+    header.width = static_cast<uint32_t>(image.width);
+    header.height = static_cast<uint32_t>(image.height);
+    header.tileSize = VIRTUAL_TILE_SIZE;
+    header.tileBorder = VIRTUAL_TILE_BORDER;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const VirtualLevel& level : levels) {
+        uint32_t entry[4] = { static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height),
+            static_cast<uint32_t>(level.tilesX), static_cast<uint32_t>(level.tilesY) };
+        stream.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+    }
+    std::vector<char> padding(GetDataOffset(levels.size()) - static_cast<size_t>(stream.tellp()));
+    stream.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+
+    // Tiles are stored bottom up like every other texture
+    FlipRows(&image);
+    std::vector<unsigned char> tile(VirtualTextureFile::GetTileBytes());
+    for (size_t levelIndex = 0; levelIndex < levels.size(); levelIndex++) {
+        const VirtualLevel& level = levels[levelIndex];
+        for (int tileY = 0; tileY < level.tilesY; tileY++) {
+            for (int tileX = 0; tileX < level.tilesX; tileX++) {
+                // Pixels past the edge of the image, including the outer border, repeat the edge pixel
+                for (int y = 0; y < VIRTUAL_PAGE_SIZE; y++) {
+                    int sourceY = std::clamp(tileY * VIRTUAL_TILE_SIZE - VIRTUAL_TILE_BORDER + y, 0, image.height - 1);
+                    for (int x = 0; x < VIRTUAL_PAGE_SIZE; x++) {
+                        int sourceX = std::clamp(tileX * VIRTUAL_TILE_SIZE - VIRTUAL_TILE_BORDER + x, 0, image.width - 1);
+                        const unsigned char* source = image.pixels.data() + image.RowBytes() * static_cast<size_t>(sourceY) + static_cast<size_t>(sourceX) * Image::CHANNELS;
+                        std::copy(source, source + Image::CHANNELS, tile.data() + (static_cast<size_t>(y) * VIRTUAL_PAGE_SIZE + static_cast<size_t>(x)) * Image::CHANNELS);
+                    }
+                }
+                stream.write(reinterpret_cast<const char*>(tile.data()), static_cast<std::streamsize>(tile.size()));
+            }
+        }
+        if (levelIndex + 1 < levels.size()) {
+            image = DownsampleImage(image, options);
+        }
+    }
+    return static_cast<bool>(stream);
+}
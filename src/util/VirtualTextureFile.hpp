@@ -0,0 +1,58 @@
+#ifndef VIRTUAL_TEXTURE_FILE_HPP
+#define VIRTUAL_TEXTURE_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <util/Image.hpp>
+#include <util/MappedFile.hpp>
+#include <util/Mipmap.hpp>
+
+// Bumped whenever the layout changes, files with any other version are rejected
+constexpr uint32_t VIRTUAL_TEXTURE_FILE_VERSION = 1;
+// Pixels of image in each tile, shared with the GLSL library so it can't be chosen per file
+constexpr int VIRTUAL_TILE_SIZE = 128;
+// Pixels copied from the neighbouring tiles around each tile, so bilinear filtering never reads another page
+constexpr int VIRTUAL_TILE_BORDER = 1;
+constexpr int VIRTUAL_PAGE_SIZE = VIRTUAL_TILE_SIZE + 2 * VIRTUAL_TILE_BORDER;
+
+struct VirtualLevel {
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    // Index of the level's first tile in the file
+    size_t firstTile = 0;
+};
+
+/*
+A pre-tiled image with its mip chain. Every tile is VIRTUAL_PAGE_SIZE square, RGBA8 with rows running bottom
+up, and the tile grid of every level starts at the bottom left. Levels stop at the first one that fits in a
+single tile. The file is mapped rather than read, so only the tiles that are actually streamed are ever paged
+in and opening a huge image costs nothing up front.
+*/
+class VirtualTextureFile {
+private:
+    MappedFile mFile;
+    int mWidth = 0;
+    int mHeight = 0;
+    std::vector<VirtualLevel> mLevels;
+    size_t mDataOffset = 0;
+public:
+    bool Open(const std::string& path);
+    int GetWidth() const;
+    int GetHeight() const;
+    const std::vector<VirtualLevel>& GetLevels() const;
+    // Pixels of one tile inside the mapping, VIRTUAL_PAGE_SIZE * VIRTUAL_PAGE_SIZE * 4 bytes
+    const unsigned char* GetTile(int level, int x, int y) const;
+    static size_t GetTileBytes();
+};
+
+// Level sizes and tile counts of a virtual texture of the given size
+std::vector<VirtualLevel> GetVirtualLevels(int width, int height);
+
+// Cut a decoded image and its mip chain into a tile file, holding only two levels in memory at a time
+bool WriteVirtualTextureFile(const std::string& path, Image image, const MipOptions& options = {});
+
+#endif // !VIRTUAL_TEXTURE_FILE_HPP
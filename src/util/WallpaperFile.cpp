@@ -0,0 +1,88 @@
+#include <fstream>
+#include <sstream>
+#include <util/Log.hpp>
+#include <util/ShaderPreprocessor.hpp>
+#include <util/WallpaperFile.hpp>
+
+bool ParseWallpaperSource(const std::string& path, WallpaperSources* out)
+{
+    std::ifstream stream(path);
+
+    if (stream.fail()) {
+        LOG_ERROR("Failed to open wallpaper: " + path);
+        return false;
+    }
+
+    std::stringstream source;
+    source << stream.rdbuf();
+    if (!SplitWallpaperSource(source.str(), out)) {
+        return false;
+    }
+
+    PreprocessedShader shader{};
+    if (!PreprocessShader(out->fragmentShaderSource, path, out->fragmentShaderLine, &shader)) {
+        LOG_ERROR("Failed to resolve the includes of wallpaper: " + path);
+        return false;
+    }
+    if (shader.files.size() > 1) {
+        LOG_TRACE("Expanded {} include(s) of {} in {:.2f} ms, {} read and {} cached", shader.files.size() - 1, path,
+            shader.milliseconds, shader.modulesParsed, shader.modulesCached);
+    }
+    out->fragmentShaderSource = std::move(shader.source);
+    out->shaderFiles = std::move(shader.files);
+    return true;
+}
+
+bool SplitWallpaperSource(const std::string& source, WallpaperSources* out)
+{
+    std::istringstream stream(source);
+    std::string line;
+    std::stringstream ss[2];
+    WallpaperSection type = WallpaperSection::NONE;
+
+    bool foundShaderSection = false;
+    int shaderLine = 1;
+
+    for (int lineNumber = 1; getline(stream, line); lineNumber++) {
+        if (line.find("#section") != std::string::npos) {
+            if (line.find("metadata") != std::string::npos) {
+                type = WallpaperSection::METADATA;
+            }
+            else if (line.find("shader") != std::string::npos) {
+                foundShaderSection = true;
+                shaderLine = lineNumber + 1;
+                type = WallpaperSection::SHADER;
+            }
+        }
+        else if (type != WallpaperSection::NONE) {
+            ss[static_cast<int>(type)] << line << "\n";
+        }
+    }
+
+    if (!foundShaderSection) {
+        LOG_ERROR("Wallpaper file must contain #section shader!");
+        return false;
+    }
+
+    *out = {
+        ss[static_cast<int>(WallpaperSection::METADATA)].str(),
+        ss[static_cast<int>(WallpaperSection::SHADER)].str(),
+        shaderLine,
+        {}
+    };
+    return true;
+}
+
+std::string InjectDefine(const std::string& source, const std::string& name, const std::string& value)
+{
+    std::string define = "#define " + name + " " + value + "\n";
+    size_t version = source.find("#version");
+    if (version == std::string::npos) {
+        return define + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + define;
+    }
+    return source.substr(0, lineEnd + 1) + define + source.substr(lineEnd + 1);
+}
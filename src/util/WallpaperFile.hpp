@@ -0,0 +1,29 @@
+#ifndef WALLPAPER_FILE_HPP
+#define WALLPAPER_FILE_HPP
+
+#include <string>
+#include <vector>
+
+enum WallpaperSection {
+    NONE = -1,
+    METADATA = 0,
+    SHADER = 1
+};
+
+struct WallpaperSources {
+    std::string metadataYamlSource;
+    std::string fragmentShaderSource;
+    // Line of the wallpaper file the shader section starts on
+    int fragmentShaderLine = 1;
+    // The wallpaper file and then every file its shader includes, in the order of their source string numbers
+    std::vector<std::string> shaderFiles;
+};
+
+// Split a .wallpaper file into its metadata yaml and fragment shader sections, expanding the shader's includes
+bool ParseWallpaperSource(const std::string& path, WallpaperSources* out);
+// Split the contents of a .wallpaper file already read into memory, leaving includes as they are
+bool SplitWallpaperSource(const std::string& source, WallpaperSources* out);
+// Insert "#define <name> <value>" after the #version directive, which has to stay the first line of the shader
+std::string InjectDefine(const std::string& source, const std::string& name, const std::string& value);
+
+#endif // !WALLPAPER_FILE_HPP